@@ -0,0 +1,175 @@
+#include "clock_sync.h"
+
+// Plain C++ only so the estimator can be exercised off-target
+
+// Samples slower than the best round trip by more than this are dropped
+static const int64_t MAX_EXTRA_DELAY_US = 2000;
+// Drift is measured against an anchor once the baseline is long enough
+// for millisecond-level jitter to stop dominating the slope
+static const int64_t MIN_DRIFT_SPAN_US = 30LL * 1000000LL;      // 30 seconds
+static const int64_t MAX_DRIFT_SPAN_US = 15LL * 60LL * 1000000LL; // 15 minutes
+// Anything beyond a bad crystal is treated as noise
+static const double MAX_DRIFT = 500e-6; // 500 ppm
+
+struct OffsetSample
+{
+    int64_t deviceUs; // Midpoint of t2/t3
+    int64_t offsetUs; // Host minus device
+    int64_t delayUs;  // Round trip excluding device turnaround
+};
+
+static OffsetSample window[CLOCK_SYNC_WINDOW];
+static int windowCount = 0;
+static int windowNext = 0;
+
+// Current model: host = device + offset + drift * (device - reference)
+static bool modelValid = false;
+static int64_t modelReferenceUs = 0;
+static int64_t modelOffsetUs = 0;
+static double modelDrift = 0.0;
+static int64_t modelDelayUs = 0;
+
+// Earlier offset estimate used as the long baseline for drift
+static bool anchorValid = false;
+static int64_t anchorDeviceUs = 0;
+static int64_t anchorOffsetUs = 0;
+
+// Last ping answered by the device, waiting for the host's t4
+static bool pendingValid = false;
+static uint32_t pendingSeq = 0;
+static int64_t pendingT1 = 0;
+static int64_t pendingT2 = 0;
+static int64_t pendingT3 = 0;
+
+static void refitModel()
+{
+    int64_t bestDelay = window[0].delayUs;
+    for (int i = 1; i < windowCount; i++)
+    {
+        if (window[i].delayUs < bestDelay)
+            bestDelay = window[i].delayUs;
+    }
+
+    // Asymmetric delay biases the offset by up to delay/2, so only the
+    // fastest exchanges are trusted
+    int64_t delayLimit = bestDelay + MAX_EXTRA_DELAY_US;
+    int64_t reference = window[(windowNext + CLOCK_SYNC_WINDOW - 1) % CLOCK_SYNC_WINDOW].deviceUs;
+
+    // Project each trusted offset to the reference using the current drift
+    int n = 0;
+    double sum = 0.0;
+    for (int i = 0; i < windowCount; i++)
+    {
+        if (window[i].delayUs > delayLimit)
+            continue;
+
+        double elapsed = (double)(reference - window[i].deviceUs);
+        sum += (double)window[i].offsetUs + modelDrift * elapsed;
+        n++;
+    }
+    int64_t offset = (int64_t)(sum / n);
+
+    if (!anchorValid)
+    {
+        anchorDeviceUs = reference;
+        anchorOffsetUs = offset;
+        anchorValid = true;
+    }
+
+    int64_t span = reference - anchorDeviceUs;
+    if (span >= MIN_DRIFT_SPAN_US)
+    {
+        double drift = (double)(offset - anchorOffsetUs) / (double)span;
+        if (drift > MAX_DRIFT)
+            drift = MAX_DRIFT;
+        if (drift < -MAX_DRIFT)
+            drift = -MAX_DRIFT;
+        modelDrift = drift;
+
+        // Slide the baseline forward so temperature-driven drift changes
+        // are still followed
+        if (span >= MAX_DRIFT_SPAN_US)
+        {
+            anchorDeviceUs = reference;
+            anchorOffsetUs = offset;
+        }
+    }
+
+    modelReferenceUs = reference;
+    modelOffsetUs = offset;
+    modelDelayUs = bestDelay;
+    modelValid = true;
+}
+
+void clockSyncReset()
+{
+    windowCount = 0;
+    windowNext = 0;
+    modelValid = false;
+    modelDrift = 0.0;
+    anchorValid = false;
+    pendingValid = false;
+}
+
+void clockSyncRecordPing(uint32_t seq, int64_t t1, int64_t t2, int64_t t3)
+{
+    pendingSeq = seq;
+    pendingT1 = t1;
+    pendingT2 = t2;
+    pendingT3 = t3;
+    pendingValid = true;
+}
+
+bool clockSyncCompletePing(uint32_t seq, int64_t t4)
+{
+    if (!pendingValid || seq != pendingSeq)
+        return false;
+
+    pendingValid = false;
+    clockSyncAddExchange({pendingT1, pendingT2, pendingT3, t4});
+    return true;
+}
+
+void clockSyncAddExchange(const ClockSyncExchange &exchange)
+{
+    int64_t delay = (exchange.t4 - exchange.t1) - (exchange.t3 - exchange.t2);
+    if (delay < 0)
+        return; // Host clock stepped mid-exchange
+
+    OffsetSample &sample = window[windowNext];
+    sample.deviceUs = exchange.t2 + (exchange.t3 - exchange.t2) / 2;
+    sample.offsetUs = ((exchange.t1 - exchange.t2) + (exchange.t4 - exchange.t3)) / 2;
+    sample.delayUs = delay;
+
+    windowNext = (windowNext + 1) % CLOCK_SYNC_WINDOW;
+    if (windowCount < CLOCK_SYNC_WINDOW)
+        windowCount++;
+
+    refitModel();
+}
+
+bool clockSyncValid()
+{
+    return modelValid;
+}
+
+int64_t clockSyncToHostUs(int64_t deviceUs)
+{
+    int64_t elapsed = deviceUs - modelReferenceUs;
+    return deviceUs + modelOffsetUs + (int64_t)(modelDrift * (double)elapsed);
+}
+
+int64_t clockSyncOffsetUs()
+{
+    return modelOffsetUs;
+}
+
+float clockSyncDriftPpm()
+{
+    return (float)(modelDrift * 1e6);
+}
+
+int64_t clockSyncRoundTripUs()
+{
+    return modelDelayUs;
+}
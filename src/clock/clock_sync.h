@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+
+// Number of ping exchanges kept for the offset/drift fit
+#define CLOCK_SYNC_WINDOW 8
+
+// One NTP-style ping over the serial command channel (microseconds)
+struct ClockSyncExchange
+{
+    int64_t t1; // Host send (host epoch)
+    int64_t t2; // Device receive (device uptime)
+    int64_t t3; // Device reply (device uptime)
+    int64_t t4; // Host receive (host epoch)
+};
+
+void clockSyncReset();
+void clockSyncRecordPing(uint32_t seq, int64_t t1, int64_t t2, int64_t t3);
+bool clockSyncCompletePing(uint32_t seq, int64_t t4);
+void clockSyncAddExchange(const ClockSyncExchange &exchange);
+bool clockSyncValid();
+int64_t clockSyncToHostUs(int64_t deviceUs);
+int64_t clockSyncOffsetUs();
+float clockSyncDriftPpm();
+int64_t clockSyncRoundTripUs();
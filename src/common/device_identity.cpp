@@ -0,0 +1,22 @@
+#include <Arduino.h>
+#include "device_identity.h"
+
+static char serialNumber[20] = "";
+static char shortId[8] = "";
+
+void deviceIdentityBegin()
+{
+    uint64_t mac = ESP.getEfuseMac();
+    snprintf(serialNumber, sizeof(serialNumber), "P61-%012llX", (unsigned long long)mac);
+    snprintf(shortId, sizeof(shortId), "%06X", (unsigned)(mac & 0xFFFFFF));
+}
+
+const char *deviceSerialNumber()
+{
+    return serialNumber;
+}
+
+const char *deviceShortId()
+{
+    return shortId;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// Serial number and short ID derived from the eFuse MAC. Set once in
+// setup() before any other task starts and read-only after that, so every
+// task may read them without locking.
+void deviceIdentityBegin();
+
+// "P61-" and the full MAC; the device_id of every frame
+const char *deviceSerialNumber();
+
+// Low three MAC bytes; shown in the setup AP name and device_info
+const char *deviceShortId();
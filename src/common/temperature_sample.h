@@ -0,0 +1,16 @@
+#pragma once
+#include <stdint.h>
+
+// Maximum number of thermocouple channels on the board
+#define MAX_THERMOCOUPLE_CHANNELS 4
+
+// One acquisition pass across all active thermocouple channels
+struct TemperatureSample
+{
+    unsigned long timestamp; // millis() at acquisition
+    uint32_t calibrationId;  // CalibrationSet::id applied, 0 = raw
+    int64_t deviceTimeUs;    // esp_timer_get_time() at acquisition
+    uint8_t channelCount;
+    float temperatureC[MAX_THERMOCOUPLE_CHANNELS];
+    uint8_t fault[MAX_THERMOCOUPLE_CHANNELS]; // CHANNEL_FAULT_* bits, 0 = ok
+};
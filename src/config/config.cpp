@@ -15,4 +15,6 @@ const char *LATEST_RELEASE_URL = "https://api.github.com/repos/ayovev/firmware-f
 const char *DEVICE_MODEL = "P61";
 const char *AP_PASSWORD = "";                                           // Open network for easy setup
 const unsigned long WIFI_CHECK_INTERVAL = 30000UL;                      // 30 seconds
-const unsigned long UPDATE_CHECK_INTERVAL = 6UL * 60UL * 60UL * 1000UL; // 6 hours
\ No newline at end of file
+const unsigned long UPDATE_CHECK_INTERVAL = 6UL * 60UL * 60UL * 1000UL; // 6 hours
+const float ROAST_ACTIVITY_THRESHOLD_C = 50.0f;                         // Any probe above this = roaster in use
+const unsigned long POWER_IDLE_DELAY_MS = 60000UL;                      // 60 seconds without activity before scaling down
\ No newline at end of file
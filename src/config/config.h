@@ -11,3 +11,5 @@ extern const char *DEVICE_MODEL;
 extern const char *AP_PASSWORD;
 extern const unsigned long WIFI_CHECK_INTERVAL;
 extern const unsigned long UPDATE_CHECK_INTERVAL;
+extern const float ROAST_ACTIVITY_THRESHOLD_C;
+extern const unsigned long POWER_IDLE_DELAY_MS;
@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+#include <ArduinoJson.h>
+#include "protocol/protocol.h"
+
+// Benchmark kernels with no Arduino or ESP-IDF dependencies, so the same
+// code runs on the device and in tools/bench_host.cpp for a Linux baseline
+
+#define BENCH_MAX_ITERATIONS 128
+
+struct BenchResult
+{
+    const char *name;
+    uint16_t iterations; // 0 = kernel could not run
+    float minUs;
+    float medianUs;
+    float p99Us;
+    uint32_t bytes; // Per iteration, for throughput; 0 if not applicable
+};
+
+int64_t benchNowUs();
+
+// Sorts samplesUs in place and reduces it to min/median/p99
+BenchResult benchSummarize(const char *name, float *samplesUs, uint16_t count, uint32_t bytes);
+
+// Appends one result object; returns it so callers can add fields
+JsonObject writeBenchResult(JsonArray results, const BenchResult &result);
+
+// Scratch space for per-iteration timings; kernels run one at a time
+float *benchSamples();
+
+BenchResult benchSerializeFrame(const DataMessage &frame, uint16_t iterations);
+BenchResult benchSha256(uint16_t iterations);
+BenchResult benchRsaVerify(const char *publicKeyPem, uint16_t iterations);
@@ -0,0 +1,123 @@
+#include <SPI.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include "benchmark.h"
+#include "bench_kernels.h"
+#include "config/config.h"
+#include "ota/ota_update.h"
+
+static const uint16_t SPI_ITERATIONS = 100;
+static const uint16_t SERIALIZE_ITERATIONS = 100;
+static const uint16_t NVS_ITERATIONS = 20;
+static const uint16_t SHA_ITERATIONS = 32;
+static const uint16_t RSA_ITERATIONS = 16;
+
+// The MAX31855 driver's own bus settings, so the timing matches a real read
+static const uint32_t SPI_CLOCK_HZ = 1000000;
+
+// Flash test region: the tail of the inactive OTA slot. Images are well
+// under the 6.4 MB slot, so this never touches a previous firmware.
+static const size_t FLASH_REGION = 64 * 1024;
+static const size_t FLASH_SECTOR = 4096;
+
+static const char *const spiNames[] = {"spi_read_ch1", "spi_read_ch2", "spi_read_ch3", "spi_read_ch4"};
+
+static BenchResult benchSpiRead(const char *name, uint8_t csPin)
+{
+    float *samples = benchSamples();
+    pinMode(csPin, OUTPUT);
+    digitalWrite(csPin, HIGH);
+
+    // One full 32-bit conversion frame, chip select to chip select
+    for (uint16_t i = 0; i < SPI_ITERATIONS; i++)
+    {
+        int64_t start = benchNowUs();
+        SPI.beginTransaction(SPISettings(SPI_CLOCK_HZ, MSBFIRST, SPI_MODE0));
+        digitalWrite(csPin, LOW);
+        SPI.transfer32(0);
+        digitalWrite(csPin, HIGH);
+        SPI.endTransaction();
+        samples[i] = benchNowUs() - start;
+    }
+    return benchSummarize(name, samples, SPI_ITERATIONS, 0);
+}
+
+static BenchResult benchNvsWrite()
+{
+    float *samples = benchSamples();
+    Preferences bench;
+    if (!bench.begin("bench", false))
+        return benchSummarize("nvs_write", samples, 0, 0);
+
+    for (uint16_t i = 0; i < NVS_ITERATIONS; i++)
+    {
+        int64_t start = benchNowUs();
+        bench.putUInt("value", i);
+        samples[i] = benchNowUs() - start;
+    }
+
+    bench.clear();
+    bench.end();
+    return benchSummarize("nvs_write", samples, NVS_ITERATIONS, 0);
+}
+
+static void benchFlash(JsonArray results)
+{
+    float *samples = benchSamples();
+    const esp_partition_t *slot = esp_ota_get_next_update_partition(NULL);
+    uint16_t sectors = FLASH_REGION / FLASH_SECTOR;
+
+    // An update in progress owns the inactive slot
+    if (!slot || otaUpdateActive())
+    {
+        writeBenchResult(results, benchSummarize("flash_erase_4k", samples, 0, 0));
+        writeBenchResult(results, benchSummarize("flash_write_4k", samples, 0, 0));
+        return;
+    }
+
+    size_t base = slot->size - FLASH_REGION;
+    for (uint16_t i = 0; i < sectors; i++)
+    {
+        int64_t start = benchNowUs();
+        esp_partition_erase_range(slot, base + i * FLASH_SECTOR, FLASH_SECTOR);
+        samples[i] = benchNowUs() - start;
+    }
+    writeBenchResult(results, benchSummarize("flash_erase_4k", samples, sectors, FLASH_SECTOR));
+
+    uint8_t *block = (uint8_t *)malloc(FLASH_SECTOR);
+    if (!block)
+    {
+        writeBenchResult(results, benchSummarize("flash_write_4k", samples, 0, 0));
+        return;
+    }
+    memset(block, 0xA5, FLASH_SECTOR);
+
+    for (uint16_t i = 0; i < sectors; i++)
+    {
+        int64_t start = benchNowUs();
+        esp_partition_write(slot, base + i * FLASH_SECTOR, block, FLASH_SECTOR);
+        samples[i] = benchNowUs() - start;
+    }
+    writeBenchResult(results, benchSummarize("flash_write_4k", samples, sectors, FLASH_SECTOR));
+
+    // Leave the region erased as it would be before an update
+    esp_partition_erase_range(slot, base, FLASH_REGION);
+    free(block);
+}
+
+void runBenchmarks(JsonArray results, const DataMessage &frame,
+                   const uint8_t *csPins, uint8_t pinCount)
+{
+    for (uint8_t i = 0; i < pinCount && i < sizeof(spiNames) / sizeof(spiNames[0]); i++)
+    {
+        JsonObject entry = writeBenchResult(results, benchSpiRead(spiNames[i], csPins[i]));
+        entry["cs_pin"] = csPins[i];
+    }
+
+    writeBenchResult(results, benchSerializeFrame(frame, SERIALIZE_ITERATIONS));
+    writeBenchResult(results, benchNvsWrite());
+    benchFlash(results);
+    writeBenchResult(results, benchSha256(SHA_ITERATIONS));
+    writeBenchResult(results, benchRsaVerify(FIRMWARE_SIGNING_PUBLIC_KEY, RSA_ITERATIONS));
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "protocol/protocol.h"
+
+// Times SPI, serialization, NVS, flash and crypto in place on this unit.
+// frame is a representative telemetry frame; csPins lists one chip select
+// per thermocouple channel. Blocks for a few seconds.
+void runBenchmarks(JsonArray results, const DataMessage &frame,
+                   const uint8_t *csPins, uint8_t pinCount);
@@ -0,0 +1,96 @@
+#include <atomic>
+#include <esp_timer.h>
+#include <esp_system.h>
+#include "boot_report.h"
+#include "serial/serial_tx.h"
+#include "common/device_identity.h"
+
+static const uint32_t PHASE_PENDING = 0;
+static const uint32_t PHASE_SKIPPED = UINT32_MAX;
+
+static const char *const phaseNames[BOOT_PHASE_COUNT] = {
+    "serial_ready_us", "config_loaded_us", "sensors_ready_us", "ready_sent_us",
+    "first_sample_us", "wifi_settled_us", "update_checked_us"};
+
+// Microseconds since boot; a uint32_t covers the first 71 minutes, far past
+// the slowest phase
+static std::atomic<uint32_t> phaseUs[BOOT_PHASE_COUNT];
+static std::atomic<bool> reported(false);
+
+static const char *resetReasonName(esp_reset_reason_t reason)
+{
+    switch (reason)
+    {
+    case ESP_RST_POWERON:
+        return "power_on";
+    case ESP_RST_SW:
+        return "software"; // Includes the restart after an OTA update
+    case ESP_RST_PANIC:
+        return "panic";
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+        return "watchdog";
+    case ESP_RST_BROWNOUT:
+        return "brownout";
+    case ESP_RST_DEEPSLEEP:
+        return "deep_sleep";
+    default:
+        return "other";
+    }
+}
+
+void addBootPhases(JsonObject out)
+{
+    out["reset_reason"] = resetReasonName(esp_reset_reason());
+    for (uint8_t i = 0; i < BOOT_PHASE_COUNT; i++)
+    {
+        uint32_t us = phaseUs[i].load();
+        if (us != PHASE_PENDING && us != PHASE_SKIPPED)
+            out[phaseNames[i]] = us;
+    }
+}
+
+static void sendBootReportWhenComplete()
+{
+    for (uint8_t i = 0; i < BOOT_PHASE_COUNT; i++)
+    {
+        if (phaseUs[i].load() == PHASE_PENDING)
+            return;
+    }
+    if (reported.exchange(true))
+        return;
+
+    JsonDocument doc;
+    doc["type"] = "boot_report";
+    doc["device_id"] = deviceSerialNumber();
+    doc["metadata"]["timestamp"] = millis();
+    addBootPhases(doc["payload"].to<JsonObject>());
+    sendJson(doc);
+}
+
+static void setPhase(BootPhase phase, uint32_t value)
+{
+    if (phase >= BOOT_PHASE_COUNT)
+        return;
+
+    uint32_t expected = PHASE_PENDING;
+    if (phaseUs[phase].compare_exchange_strong(expected, value))
+        sendBootReportWhenComplete();
+}
+
+void bootMark(BootPhase phase)
+{
+    uint32_t us = (uint32_t)esp_timer_get_time();
+    setPhase(phase, us == PHASE_PENDING ? 1 : us);
+}
+
+void bootSkip(BootPhase phase)
+{
+    setPhase(phase, PHASE_SKIPPED);
+}
+
+bool bootSettled()
+{
+    return reported.load();
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Boot milestones, in the order they normally happen. The first four run
+// in setup(); the rest complete in the background.
+enum BootPhase : uint8_t
+{
+    BOOT_SERIAL_READY,   // Serial and the TX writer are up
+    BOOT_CONFIG_LOADED,  // Settings read from NVS
+    BOOT_SENSORS_READY,  // Thermocouples initialized
+    BOOT_READY_SENT,     // ready message queued; commands are served
+    BOOT_FIRST_SAMPLE,   // First sample read and handed to the senders
+    BOOT_WIFI_SETTLED,   // Saved network joined, or setup mode started
+    BOOT_UPDATE_CHECKED, // Startup firmware update check finished
+    BOOT_PHASE_COUNT,
+};
+
+// Records when a phase was reached, in microseconds since boot; only the
+// first call per phase counts. Safe from any task.
+void bootMark(BootPhase phase);
+
+// The phase will not happen on this boot (no WiFi, so no update check)
+void bootSkip(BootPhase phase);
+
+// Once every phase is reached or skipped, a boot_report frame goes out
+// with the timings. addBootPhases() writes the same fields on request.
+void addBootPhases(JsonObject out);
+
+// True once that report has gone out: WiFi and the update check are done
+// with, so the heap and the loop's timing have settled
+bool bootSettled();
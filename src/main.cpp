@@ -1,7 +1,8 @@
 /*
  * P61 Data Bridge - Integrated Firmware
  * Features:
- * - 4-channel MAX31856 thermocouple reading
+ * - Up to 4 thermocouple channels (MAX31855, MAX31856 or MAX6675, chosen
+ *   at build time)
  * - WiFi provisioning with captive portal
  * - OTA firmware updates
  * - Web Serial API communication
@@ -11,33 +12,53 @@
 
 #include <USB.h>
 #include <WiFi.h>
-#include <WebServer.h>
 #include <Preferences.h>
-#include <DNSServer.h>
 #include <HTTPClient.h>
 #include <Update.h>
 #include <SPI.h>
-// TEMP - START
-#include <Adafruit_MAX31855.h>
-// TEMP - END
-// #include <Adafruit_MAX31856.h>
 #include <ArduinoJson.h>
+#include <esp_timer.h>
 #include "config/config.h"
 #include "ota/ota_update.h"
 #include "wifi/wifi_manager.h"
-#include "common/connection_state.h"
+#include "common/device_identity.h"
 #include "common/roast_state.h"
+#include "common/temperature_sample.h"
+#include "telemetry/sample_batch.h"
+#include "telemetry/deadband.h"
+#include "mqtt/mqtt_publisher.h"
+#include "telemetry/backfill_buffer.h"
+#include "telemetry/history_buffer.h"
+#include "clock/clock_sync.h"
+#include "sensors/thermocouple_linearization.h"
+#include "sensors/channel_health.h"
+#include "sensors/noise_filter.h"
+#include "sensors/calibration.h"
+#include "sensors/thermocouple_chips.h"
+#include "scheduler/event_loop.h"
+#include "scheduler/event_bus.h"
+#include "serial/serial_tx.h"
+#include "serial/command_channel.h"
+#include "power/power_manager.h"
+#include "telemetry/adaptive_rate.h"
+#include "trace/trace_recorder.h"
+#include "diagnostics/benchmark.h"
+#include "protocol/protocol.h"
+#include "telemetry/subscriptions.h"
+#include "diagnostics/boot_report.h"
+#include "ota/ota_verify.h"
+#include "status/status_leds.h"
 
 // ============================================================================
 // CONFIGURATION
 // ============================================================================
 
-// SPI Pins for MAX31856 (ESP32-S3 default SPI)
+// SPI Pins for the thermocouple amplifiers (ESP32-S3 default SPI)
 #define SPI_MOSI 11
 #define SPI_MISO 13
 #define SPI_SCK 12
 
-// Chip Select pins for 4 MAX31856 channels
+// Chip Select pins for up to 4 thermocouple channels
 #define CS_PIN_1 5
 #define CS_PIN_2 10
 #define CS_PIN_3 15
@@ -54,44 +75,37 @@
 // GLOBAL OBJECTS
 // ============================================================================
 
-// TEMP - START
-Adafruit_MAX31855 thermocouple1(CS_PIN_1);
-// TEMP - END
-
-// Create 4 MAX31856 instances
-// Adafruit_MAX31856 thermocouple1(CS_PIN_1);
-// Adafruit_MAX31856 thermocouple2(CS_PIN_2);
-// Adafruit_MAX31856 thermocouple3(CS_PIN_3);
-// Adafruit_MAX31856 thermocouple4(CS_PIN_4);
+// Chip type and count come from THERMOCOUPLE_CHIP / THERMOCOUPLE_CHANNELS
+const uint8_t thermocoupleCsPins[MAX_THERMOCOUPLE_CHANNELS] = {CS_PIN_1, CS_PIN_2, CS_PIN_3, CS_PIN_4};
+ThermocoupleArray thermocouples(thermocoupleCsPins);
+const int THERMOCOUPLE_COUNT = ThermocoupleArray::CHANNELS;
 
 Preferences preferences;
-WebServer server(80);
-DNSServer dnsServer;
 
 // ============================================================================
 // STATE VARIABLES
 // ============================================================================
 
-// Device identification
-String deviceId;
-String deviceSerialNumber;
+// Loop task's subscription to WiFi and setup-mode events
+int loopBusSubscriber = -1;
 
-// WiFi state
-bool wifiConfigured = false;
-bool apModeActive = false;
-unsigned long lastWiFiCheck = 0;
+// Operations accepted in one {"batch": [...]} command frame
+const size_t BATCH_MAX_OPS = 16;
 
 // Temperature reading state
 int samplingRateMs = 1000; // Default 1 second
+int effectiveRateMs = 1000; // samplingRateMs, or the adaptive rate when enabled
 unsigned long lastReadingTime = 0;
-
-// Serial command processing
-String inputBuffer = "";
+unsigned long lastProbeTime = 0;  // Adaptive probe between slow samples
+TemperatureSample quietProbe;     // Newest probe that tripped nothing
+bool quietProbeValid = false;
 
 // OTA update state
 unsigned long lastUpdateCheck = 0;
+bool wifiStartPending = true; // Until the loop has sent its first sample
 bool updateAvailable = false;
 String pendingFirmwareVersion = "";
+volatile bool otaUpdateRequested = false; // Set by command, run by loop
 
 // Roast state tracking
 RoastState currentRoastState = IDLE;
@@ -99,24 +113,58 @@ unsigned long roastStartTime = 0;
 unsigned long lastActivityTime = 0;
 const unsigned long ACTIVITY_TIMEOUT = 60000; // 60 seconds of no high temps = idle
 
-// Connection state
-ConnectionState currentConnectionState = DISCONNECTED;
+// Power management
+PowerMode currentPowerMode = POWER_PERFORMANCE;
+volatile unsigned long lastHostActivityTime = 0; // Last command or button press
+int64_t wakeStartUs = 0;
+bool wakeSamplePending = false;
+int64_t lastWakeLatencyUs = -1;
+
+// Software linearization table per channel (nullptr = chip conversion)
+const ThermocoupleTable *channelLinearization[MAX_THERMOCOUPLE_CHANNELS] = {};
+
+// Fault tracking and re-init backoff per channel
+ChannelHealth channelHealth[MAX_THERMOCOUPLE_CHANNELS];
+
+// Per-channel probe correction, applied in the acquisition pass
+CalibrationSet calibration = {};
 
 // ============================================================================
 // FUNCTION DECLARATIONS
 // ============================================================================
 
-void generateDeviceIds();
 void initializeThermocouples();
+void recoverThermocouples(unsigned long now);
 void readAndTransmitTemperatures();
-void readChannel(JsonArray &channels, int channelNum, Adafruit_MAX31855 &tc);
-void handleSerialCommands();
-void processCommand(String command);
+bool adaptiveProbeDue(unsigned long now);
+void probeTemperatures(unsigned long now);
+void readTemperatures(TemperatureSample &sample);
+void processSample(TemperatureSample &sample, unsigned long periodMs);
+void transmitSample(const TemperatureSample &sample, ChannelMask channels, bool keyframe);
+void buildDataMessage(DataMessage &msg, const TemperatureSample &sample, ChannelMask channels, bool keyframe, uint32_t sequence);
+void buildBenchmarkFrame(DataMessage &frame);
+void finishOtaVerification();
+void updateRoastState(const TemperatureSample &sample);
+void publishRoastEvent(BusEventType type, const TemperatureSample &sample, int32_t value);
+void updatePowerMode(unsigned long now);
+void transmitSampleBatch();
+void publishDataSent();
+void processCommand(const char *command, int64_t receivedUs);
+void rejectCommand(LineStatus status, int64_t receivedUs);
+JsonObject beginCommandResponse(JsonDocument &docOut, int64_t receivedUs);
+void executeCommand(JsonObject docIn, JsonObject docOut, JsonObject payload, const char *command, int64_t receivedUs,
+                    bool apply = true);
+void executeBatch(JsonArray ops, JsonObject docOut, JsonObject payload, int64_t receivedUs);
+void addStatusFields(JsonObject out);
+void addMetricFields(JsonObject out);
+void addSubscriptionSnapshot(SubscriptionTopic topic, JsonObject out);
+void addTxStats(JsonObject out, const TxClassStats &stats);
+void sendCommandResponse(JsonDocument &docOut);
 void sendReadyMessage();
-void setConnectionState(ConnectionState state);
-void blinkSetupLED();
+void handleBusEvents();
 void checkFactoryReset();
-int calculateLoopDelay(int samplingRate);
+void onBootButton();
+unsigned long calculateWakeTimeout(unsigned long now);
 
 // ============================================================================
 // SETUP
@@ -124,8 +172,14 @@ int calculateLoopDelay(int samplingRate);
 
 void setup()
 {
-  Serial.begin(115200);
-  delay(1000);
+  // Before anything else runs, so a crash trace is saved untouched
+  traceRecorderBegin();
+
+  // UART bridge, or native USB CDC in the esp32-s3-usb build
+  serialTxBegin();
+
+  // loop() sleeps until an event source (or the next sample) wakes it
+  eventLoopBegin();
 
 // Custom USB device identification (optional)
 #if ARDUINO_USB_CDC_ON_BOOT
@@ -133,76 +187,149 @@ void setup()
   USB.productName("P61");
   USB.begin();
 #endif
+  bootMark(BOOT_SERIAL_READY);
 
-  Serial.println("\n\n==================================");
-  Serial.println("     Data Bridge Initializing");
-  Serial.println("==================================");
-  Serial.printf("Model: %s\n", DEVICE_MODEL);
-  Serial.printf("Firmware: v%s\n", FIRMWARE_VERSION);
+  serialLog("\n\n==================================");
+  serialLog("     Data Bridge Initializing");
+  serialLog("==================================");
+  serialLog("Model: %s", DEVICE_MODEL);
+  serialLog("Firmware: v%s", FIRMWARE_VERSION);
 
-  // Initialize LED pins
-  pinMode(LED_CONN, OUTPUT);
-  pinMode(LED_DATA, OUTPUT);
-  digitalWrite(LED_CONN, HIGH); // OFF (active LOW)
-  digitalWrite(LED_DATA, HIGH); // OFF (active LOW)
+  // LEDs follow connection and data events from their own task
+  statusLedsBegin(LED_CONN, LED_DATA);
 
   // Initialize button
   pinMode(BOOT_BTN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(BOOT_BTN), onBootButton, FALLING);
+
+  // Scale down and light-sleep while no roast is running
+  powerManagerBegin(BOOT_BTN);
 
-  // Generate device IDs
-  generateDeviceIds();
-  Serial.printf("Device ID: %s\n", deviceId.c_str());
-  Serial.printf("Serial Number: %s\n", deviceSerialNumber.c_str());
+  // Device IDs come from the eFuse MAC
+  deviceIdentityBegin();
+  serialLog("Device ID: %s", deviceShortId());
+  serialLog("Serial Number: %s", deviceSerialNumber());
 
   // Initialize preferences
   preferences.begin("config", false);
 
+  // Store the serial number if not already set
+  if (!preferences.isKey("serial_number"))
+  {
+    preferences.putString("serial_number", deviceSerialNumber());
+  }
+
   // Load sampling rate if saved
   samplingRateMs = preferences.getInt("sampling_rate", 5000);
-  Serial.printf("Sampling Rate: %d ms\n", samplingRateMs);
+  serialLog("Sampling Rate: %d ms", samplingRateMs);
+  effectiveRateMs = samplingRateMs;
+
+  // Load adaptive sampling if saved
+  AdaptiveRateConfig adaptive;
+  adaptive.enabled = preferences.getBool("adapt_on", false);
+  adaptive.minIntervalMs = preferences.getUInt("adapt_min", 500);
+  adaptive.maxIntervalMs = preferences.getUInt("adapt_max", 5000);
+  adaptive.slopeThreshold = preferences.getFloat("adapt_slope", 0.5f);
+  adaptive.accelThreshold = preferences.getFloat("adapt_accel", 0.05f);
+  configureAdaptiveRate(adaptive);
+  if (adaptive.enabled)
+  {
+    effectiveRateMs = adaptive.minIntervalMs;
+  }
+
+  // Load batch mode if saved (1 sample = one frame per reading)
+  configureSampleBatch(preferences.getUInt("batch_samples", 1),
+                       preferences.getUInt("batch_age_ms", 0));
+
+  // Load TX drop policy if saved (what to shed when the host lags)
+  setTxDropPolicy((TxDropPolicy)preferences.getUChar("tx_policy", TX_DROP_OLDEST));
+
+  // Load deadband if saved (0 C = report every channel every frame)
+  configureDeadband(preferences.getFloat("deadband_c", 0.0f),
+                    preferences.getUInt("keyframe_ms", 10000));
 
   // Initialize SPI
   SPI.begin(SPI_SCK, SPI_MISO, SPI_MOSI);
 
-  // Initialize all 4 thermocouples
-  initializeThermocouples();
-
-  // Try to connect to saved WiFi
-  String savedSSID = preferences.getString("ssid", "");
-  String savedPassword = preferences.getString("password", "");
+  // Load noise filter settings if saved (defaults leave readings raw)
+  configureNoiseFilter(preferences.getUChar("filter_median", 1),
+                       preferences.getFloat("filter_q", NOISE_FILTER_DEFAULT_Q),
+                       preferences.getFloat("filter_r", 0.0f));
 
-  if (savedSSID.length() > 0)
+  // Load per-channel thermocouple types for software linearization
+  for (int i = 0; i < MAX_THERMOCOUPLE_CHANNELS; i++)
   {
-    Serial.println("\nAttempting WiFi connection...");
-    wifiConfigured = connectToWiFi(savedSSID.c_str(), savedPassword.c_str());
-
-    if (wifiConfigured)
-    {
-      Serial.println("✓ WiFi Connected");
-      setConnectionState(CONNECTED);
+    char key[12];
+    sprintf(key, "tc_type_%d", i + 1);
+    String type = preferences.getString(key, "");
+    channelLinearization[i] = type.length() == 1 ? thermocoupleTable(type[0]) : nullptr;
+  }
 
-      // Check for firmware updates on startup
-      checkForFirmwareUpdate();
-    }
-    else
+  // Load per-channel calibration curves; a stored curve that no longer
+  // validates is ignored rather than applied
+  for (int i = 0; i < MAX_THERMOCOUPLE_CHANNELS; i++)
+  {
+    char key[12];
+    sprintf(key, "cal_%d", i + 1);
+    CalibrationPoints points;
+    const char *error;
+    if (preferences.getBytes(key, &points, sizeof(points)) == sizeof(points) &&
+        !calibrationBuild(points, calibration.curves[i], error))
     {
-      Serial.println("✗ WiFi connection failed");
+      serialLog("⚠ Channel %d calibration ignored: %s", i + 1, error);
     }
   }
+  calibration.id = calibrationSetId(calibration);
+  bootMark(BOOT_CONFIG_LOADED);
 
-  // If not connected, start AP mode
-  if (!wifiConfigured)
-  {
-    Serial.println("\nStarting WiFi Setup Mode");
-    startAPMode();
-  }
+  // Initialize the configured thermocouple channels
+  initializeThermocouples();
+  bootMark(BOOT_SENSORS_READY);
+
+  // Commands are served from here on, including during WiFi connect
+  subscriptionsBegin(addSubscriptionSnapshot);
+  commandChannelBegin(processCommand, rejectCommand);
+
+  // Wake the loop on WiFi drops instead of waiting for the next check
+  wifiManagerBegin();
+
+  // The loop records boot phases from WiFi state changes on the bus
+  loopBusSubscriber = busSubscribe(BUS_MASK(BUS_WIFI_CONNECTED) | BUS_MASK(BUS_WIFI_DISCONNECTED) | BUS_MASK(BUS_SETUP_MODE),
+                                   [](void *)
+                                   { eventLoopSignal(EVENT_BUS); },
+                                   nullptr);
+
+  // MQTT publishing starts on its own once WiFi is up and a broker is set
+  MqttSettings mqtt;
+  mqtt.enabled = preferences.getBool("mqtt_on", false);
+  mqtt.host = preferences.getString("mqtt_host", "");
+  mqtt.port = preferences.getUShort("mqtt_port", 1883);
+  mqtt.baseTopic = preferences.getString("mqtt_topic", "");
+  mqtt.username = preferences.getString("mqtt_user", "");
+  mqtt.password = preferences.getString("mqtt_pass", "");
+  mqttPublisherBegin(mqtt, deviceSerialNumber());
+
+  // Holds samples while the host is away for replay on reconnect
+  backfillBegin();
+
+  // Keeps every sample for get_history
+  historyBegin();
 
   // Send initial ready message
   sendReadyMessage();
+  bootMark(BOOT_READY_SENT);
 
-  Serial.println("\n=================================");
-  Serial.println("        Data Bridge Ready");
-  Serial.println("=================================\n");
+  // An updated image runs on probation until its self-benchmark passes
+  otaVerifyBegin();
+
+  // Nothing below blocks: the first loop pass samples straight away, then
+  // starts WiFi, and the update check runs once WiFi is up
+  lastReadingTime = millis() - effectiveRateMs;
+  lastUpdateCheck = millis() - UPDATE_CHECK_INTERVAL - 1;
+
+  serialLog("\n=================================");
+  serialLog("        Data Bridge Ready");
+  serialLog("=================================\n");
 }
 
 // ============================================================================
@@ -212,68 +339,110 @@ void setup()
 void loop()
 {
   unsigned long currentTime = millis();
+  traceBegin(TRACE_LOOP);
+
+  handleBusEvents();
 
   // Handle AP mode operations
-  if (apModeActive)
+  if (wifiSetupModeActive())
   {
-    dnsServer.processNextRequest();
-    server.handleClient();
-    blinkSetupLED();
+    serviceSetupPortal();
   }
 
-  // Handle WiFi connection monitoring
-  if (wifiConfigured && !apModeActive)
+  // Handle WiFi connection monitoring, including the join started at boot
+  if ((wifiIsConfigured() || wifiJoining()) && !wifiSetupModeActive())
   {
     monitorWiFiConnection();
 
-    // Periodic firmware update check
-    if (currentTime - lastUpdateCheck > UPDATE_CHECK_INTERVAL)
+    // Periodic firmware update check, first one right after boot
+    if (wifiIsConfigured() && currentTime - lastUpdateCheck > UPDATE_CHECK_INTERVAL)
     {
-      checkForFirmwareUpdate();
+      requestFirmwareUpdateCheck();
       lastUpdateCheck = currentTime;
     }
   }
 
+  // OTA requested over serial; commands keep being served meanwhile
+  if (otaUpdateRequested)
+  {
+    otaUpdateRequested = false;
+    performOTAUpdate();
+  }
+
+  // Sensor work shares state with the command task, so it runs as one
+  // short locked step
+  acquireStateLock();
+
+  // Pick the power mode before sampling so a wake samples right away
+  updatePowerMode(currentTime);
+
+  // Re-initialize failed chips in the background
+  recoverThermocouples(currentTime);
+
   // Read and transmit temperature data
-  if (currentTime - lastReadingTime >= samplingRateMs)
+  if (currentTime - lastReadingTime >= (unsigned long)effectiveRateMs)
   {
     lastReadingTime = currentTime;
     readAndTransmitTemperatures();
   }
+  else if (adaptiveProbeDue(currentTime))
+  {
+    probeTemperatures(currentTime);
+  }
 
-  // Handle serial commands
-  handleSerialCommands();
+  // Flush a partially filled batch once it has aged out
+  if (sampleBatchDue(currentTime))
+  {
+    transmitSampleBatch();
+  }
 
-  // Check for factory reset button press (hold BOOT for 5 seconds)
-  checkFactoryReset();
+  // Replay the outage backlog one frame per pass so live samples
+  // interleave with it, pacing on the TX queue so replay never forces
+  // live frames out
+  if (hostConnected() && backfillPending() && !txTelemetryBacklogged())
+  {
+    sendBackfillFrame();
+  }
 
-  // Dynamic loop delay based on sampling rate
-  int loopDelay = calculateLoopDelay(samplingRateMs);
-  delay(loopDelay);
-}
+  // A history query streams the same way, once any backfill is out
+  if (hostConnected() && historyPending() && !backfillPending() && !txTelemetryBacklogged())
+  {
+    sendHistoryFrame();
+  }
 
-// ============================================================================
-// DEVICE IDENTIFICATION
-// ============================================================================
+  // Push whatever changed to a subscribed host
+  serviceSubscriptions(currentTime);
 
-void generateDeviceIds()
-{
-  uint64_t mac = ESP.getEfuseMac();
+  // Commit a freshly updated image, or roll it back
+  if (otaVerifyDue(currentTime))
+  {
+    finishOtaVerification();
+  }
 
-  // Full serial number for database
-  char serialBuf[20];
-  sprintf(serialBuf, "P61-%012llX", mac);
-  deviceSerialNumber = String(serialBuf);
+  releaseStateLock();
 
-  // Short device ID for display
-  char idBuf[20];
-  sprintf(idBuf, "%06X", (uint32_t)(mac & 0xFFFFFF));
-  deviceId = String(idBuf);
+  // Radio bring-up takes a few hundred ms, so it waits for the first sample
+  if (wifiStartPending)
+  {
+    wifiStartPending = false;
+    if (!beginSavedWiFi())
+    {
+      serialLog("\nStarting WiFi Setup Mode");
+      startAPMode();
+    }
+  }
 
-  // Store in preferences if not already set
-  if (!preferences.isKey("serial_number"))
+  // Check for factory reset button press (hold BOOT for 5 seconds)
+  checkFactoryReset();
+
+  traceEnd(TRACE_LOOP);
+
+  // Sleep until the next sample is due or an event source wakes us
+  uint32_t events = eventLoopWait(calculateWakeTimeout(millis()));
+
+  if (events & EVENT_WIFI)
   {
-    preferences.putString("serial_number", deviceSerialNumber);
+    requestWiFiCheck();
   }
 }
 
@@ -283,48 +452,53 @@ void generateDeviceIds()
 
 void initializeThermocouples()
 {
-  Serial.println("\nInitializing thermocouples...");
+  serialLog("\nInitializing %d %s thermocouple channel(s)...", THERMOCOUPLE_COUNT, THERMOCOUPLE_CHIP_NAME);
 
   bool success = true;
 
-  if (!thermocouple1.begin())
+  for (int i = 0; i < THERMOCOUPLE_COUNT; i++)
   {
-    Serial.println("✗ Channel 1 (MAX31856) initialization failed!");
-    success = false;
+    // A type saved under a different chip falls back to the chip default
+    if (!ThermocoupleChip::supportsType(channelLinearization[i]))
+    {
+      channelLinearization[i] = nullptr;
+    }
+
+    thermocouples.setType(i, channelLinearization[i]);
+    bool ok = thermocouples.chip(i).begin();
+    channelHealthInit(channelHealth[i], ok, millis());
+
+    if (!ok)
+    {
+      serialLog("✗ Channel %d (%s) initialization failed!", i + 1, THERMOCOUPLE_CHIP_NAME);
+      success = false;
+    }
+    else
+    {
+      char type = channelLinearization[i] ? channelLinearization[i]->type : 'K';
+      serialLog("✓ Channel %d ready (%c-type)", i + 1, type);
+    }
   }
-  else
-  {
-    // thermocouple1.setThermocoupleType(MAX31856_TCTYPE_K);
-    Serial.println("✓ Channel 1 ready (K-type)");
-  }
-
-  // if (!thermocouple2.begin()) {
-  //   Serial.println("✗ Channel 2 (MAX31856) initialization failed!");
-  //   success = false;
-  // } else {
-  //   thermocouple2.setThermocoupleType(MAX31856_TCTYPE_K);
-  //   Serial.println("✓ Channel 2 ready (K-type)");
-  // }
-
-  // if (!thermocouple3.begin()) {
-  //   Serial.println("✗ Channel 3 (MAX31856) initialization failed!");
-  //   success = false;
-  // } else {
-  //   thermocouple3.setThermocoupleType(MAX31856_TCTYPE_K);
-  //   Serial.println("✓ Channel 3 ready (K-type)");
-  // }
-
-  // if (!thermocouple4.begin()) {
-  //   Serial.println("✗ Channel 4 (MAX31856) initialization failed!");
-  //   success = false;
-  // } else {
-  //   thermocouple4.setThermocoupleType(MAX31856_TCTYPE_K);
-  //   Serial.println("✓ Channel 4 ready (K-type)");
-  // }
 
   if (success)
   {
-    Serial.println("All thermocouples initialized successfully");
+    serialLog("All thermocouples initialized successfully");
+  }
+}
+
+void recoverThermocouples(unsigned long now)
+{
+  // At most one re-init per pass so healthy channels keep their cadence
+  for (int i = 0; i < THERMOCOUPLE_COUNT; i++)
+  {
+    if (!channelHealthRetryDue(channelHealth[i], now))
+      continue;
+
+    bool ok = thermocouples.chip(i).begin();
+    channelHealthRetryResult(channelHealth[i], ok, now);
+
+    serialLog("%s Channel %d re-init %s", ok ? "✓" : "✗", i + 1, ok ? "succeeded" : "failed");
+    return;
   }
 }
 
@@ -334,128 +508,354 @@ void initializeThermocouples()
 
 void readAndTransmitTemperatures()
 {
-  setConnectionState(TRANSMITTING);
-
-  JsonDocument doc;
-  doc["type"] = "data";
-  doc["device_id"] = deviceSerialNumber;
-  doc["firmware_version"] = FIRMWARE_VERSION;
-
-  JsonObject meta = doc["metadata"].to<JsonObject>();
-  meta["timestamp"] = millis();
-  meta["sampling_rate_ms"] = samplingRateMs;
+  TemperatureSample sample;
+  readTemperatures(sample);
+  lastProbeTime = sample.timestamp;
+  quietProbeValid = false;
+  processSample(sample, effectiveRateMs);
+}
 
-  JsonArray channels = doc["channels"].to<JsonArray>();
+// While adaptive sampling waits out an interval longer than min_rate_ms
+bool adaptiveProbeDue(unsigned long now)
+{
+  const AdaptiveRateConfig &adaptive = adaptiveRateConfig();
+  return adaptive.enabled && (uint32_t)effectiveRateMs > adaptive.minIntervalMs &&
+         now - lastProbeTime >= adaptive.minIntervalMs;
+}
 
-  // Read all 4 channels
-  readChannel(channels, 1, thermocouple1);
-  // readChannel(channels, 2, thermocouple2);
-  // readChannel(channels, 3, thermocouple3);
-  // readChannel(channels, 4, thermocouple4);
+// Reads the probes between slow adaptive samples, so a charge is caught
+// within min_rate_ms instead of after the interval in progress. Nothing
+// goes out unless the change crosses a threshold; then the last quiet
+// probe is sent ahead of this reading to mark where the change began.
+void probeTemperatures(unsigned long now)
+{
+  lastProbeTime = now;
+  TemperatureSample probe;
+  readTemperatures(probe);
 
-  serializeJson(doc, Serial);
-  Serial.println();
+  if (!adaptiveRateProbe(probe))
+  {
+    quietProbe = probe;
+    quietProbeValid = true;
+    return;
+  }
 
-  // Brief LED blink to indicate transmission
-  digitalWrite(LED_DATA, LOW);
-  delay(50);
-  digitalWrite(LED_DATA, HIGH);
+  unsigned long previousMs = lastReadingTime;
+  if (quietProbeValid)
+  {
+    processSample(quietProbe, quietProbe.timestamp - previousMs);
+    previousMs = quietProbe.timestamp;
+    quietProbeValid = false;
+  }
+  lastReadingTime = now;
+  processSample(probe, probe.timestamp - previousMs);
+}
 
-  setConnectionState(wifiConfigured ? CONNECTED : DISCONNECTED);
+void readTemperatures(TemperatureSample &sample)
+{
+  sample.timestamp = millis();
+  sample.deviceTimeUs = esp_timer_get_time();
+  thermocouples.read(sample, channelHealth, calibration);
 }
 
-void readChannel(JsonArray &channels, int channelNum, Adafruit_MAX31855 &tc)
+// Filters, records and sends one reading. periodMs is the time since the
+// previous sample, for the OTA gate's jitter check.
+void processSample(TemperatureSample &sample, unsigned long periodMs)
 {
-  JsonObject channel = channels.add<JsonObject>();
-  channel["channel"] = channelNum;
+  TraceScope trace(TRACE_SAMPLE);
+
+  // Reject EMI spikes and smooth before anything leaves the device
+  applyNoiseFilter(sample);
+
+  updateRoastState(sample);
 
-  // uint8_t fault = tc.readFault();
+  // Before the adaptive rate moves on: this is the period just waited
+  otaVerifyRecordSample(sample.deviceTimeUs, periodMs);
 
-  // if (fault) {
-  //   channel["status"] = "error";
-  //   channel["fault_code"] = fault;
+  // Speed up on fast temperature changes, back off on plateaus
+  if (adaptiveRateConfig().enabled)
+  {
+    effectiveRateMs = adaptiveRateUpdate(sample);
+  }
 
-  //   // Decode fault
-  //   JsonArray faults = channel.createNestedArray("faults");
-  //   if (fault & MAX31856_FAULT_CJRANGE) faults.add("cold_junction_range");
-  //   if (fault & MAX31856_FAULT_TCRANGE) faults.add("thermocouple_range");
-  //   if (fault & MAX31856_FAULT_CJHIGH) faults.add("cold_junction_high");
-  //   if (fault & MAX31856_FAULT_CJLOW) faults.add("cold_junction_low");
-  //   if (fault & MAX31856_FAULT_TCHIGH) faults.add("thermocouple_high");
-  //   if (fault & MAX31856_FAULT_TCLOW) faults.add("thermocouple_low");
-  //   if (fault & MAX31856_FAULT_OVUV) faults.add("over_under_voltage");
-  //   if (fault & MAX31856_FAULT_OPEN) faults.add("open_circuit");
+  if (wakeSamplePending)
+  {
+    lastWakeLatencyUs = sample.deviceTimeUs - wakeStartUs;
+    wakeSamplePending = false;
+    serialLog("Wake to first sample: %lld us", lastWakeLatencyUs);
+  }
 
-  //   channel["temperature_c"] = nullptr;
-  //   channel["temperature_f"] = nullptr;
-  // } else {
-  channel["status"] = "ok";
-  // float tempC = tc.readThermocoupleTemperature();
-  float tempC = tc.readCelsius();
+  // Nobody reads Serial while the host is away; keep every sample for replay
+  if (!hostConnected())
+  {
+    backfillStore(sample);
+  }
 
-  channel["temperature_c"] = tempC;
-  // channel["cold_junction_c"] = tc.readCJTemperature();
-  // }
-}
+  historyStore(sample);
 
-// ============================================================================
-// SERIAL COMMAND HANDLING
-// ============================================================================
+  bootMark(BOOT_FIRST_SAMPLE);
 
-void handleSerialCommands()
-{
-  while (Serial.available())
+  // Report by exception: nothing goes out until a channel leaves its
+  // deadband or a keyframe is due
+  bool keyframe;
+  ChannelMask changed = deadbandSelect(sample, keyframe);
+  if (!changed)
   {
-    char c = Serial.read();
+    return;
+  }
 
-    if (c == '\n' || c == '\r')
+  if (sampleBatchEnabled())
+  {
+    addSampleToBatch(sample, changed, effectiveRateMs);
+    if (sampleBatchDue(sample.timestamp))
     {
-      if (inputBuffer.length() > 0)
-      {
-        processCommand(inputBuffer);
-        inputBuffer = "";
-      }
+      transmitSampleBatch();
     }
-    else
+  }
+  else
+  {
+    transmitSample(sample, changed, keyframe);
+  }
+}
+
+void updateRoastState(const TemperatureSample &sample)
+{
+  bool hot = false;
+  float hottestC = 0.0f;
+  for (int i = 0; i < sample.channelCount; i++)
+  {
+    if (!sample.fault[i] && sample.temperatureC[i] >= ROAST_ACTIVITY_THRESHOLD_C)
+    {
+      hot = true;
+      hottestC = max(hottestC, sample.temperatureC[i]);
+    }
+  }
+
+  if (hot)
+  {
+    lastActivityTime = sample.timestamp;
+    if (currentRoastState == IDLE)
     {
-      inputBuffer += c;
+      currentRoastState = ROASTING;
+      roastStartTime = sample.timestamp;
+      publishRoastEvent(BUS_ROAST_STARTED, sample, (int32_t)(hottestC * 100.0f));
     }
   }
+  else if (currentRoastState == ROASTING && sample.timestamp - lastActivityTime > ACTIVITY_TIMEOUT)
+  {
+    currentRoastState = IDLE;
+    publishRoastEvent(BUS_ROAST_ENDED, sample, (sample.timestamp - roastStartTime) / 1000);
+  }
+}
+
+void publishRoastEvent(BusEventType type, const TemperatureSample &sample, int32_t value)
+{
+  BusEvent event = {type, (uint32_t)sample.timestamp, 0, value};
+  if (clockSyncValid())
+  {
+    event.hostTimeUs = clockSyncToHostUs(sample.deviceTimeUs);
+  }
+  busPublish(event);
+}
+
+void transmitSample(const TemperatureSample &sample, ChannelMask channels, bool keyframe)
+{
+  // Encoded once, straight to text, for both Serial and MQTT
+  DataMessage msg;
+  buildDataMessage(msg, sample, channels, keyframe, nextDataSequence());
+  char frame[PROTO_DATA_FRAME_MAX];
+  size_t length = encodeDataMessage(msg, frame, sizeof(frame));
+
+  if (hostConnected() && length > 0)
+  {
+    sendFrame(frame, length, TX_TELEMETRY);
+  }
+  if (length > 0)
+  {
+    mqttPublishFrame(MQTT_TOPIC_DATA, frame, length);
+  }
+
+  publishDataSent();
+}
+
+void buildDataMessage(DataMessage &msg, const TemperatureSample &sample, ChannelMask channels, bool keyframe, uint32_t sequence)
+{
+  msg = {};
+  msg.deviceId = protoSpan(deviceSerialNumber());
+  msg.firmwareVersion = protoSpan(FIRMWARE_VERSION);
+
+  msg.metadata.timestamp = sample.timestamp;
+  msg.metadata.samplingRateMs = effectiveRateMs;
+  msg.metadata.sequence = sequence;
+  msg.metadata.keyframe = keyframe;
+  msg.metadata.calibrationId = sample.calibrationId;
+  if (clockSyncValid())
+  {
+    msg.metadata.hasHostTime = true;
+    msg.metadata.hostTimeUs = clockSyncToHostUs(sample.deviceTimeUs);
+  }
+
+  for (int i = 0; i < sample.channelCount && i < PROTO_MAX_CHANNELS; i++)
+  {
+    // Unchanged channels keep the value from their last report
+    if (!(channels & (1u << i)))
+      continue;
+
+    DataChannel &channel = msg.channels[msg.channelCount++];
+    channel.channel = i + 1;
+    channel.ok = sample.fault[i] == 0;
+    channel.faultCode = sample.fault[i];
+    channel.temperatureC = sample.temperatureC[i];
+  }
+}
+
+// A full four-channel frame, built without consuming a sequence number
+void buildBenchmarkFrame(DataMessage &frame)
+{
+  TemperatureSample sample = {};
+  sample.timestamp = millis();
+  sample.deviceTimeUs = esp_timer_get_time();
+  sample.channelCount = MAX_THERMOCOUPLE_CHANNELS;
+  for (int i = 0; i < MAX_THERMOCOUPLE_CHANNELS; i++)
+  {
+    sample.temperatureC[i] = 201.25f + i;
+  }
+  buildDataMessage(frame, sample, 0xFF, true, 0);
+}
+
+void finishOtaVerification()
+{
+  DataMessage frame;
+  buildBenchmarkFrame(frame);
+
+  uint8_t online = 0;
+  for (int i = 0; i < THERMOCOUPLE_COUNT; i++)
+  {
+    online += channelHealth[i].online ? 1 : 0;
+  }
+  otaVerifyFinish(frame, online, THERMOCOUPLE_COUNT);
 }
 
-void processCommand(String command)
+void transmitSampleBatch()
 {
+  if (flushSampleBatch())
+  {
+    publishDataSent();
+  }
+}
+
+void publishDataSent()
+{
+  // The LED task blinks the data LED; a full queue only costs a blink
+  BusEvent event = {BUS_DATA_SENT, (uint32_t)millis(), 0, 0};
+  busPublish(event);
+}
+
+// ============================================================================
+// SERIAL COMMAND HANDLING
+// ============================================================================
+
+void processCommand(const char *command, int64_t receivedUs)
+{
+  // Any host traffic brings the device back to full speed
+  lastHostActivityTime = millis();
+
   JsonDocument docIn;
   DeserializationError error = deserializeJson(docIn, command);
 
   JsonDocument docOut;
-  docOut["device_id"] = deviceSerialNumber;
-  JsonObject meta = docOut["metadata"].to<JsonObject>();
-  meta["timestamp"] = millis();
-  JsonObject payload = docOut["payload"].to<JsonObject>();
+  JsonObject payload = beginCommandResponse(docOut, receivedUs);
+
+  // Echo the caller's correlation ID so responses can be matched
+  if (!error && !docIn["request_id"].isNull())
+  {
+    docOut["request_id"] = docIn["request_id"];
+  }
 
   if (error)
   {
     docOut["type"] = "error";
     payload["error"] = "Invalid JSON command";
     payload["details"] = command;
-    serializeJson(docOut, Serial);
-    Serial.println();
+    sendCommandResponse(docOut);
     return;
   }
 
+  if (docIn["batch"].is<JsonArray>())
+  {
+    executeBatch(docIn["batch"], docOut.as<JsonObject>(), payload, receivedUs);
+  }
+  else
+  {
+    executeCommand(docIn.as<JsonObject>(), docOut.as<JsonObject>(), payload, command, receivedUs);
+  }
+
+  sendCommandResponse(docOut);
+}
+
+// A line the command channel could not hand on: one longer than
+// COMMAND_MAX_LENGTH, or one dropped by the resync after light sleep.
+// There is no request_id to echo
+void rejectCommand(LineStatus status, int64_t receivedUs)
+{
+  lastHostActivityTime = millis();
+
+  JsonDocument docOut;
+  JsonObject payload = beginCommandResponse(docOut, receivedUs);
+  docOut["type"] = "error";
+  if (status == LINE_TOO_LONG)
+  {
+    payload["error"] = "Command too long";
+    payload["max_length"] = COMMAND_MAX_LENGTH - 1;
+  }
+  else
+  {
+    // The UART wake cost the line its first bytes
+    payload["error"] = "Command lost during wake, resend";
+  }
+  sendCommandResponse(docOut);
+}
+
+// Fields every command response carries; returns the payload to fill in
+JsonObject beginCommandResponse(JsonDocument &docOut, int64_t receivedUs)
+{
+  docOut["device_id"] = deviceSerialNumber();
+  JsonObject meta = docOut["metadata"].to<JsonObject>();
+  meta["timestamp"] = millis();
+  meta["received_us"] = receivedUs;
+  return docOut["payload"].to<JsonObject>();
+}
+
+// Runs one operation, filling in the response type and payload. command is
+// the raw line for error echoes, or null inside a batch. With apply false
+// it only validates: an invalid operation gets its error response, a valid
+// one returns before changing anything and leaves the response empty.
+void executeCommand(JsonObject docIn, JsonObject docOut, JsonObject payload, const char *command, int64_t receivedUs,
+                    bool apply)
+{
   // Handle commands
   if (docIn["update_connection_status"].is<const char *>())
   {
     String status = docIn["update_connection_status"];
+    if (!apply)
+      return;
+
+    // A partial batch belongs to the period it was collected in
+    if (status == "connected" || status == "disconnected")
+    {
+      flushSampleBatch();
+    }
 
     if (status == "connected")
     {
-      setConnectionState(CONNECTED);
+      setHostConnected(true);
+      deadbandForceKeyframe();
     }
     else if (status == "disconnected")
     {
-      setConnectionState(DISCONNECTED);
+      setHostConnected(false);
+      configureSubscriptions(0, subscriptionIntervalMs());
+      historyCancel();
     }
 
     docOut["type"] = "configuration";
@@ -468,8 +868,14 @@ void processCommand(String command)
 
     if (newRate >= 1000 && newRate <= 60000)
     {
+      if (!apply)
+        return;
       samplingRateMs = newRate;
       preferences.putInt("sampling_rate", samplingRateMs);
+      if (!adaptiveRateConfig().enabled)
+      {
+        effectiveRateMs = samplingRateMs;
+      }
 
       docOut["type"] = "configuration";
       payload["result"] = "sampling_rate_updated";
@@ -482,141 +888,734 @@ void processCommand(String command)
       payload["requested_rate"] = newRate;
     }
   }
+  else if (docIn["update_adaptive_sampling"].is<JsonObject>())
+  {
+    JsonObject request = docIn["update_adaptive_sampling"];
+    AdaptiveRateConfig adaptive = adaptiveRateConfig();
+    adaptive.enabled = request["enabled"] | adaptive.enabled;
+    adaptive.minIntervalMs = request["min_rate_ms"] | adaptive.minIntervalMs;
+    adaptive.maxIntervalMs = request["max_rate_ms"] | adaptive.maxIntervalMs;
+    adaptive.slopeThreshold = request["slope_c_per_s"] | adaptive.slopeThreshold;
+    adaptive.accelThreshold = request["accel_c_per_s2"] | adaptive.accelThreshold;
+
+    if (adaptive.minIntervalMs >= 100 && adaptive.maxIntervalMs <= 60000 &&
+        adaptive.minIntervalMs <= adaptive.maxIntervalMs &&
+        adaptive.slopeThreshold > 0.0f && adaptive.accelThreshold > 0.0f)
+    {
+      if (!apply)
+        return;
+      configureAdaptiveRate(adaptive);
+      effectiveRateMs = adaptive.enabled ? adaptive.minIntervalMs : samplingRateMs;
+
+      preferences.putBool("adapt_on", adaptive.enabled);
+      preferences.putUInt("adapt_min", adaptive.minIntervalMs);
+      preferences.putUInt("adapt_max", adaptive.maxIntervalMs);
+      preferences.putFloat("adapt_slope", adaptive.slopeThreshold);
+      preferences.putFloat("adapt_accel", adaptive.accelThreshold);
+
+      docOut["type"] = "configuration";
+      payload["result"] = "adaptive_sampling_updated";
+      payload["enabled"] = adaptive.enabled;
+      payload["min_rate_ms"] = adaptive.minIntervalMs;
+      payload["max_rate_ms"] = adaptive.maxIntervalMs;
+      payload["slope_c_per_s"] = adaptive.slopeThreshold;
+      payload["accel_c_per_s2"] = adaptive.accelThreshold;
+    }
+    else
+    {
+      docOut["type"] = "error";
+      payload["error"] = "Invalid adaptive sampling. Rates must be 100-60000ms with min <= max, thresholds > 0";
+    }
+  }
+  else if (docIn["update_batch_mode"].is<JsonObject>())
+  {
+    JsonObject batch = docIn["update_batch_mode"];
+    int maxSamples = batch["max_samples"] | 1;
+    int maxAgeMs = batch["max_age_ms"] | 0;
+
+    if (maxSamples >= 1 && maxSamples <= SAMPLE_BATCH_CAPACITY && maxAgeMs >= 0 && maxAgeMs <= 60000)
+    {
+      if (!apply)
+        return;
+      configureSampleBatch(maxSamples, maxAgeMs);
+      preferences.putUInt("batch_samples", maxSamples);
+      preferences.putUInt("batch_age_ms", maxAgeMs);
+
+      docOut["type"] = "configuration";
+      payload["result"] = "batch_mode_updated";
+      payload["max_samples"] = sampleBatchMaxSamples();
+      payload["max_age_ms"] = sampleBatchMaxAgeMs();
+    }
+    else
+    {
+      docOut["type"] = "error";
+      payload["error"] = "Invalid batch mode. max_samples must be 1-64, max_age_ms 0-60000";
+      payload["requested_max_samples"] = maxSamples;
+      payload["requested_max_age_ms"] = maxAgeMs;
+    }
+  }
+  else if (docIn["update_tx_policy"].is<const char *>())
+  {
+    String policy = docIn["update_tx_policy"];
+
+    if (policy == "drop_oldest" || policy == "drop_newest")
+    {
+      if (!apply)
+        return;
+      setTxDropPolicy(policy == "drop_newest" ? TX_DROP_NEWEST : TX_DROP_OLDEST);
+      preferences.putUChar("tx_policy", txDropPolicy());
+
+      docOut["type"] = "configuration";
+      payload["result"] = "tx_policy_updated";
+      payload["tx_policy"] = policy;
+    }
+    else
+    {
+      docOut["type"] = "error";
+      payload["error"] = "Invalid TX policy. Use drop_oldest or drop_newest";
+      payload["requested_tx_policy"] = policy;
+    }
+  }
+  else if (docIn["run_benchmark"].is<bool>())
+  {
+    if (otaUpdateRequested || otaUpdateActive())
+    {
+      docOut["type"] = "error";
+      payload["error"] = "Benchmark unavailable during an OTA update";
+    }
+    else
+    {
+      if (!apply)
+        return;
+      DataMessage frame;
+      buildBenchmarkFrame(frame);
+
+      // Runs under the state lock, so sampling pauses until it finishes
+      const uint8_t csPins[] = {CS_PIN_1, CS_PIN_2, CS_PIN_3, CS_PIN_4};
+      int64_t started = esp_timer_get_time();
+      runBenchmarks(payload["results"].to<JsonArray>(), frame, csPins, sizeof(csPins));
+
+      docOut["type"] = "benchmark";
+      payload["firmware_version"] = FIRMWARE_VERSION;
+      payload["cpu_mhz"] = getCpuFrequencyMhz();
+      payload["duration_ms"] = (esp_timer_get_time() - started) / 1000;
+    }
+  }
+  else if (docIn["get_history"].is<JsonObject>())
+  {
+    JsonObject query = docIn["get_history"];
+    uint32_t sinceMs = query["since_ms"] | 0UL;
+    uint32_t maxPoints = query["max_points"] | 0UL;
+
+    // Rows follow as history frames, paced by the loop like backfill
+    if (maxPoints == 0 || (maxPoints >= 3 && maxPoints <= HISTORY_MAX_POINTS))
+    {
+      if (!apply)
+        return;
+      HistoryQuery started = historyStartQuery(sinceMs, maxPoints, THERMOCOUPLE_COUNT);
+
+      docOut["type"] = "configuration";
+      payload["result"] = "history_started";
+      payload["rows"] = started.rows;
+      payload["points"] = started.points;
+      payload["frames"] = started.frames;
+    }
+    else
+    {
+      docOut["type"] = "error";
+      payload["error"] = "Invalid max_points. Must be 3-20000, or 0 for every sample";
+      payload["requested_max_points"] = maxPoints;
+    }
+  }
+  else if (docIn["get_trace"].is<const char *>())
+  {
+    String source = docIn["get_trace"];
+
+    if (source == "live" || source == "crash")
+    {
+      if (!apply)
+        return;
+
+      // Trace frames go out first; this response marks the end of the dump
+      bool sent = sendTraceDump(source == "crash");
+
+      docOut["type"] = "configuration";
+      payload["result"] = sent ? "trace_sent" : "trace_empty";
+      payload["source"] = source;
+      payload["overhead_ns"] = traceOverheadNs();
+    }
+    else
+    {
+      docOut["type"] = "error";
+      payload["error"] = "Invalid trace source. Use live or crash";
+      payload["requested_source"] = source;
+    }
+  }
+  else if (docIn["update_mqtt"].is<JsonObject>())
+  {
+    JsonObject request = docIn["update_mqtt"];
+    MqttSettings mqtt = mqttSettings();
+    mqtt.enabled = request["enabled"] | mqtt.enabled;
+    mqtt.host = request["host"] | mqtt.host;
+    int port = request["port"] | (int)mqtt.port;
+    mqtt.baseTopic = request["topic"] | mqtt.baseTopic;
+    mqtt.username = request["username"] | mqtt.username;
+    mqtt.password = request["password"] | mqtt.password;
+
+    if (port >= 1 && port <= 65535 && (!mqtt.enabled || mqtt.host.length() > 0))
+    {
+      if (!apply)
+        return;
+      mqtt.port = port;
+      configureMqtt(mqtt);
+      preferences.putBool("mqtt_on", mqtt.enabled);
+      preferences.putString("mqtt_host", mqtt.host);
+      preferences.putUShort("mqtt_port", mqtt.port);
+      preferences.putString("mqtt_topic", mqtt.baseTopic);
+      preferences.putString("mqtt_user", mqtt.username);
+      preferences.putString("mqtt_pass", mqtt.password);
+
+      docOut["type"] = "configuration";
+      payload["result"] = "mqtt_updated";
+      payload["enabled"] = mqtt.enabled;
+      payload["host"] = mqtt.host;
+      payload["port"] = mqtt.port;
+      payload["topic"] = mqtt.baseTopic;
+    }
+    else
+    {
+      docOut["type"] = "error";
+      payload["error"] = "Invalid MQTT settings. host is required when enabled, port must be 1-65535";
+    }
+  }
+  else if (docIn["update_deadband"].is<JsonObject>())
+  {
+    JsonObject deadband = docIn["update_deadband"];
+    float thresholdC = deadband["threshold_c"] | 0.0f;
+    unsigned long keyframeMs = deadband["keyframe_interval_ms"] | 10000UL;
+
+    if (thresholdC >= 0.0f && thresholdC <= 50.0f && keyframeMs >= 1000 && keyframeMs <= 600000)
+    {
+      if (!apply)
+        return;
+      configureDeadband(thresholdC, keyframeMs);
+      preferences.putFloat("deadband_c", thresholdC);
+      preferences.putUInt("keyframe_ms", keyframeMs);
+
+      docOut["type"] = "configuration";
+      payload["result"] = "deadband_updated";
+      payload["threshold_c"] = deadbandThresholdC();
+      payload["keyframe_interval_ms"] = deadbandKeyframeIntervalMs();
+    }
+    else
+    {
+      docOut["type"] = "error";
+      payload["error"] = "Invalid deadband. threshold_c must be 0-50, keyframe_interval_ms 1000-600000";
+      payload["requested_threshold_c"] = thresholdC;
+      payload["requested_keyframe_interval_ms"] = keyframeMs;
+    }
+  }
+  else if (docIn["update_filter"].is<JsonObject>())
+  {
+    JsonObject filter = docIn["update_filter"];
+    int median = filter["median_window"] | 1;
+    float q = filter["process_noise"] | NOISE_FILTER_DEFAULT_Q;
+    float r = filter["measurement_noise"] | 0.0f;
+
+    // q = 0 with r > 0 drives the Kalman gain to zero and freezes readings
+    bool noiseValid = r >= 0.0f && (q > 0.0f || (q == 0.0f && r == 0.0f));
+    if ((median == 1 || median == 3 || median == NOISE_FILTER_MAX_MEDIAN) && noiseValid)
+    {
+      if (!apply)
+        return;
+      configureNoiseFilter(median, q, r);
+      preferences.putUChar("filter_median", median);
+      preferences.putFloat("filter_q", q);
+      preferences.putFloat("filter_r", r);
+
+      docOut["type"] = "configuration";
+      payload["result"] = "filter_updated";
+      payload["median_window"] = noiseFilterMedianWindow();
+      payload["process_noise"] = noiseFilterProcessNoise();
+      payload["measurement_noise"] = noiseFilterMeasurementNoise();
+    }
+    else
+    {
+      docOut["type"] = "error";
+      payload["error"] = "Invalid filter. median_window must be 1, 3 or 5, measurement_noise >= 0 and process_noise > 0 when measurement_noise is set";
+      payload["requested_median_window"] = median;
+      payload["requested_process_noise"] = q;
+    }
+  }
+  else if (docIn["sync_clock"].is<JsonObject>())
+  {
+    if (!apply)
+      return;
+    JsonObject sync = docIn["sync_clock"];
+    uint32_t seq = sync["seq"] | 0;
+    int64_t t1 = sync["t1"] | (int64_t)0;
+
+    // The host reports when our previous reply arrived, closing that exchange
+    if (sync["prev_t4"].is<int64_t>())
+    {
+      clockSyncCompletePing(sync["prev_seq"] | 0, sync["prev_t4"].as<int64_t>());
+    }
+
+    docOut["type"] = "clock_sync";
+    payload["seq"] = seq;
+    payload["t1"] = t1;
+    payload["t2"] = receivedUs;
+    payload["synced"] = clockSyncValid();
+    if (clockSyncValid())
+    {
+      payload["offset_us"] = clockSyncOffsetUs();
+      payload["drift_ppm"] = clockSyncDriftPpm();
+      payload["round_trip_us"] = clockSyncRoundTripUs();
+    }
+
+    int64_t replyUs = esp_timer_get_time();
+    payload["t3"] = replyUs;
+    clockSyncRecordPing(seq, t1, receivedUs, replyUs);
+  }
+  else if (docIn["subscribe"].is<JsonObject>())
+  {
+    JsonObject request = docIn["subscribe"];
+    unsigned long intervalMs = request["interval_ms"] | 1000UL;
+
+    // An empty topic list unsubscribes
+    uint8_t topics = 0;
+    bool validTopics = request["topics"].is<JsonArray>();
+    for (JsonVariant name : request["topics"].as<JsonArray>())
+    {
+      SubscriptionTopic topic;
+      if (parseSubscriptionTopic(name.as<const char *>(), topic))
+      {
+        topics |= SUB_MASK(topic);
+      }
+      else
+      {
+        validTopics = false;
+      }
+    }
+
+    if (validTopics && intervalMs >= 100 && intervalMs <= 60000)
+    {
+      if (!apply)
+        return;
+      configureSubscriptions(topics, intervalMs);
+
+      docOut["type"] = "configuration";
+      payload["result"] = topics ? "subscribed" : "unsubscribed";
+      JsonArray active = payload["topics"].to<JsonArray>();
+      for (uint8_t i = 0; i < SUB_TOPIC_COUNT; i++)
+      {
+        if (topics & SUB_MASK(i))
+        {
+          active.add(subscriptionTopicName((SubscriptionTopic)i));
+        }
+      }
+      payload["interval_ms"] = subscriptionIntervalMs();
+    }
+    else
+    {
+      docOut["type"] = "error";
+      payload["error"] = "Invalid subscription. topics must list status and/or metrics, interval_ms 100-60000";
+      payload["requested_interval_ms"] = intervalMs;
+    }
+  }
   else if (docIn["get_device_info"].is<bool>())
   {
+    if (!apply)
+      return;
     docOut["type"] = "device_info";
-    payload["serial_number"] = deviceSerialNumber;
-    payload["device_id"] = deviceId;
+    payload["serial_number"] = deviceSerialNumber();
+    payload["device_id"] = deviceShortId();
     payload["firmware_version"] = FIRMWARE_VERSION;
     payload["model"] = DEVICE_MODEL;
-    payload["wifi_configured"] = wifiConfigured;
+    payload["sensor_chip"] = THERMOCOUPLE_CHIP_NAME;
     payload["sampling_rate_ms"] = samplingRateMs;
-
-    if (wifiConfigured)
-    {
-      payload["wifi_ssid"] = WiFi.SSID();
-      payload["wifi_rssi"] = WiFi.RSSI();
-      payload["ip_address"] = WiFi.localIP().toString();
-    }
+    payload["adaptive_sampling"] = adaptiveRateConfig().enabled;
+    payload["batch_max_samples"] = sampleBatchMaxSamples();
+    payload["batch_max_age_ms"] = sampleBatchMaxAgeMs();
+    payload["deadband_c"] = deadbandThresholdC();
+    payload["keyframe_interval_ms"] = deadbandKeyframeIntervalMs();
+    payload["mqtt_enabled"] = mqttSettings().enabled;
+    payload["mqtt_queue_capacity_bytes"] = mqttQueueStats().capacityBytes;
+    payload["backfill_capacity"] = backfillCapacity();
+    payload["history_capacity"] = historyCapacity();
+    payload["tx_policy"] = txDropPolicy() == TX_DROP_NEWEST ? "drop_newest" : "drop_oldest";
+    payload["trace_crash_available"] = traceHasCrashDump();
+    addBootPhases(payload["boot"].to<JsonObject>());
+    addOtaGateStatus(payload["ota_gate"].to<JsonObject>());
+    addStatusFields(payload);
+    addMetricFields(payload);
   }
   else if (docIn["trigger_ota_update"].is<bool>())
   {
+    if (!apply)
+      return;
     docOut["type"] = "configuration";
     payload["result"] = "ota_update_triggered";
-    serializeJson(docOut, Serial);
-    Serial.println();
 
-    // Trigger OTA update
-    performOTAUpdate();
-    return;
+    // Runs on the loop task so this channel stays responsive
+    otaUpdateRequested = true;
+  }
+  else if (docIn["set_thermocouple_type"].is<const char *>())
+  {
+    int channel = docIn["channel"] | 0;
+    String type = docIn["set_thermocouple_type"];
+
+    // "chip" reverts to the amplifier's own conversion
+    const ThermocoupleTable *table = nullptr;
+    bool validType = type == "chip";
+    if (type.length() == 1)
+    {
+      table = thermocoupleTable(type[0]);
+      validType = table != nullptr;
+    }
+
+    if (!validType)
+    {
+      docOut["type"] = "error";
+      payload["error"] = "Invalid thermocouple type";
+      payload["requested_type"] = type;
+    }
+    else if (channel < 1 || channel > MAX_THERMOCOUPLE_CHANNELS)
+    {
+      docOut["type"] = "error";
+      payload["error"] = "Invalid channel number (1-4)";
+      payload["requested_channel"] = channel;
+    }
+    else if (!ThermocoupleChip::supportsType(table))
+    {
+      docOut["type"] = "error";
+      payload["error"] = "Thermocouple type not supported by " THERMOCOUPLE_CHIP_NAME;
+      payload["requested_type"] = type;
+    }
+    else
+    {
+      if (!apply)
+        return;
+      channelLinearization[channel - 1] = table;
+      if (channel <= THERMOCOUPLE_COUNT)
+      {
+        thermocouples.setType(channel - 1, table);
+      }
+
+      char key[12];
+      sprintf(key, "tc_type_%d", channel);
+      preferences.putString(key, table ? type : String(""));
+
+      docOut["type"] = "configuration";
+      payload["result"] = "thermocouple_type_updated";
+      payload["channel"] = channel;
+      payload["type"] = type;
+    }
+  }
+  else if (docIn["set_calibration"].is<JsonArray>())
+  {
+    int channel = docIn["channel"] | 0;
+    JsonArray points = docIn["set_calibration"];
+
+    // [{"raw_c": 99.1, "actual_c": 100.0}, ...]; an empty list clears
+    CalibrationPoints parsed = {};
+    const char *error = nullptr;
+    if (points.size() > CALIBRATION_MAX_POINTS)
+    {
+      error = "Invalid calibration: 1-16 points";
+    }
+    for (JsonObject point : points)
+    {
+      if (error)
+        break;
+      if (!point["raw_c"].is<float>() || !point["actual_c"].is<float>())
+      {
+        error = "Invalid calibration: each point needs raw_c and actual_c";
+        break;
+      }
+      parsed.rawMilliC[parsed.count] = lroundf(point["raw_c"].as<float>() * 1000.0f);
+      parsed.actualMilliC[parsed.count] = lroundf(point["actual_c"].as<float>() * 1000.0f);
+      parsed.count++;
+    }
+
+    CalibrationCurve curve = {};
+    if (channel < 1 || channel > MAX_THERMOCOUPLE_CHANNELS)
+    {
+      docOut["type"] = "error";
+      payload["error"] = "Invalid channel number (1-4)";
+      payload["requested_channel"] = channel;
+    }
+    else if (error || (parsed.count > 0 && !calibrationBuild(parsed, curve, error)))
+    {
+      docOut["type"] = "error";
+      payload["error"] = error;
+      payload["channel"] = channel;
+    }
+    else
+    {
+      if (!apply)
+        return;
+      calibration.curves[channel - 1] = curve;
+      calibration.id = calibrationSetId(calibration);
+
+      char key[12];
+      sprintf(key, "cal_%d", channel);
+      if (parsed.count > 0)
+      {
+        preferences.putBytes(key, &parsed, sizeof(parsed));
+      }
+      else
+      {
+        preferences.remove(key);
+      }
+
+      docOut["type"] = "configuration";
+      payload["result"] = "calibration_updated";
+      payload["channel"] = channel;
+      payload["points"] = parsed.count;
+      payload["calibration_id"] = calibration.id;
+    }
   }
-  // else if (docIn.containsKey("set_thermocouple_type")) {
-  //   int channel = docIn["channel"];
-  //   String type = docIn["set_thermocouple_type"];
-
-  //   max31856_thermocoupletype_t tcType;
-
-  //   if (type == "K") tcType = MAX31856_TCTYPE_K;
-  //   else if (type == "J") tcType = MAX31856_TCTYPE_J;
-  //   else if (type == "T") tcType = MAX31856_TCTYPE_T;
-  //   else if (type == "N") tcType = MAX31856_TCTYPE_N;
-  //   else if (type == "S") tcType = MAX31856_TCTYPE_S;
-  //   else if (type == "E") tcType = MAX31856_TCTYPE_E;
-  //   else if (type == "B") tcType = MAX31856_TCTYPE_B;
-  //   else if (type == "R") tcType = MAX31856_TCTYPE_R;
-  //   else {
-  //     docOut["type"] = "error";
-  //     payload["error"] = "Invalid thermocouple type";
-  //     payload["requested_type"] = type;
-  //     serializeJson(docOut, Serial);
-  //     Serial.println();
-  //     return;
-  //   }
-
-  //   bool success = false;
-  //   // if (channel == 1) { thermocouple1.setThermocoupleType(tcType); success = true; }
-  //   // else if (channel == 2) { thermocouple2.setThermocoupleType(tcType); success = true; }
-  //   // else if (channel == 3) { thermocouple3.setThermocoupleType(tcType); success = true; }
-  //   // else if (channel == 4) { thermocouple4.setThermocoupleType(tcType); success = true; }
-
-  //   if (success) {
-  //     docOut["type"] = "configuration";
-  //     payload["result"] = "thermocouple_type_updated";
-  //     payload["channel"] = channel;
-  //     payload["type"] = type;
-  //   } else {
-  //     docOut["type"] = "error";
-  //     payload["error"] = "Invalid channel number (1-4)";
-  //     payload["requested_channel"] = channel;
-  //   }
-  // }
   else
   {
     docOut["type"] = "error";
     payload["error"] = "Unknown command";
-    payload["received"] = command;
+    if (command)
+    {
+      payload["received"] = command;
+    }
+    else
+    {
+      payload["received"] = docIn;
+    }
+  }
+}
+
+// Runs a {"batch": [...]} frame's operations in order and collects their
+// responses into one reply. The whole batch is a single command callback
+// under the state lock, so no sample or other command lands between its
+// operations. Every operation is validated before any is applied, so a
+// batch with an invalid operation changes nothing: the reply holds only
+// that operation's error and failed_at. update_adaptive_sampling and
+// update_mqtt merge with the current settings, so each may appear once,
+// and trigger_ota_update only last, where it cannot fail a later benchmark.
+// A malformed batch runs nothing and gets the standard error response.
+void executeBatch(JsonArray ops, JsonObject docOut, JsonObject payload, int64_t receivedUs)
+{
+  bool valid = ops.size() >= 1 && ops.size() <= BATCH_MAX_OPS;
+  int adaptiveOps = 0, mqttOps = 0;
+  size_t index = 0;
+  for (JsonVariant op : ops)
+  {
+    valid = valid && op.is<JsonObject>() && op["batch"].isNull();
+    valid = valid && (op["trigger_ota_update"].isNull() || index == ops.size() - 1);
+    adaptiveOps += !op["update_adaptive_sampling"].isNull();
+    mqttOps += !op["update_mqtt"].isNull();
+    index++;
   }
+  valid = valid && adaptiveOps <= 1 && mqttOps <= 1;
 
-  serializeJson(docOut, Serial);
-  Serial.println();
+  if (!valid)
+  {
+    docOut["type"] = "error";
+    payload["error"] = "Invalid batch. Must hold 1-16 command objects, no nested batch, update_adaptive_sampling "
+                       "and update_mqtt at most once, trigger_ota_update only last";
+    payload["requested_ops"] = ops.size();
+    return;
+  }
+
+  docOut["type"] = "batch";
+  JsonArray results = payload["results"].to<JsonArray>();
+  for (int pass = 0; pass < 2; pass++)
+  {
+    bool apply = pass == 1;
+    int position = 0;
+    for (JsonObject op : ops)
+    {
+      JsonObject result = results.add<JsonObject>();
+      if (!op["request_id"].isNull())
+      {
+        result["request_id"] = op["request_id"];
+      }
+      executeCommand(op, result, result["payload"].to<JsonObject>(), nullptr, receivedUs, apply);
+
+      if (result["type"] == "error")
+      {
+        payload["completed"] = apply ? position : 0;
+        payload["failed_at"] = position;
+        return;
+      }
+      if (!apply)
+      {
+        // Validation leaves only an error in the reply
+        results.remove(results.size() - 1);
+      }
+      position++;
+    }
+  }
+
+  payload["completed"] = results.size();
 }
 
-void sendReadyMessage()
+// Fields that change with connectivity and mode; the "status" subscription
+void addStatusFields(JsonObject out)
 {
-  JsonDocument doc;
-  doc["type"] = "ready";
-  doc["device_id"] = deviceSerialNumber;
-  doc["firmware_version"] = FIRMWARE_VERSION;
-  doc["model"] = DEVICE_MODEL;
+  out["wifi_configured"] = wifiIsConfigured();
+  out["effective_sampling_rate_ms"] = effectiveRateMs;
+  out["mqtt_connected"] = mqttConnected();
+  out["clock_synced"] = clockSyncValid();
+  out["roast_state"] = currentRoastState == ROASTING ? "roasting" : "idle";
+  out["power_mode"] = powerModeName(currentPowerMode);
+
+  JsonArray channels = out["channels"].to<JsonArray>();
+  for (int i = 0; i < THERMOCOUPLE_COUNT; i++)
+  {
+    JsonObject channel = channels.add<JsonObject>();
+    channel["channel"] = i + 1;
+    channel["online"] = channelHealth[i].online;
+    channel["recoveries"] = channelHealth[i].recoveries;
+    channel["calibration_points"] = calibration.curves[i].count;
+  }
+  out["calibration_id"] = calibration.id;
 
-  JsonObject meta = doc["metadata"].to<JsonObject>();
-  meta["timestamp"] = millis();
-  meta["sampling_rate_ms"] = samplingRateMs;
+  if (wifiIsConfigured())
+  {
+    out["wifi_ssid"] = WiFi.SSID();
+    out["ip_address"] = WiFi.localIP().toString();
+    out["wifi_connect_ms"] = wifiLastConnectMs();
+    out["wifi_connect_path"] = wifiLastConnectPath();
+  }
+}
 
-  serializeJson(doc, Serial);
-  Serial.println();
+// Counters and gauges; the "metrics" subscription
+void addMetricFields(JsonObject out)
+{
+  MqttQueueStats mqtt = mqttQueueStats();
+  out["mqtt_queue_depth"] = mqtt.depth;
+  out["mqtt_queue_bytes"] = mqtt.bytes;
+  out["mqtt_in_flight"] = mqtt.inFlight;
+  out["mqtt_dropped"] = mqtt.dropped;
+  out["backfill_buffered"] = backfillDepth();
+  out["backfill_dropped"] = backfillDropped();
+  out["history_buffered"] = historyDepth();
+  addTxStats(out["tx_telemetry"].to<JsonObject>(), txStats(TX_TELEMETRY));
+  addTxStats(out["tx_responses"].to<JsonObject>(), txStats(TX_RESPONSE));
+  if (lastWakeLatencyUs >= 0)
+  {
+    out["wake_to_sample_us"] = lastWakeLatencyUs;
+  }
+  if (wifiIsConfigured())
+  {
+    out["wifi_rssi"] = WiFi.RSSI();
+  }
 }
 
-// ============================================================================
-// LED STATUS MANAGEMENT
-// ============================================================================
+void addSubscriptionSnapshot(SubscriptionTopic topic, JsonObject out)
+{
+  if (topic == SUB_STATUS)
+  {
+    addStatusFields(out);
+  }
+  else
+  {
+    addMetricFields(out);
+  }
+}
 
-void setConnectionState(ConnectionState state)
+void addTxStats(JsonObject out, const TxClassStats &stats)
 {
-  currentConnectionState = state;
+  out["queued"] = stats.queued;
+  out["sent"] = stats.sent;
+  out["dropped"] = stats.dropped;
+  out["pending_bytes"] = stats.pendingBytes;
+}
 
-  switch (state)
+void sendCommandResponse(JsonDocument &docOut)
+{
+  int64_t sentUs = esp_timer_get_time();
+  JsonObject meta = docOut["metadata"];
+  meta["sent_us"] = sentUs;
+  if (clockSyncValid())
   {
-  case DISCONNECTED:
-    digitalWrite(LED_CONN, HIGH); // OFF
-    digitalWrite(LED_DATA, HIGH); // OFF
-    break;
+    meta["host_time_us"] = clockSyncToHostUs(sentUs);
+  }
 
-  case SETUP_MODE:
-    // Handled by blinkSetupLED() in loop
-    digitalWrite(LED_CONN, HIGH); // OFF
-    break;
+  sendJson(docOut);
+}
 
-  case CONNECTED:
-    digitalWrite(LED_CONN, LOW);  // ON (solid)
-    digitalWrite(LED_DATA, HIGH); // OFF
-    break;
+void sendReadyMessage()
+{
+  ReadyMessage msg = {};
+  msg.deviceId = protoSpan(deviceSerialNumber());
+  msg.firmwareVersion = protoSpan(FIRMWARE_VERSION);
+  msg.model = protoSpan(DEVICE_MODEL);
+  msg.metadata.timestamp = millis();
+  msg.metadata.samplingRateMs = samplingRateMs;
+
+  char frame[256];
+  size_t length = encodeReadyMessage(msg, frame, sizeof(frame));
+  if (length > 0)
+  {
+    sendFrame(frame, length);
+  }
+}
+
+// ============================================================================
+// EVENTS AND POWER
+// ============================================================================
 
-  case TRANSMITTING:
-    digitalWrite(LED_CONN, LOW); // ON
-    digitalWrite(LED_DATA, LOW); // ON (brief)
-    break;
+void handleBusEvents()
+{
+  BusEvent event;
+  while (busPoll(loopBusSubscriber, event))
+  {
+    switch (event.type)
+    {
+    case BUS_WIFI_CONNECTED:
+      bootMark(BOOT_WIFI_SETTLED);
+      break;
+    case BUS_SETUP_MODE:
+      // No network, so no startup update check either
+      bootMark(BOOT_WIFI_SETTLED);
+      bootSkip(BOOT_UPDATE_CHECKED);
+      break;
+    }
   }
 }
 
-void blinkSetupLED()
+void IRAM_ATTR onBootButton()
+{
+  lastHostActivityTime = millis();
+  eventLoopSignalFromISR(EVENT_BUTTON);
+}
+
+void updatePowerMode(unsigned long now)
 {
-  static unsigned long lastBlink = 0;
-  if (millis() - lastBlink > 500)
+  PowerPolicyInput input;
+  input.roasting = currentRoastState == ROASTING;
+  input.setupMode = wifiSetupModeActive();
+  input.hostConnected = hostConnected();
+  input.msSinceActivity = min(now - lastActivityTime, now - lastHostActivityTime);
+
+  PowerMode mode = selectPowerMode(input, POWER_IDLE_DELAY_MS);
+  if (mode == currentPowerMode)
+    return;
+
+  if (mode == POWER_PERFORMANCE)
   {
-    digitalWrite(LED_DATA, !digitalRead(LED_DATA));
-    lastBlink = millis();
+    // Take a sample straight away and time how long the wake took
+    wakeStartUs = esp_timer_get_time();
+    wakeSamplePending = true;
+    lastReadingTime = now - effectiveRateMs;
   }
+
+  // The host's next line may arrive as the UART wakes, minus its first bytes
+  if (mode == POWER_IDLE_SLEEP && powerManagerLightSleep())
+    commandChannelResync();
+
+  powerManagerApply(mode);
+  currentPowerMode = mode;
+  serialLog("Power mode: %s", powerModeName(mode));
 }
 
 void checkFactoryReset()
@@ -635,27 +1634,24 @@ void checkFactoryReset()
     // Check if held for 5 seconds
     if (millis() - bootPressStart > 5000)
     {
-      Serial.println("\n=== FACTORY RESET ===");
+      serialLog("\n=== FACTORY RESET ===");
 
-      // Clear all preferences
+      // Clear all preferences. The command task writes them under the state
+      // lock, which stays held until the restart so none is written back.
+      acquireStateLock();
       preferences.clear();
 
       // Notify via serial
       JsonDocument doc;
       doc["type"] = "factory_reset";
       doc["message"] = "All settings cleared, rebooting...";
-      serializeJson(doc, Serial);
-      Serial.println();
+      sendJson(doc);
 
-      // Blink LEDs rapidly
-      for (int i = 0; i < 10; i++)
-      {
-        digitalWrite(LED_CONN, !digitalRead(LED_CONN));
-        digitalWrite(LED_DATA, !digitalRead(LED_DATA));
-        delay(100);
-      }
+      // The LED task blinks both LEDs rapidly for a second
+      BusEvent event = {BUS_FACTORY_RESET, (uint32_t)millis(), 0, 0};
+      busPublish(event);
 
-      delay(1000);
+      delay(2000);
       ESP.restart();
     }
   }
@@ -669,14 +1665,39 @@ void checkFactoryReset()
 // UTILITY FUNCTIONS
 // ============================================================================
 
-int calculateLoopDelay(int samplingRate)
+unsigned long calculateWakeTimeout(unsigned long now)
 {
-  if (samplingRate <= 2000)
+  // The captive portal's DNS and web servers are polled
+  if (wifiSetupModeActive())
     return 10;
-  else if (samplingRate <= 10000)
-    return 50;
-  else if (samplingRate <= 30000)
+
+  // Factory reset measures how long the button stays down
+  if (digitalRead(BOOT_BTN) == LOW)
     return 100;
-  else
-    return 250;
-}
\ No newline at end of file
+
+  // Drain a backfill or history query as fast as the link takes it
+  if (hostConnected() && (backfillPending() || historyPending()))
+    return txTelemetryBacklogged() ? 5 : 0;
+
+  // Upper bound so interval-based housekeeping (WiFi check, OTA check,
+  // chip recovery) still runs on an idle device
+  unsigned long timeout = 1000;
+
+  // Join timeouts are polled, so the cached-AP fallback is not late
+  if (wifiJoining())
+    timeout = 100;
+
+  unsigned long sinceReading = now - lastReadingTime;
+  unsigned long untilReading = sinceReading >= (unsigned long)effectiveRateMs ? 0 : effectiveRateMs - sinceReading;
+
+  timeout = min(timeout, untilReading);
+  if (adaptiveRateConfig().enabled && (uint32_t)effectiveRateMs > adaptiveRateConfig().minIntervalMs)
+  {
+    unsigned long sinceProbe = now - lastProbeTime;
+    unsigned long probeMs = adaptiveRateConfig().minIntervalMs;
+    timeout = min(timeout, sinceProbe >= probeMs ? 0 : probeMs - sinceProbe);
+  }
+  timeout = min(timeout, sampleBatchMsUntilDue(now));
+  timeout = min(timeout, subscriptionMsUntilDue(now));
+  return timeout;
+}
@@ -0,0 +1,399 @@
+#include <WiFi.h>
+#include <mqtt_client.h>
+#include <esp_heap_caps.h>
+#include "mqtt_publisher.h"
+#include "mqtt_queue.h"
+#include "wifi/wifi_manager.h"
+#include "scheduler/event_bus.h"
+#include "serial/serial_tx.h"
+#include "trace/trace_recorder.h"
+
+// Frames are queued by the loop and published by a task of their own, so a
+// slow broker never stalls sampling. Up to MQTT_MAX_IN_FLIGHT QoS 1
+// messages are on the wire at once: esp-mqtt keeps each in its outbox,
+// retransmits it after a reconnect and reports its PUBACK. A message leaves
+// the queue only once the broker has acknowledged it; while disconnected
+// the queue fills and then drops its oldest entries.
+
+static const size_t QUEUE_BYTES_PSRAM = 1024 * 1024;
+static const size_t QUEUE_BYTES_INTERNAL = 16 * 1024; // Fallback without PSRAM
+
+static const UBaseType_t MQTT_TASK_PRIORITY = 1;
+static const uint32_t MQTT_TASK_STACK = 6144;
+
+static const int MQTT_KEEPALIVE_S = 30;
+static const int MQTT_NETWORK_TIMEOUT_MS = 2000;
+static const unsigned long RECONNECT_MIN_MS = 1000;
+static const unsigned long RECONNECT_MAX_MS = 30000;
+static const TickType_t IDLE_POLL_TICKS = pdMS_TO_TICKS(1000);
+
+static MqttQueue queue;
+static uint8_t *queueStorage = nullptr;
+
+static SemaphoreHandle_t queueMutex = nullptr;
+static TaskHandle_t mqttTaskHandle = nullptr;
+
+static MqttSettings settings = {false, "", 1883, "", "", ""};
+static bool settingsChanged = false;
+static String mqttClientId;
+
+static esp_mqtt_client_handle_t client = nullptr;
+static volatile bool brokerConnected = false;
+static volatile bool brokerLost = false; // Set by each disconnect or failed connect
+static volatile int brokerError = 0;
+static int busSubscriber = -1;
+
+static String topicPath(const MqttSettings &active, uint8_t topic)
+{
+    String base = active.baseTopic.length() > 0 ? active.baseTopic : "roaster/" + mqttClientId;
+    return base + (topic == MQTT_TOPIC_EVENTS ? "/events" : "/data");
+}
+
+// Runs on the esp-mqtt task
+static void onMqttEvent(void *, esp_event_base_t, int32_t eventId, void *eventData)
+{
+    esp_mqtt_event_handle_t event = (esp_mqtt_event_handle_t)eventData;
+    switch (eventId)
+    {
+    case MQTT_EVENT_CONNECTED:
+        brokerConnected = true;
+        break;
+    case MQTT_EVENT_DISCONNECTED:
+        brokerConnected = false;
+        brokerLost = true;
+        xSemaphoreTake(queueMutex, portMAX_DELAY);
+        mqttQueueDisconnected(queue);
+        xSemaphoreGive(queueMutex);
+        break;
+    case MQTT_EVENT_ERROR:
+        brokerError = event->error_handle->error_type == MQTT_ERROR_TYPE_CONNECTION_REFUSED
+                          ? event->error_handle->connect_return_code
+                          : -event->error_handle->esp_transport_sock_errno;
+        return;
+    case MQTT_EVENT_PUBLISHED:
+        xSemaphoreTake(queueMutex, portMAX_DELAY);
+        mqttQueueAcked(queue, event->msg_id);
+        xSemaphoreGive(queueMutex);
+        break;
+    case MQTT_EVENT_DELETED:
+        // Expired in the outbox before an ack; publish it again
+        xSemaphoreTake(queueMutex, portMAX_DELAY);
+        mqttQueueExpired(queue, event->msg_id);
+        xSemaphoreGive(queueMutex);
+        break;
+    default:
+        return;
+    }
+    xTaskNotifyGive(mqttTaskHandle);
+}
+
+static void startClient(const MqttSettings &active)
+{
+    esp_mqtt_client_config_t config = {};
+#if ESP_IDF_VERSION_MAJOR >= 5
+    config.broker.address.hostname = active.host.c_str();
+    config.broker.address.port = active.port;
+    config.broker.address.transport = MQTT_TRANSPORT_OVER_TCP;
+    config.credentials.client_id = mqttClientId.c_str();
+    config.credentials.username = active.username.length() > 0 ? active.username.c_str() : nullptr;
+    config.credentials.authentication.password = active.password.length() > 0 ? active.password.c_str() : nullptr;
+    config.session.keepalive = MQTT_KEEPALIVE_S;
+    config.network.timeout_ms = MQTT_NETWORK_TIMEOUT_MS;
+    config.network.disable_auto_reconnect = true;
+    config.buffer.size = 256;
+    config.buffer.out_size = MQTT_MESSAGE_MAX + 256;
+#else
+    config.host = active.host.c_str();
+    config.port = active.port;
+    config.transport = MQTT_TRANSPORT_OVER_TCP;
+    config.client_id = mqttClientId.c_str();
+    config.username = active.username.length() > 0 ? active.username.c_str() : nullptr;
+    config.password = active.password.length() > 0 ? active.password.c_str() : nullptr;
+    config.keepalive = MQTT_KEEPALIVE_S;
+    config.network_timeout_ms = MQTT_NETWORK_TIMEOUT_MS;
+    config.disable_auto_reconnect = true;
+    config.buffer_size = 256;
+    config.out_buffer_size = MQTT_MESSAGE_MAX + 256;
+#endif
+
+    // The client copies the strings; reconnects are paced by the task
+    client = esp_mqtt_client_init(&config);
+    esp_mqtt_client_register_event(client, MQTT_EVENT_ANY, onMqttEvent, nullptr);
+    brokerLost = false;
+    brokerError = 0;
+    esp_mqtt_client_start(client);
+}
+
+static void stopClient()
+{
+    if (!client)
+        return;
+
+    // The outbox goes with the client, so whatever was in flight is resent
+    esp_mqtt_client_stop(client);
+    esp_mqtt_client_destroy(client);
+    client = nullptr;
+    brokerConnected = false;
+
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    mqttQueueResendAll(queue);
+    xSemaphoreGive(queueMutex);
+}
+
+// Roast state changes arrive on the event bus; turn them into frames on
+// this task rather than on the sampling path
+static void queueRoastEvents()
+{
+    BusEvent event;
+    while (busPoll(busSubscriber, event))
+    {
+        JsonDocument doc;
+        doc["type"] = "roast_event";
+        doc["device_id"] = mqttClientId;
+        doc["timestamp"] = event.timestampMs;
+        if (event.hostTimeUs != 0)
+        {
+            doc["host_time_us"] = event.hostTimeUs;
+        }
+
+        if (event.type == BUS_ROAST_STARTED)
+        {
+            doc["event"] = "roast_started";
+            doc["temperature_c"] = event.value / 100.0f;
+        }
+        else
+        {
+            doc["event"] = "roast_ended";
+            doc["duration_s"] = event.value;
+        }
+
+        mqttPublish(MQTT_TOPIC_EVENTS, doc);
+    }
+}
+
+static void mqttTask(void *)
+{
+    static char payload[MQTT_MESSAGE_MAX];
+    MqttSettings active;
+    unsigned long backoffMs = RECONNECT_MIN_MS;
+    unsigned long nextAttempt = 0;
+    bool announced = false;
+
+    for (;;)
+    {
+        xSemaphoreTake(queueMutex, portMAX_DELAY);
+        bool reconfigure = settingsChanged;
+        if (reconfigure)
+        {
+            active = settings;
+            settingsChanged = false;
+        }
+        xSemaphoreGive(queueMutex);
+
+        queueRoastEvents();
+
+        if (reconfigure)
+        {
+            stopClient();
+            backoffMs = RECONNECT_MIN_MS;
+            nextAttempt = 0;
+        }
+
+        if (!active.enabled || active.host.length() == 0 || !wifiIsConfigured() || !WiFi.isConnected())
+        {
+            stopClient();
+            ulTaskNotifyTake(pdTRUE, IDLE_POLL_TICKS);
+            continue;
+        }
+
+        if (!client)
+        {
+            startClient(active);
+            announced = false;
+        }
+
+        if (brokerLost)
+        {
+            brokerLost = false;
+            serialLog("MQTT %s %s:%u failed (%d), retry in %lu ms", announced ? "connection to" : "connect to",
+                      active.host.c_str(), active.port, (int)brokerError, backoffMs);
+            nextAttempt = millis() + backoffMs;
+            backoffMs = min(backoffMs * 2, RECONNECT_MAX_MS);
+            announced = false;
+            continue;
+        }
+
+        if (!brokerConnected)
+        {
+            unsigned long now = millis();
+            if (nextAttempt != 0 && (long)(now - nextAttempt) >= 0)
+            {
+                nextAttempt = 0;
+                esp_mqtt_client_reconnect(client);
+            }
+            ulTaskNotifyTake(pdTRUE, nextAttempt != 0 ? pdMS_TO_TICKS(nextAttempt - now) : IDLE_POLL_TICKS);
+            continue;
+        }
+
+        if (!announced)
+        {
+            serialLog("✓ MQTT connected to %s:%u", active.host.c_str(), active.port);
+            announced = true;
+            backoffMs = RECONNECT_MIN_MS;
+        }
+
+        // Copy the next unsent message out so the loop can keep queueing
+        // while it is written
+        xSemaphoreTake(queueMutex, portMAX_DELAY);
+        size_t index;
+        uint8_t topic = 0;
+        const char *queued;
+        size_t length = mqttQueueNext(queue, &index, &topic, &queued);
+        uint32_t pops = queue.pops;
+        if (length > 0)
+            memcpy(payload, queued, length);
+        xSemaphoreGive(queueMutex);
+
+        // Empty, or the window is full until the next PUBACK
+        if (length == 0)
+        {
+            ulTaskNotifyTake(pdTRUE, IDLE_POLL_TICKS);
+            continue;
+        }
+
+        traceBegin(TRACE_MQTT_PUBLISH);
+        int packetId = esp_mqtt_client_publish(client, topicPath(active, topic).c_str(), payload, length, 1, 0);
+        traceEnd(TRACE_MQTT_PUBLISH);
+
+        if (packetId > 0)
+        {
+            xSemaphoreTake(queueMutex, portMAX_DELAY);
+            mqttQueueSent(queue, index, pops, packetId);
+            xSemaphoreGive(queueMutex);
+        }
+        else
+        {
+            // The session is going down; the disconnect event paces the retry
+            ulTaskNotifyTake(pdTRUE, IDLE_POLL_TICKS);
+        }
+    }
+}
+
+void mqttPublisherBegin(const MqttSettings &initial, const String &clientId)
+{
+    mqttClientId = clientId;
+    settings = initial;
+    settingsChanged = true;
+    queueMutex = xSemaphoreCreateMutex();
+
+    size_t queueBytes = QUEUE_BYTES_PSRAM;
+    queueStorage = (uint8_t *)heap_caps_malloc(queueBytes, MALLOC_CAP_SPIRAM);
+    if (!queueStorage)
+    {
+        serialLog("⚠ No PSRAM for MQTT queue, using a small internal one");
+        queueBytes = QUEUE_BYTES_INTERNAL;
+        queueStorage = (uint8_t *)malloc(queueBytes);
+    }
+    mqttQueueInit(queue, queueStorage, queueStorage ? queueBytes : 0);
+
+    busSubscriber = busSubscribe(BUS_MASK(BUS_ROAST_STARTED) | BUS_MASK(BUS_ROAST_ENDED),
+                                 [](void *)
+                                 {
+                                     if (mqttTaskHandle)
+                                         xTaskNotifyGive(mqttTaskHandle);
+                                 },
+                                 nullptr);
+
+    xTaskCreatePinnedToCore(mqttTask, "mqtt", MQTT_TASK_STACK, nullptr,
+                            MQTT_TASK_PRIORITY, &mqttTaskHandle, ARDUINO_RUNNING_CORE);
+}
+
+void configureMqtt(const MqttSettings &newSettings)
+{
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    settings = newSettings;
+    settingsChanged = true;
+    xSemaphoreGive(queueMutex);
+    xTaskNotifyGive(mqttTaskHandle);
+}
+
+MqttSettings mqttSettings()
+{
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    MqttSettings copy = settings;
+    xSemaphoreGive(queueMutex);
+    return copy;
+}
+
+// ArduinoJson output straight into a reserved payload, no terminator
+struct PayloadWriter
+{
+    char *next;
+
+    size_t write(uint8_t c)
+    {
+        *next++ = c;
+        return 1;
+    }
+
+    size_t write(const uint8_t *bytes, size_t length)
+    {
+        memcpy(next, bytes, length);
+        next += length;
+        return length;
+    }
+};
+
+// fill writes exactly length payload bytes into the queue
+template <typename Fill>
+static bool queueMessage(MqttTopic topic, size_t length, Fill fill)
+{
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    if (!settings.enabled || !queueStorage)
+    {
+        xSemaphoreGive(queueMutex);
+        return false;
+    }
+
+    char *payload = length < MQTT_MESSAGE_MAX ? mqttQueuePush(queue, topic, length) : nullptr;
+    if (!payload)
+    {
+        if (length >= MQTT_MESSAGE_MAX)
+            queue.ring.dropped++;
+        xSemaphoreGive(queueMutex);
+        return false;
+    }
+    fill(payload);
+    xSemaphoreGive(queueMutex);
+
+    xTaskNotifyGive(mqttTaskHandle);
+    return true;
+}
+
+bool mqttPublish(MqttTopic topic, JsonDocument &doc)
+{
+    return queueMessage(topic, measureJson(doc), [&](char *payload)
+                        {
+                            PayloadWriter writer = {payload};
+                            serializeJson(doc, writer); });
+}
+
+bool mqttPublishFrame(MqttTopic topic, const char *frame, size_t length)
+{
+    return queueMessage(topic, length, [&](char *payload)
+                        { memcpy(payload, frame, length); });
+}
+
+bool mqttConnected()
+{
+    return brokerConnected;
+}
+
+MqttQueueStats mqttQueueStats()
+{
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    MqttQueueStats stats = {queue.ring.frames, queue.ring.used, queue.ring.capacity,
+                            mqttQueueInFlight(queue), queue.ring.dropped};
+    xSemaphoreGive(queueMutex);
+    return stats;
+}
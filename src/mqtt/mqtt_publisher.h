@@ -0,0 +1,42 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Largest serialized frame the queue and client buffers will carry
+#define MQTT_MESSAGE_MAX 4096
+
+enum MqttTopic
+{
+    MQTT_TOPIC_DATA,   // <base>/data: data and data_batch frames
+    MQTT_TOPIC_EVENTS, // <base>/events: roast start/end
+};
+
+struct MqttSettings
+{
+    bool enabled;
+    String host;
+    uint16_t port;
+    String baseTopic;
+    String username;
+    String password;
+};
+
+void mqttPublisherBegin(const MqttSettings &settings, const String &clientId);
+void configureMqtt(const MqttSettings &settings);
+MqttSettings mqttSettings();
+
+// Queues a frame for QoS 1 delivery; false if MQTT is off or it did not fit
+bool mqttPublish(MqttTopic topic, JsonDocument &doc);
+bool mqttPublishFrame(MqttTopic topic, const char *frame, size_t length);
+
+struct MqttQueueStats
+{
+    size_t depth; // Messages queued, in flight included
+    size_t bytes;
+    size_t capacityBytes;
+    size_t inFlight; // Published, waiting for PUBACK
+    uint32_t dropped;
+};
+
+bool mqttConnected();
+MqttQueueStats mqttQueueStats();
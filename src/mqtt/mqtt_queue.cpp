@@ -0,0 +1,161 @@
+#include <string.h>
+#include "mqtt_queue.h"
+
+static void popHead(MqttQueue &queue)
+{
+    txRingPop(queue.ring);
+    memmove(queue.packetIds, queue.packetIds + 1, sizeof(queue.packetIds) - sizeof(queue.packetIds[0]));
+    queue.packetIds[MQTT_MAX_IN_FLIGHT - 1] = 0;
+    queue.pops++;
+}
+
+static void popAcked(MqttQueue &queue)
+{
+    while (queue.ring.frames > 0 && queue.packetIds[0] == -1)
+    {
+        popHead(queue);
+        queue.ring.sent++;
+    }
+}
+
+static int findPacket(const MqttQueue &queue, int32_t packetId)
+{
+    for (int i = 0; i < MQTT_MAX_IN_FLIGHT; i++)
+    {
+        if (queue.packetIds[i] == packetId)
+            return i;
+    }
+    return -1;
+}
+
+static const int32_t PACKET_ID_COUNT = 65535; // 1-65535
+
+// Whether packetId is one of the next MQTT_MAX_IN_FLIGHT ids after the
+// last recorded publish, across the wrap
+static bool inPublishWindow(const MqttQueue &queue, int32_t packetId)
+{
+    if (packetId < 1 || packetId > PACKET_ID_COUNT)
+        return false;
+    if (queue.lastPacketId == 0)
+        return true;
+    int32_t ahead = (packetId - queue.lastPacketId + PACKET_ID_COUNT) % PACKET_ID_COUNT;
+    return ahead >= 1 && ahead <= MQTT_MAX_IN_FLIGHT;
+}
+
+void mqttQueueInit(MqttQueue &queue, uint8_t *storage, size_t capacity)
+{
+    memset(&queue, 0, sizeof(queue));
+    txRingInit(queue.ring, storage, capacity);
+}
+
+char *mqttQueuePush(MqttQueue &queue, uint8_t topic, size_t length)
+{
+    if (length + 1 > txRingMaxFrame(queue.ring))
+    {
+        queue.ring.dropped++;
+        return nullptr;
+    }
+
+    // Evict here rather than in txRingPush so the window moves with the head
+    uint8_t *frame;
+    while (!(frame = txRingPush(queue.ring, length + 1, TX_NEVER_DROP)))
+    {
+        popHead(queue);
+        queue.ring.dropped++;
+    }
+
+    frame[0] = topic;
+    return (char *)frame + 1;
+}
+
+size_t mqttQueueNext(const MqttQueue &queue, size_t *index, uint8_t *topic, const char **payload)
+{
+    for (size_t i = 0; i < MQTT_MAX_IN_FLIGHT && i < queue.ring.frames; i++)
+    {
+        if (queue.packetIds[i] != 0)
+            continue;
+
+        const uint8_t *frame;
+        size_t length = txRingPeekAt(queue.ring, i, &frame);
+        *index = i;
+        *topic = frame[0];
+        *payload = (const char *)frame + 1;
+        return length - 1;
+    }
+    return 0;
+}
+
+void mqttQueueSent(MqttQueue &queue, size_t index, uint32_t pops, int32_t packetId)
+{
+    uint32_t popped = queue.pops - pops;
+    if (popped > index)
+        return;
+    index -= popped;
+
+    queue.sends++;
+    queue.lastPacketId = packetId;
+    for (MqttEarlyAck &early : queue.earlyAcks)
+    {
+        if (early.packetId == 0)
+            continue;
+        if (early.packetId == packetId)
+        {
+            early.packetId = 0;
+            packetId = -1;
+        }
+        else if (queue.sends - early.sends > MQTT_MAX_IN_FLIGHT)
+        {
+            early.packetId = 0; // Its publish never came
+        }
+    }
+    queue.packetIds[index] = packetId;
+    popAcked(queue);
+}
+
+void mqttQueueAcked(MqttQueue &queue, int32_t packetId)
+{
+    int slot = findPacket(queue, packetId);
+    if (slot < 0)
+    {
+        if (inPublishWindow(queue, packetId))
+        {
+            queue.earlyAcks[queue.nextEarlyAck] = {packetId, queue.sends};
+            queue.nextEarlyAck = (queue.nextEarlyAck + 1) % MQTT_MAX_IN_FLIGHT;
+        }
+        return;
+    }
+    queue.packetIds[slot] = -1;
+    popAcked(queue);
+}
+
+void mqttQueueExpired(MqttQueue &queue, int32_t packetId)
+{
+    int slot = findPacket(queue, packetId);
+    if (slot >= 0)
+        queue.packetIds[slot] = 0;
+}
+
+void mqttQueueResendAll(MqttQueue &queue)
+{
+    for (int32_t &id : queue.packetIds)
+    {
+        if (id > 0)
+            id = 0;
+    }
+    queue.lastPacketId = 0; // A new client numbers from its own start
+    mqttQueueDisconnected(queue);
+}
+
+void mqttQueueDisconnected(MqttQueue &queue)
+{
+    memset(queue.earlyAcks, 0, sizeof(queue.earlyAcks));
+    queue.nextEarlyAck = 0;
+}
+
+size_t mqttQueueInFlight(const MqttQueue &queue)
+{
+    size_t count = 0;
+    for (int32_t id : queue.packetIds)
+        count += id > 0 ? 1 : 0;
+    return count;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "serial/tx_ring.h"
+
+// Outbound MQTT messages in one byte ring, each stored as its topic byte
+// followed by the payload, so a 300-byte frame takes 303 bytes rather than
+// a fixed slot. Up to MQTT_MAX_IN_FLIGHT messages at the head can be
+// published at once; a message leaves the ring only when its PUBACK comes
+// back, and acks that arrive out of order wait for the ones ahead of them.
+// Plain C++ with no Arduino or FreeRTOS dependencies; callers provide the
+// locking.
+
+#define MQTT_MAX_IN_FLIGHT 8
+
+// An ack for an id the queue does not hold is kept only if the id is one
+// of the next MQTT_MAX_IN_FLIGHT after the last recorded publish (ids are
+// 16-bit and skip 0), and only for MQTT_MAX_IN_FLIGHT recorded publishes.
+// A late ack for an evicted message is never kept to match a reused id.
+struct MqttEarlyAck
+{
+    int32_t packetId; // 0 when free
+    uint32_t sends;   // MqttQueue::sends when it arrived
+};
+
+struct MqttQueue
+{
+    TxRing ring;
+    int32_t packetIds[MQTT_MAX_IN_FLIGHT];      // Per head message: 0 unsent, -1 acked
+    MqttEarlyAck earlyAcks[MQTT_MAX_IN_FLIGHT]; // Acked before the publish returned
+    size_t nextEarlyAck;
+    int32_t lastPacketId; // Last recorded publish this session, 0 if none
+    uint32_t sends;       // Bumped on every recorded publish
+    uint32_t pops;        // Bumped on every removal, acked or evicted
+};
+
+void mqttQueueInit(MqttQueue &queue, uint8_t *storage, size_t capacity);
+
+// Reserves a message, evicting the oldest (in flight or not) to make room.
+// Returns where to write length payload bytes, or nullptr if it can never
+// fit.
+char *mqttQueuePush(MqttQueue &queue, uint8_t topic, size_t length);
+
+// Next message in the window that has not been published. Returns its
+// length, 0 if none; pass index and pops back to mqttQueueSent.
+size_t mqttQueueNext(const MqttQueue &queue, size_t *index, uint8_t *topic, const char **payload);
+
+// Records the broker's packet id for a message published from index when
+// pops was read; ignored if the message was evicted meanwhile
+void mqttQueueSent(MqttQueue &queue, size_t index, uint32_t pops, int32_t packetId);
+
+void mqttQueueAcked(MqttQueue &queue, int32_t packetId);
+
+// The client gave up on a packet, or lost its session: publish again
+void mqttQueueExpired(MqttQueue &queue, int32_t packetId);
+void mqttQueueResendAll(MqttQueue &queue);
+
+// The connection dropped: acks still waiting for their publish belong to
+// it and are forgotten. mqttQueueResendAll does this too, and forgets the
+// last packet id, since a new client numbers packets afresh.
+void mqttQueueDisconnected(MqttQueue &queue);
+
+size_t mqttQueueInFlight(const MqttQueue &queue);
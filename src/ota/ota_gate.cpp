@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include "ota_gate.h"
+
+bool otaGateEvaluate(const OtaHealth *baseline, const OtaHealth &candidate, const OtaGateLimits &limits,
+                     char *reason, size_t reasonSize)
+{
+    if (baseline && baseline->magic != OTA_GATE_MAGIC)
+        baseline = nullptr;
+
+    if (candidate.samples < limits.minSamples)
+    {
+        snprintf(reason, reasonSize, "sampling stalled: %u of %u periods measured",
+                 candidate.samples, limits.minSamples);
+        return false;
+    }
+
+    // A chip the previous image could read and this one cannot
+    uint8_t expectedOnline = baseline ? baseline->channelsOnline : (candidate.channelCount > 0 ? 1 : 0);
+    if (candidate.channelsOnline < expectedOnline)
+    {
+        snprintf(reason, reasonSize, "sensor health: %u of %u channels online, expected %u",
+                 candidate.channelsOnline, candidate.channelCount, expectedOnline);
+        return false;
+    }
+
+    if (candidate.freeHeap < limits.heapFloorBytes)
+    {
+        snprintf(reason, reasonSize, "free heap %u below the %u byte floor",
+                 (unsigned)candidate.freeHeap, (unsigned)limits.heapFloorBytes);
+        return false;
+    }
+
+    if (candidate.heapDrift > (int32_t)limits.leakBytes)
+    {
+        snprintf(reason, reasonSize, "heap leak: %d bytes lost during the window", (int)candidate.heapDrift);
+        return false;
+    }
+
+    if (!baseline)
+    {
+        snprintf(reason, reasonSize, "passed absolute limits; no baseline");
+        return true;
+    }
+
+    if (candidate.jitterMaxUs > baseline->jitterMaxUs * limits.jitterRatio + limits.jitterSlackUs)
+    {
+        snprintf(reason, reasonSize, "sample jitter %.0f us vs %.0f us on %.15s",
+                 candidate.jitterMaxUs, baseline->jitterMaxUs, baseline->version);
+        return false;
+    }
+
+    if (candidate.serializeMedianUs > baseline->serializeMedianUs * limits.serializeRatio + limits.serializeSlackUs)
+    {
+        snprintf(reason, reasonSize, "frame serialization %.1f us vs %.1f us on %.15s",
+                 candidate.serializeMedianUs, baseline->serializeMedianUs, baseline->version);
+        return false;
+    }
+
+    if (candidate.freeHeap + limits.heapDropBytes < baseline->freeHeap)
+    {
+        snprintf(reason, reasonSize, "free heap %u vs %u on %.15s",
+                 (unsigned)candidate.freeHeap, (unsigned)baseline->freeHeap, baseline->version);
+        return false;
+    }
+
+    snprintf(reason, reasonSize, "passed against %.15s", baseline->version);
+    return true;
+}
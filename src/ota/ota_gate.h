@@ -0,0 +1,43 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Pass/fail rules for a freshly updated image, with no Arduino or ESP-IDF
+// dependencies so tools/ota_gate_check.cpp can exercise them on Linux
+
+#define OTA_GATE_MAGIC 0x4F474231 // "OGB1"
+
+// One image's self-benchmark. The last passing image's copy is kept in
+// NVS as the baseline the next image is held to.
+struct OtaHealth
+{
+    uint32_t magic;
+    char version[16];        // Firmware that measured it
+    float jitterMaxUs;       // Worst |actual - expected| sample period
+    float serializeMedianUs; // Four-channel data frame encode
+    uint32_t freeHeap;       // Internal heap at the end of the window
+    int32_t heapDrift;       // Bytes lost across the window; < 0 = grew
+    uint8_t channelsOnline;
+    uint8_t channelCount;
+    uint16_t samples; // Sample periods measured
+};
+
+struct OtaGateLimits
+{
+    float jitterRatio;   // Allowed growth over the baseline...
+    float jitterSlackUs; // ...plus a fixed margin for scheduler noise
+    float serializeRatio;
+    float serializeSlackUs;
+    uint32_t heapDropBytes;  // Allowed loss of free heap vs the baseline
+    uint32_t heapFloorBytes; // Absolute minimum, baseline or not
+    uint32_t leakBytes;      // Allowed drift within the window
+    uint16_t minSamples;
+};
+
+static const OtaGateLimits OTA_GATE_DEFAULT_LIMITS = {1.5f, 2000.0f, 1.5f, 50.0f, 16384, 32768, 4096, 8};
+
+// True when candidate passes. Otherwise reason names the first failed
+// check. baseline is null when the previous image left none; only the
+// absolute limits apply then.
+bool otaGateEvaluate(const OtaHealth *baseline, const OtaHealth &candidate, const OtaGateLimits &limits,
+                     char *reason, size_t reasonSize);
@@ -1,24 +1,65 @@
-#include <Preferences.h>
 #include <HTTPClient.h>
 #include <Update.h>
 #include <mbedtls/sha256.h>
 #include <mbedtls/pk.h>
 #include <mbedtls/rsa.h>
 #include <ArduinoJson.h>
+#include <atomic>
 #include "ota_update.h"
 #include "config/config.h"
+#include "serial/serial_tx.h"
+#include "trace/trace_recorder.h"
+#include "protocol/protocol.h"
+#include "diagnostics/boot_report.h"
+#include "ota_verify.h"
 
-extern Preferences preferences;
-extern String deviceSerialNumber;
-extern String deviceId;
-extern bool wifiConfigured;
+// Set while performOTAUpdate() owns the inactive slot
+static std::atomic<bool> updateActive(false);
+
+struct UpdateActiveScope
+{
+    UpdateActiveScope() { updateActive = true; }
+    ~UpdateActiveScope() { updateActive = false; }
+};
+
+// Update checks run on a short-lived task of their own so the HTTPS
+// round trip never holds up sampling
+static const uint32_t CHECK_TASK_STACK = 8192;
+static const UBaseType_t CHECK_TASK_PRIORITY = 1;
+static std::atomic<bool> checkRunning(false);
+
+static void updateCheckTask(void *)
+{
+    if (!updateActive)
+    {
+        checkForFirmwareUpdate();
+    }
+    bootMark(BOOT_UPDATE_CHECKED);
+
+    checkRunning = false;
+    vTaskDelete(nullptr);
+}
+
+void requestFirmwareUpdateCheck()
+{
+    if (checkRunning.exchange(true))
+        return;
+
+    if (xTaskCreatePinnedToCore(updateCheckTask, "ota_check", CHECK_TASK_STACK, nullptr,
+                                CHECK_TASK_PRIORITY, nullptr, ARDUINO_RUNNING_CORE) != pdPASS)
+    {
+        checkRunning = false;
+    }
+}
 
 void checkForFirmwareUpdate()
 {
     if (WiFi.status() != WL_CONNECTED)
         return;
 
-    Serial.println("Checking for firmware updates...");
+    TraceScope trace(TRACE_OTA_CHECK);
+
+    serialLog("Checking for firmware updates...");
 
     HTTPClient http;
     http.begin(LATEST_RELEASE_URL);
@@ -33,7 +74,7 @@ void checkForFirmwareUpdate()
 
         const char *latestVersion = doc["tag_name"];
 
-        Serial.printf("Latest version: %s (current: %s)\n", latestVersion, FIRMWARE_VERSION);
+        serialLog("Latest version: %s (current: %s)", latestVersion, FIRMWARE_VERSION);
 
         if (isNewerVersion(latestVersion))
         {
@@ -53,15 +94,22 @@ void checkForFirmwareUpdate()
             }
 
             // Notify user via Serial
-            JsonDocument notif;
-            notif["type"] = "update_available";
-            notif["version"] = latestVersion;
-            notif["firmware_url"] = firmwareUrl;
-            notif["signature_url"] = signatureUrl;
-            notif["changelog"] = doc["body"];
-
-            serializeJson(notif, Serial);
-            Serial.println();
+            UpdateAvailableMessage notif;
+            notif.version = protoSpan(latestVersion);
+            notif.firmwareUrl = {firmwareUrl.c_str(), firmwareUrl.length()};
+            notif.signatureUrl = {signatureUrl.c_str(), signatureUrl.length()};
+            notif.changelog = protoSpan(doc["body"].as<const char *>());
+
+            // Release notes are unbounded; size for escaping every byte
+            size_t capacity = 128 + 6 * (notif.version.length + notif.firmwareUrl.length +
+                                         notif.signatureUrl.length + notif.changelog.length);
+            char *frame = (char *)malloc(capacity);
+            size_t length = frame ? encodeUpdateAvailableMessage(notif, frame, capacity) : 0;
+            if (length > 0)
+            {
+                sendFrame(frame, length);
+            }
+            free(frame);
         }
     }
 
@@ -72,13 +120,16 @@ void performOTAUpdate()
 {
     if (WiFi.status() != WL_CONNECTED)
     {
-        Serial.println("Cannot update: WiFi not connected");
+        serialLog("Cannot update: WiFi not connected");
         return;
     }
 
-    Serial.println("Starting OTA firmware update...");
+    serialLog("Starting OTA firmware update...");
+    TraceScope trace(TRACE_OTA_UPDATE);
+    UpdateActiveScope active;
 
     // Step 1: Fetch latest release info
+    traceInstant(TRACE_OTA_RELEASE);
     String firmwareUrl, signatureUrl;
     HTTPClient http;
     http.begin(LATEST_RELEASE_URL);
@@ -107,12 +158,13 @@ void performOTAUpdate()
 
     if (firmwareUrl.length() == 0 || signatureUrl.length() == 0)
     {
-        Serial.println("✗ Firmware or signature not found in release");
+        serialLog("✗ Firmware or signature not found in release");
         return;
     }
 
     // Step 2: Download signature (small - 256 bytes)
-    Serial.println("Downloading signature...");
+    traceInstant(TRACE_OTA_SIGNATURE);
+    serialLog("Downloading signature...");
     HTTPClient sigClient;
     sigClient.begin(signatureUrl);
     sigClient.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
@@ -132,14 +184,15 @@ void performOTAUpdate()
 
     if (signature.size() != 256)
     {
-        Serial.printf("✗ Invalid signature size: %d bytes (expected 256)\n", signature.size());
+        serialLog("✗ Invalid signature size: %d bytes (expected 256)", signature.size());
         return;
     }
 
-    Serial.println("✓ Signature downloaded");
+    serialLog("✓ Signature downloaded");
 
     // Step 3: Download firmware while computing hash
-    Serial.println("Downloading and hashing firmware...");
+    traceInstant(TRACE_OTA_DOWNLOAD);
+    serialLog("Downloading and hashing firmware...");
     HTTPClient fwClient;
     fwClient.begin(firmwareUrl);
     fwClient.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS);
@@ -149,13 +202,13 @@ void performOTAUpdate()
     int fwCode = fwClient.GET();
     if (fwCode != 200)
     {
-        Serial.printf("✗ Firmware download failed: %d\n", fwCode);
+        serialLog("✗ Firmware download failed: %d", fwCode);
         fwClient.end();
         return;
     }
 
     int contentLength = fwClient.getSize();
-    Serial.printf("Firmware size: %d bytes\n", contentLength);
+    serialLog("Firmware size: %d bytes", contentLength);
 
     // Initialize SHA256 context for incremental hashing
     mbedtls_sha256_context sha256_ctx;
@@ -165,7 +218,7 @@ void performOTAUpdate()
     // Begin OTA update
     if (!Update.begin(contentLength))
     {
-        Serial.println("✗ Not enough space for OTA");
+        serialLog("✗ Not enough space for OTA");
         fwClient.end();
         mbedtls_sha256_free(&sha256_ctx);
         return;
@@ -188,7 +241,7 @@ void performOTAUpdate()
 
         if (!stream->available())
         {
-            Serial.println("✗ Stream timeout - no data available");
+            serialLog("✗ Stream timeout - no data available");
             break;
         }
 
@@ -197,7 +250,7 @@ void performOTAUpdate()
 
         if (bytesRead == 0)
         {
-            Serial.println("✗ Read returned 0 bytes");
+            serialLog("✗ Read returned 0 bytes");
             break;
         }
 
@@ -208,7 +261,7 @@ void performOTAUpdate()
         size_t written = Update.write(buffer, bytesRead);
         if (written != bytesRead)
         {
-            Serial.println("✗ Write error during OTA");
+            serialLog("✗ Write error during OTA");
             Update.abort();
             fwClient.end();
             mbedtls_sha256_free(&sha256_ctx);
@@ -220,9 +273,9 @@ void performOTAUpdate()
         // Progress indicator
         if (totalWritten % 51200 == 0) // Every 50KB
         {
-            Serial.printf("Progress: %d/%d bytes (%.1f%%)\n",
-                          totalWritten, contentLength,
-                          (totalWritten * 100.0) / contentLength);
+            serialLog("Progress: %d/%d bytes (%.1f%%)",
+                      totalWritten, contentLength,
+                      (totalWritten * 100.0) / contentLength);
         }
     }
 
@@ -230,7 +283,7 @@ void performOTAUpdate()
 
     if (totalWritten != contentLength)
     {
-        Serial.printf("✗ Incomplete download: %d/%d bytes\n", totalWritten, contentLength);
+        serialLog("✗ Incomplete download: %d/%d bytes", totalWritten, contentLength);
         Update.abort();
         mbedtls_sha256_free(&sha256_ctx);
         return;
@@ -241,18 +294,19 @@ void performOTAUpdate()
     mbedtls_sha256_finish(&sha256_ctx, computedHash);
     mbedtls_sha256_free(&sha256_ctx);
 
-    Serial.println("✓ Firmware downloaded and hashed");
-    Serial.print("Computed hash: ");
+    serialLog("✓ Firmware downloaded and hashed");
+    char hashHex[65];
     for (int i = 0; i < 32; i++)
     {
-        Serial.printf("%02x", computedHash[i]);
+        snprintf(hashHex + i * 2, 3, "%02x", computedHash[i]);
     }
-    Serial.println();
+    serialLog("Computed hash: %s", hashHex);
 
     // Step 4: Verify signature
-    Serial.println("\n========================================");
-    Serial.println("SIGNATURE VERIFICATION STARTING");
-    Serial.println("========================================");
+    traceInstant(TRACE_OTA_VERIFY);
+    serialLog("\n========================================");
+    serialLog("SIGNATURE VERIFICATION STARTING");
+    serialLog("========================================");
     delay(100);
 
     mbedtls_pk_context pk;
@@ -262,12 +316,12 @@ void performOTAUpdate()
                                               (const unsigned char *)FIRMWARE_SIGNING_PUBLIC_KEY,
                                               strlen(FIRMWARE_SIGNING_PUBLIC_KEY) + 1);
 
-    Serial.printf("Public key parse result: %d\n", pkParse);
+    serialLog("Public key parse result: %d", pkParse);
     delay(100);
 
     if (pkParse != 0)
     {
-        Serial.printf("✗ Public key parse failed: -0x%04x\n", -pkParse);
+        serialLog("✗ Public key parse failed: -0x%04x", -pkParse);
         Update.abort();
         mbedtls_pk_free(&pk);
         return;
@@ -286,42 +340,51 @@ void performOTAUpdate()
                                           computedHash,
                                           signature.data());
 
-    Serial.printf("Signature verification result: %d\n", verify);
+    serialLog("Signature verification result: %d", verify);
     delay(100);
 
     mbedtls_pk_free(&pk);
 
     if (verify != 0)
     {
-        Serial.printf("✗ Firmware signature verification failed: -0x%04x\n", -verify);
-        Serial.println("✗ Aborting update for security reasons");
+        serialLog("✗ Firmware signature verification failed: -0x%04x", -verify);
+        serialLog("✗ Aborting update for security reasons");
         Update.abort();
         return;
     }
 
-    Serial.println("✓ Signature verified successfully!");
-    Serial.println("========================================\n");
+    serialLog("✓ Signature verified successfully!");
+    serialLog("========================================\n");
 
     // Step 5: Commit the update
+    traceInstant(TRACE_OTA_COMMIT);
     if (Update.end())
     {
         if (Update.isFinished())
         {
-            Serial.println("✓ OTA update complete! Rebooting...");
+            serialLog("✓ OTA update complete! Rebooting...");
+
+            // The new image must pass the gate before it is kept
+            otaMarkUpdatePending();
             delay(2000);
             ESP.restart();
         }
         else
         {
-            Serial.println("✗ OTA update not finished");
+            serialLog("✗ OTA update not finished");
         }
     }
     else
     {
-        Serial.printf("✗ OTA update failed: %s\n", Update.errorString());
+        serialLog("✗ OTA update failed: %s", Update.errorString());
     }
 }
 
+bool otaUpdateActive()
+{
+    return updateActive;
+}
+
 bool isNewerVersion(const char *version)
 {
     // Remove leading 'v' (or 'V') prefix if present
@@ -2,5 +2,7 @@
 #include <Arduino.h>
 
 void checkForFirmwareUpdate();
+void requestFirmwareUpdateCheck(); // Runs checkForFirmwareUpdate() in the background
 void performOTAUpdate();
+bool otaUpdateActive();
 bool isNewerVersion(const char *version);
@@ -0,0 +1,280 @@
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include "ota_verify.h"
+#include "ota_gate.h"
+#include "config/config.h"
+#include "common/device_identity.h"
+#include "serial/serial_tx.h"
+#include "diagnostics/bench_kernels.h"
+#include "diagnostics/boot_report.h"
+
+static const uint16_t WINDOW_SAMPLES = 16;
+static const unsigned long SETTLE_TIMEOUT_MS = 5UL * 60UL * 1000UL; // From boot
+static const unsigned long STALL_SLACK_MS = 10000;
+static const uint16_t SERIALIZE_ITERATIONS = 64;
+static const uint8_t MAX_BOOT_ATTEMPTS = 3; // Crashes before the window ends
+
+enum GateMode : uint8_t
+{
+    GATE_IDLE,      // This image is committed and has its baseline
+    GATE_BASELINE,  // Committed, but no numbers of its own yet
+    GATE_VERIFYING, // Fresh from an update; commits or rolls back
+};
+
+static const char *const modeNames[] = {"idle", "recording_baseline", "verifying"};
+
+static GateMode mode = GATE_IDLE;
+static bool bootloaderPending = false; // Bootloader will roll back on its own if we crash
+static String previousVersion;
+
+static bool windowOpen = false;
+static int64_t lastSampleUs = 0;
+static float jitterMaxUs = 0;
+static uint16_t periods = 0;
+static size_t heapAtOpen = 0;
+static unsigned long lastProgressMs = 0;
+static unsigned long lastIntervalMs = 0;
+
+// Arduino validates a pending image before setup() unless told we will
+extern "C" bool verifyRollbackLater()
+{
+    return true;
+}
+
+static void sendGateResult(const char *result, const char *version, const char *reason, const OtaHealth *health)
+{
+    JsonDocument doc;
+    doc["type"] = "ota_gate";
+    doc["device_id"] = deviceSerialNumber();
+    doc["metadata"]["timestamp"] = millis();
+    JsonObject payload = doc["payload"].to<JsonObject>();
+    payload["result"] = result;
+    payload["version"] = version;
+    if (previousVersion.length() > 0)
+    {
+        payload["previous_version"] = previousVersion;
+    }
+    payload["reason"] = reason;
+    if (health)
+    {
+        payload["jitter_max_us"] = health->jitterMaxUs;
+        payload["serialize_median_us"] = health->serializeMedianUs;
+        payload["free_heap"] = health->freeHeap;
+        payload["heap_drift"] = health->heapDrift;
+        payload["channels_online"] = health->channelsOnline;
+        payload["samples"] = health->samples;
+    }
+    sendJson(doc);
+}
+
+static void saveResult(Preferences &gatePrefs, const char *result, const char *reason)
+{
+    gatePrefs.putString("result", result);
+    gatePrefs.putString("result_ver", FIRMWARE_VERSION);
+    gatePrefs.putString("reason", reason);
+    gatePrefs.putBool("reported", false);
+    gatePrefs.remove("pending");
+    gatePrefs.remove("attempts");
+}
+
+static void rollBack(Preferences &gatePrefs, const char *reason, const OtaHealth *health)
+{
+    serialLog("✗ OTA gate failed: %s. Rolling back", reason);
+    saveResult(gatePrefs, "rolled_back", reason);
+    gatePrefs.end();
+    sendGateResult("rolled_back", FIRMWARE_VERSION, reason, health);
+    delay(200); // Let the writer get the frame out
+
+    if (bootloaderPending)
+    {
+        esp_ota_mark_app_invalid_rollback_and_reboot();
+    }
+
+    // Bootloader built without rollback support: boot the other slot
+    const esp_partition_t *previous = esp_ota_get_next_update_partition(nullptr);
+    if (previous && esp_ota_set_boot_partition(previous) == ESP_OK)
+    {
+        esp_restart();
+    }
+
+    serialLog("✗ No previous image to roll back to; staying on this one");
+    gatePrefs.begin("ota_gate", false);
+    gatePrefs.putString("result", "rollback_failed");
+    gatePrefs.end();
+    mode = GATE_IDLE;
+}
+
+void otaVerifyBegin()
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    esp_ota_img_states_t state;
+    bootloaderPending = esp_ota_get_state_partition(running, &state) == ESP_OK &&
+                        state == ESP_OTA_IMG_PENDING_VERIFY;
+
+    Preferences gatePrefs;
+    gatePrefs.begin("ota_gate", false);
+    previousVersion = gatePrefs.getString("pending", "");
+
+    OtaHealth baseline;
+    bool haveBaseline = gatePrefs.getBytes("baseline", &baseline, sizeof(baseline)) == sizeof(baseline) &&
+                        baseline.magic == OTA_GATE_MAGIC;
+
+    // The image before this one rolled back, or was rolled back to
+    String result = gatePrefs.getString("result", "");
+    if (result == "rolled_back" && !gatePrefs.getBool("reported", true))
+    {
+        String version = gatePrefs.getString("result_ver", "");
+        String reason = gatePrefs.getString("reason", "");
+        sendGateResult("rolled_back", version.c_str(), reason.c_str(), nullptr);
+        gatePrefs.putBool("reported", true);
+    }
+
+    if (bootloaderPending || previousVersion.length() > 0)
+    {
+        mode = GATE_VERIFYING;
+
+        // A crash before the window closes never reaches the gate; count
+        // boots so a crashing image still goes back
+        uint8_t attempts = gatePrefs.getUChar("attempts", 0) + 1;
+        gatePrefs.putUChar("attempts", attempts);
+        if (attempts > MAX_BOOT_ATTEMPTS)
+        {
+            char reason[64];
+            snprintf(reason, sizeof(reason), "restarted %u times before verification", attempts - 1);
+            rollBack(gatePrefs, reason, nullptr);
+            return;
+        }
+        serialLog("OTA gate: verifying v%s against %s", FIRMWARE_VERSION,
+                  haveBaseline ? baseline.version : "absolute limits");
+    }
+    else if (!haveBaseline || strncmp(baseline.version, FIRMWARE_VERSION, sizeof(baseline.version)) != 0)
+    {
+        mode = GATE_BASELINE;
+    }
+    gatePrefs.end();
+}
+
+void otaMarkUpdatePending()
+{
+    Preferences gatePrefs;
+    gatePrefs.begin("ota_gate", false);
+    gatePrefs.putString("pending", FIRMWARE_VERSION);
+    gatePrefs.putUChar("attempts", 0);
+    gatePrefs.end();
+}
+
+void otaVerifyRecordSample(int64_t sampleUs, unsigned long intervalMs)
+{
+    if (mode == GATE_IDLE || periods >= WINDOW_SAMPLES)
+        return;
+
+    // Boot-time allocations (WiFi, TLS) would read as a leak
+    if (!windowOpen)
+    {
+        if (!bootSettled())
+            return;
+        windowOpen = true;
+        heapAtOpen = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+        lastSampleUs = sampleUs;
+        lastProgressMs = millis();
+        lastIntervalMs = intervalMs;
+        return;
+    }
+
+    float jitterUs = fabsf((float)(sampleUs - lastSampleUs) - intervalMs * 1000.0f);
+    jitterMaxUs = max(jitterMaxUs, jitterUs);
+    lastSampleUs = sampleUs;
+    lastProgressMs = millis();
+    lastIntervalMs = intervalMs;
+    periods++;
+}
+
+bool otaVerifyDue(unsigned long now)
+{
+    if (mode == GATE_IDLE)
+        return false;
+    if (!windowOpen)
+        return now >= SETTLE_TIMEOUT_MS;
+
+    // Samples stopped arriving: decide on what there is
+    bool stalled = now - lastProgressMs > 3 * lastIntervalMs + STALL_SLACK_MS;
+    return periods >= WINDOW_SAMPLES || stalled;
+}
+
+void otaVerifyFinish(const DataMessage &frame, uint8_t channelsOnline, uint8_t channelCount)
+{
+    OtaHealth health = {};
+    health.magic = OTA_GATE_MAGIC;
+    strlcpy(health.version, FIRMWARE_VERSION, sizeof(health.version));
+    health.jitterMaxUs = jitterMaxUs;
+    health.serializeMedianUs = benchSerializeFrame(frame, SERIALIZE_ITERATIONS).medianUs;
+    health.freeHeap = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    health.heapDrift = windowOpen ? (int32_t)heapAtOpen - (int32_t)health.freeHeap : 0;
+    health.channelsOnline = channelsOnline;
+    health.channelCount = channelCount;
+    health.samples = periods;
+
+    Preferences gatePrefs;
+    gatePrefs.begin("ota_gate", false);
+    OtaHealth baseline;
+    bool haveBaseline = gatePrefs.getBytes("baseline", &baseline, sizeof(baseline)) == sizeof(baseline);
+
+    // Recording a baseline holds the image to the absolute limits only
+    char reason[96];
+    bool compare = haveBaseline && mode == GATE_VERIFYING;
+    bool passed = otaGateEvaluate(compare ? &baseline : nullptr, health, OTA_GATE_DEFAULT_LIMITS,
+                                  reason, sizeof(reason));
+
+    if (mode == GATE_VERIFYING && !passed)
+    {
+        rollBack(gatePrefs, reason, &health);
+        return;
+    }
+
+    // A baseline only comes from an image that meets the limits itself
+    if (passed)
+    {
+        gatePrefs.putBytes("baseline", &health, sizeof(health));
+    }
+
+    if (mode == GATE_VERIFYING)
+    {
+        if (bootloaderPending)
+        {
+            esp_ota_mark_app_valid_cancel_rollback();
+        }
+        saveResult(gatePrefs, "passed", reason);
+        gatePrefs.putBool("reported", true);
+        serialLog("✓ OTA gate passed: %s", reason);
+        sendGateResult("passed", FIRMWARE_VERSION, reason, &health);
+    }
+    else
+    {
+        sendGateResult(passed ? "baseline_recorded" : "baseline_rejected", FIRMWARE_VERSION, reason, &health);
+    }
+
+    gatePrefs.end();
+    mode = GATE_IDLE;
+}
+
+void addOtaGateStatus(JsonObject out)
+{
+    out["mode"] = modeNames[mode];
+    if (mode != GATE_IDLE)
+    {
+        out["periods_measured"] = periods;
+    }
+
+    Preferences gatePrefs;
+    gatePrefs.begin("ota_gate", true);
+    String result = gatePrefs.getString("result", "");
+    if (result.length() > 0)
+    {
+        out["last_result"] = result;
+        out["last_version"] = gatePrefs.getString("result_ver", "");
+        out["last_reason"] = gatePrefs.getString("reason", "");
+    }
+    gatePrefs.end();
+}
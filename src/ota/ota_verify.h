@@ -0,0 +1,29 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "protocol/protocol.h"
+
+// An updated image boots pending verification. Once boot settles it
+// measures sample-period jitter, frame serialization, free heap and sensor
+// health over a window of live samples. It then compares them with the
+// previous image's numbers (ota_gate.h) and either commits itself or rolls
+// back to the other app slot. An image with no baseline of its own records
+// one the same way, without the gate.
+
+void otaVerifyBegin(); // In setup(); reports a rollback the last image made
+
+// performOTAUpdate() calls this just before restarting into the new image
+void otaMarkUpdatePending();
+
+// The loop feeds every sample while a window is open; interval is the
+// period the sample was scheduled for
+void otaVerifyRecordSample(int64_t sampleUs, unsigned long intervalMs);
+
+// True when the window has enough samples, or has run out of time
+bool otaVerifyDue(unsigned long now);
+
+// Benchmarks frame, decides, and either commits or reboots into the other
+// slot. Call from the loop once otaVerifyDue() says so.
+void otaVerifyFinish(const DataMessage &frame, uint8_t channelsOnline, uint8_t channelCount);
+
+void addOtaGateStatus(JsonObject out);
@@ -0,0 +1,89 @@
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <driver/uart.h>
+#include <driver/gpio.h>
+#include "power_manager.h"
+#include "serial/serial_tx.h"
+
+// Frequency floor stays at 80 MHz so APB, and with it the UART baud
+// clock, never changes under dynamic frequency scaling
+static const int POWER_MAX_FREQ_MHZ = 240;
+static const int POWER_MIN_FREQ_MHZ = 80;
+
+static esp_pm_lock_handle_t cpuLock = nullptr;
+static esp_pm_lock_handle_t awakeLock = nullptr;
+static bool cpuLockHeld = false;
+static bool awakeLockHeld = false;
+static bool lightSleepEnabled = false;
+
+static void holdLock(esp_pm_lock_handle_t lock, bool &held, bool hold)
+{
+    if (!lock || held == hold)
+        return;
+
+    if (hold)
+        esp_pm_lock_acquire(lock);
+    else
+        esp_pm_lock_release(lock);
+    held = hold;
+}
+
+void powerManagerBegin(int wakeButtonPin)
+{
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t config = {};
+#else
+    esp_pm_config_esp32s3_t config = {};
+#endif
+    config.max_freq_mhz = POWER_MAX_FREQ_MHZ;
+    config.min_freq_mhz = POWER_MIN_FREQ_MHZ;
+#if ARDUINO_USB_CDC_ON_BOOT
+    // Light sleep suspends the native USB PHY and drops the CDC link
+    config.light_sleep_enable = false;
+#else
+    config.light_sleep_enable = true;
+#endif
+
+    // Auto light sleep needs tickless idle in the SDK build; fall back to
+    // frequency scaling alone when it is not available
+    esp_err_t err = esp_pm_configure(&config);
+    if (err != ESP_OK)
+    {
+        config.light_sleep_enable = false;
+        err = esp_pm_configure(&config);
+    }
+
+    if (err != ESP_OK)
+    {
+        serialLog("✗ Power management unavailable: %s", esp_err_to_name(err));
+        return;
+    }
+
+    lightSleepEnabled = config.light_sleep_enable;
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "active", &cpuLock);
+    esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "awake", &awakeLock);
+
+    // The host and the BOOT button can both pull us out of light sleep.
+    // The character that wakes the UART, and anything before it, is never
+    // received; the command reader re-syncs on the next line ending.
+#if !ARDUINO_USB_CDC_ON_BOOT
+    uart_set_wakeup_threshold(UART_NUM_0, 3);
+    esp_sleep_enable_uart_wakeup(UART_NUM_0);
+#endif
+    gpio_wakeup_enable((gpio_num_t)wakeButtonPin, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+
+    powerManagerApply(POWER_PERFORMANCE);
+    serialLog("✓ Power management ready (light sleep %s)", config.light_sleep_enable ? "on" : "off");
+}
+
+void powerManagerApply(PowerMode mode)
+{
+    holdLock(cpuLock, cpuLockHeld, mode == POWER_PERFORMANCE);
+    holdLock(awakeLock, awakeLockHeld, mode != POWER_IDLE_SLEEP);
+}
+
+bool powerManagerLightSleep()
+{
+    return lightSleepEnabled;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <Arduino.h>
+#include "power_policy.h"
+
+void powerManagerBegin(int wakeButtonPin);
+void powerManagerApply(PowerMode mode);
+
+// True when idle_sleep really enters light sleep, so a UART wake can cost
+// the first bytes of a line
+bool powerManagerLightSleep();
@@ -0,0 +1,45 @@
+#pragma once
+
+// Power mode selection, kept free of Arduino and IDF headers so the policy
+// can be checked on a host (tools/power_wake_check.cpp)
+
+enum PowerMode
+{
+    POWER_PERFORMANCE, // Full clock, no sleep
+    POWER_IDLE_SCALED, // Clock drops between work, serial stays live
+    POWER_IDLE_SLEEP,  // Automatic light sleep between samples
+};
+
+struct PowerPolicyInput
+{
+    bool roasting;
+    bool setupMode;
+    bool hostConnected;
+    unsigned long msSinceActivity;
+};
+
+inline PowerMode selectPowerMode(const PowerPolicyInput &input, unsigned long idleDelayMs)
+{
+    if (input.roasting || input.msSinceActivity < idleDelayMs)
+        return POWER_PERFORMANCE;
+
+    // Light sleep drops UART bytes and stalls the polled setup portal
+    if (input.setupMode || input.hostConnected)
+        return POWER_IDLE_SCALED;
+
+    return POWER_IDLE_SLEEP;
+}
+
+inline const char *powerModeName(PowerMode mode)
+{
+    switch (mode)
+    {
+    case POWER_PERFORMANCE:
+        return "performance";
+    case POWER_IDLE_SCALED:
+        return "idle_scaled";
+    case POWER_IDLE_SLEEP:
+        return "idle_sleep";
+    }
+    return "unknown";
+}
@@ -0,0 +1,1071 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+// The bridge's line-delimited JSON messages, defined once for the firmware
+// and for host tools. Header-only, with no Arduino, heap or exception use,
+// so host code can include it as-is.
+//
+// Encoders write straight into a caller's buffer. The decoder reads a byte
+// span in place: strings come back as spans into the input, still in their
+// JSON-escaped form, and nothing is copied or allocated. Members a decoder
+// does not know are skipped, so older hosts keep working as fields are
+// added.
+
+#define PROTO_MAX_CHANNELS 4
+#define PROTO_MAX_DEPTH 16      // Nesting accepted inside skipped values
+#define PROTO_TEMP_DECIMALS 2   // temperature_c resolution on the wire
+#define PROTO_DATA_FRAME_MAX 512 // Encoded four-channel data frame, with room
+
+enum MessageType : uint8_t
+{
+    MSG_UNKNOWN, // Well-formed, but a type this codec does not model
+    MSG_DATA,
+    MSG_READY,
+    MSG_CONFIGURATION,
+    MSG_DEVICE_INFO,
+    MSG_ERROR,
+    MSG_UPDATE_AVAILABLE,
+    MSG_TYPE_COUNT,
+};
+
+static const char *const MESSAGE_TYPE_NAMES[MSG_TYPE_COUNT] = {
+    "", "data", "ready", "configuration", "device_info", "error", "update_available"};
+
+// Bytes of a string value without its quotes, or of a raw JSON value.
+// data is null for an absent or null member.
+struct ProtoSpan
+{
+    const char *data;
+    size_t length;
+};
+
+static inline ProtoSpan protoSpan(const char *text)
+{
+    return {text, text ? strlen(text) : 0};
+}
+
+static inline bool protoSpanIs(ProtoSpan span, const char *literal)
+{
+    size_t length = strlen(literal);
+    return span.data && span.length == length && memcmp(span.data, literal, length) == 0;
+}
+
+// ============================================================================
+// MESSAGES
+// ============================================================================
+
+// Shared "metadata" object; which members a message carries is noted
+struct MessageMetadata
+{
+    uint32_t timestamp;     // All: millis() when built
+    int32_t samplingRateMs; // data, ready
+    uint32_t sequence;      // data
+    bool keyframe;          // data
+    uint32_t calibrationId; // data, when a calibration is applied
+    bool hasHostTime;
+    int64_t hostTimeUs; // data and responses, once the clock is synced
+    int64_t receivedUs; // Responses: command arrival
+    int64_t sentUs;     // Responses: response queued
+};
+
+struct DataChannel
+{
+    uint8_t channel;    // 1-based
+    bool ok;            // "status": "ok" or "error"
+    float temperatureC; // Valid when ok
+    uint8_t faultCode;  // CHANNEL_FAULT_* bits when not ok
+};
+
+// One sample; deadband frames carry only the channels that moved
+struct DataMessage
+{
+    ProtoSpan deviceId;
+    ProtoSpan firmwareVersion;
+    MessageMetadata metadata;
+    uint8_t channelCount;
+    DataChannel channels[PROTO_MAX_CHANNELS];
+};
+
+// Sent once at boot
+struct ReadyMessage
+{
+    ProtoSpan deviceId;
+    ProtoSpan firmwareVersion;
+    ProtoSpan model;
+    MessageMetadata metadata;
+};
+
+// Sent when the release feed has a newer firmware
+struct UpdateAvailableMessage
+{
+    ProtoSpan version;
+    ProtoSpan firmwareUrl;
+    ProtoSpan signatureUrl;
+    ProtoSpan changelog;
+};
+
+// configuration, device_info and error share the command response
+// envelope; the payload object is kept raw for protoFindMember()
+struct ResponseMessage
+{
+    ProtoSpan deviceId;
+    ProtoSpan requestId; // Raw JSON value echoed from the command
+    MessageMetadata metadata;
+    ProtoSpan payload;
+    ProtoSpan result; // configuration: what changed
+    ProtoSpan error;  // error: why the command was rejected
+};
+
+// The device_info payload members hosts rely on
+struct DeviceInfo
+{
+    ProtoSpan serialNumber;
+    ProtoSpan firmwareVersion;
+    ProtoSpan model;
+    bool wifiConfigured;
+    int32_t samplingRateMs;
+    int32_t effectiveSamplingRateMs;
+    bool clockSynced;
+};
+
+// Only the member matching type is filled in
+struct Message
+{
+    MessageType type;
+    ProtoSpan typeName;
+    DataMessage data;
+    ReadyMessage ready;
+    UpdateAvailableMessage update;
+    ResponseMessage response;
+    DeviceInfo deviceInfo; // MSG_DEVICE_INFO, alongside response
+};
+
+// ============================================================================
+// ENCODING
+// ============================================================================
+
+// Appends JSON text to a fixed buffer, tracking where commas go. On
+// overflow it stops writing and sets overflow.
+struct ProtoWriter
+{
+    char *buffer;
+    size_t capacity;
+    size_t length;
+    bool overflow;
+    bool needComma;
+};
+
+static inline void protoWriterInit(ProtoWriter &w, char *buffer, size_t capacity)
+{
+    w = {buffer, capacity, 0, false, false};
+}
+
+static inline void protoPutRaw(ProtoWriter &w, const char *text, size_t length)
+{
+    if (w.overflow || length > w.capacity - w.length)
+    {
+        w.overflow = true;
+        return;
+    }
+    memcpy(w.buffer + w.length, text, length);
+    w.length += length;
+}
+
+static inline void protoPutChar(ProtoWriter &w, char c)
+{
+    protoPutRaw(w, &c, 1);
+}
+
+static inline void protoSeparate(ProtoWriter &w)
+{
+    if (w.needComma)
+        protoPutChar(w, ',');
+    w.needComma = true;
+}
+
+static inline void protoBeginObject(ProtoWriter &w)
+{
+    protoSeparate(w);
+    protoPutChar(w, '{');
+    w.needComma = false;
+}
+
+static inline void protoBeginArray(ProtoWriter &w)
+{
+    protoSeparate(w);
+    protoPutChar(w, '[');
+    w.needComma = false;
+}
+
+static inline void protoEndObject(ProtoWriter &w)
+{
+    protoPutChar(w, '}');
+    w.needComma = true;
+}
+
+static inline void protoEndArray(ProtoWriter &w)
+{
+    protoPutChar(w, ']');
+    w.needComma = true;
+}
+
+static inline void protoQuoted(ProtoWriter &w, ProtoSpan text)
+{
+    static const char hex[] = "0123456789abcdef";
+    protoPutChar(w, '"');
+    for (size_t i = 0; i < text.length; i++)
+    {
+        char c = text.data[i];
+        if (c == '"' || c == '\\')
+        {
+            char escaped[2] = {'\\', c};
+            protoPutRaw(w, escaped, 2);
+        }
+        else if ((uint8_t)c < 0x20)
+        {
+            char escaped[6] = {'\\', 'u', '0', '0', hex[(c >> 4) & 0xF], hex[c & 0xF]};
+            protoPutRaw(w, escaped, 6);
+        }
+        else
+        {
+            protoPutChar(w, c);
+        }
+    }
+    protoPutChar(w, '"');
+}
+
+static inline void protoKey(ProtoWriter &w, const char *key)
+{
+    protoSeparate(w);
+    protoQuoted(w, protoSpan(key));
+    protoPutChar(w, ':');
+    w.needComma = false;
+}
+
+static inline void protoString(ProtoWriter &w, ProtoSpan text)
+{
+    protoSeparate(w);
+    if (!text.data)
+        protoPutRaw(w, "null", 4);
+    else
+        protoQuoted(w, text);
+}
+
+static inline void protoInt(ProtoWriter &w, int64_t value)
+{
+    char digits[20];
+    size_t count = 0;
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    do
+    {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+
+    protoSeparate(w);
+    if (value < 0)
+        protoPutChar(w, '-');
+    while (count)
+        protoPutChar(w, digits[--count]);
+}
+
+static inline void protoBool(ProtoWriter &w, bool value)
+{
+    protoSeparate(w);
+    protoPutRaw(w, value ? "true" : "false", value ? 4 : 5);
+}
+
+static inline void protoNull(ProtoWriter &w)
+{
+    protoSeparate(w);
+    protoPutRaw(w, "null", 4);
+}
+
+// Fixed point with trailing zeros trimmed; printf's float path can
+// allocate on newlib, this never does. Non-finite values, and any too large
+// for the fixed-point range, are written as null.
+static inline void protoFixed(ProtoWriter &w, float value, uint8_t decimals)
+{
+    int64_t scale = 1;
+    for (uint8_t i = 0; i < decimals && i < 7; i++)
+        scale *= 10;
+
+    if (isnan(value) || fabs((double)value) * scale >= 1e18)
+    {
+        protoNull(w);
+        return;
+    }
+    int64_t scaled = (int64_t)llround((double)value * scale);
+    while (decimals > 0 && scaled % 10 == 0)
+    {
+        scaled /= 10;
+        scale /= 10;
+        decimals--;
+    }
+
+    int64_t whole = scaled / scale;
+    int64_t fraction = scaled % scale;
+    if (scaled < 0)
+    {
+        fraction = -fraction;
+        if (whole == 0)
+        {
+            protoSeparate(w);
+            protoPutChar(w, '-');
+            w.needComma = false;
+        }
+    }
+    protoInt(w, whole);
+
+    if (decimals > 0)
+    {
+        char digits[8];
+        for (uint8_t i = decimals; i > 0; i--)
+        {
+            digits[i - 1] = '0' + fraction % 10;
+            fraction /= 10;
+        }
+        protoPutChar(w, '.');
+        protoPutRaw(w, digits, decimals);
+    }
+}
+
+// Each encoder returns the frame length without a line terminator, or 0
+// if it did not fit
+static inline size_t protoFinish(ProtoWriter &w)
+{
+    return w.overflow ? 0 : w.length;
+}
+
+static inline size_t encodeDataMessage(const DataMessage &msg, char *buffer, size_t capacity)
+{
+    ProtoWriter w;
+    protoWriterInit(w, buffer, capacity);
+    protoBeginObject(w);
+    protoKey(w, "type");
+    protoString(w, protoSpan(MESSAGE_TYPE_NAMES[MSG_DATA]));
+    protoKey(w, "device_id");
+    protoString(w, msg.deviceId);
+    protoKey(w, "firmware_version");
+    protoString(w, msg.firmwareVersion);
+
+    protoKey(w, "metadata");
+    protoBeginObject(w);
+    protoKey(w, "timestamp");
+    protoInt(w, msg.metadata.timestamp);
+    protoKey(w, "sampling_rate_ms");
+    protoInt(w, msg.metadata.samplingRateMs);
+    protoKey(w, "sequence");
+    protoInt(w, msg.metadata.sequence);
+    protoKey(w, "keyframe");
+    protoBool(w, msg.metadata.keyframe);
+    if (msg.metadata.calibrationId != 0)
+    {
+        protoKey(w, "calibration_id");
+        protoInt(w, msg.metadata.calibrationId);
+    }
+    if (msg.metadata.hasHostTime)
+    {
+        protoKey(w, "host_time_us");
+        protoInt(w, msg.metadata.hostTimeUs);
+    }
+    protoEndObject(w);
+
+    protoKey(w, "channels");
+    protoBeginArray(w);
+    for (uint8_t i = 0; i < msg.channelCount && i < PROTO_MAX_CHANNELS; i++)
+    {
+        const DataChannel &channel = msg.channels[i];
+        protoBeginObject(w);
+        protoKey(w, "channel");
+        protoInt(w, channel.channel);
+        protoKey(w, "status");
+        protoString(w, protoSpan(channel.ok ? "ok" : "error"));
+        if (!channel.ok)
+        {
+            protoKey(w, "fault_code");
+            protoInt(w, channel.faultCode);
+        }
+        protoKey(w, "temperature_c");
+        if (channel.ok)
+            protoFixed(w, channel.temperatureC, PROTO_TEMP_DECIMALS);
+        else
+            protoNull(w);
+        protoEndObject(w);
+    }
+    protoEndArray(w);
+    protoEndObject(w);
+    return protoFinish(w);
+}
+
+static inline size_t encodeReadyMessage(const ReadyMessage &msg, char *buffer, size_t capacity)
+{
+    ProtoWriter w;
+    protoWriterInit(w, buffer, capacity);
+    protoBeginObject(w);
+    protoKey(w, "type");
+    protoString(w, protoSpan(MESSAGE_TYPE_NAMES[MSG_READY]));
+    protoKey(w, "device_id");
+    protoString(w, msg.deviceId);
+    protoKey(w, "firmware_version");
+    protoString(w, msg.firmwareVersion);
+    protoKey(w, "model");
+    protoString(w, msg.model);
+
+    protoKey(w, "metadata");
+    protoBeginObject(w);
+    protoKey(w, "timestamp");
+    protoInt(w, msg.metadata.timestamp);
+    protoKey(w, "sampling_rate_ms");
+    protoInt(w, msg.metadata.samplingRateMs);
+    protoEndObject(w);
+
+    protoEndObject(w);
+    return protoFinish(w);
+}
+
+static inline size_t encodeUpdateAvailableMessage(const UpdateAvailableMessage &msg, char *buffer, size_t capacity)
+{
+    ProtoWriter w;
+    protoWriterInit(w, buffer, capacity);
+    protoBeginObject(w);
+    protoKey(w, "type");
+    protoString(w, protoSpan(MESSAGE_TYPE_NAMES[MSG_UPDATE_AVAILABLE]));
+    protoKey(w, "version");
+    protoString(w, msg.version);
+    protoKey(w, "firmware_url");
+    protoString(w, msg.firmwareUrl);
+    protoKey(w, "signature_url");
+    protoString(w, msg.signatureUrl);
+    protoKey(w, "changelog");
+    protoString(w, msg.changelog);
+    protoEndObject(w);
+    return protoFinish(w);
+}
+
+// Closes the "metadata" object of a data_batch, data_backfill or history
+// frame and writes its columns: timestamp_offsets_ms, then per channel a
+// temperature_c column and, when any reading faulted, a fault_code column.
+// Sample is anything with timestamp, channelCount, temperatureC[] and
+// fault[]; the firmware passes TemperatureSample. Channels whose bit is
+// clear in channelMask get no column.
+template <typename Sample>
+static inline size_t protoFinishSampleColumns(ProtoWriter &w, const Sample *samples, uint16_t count,
+                                              uint8_t channelMask = 0xFF)
+{
+    protoEndObject(w); // metadata
+
+    if (count > 0)
+    {
+        // Offsets from metadata.timestamp keep the time column short
+        protoKey(w, "timestamp_offsets_ms");
+        protoBeginArray(w);
+        for (uint16_t i = 0; i < count; i++)
+        {
+            protoInt(w, (uint32_t)(samples[i].timestamp - samples[0].timestamp));
+        }
+        protoEndArray(w);
+
+        protoKey(w, "channels");
+        protoBeginArray(w);
+        for (uint8_t ch = 0; ch < samples[0].channelCount; ch++)
+        {
+            if (!(channelMask & (1u << ch)))
+                continue;
+
+            protoBeginObject(w);
+            protoKey(w, "channel");
+            protoInt(w, ch + 1);
+
+            // Faulted readings are NaN, which is written as null
+            protoKey(w, "temperature_c");
+            protoBeginArray(w);
+            uint8_t anyFault = 0;
+            for (uint16_t i = 0; i < count; i++)
+            {
+                protoFixed(w, samples[i].temperatureC[ch], PROTO_TEMP_DECIMALS);
+                anyFault |= samples[i].fault[ch];
+            }
+            protoEndArray(w);
+
+            // Fault column only when something went wrong in this batch
+            if (anyFault)
+            {
+                protoKey(w, "fault_code");
+                protoBeginArray(w);
+                for (uint16_t i = 0; i < count; i++)
+                {
+                    protoInt(w, samples[i].fault[ch]);
+                }
+                protoEndArray(w);
+            }
+            protoEndObject(w);
+        }
+        protoEndArray(w);
+    }
+
+    protoEndObject(w);
+    return protoFinish(w);
+}
+
+// ============================================================================
+// DECODING
+// ============================================================================
+
+struct ProtoCursor
+{
+    const char *p;
+    const char *end;
+};
+
+static inline void protoSkipSpace(ProtoCursor &c)
+{
+    while (c.p < c.end && (*c.p == ' ' || *c.p == '\t' || *c.p == '\n' || *c.p == '\r'))
+        c.p++;
+}
+
+static inline bool protoConsume(ProtoCursor &c, char expected)
+{
+    protoSkipSpace(c);
+    if (c.p < c.end && *c.p == expected)
+    {
+        c.p++;
+        return true;
+    }
+    return false;
+}
+
+static inline bool protoLiteral(ProtoCursor &c, const char *literal)
+{
+    size_t length = strlen(literal);
+    if ((size_t)(c.end - c.p) < length || memcmp(c.p, literal, length) != 0)
+        return false;
+    c.p += length;
+    return true;
+}
+
+static inline bool protoIsHex(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+// Validates escapes but leaves them in place
+static inline bool protoParseString(ProtoCursor &c, ProtoSpan &out)
+{
+    if (!protoConsume(c, '"'))
+        return false;
+
+    const char *start = c.p;
+    while (c.p < c.end)
+    {
+        char ch = *c.p;
+        if (ch == '"')
+        {
+            out = {start, (size_t)(c.p - start)};
+            c.p++;
+            return true;
+        }
+        if ((uint8_t)ch < 0x20)
+            return false;
+        if (ch == '\\')
+        {
+            if (c.end - c.p < 2)
+                return false;
+            char escape = c.p[1];
+            if (escape == 'u')
+            {
+                if (c.end - c.p < 6 || !protoIsHex(c.p[2]) || !protoIsHex(c.p[3]) ||
+                    !protoIsHex(c.p[4]) || !protoIsHex(c.p[5]))
+                    return false;
+                c.p += 6;
+                continue;
+            }
+            if (!strchr("\"\\/bfnrt", escape) || escape == '\0')
+                return false;
+            c.p += 2;
+            continue;
+        }
+        c.p++;
+    }
+    return false;
+}
+
+// Strict JSON number. integral is set when there is no fraction or
+// exponent and the value fits in int64_t.
+static inline bool protoParseNumber(ProtoCursor &c, double &value, bool &integral, int64_t &integer)
+{
+    protoSkipSpace(c);
+    const char *p = c.p;
+    bool negative = p < c.end && *p == '-';
+    if (negative)
+        p++;
+    if (p >= c.end || *p < '0' || *p > '9')
+        return false;
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    bool overflow = false;
+
+    if (*p == '0')
+    {
+        p++;
+    }
+    else
+    {
+        while (p < c.end && *p >= '0' && *p <= '9')
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits++;
+            }
+            else
+            {
+                exponent++;
+                overflow = true;
+            }
+            p++;
+        }
+    }
+
+    integral = true;
+    if (p < c.end && *p == '.')
+    {
+        p++;
+        integral = false;
+        if (p >= c.end || *p < '0' || *p > '9')
+            return false;
+        while (p < c.end && *p >= '0' && *p <= '9')
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa ? 1 : 0;
+                exponent--;
+            }
+            p++;
+        }
+    }
+
+    if (p < c.end && (*p == 'e' || *p == 'E'))
+    {
+        p++;
+        integral = false;
+        bool negativeExponent = false;
+        if (p < c.end && (*p == '+' || *p == '-'))
+            negativeExponent = *p++ == '-';
+        if (p >= c.end || *p < '0' || *p > '9')
+            return false;
+        int written = 0;
+        while (p < c.end && *p >= '0' && *p <= '9')
+        {
+            if (written < 10000)
+                written = written * 10 + (*p - '0');
+            p++;
+        }
+        exponent += negativeExponent ? -written : written;
+    }
+
+    value = (double)mantissa;
+    for (int e = exponent; e > 0 && value != INFINITY; e--)
+        value *= 10;
+    for (int e = exponent; e < 0 && value != 0; e++)
+        value /= 10;
+    if (negative)
+        value = -value;
+
+    integral = integral && !overflow && mantissa <= (uint64_t)INT64_MAX;
+    integer = integral ? (negative ? -(int64_t)mantissa : (int64_t)mantissa) : 0;
+    c.p = p;
+    return true;
+}
+
+static inline bool protoSkipValue(ProtoCursor &c, int depth = 0);
+
+// Steps to the next object member. Returns 1 with key set and the cursor
+// on its value, 0 after the closing brace, -1 on malformed input. first
+// must start true; the caller consumes each value before the next call.
+static inline int protoNextMember(ProtoCursor &c, bool &first, ProtoSpan &key)
+{
+    if (protoConsume(c, '}'))
+        return 0;
+    if (!first && !protoConsume(c, ','))
+        return -1;
+    first = false;
+    if (!protoParseString(c, key) || !protoConsume(c, ':'))
+        return -1;
+    protoSkipSpace(c);
+    return 1;
+}
+
+// As protoNextMember(), for array elements
+static inline int protoNextElement(ProtoCursor &c, bool &first)
+{
+    if (protoConsume(c, ']'))
+        return 0;
+    if (!first && !protoConsume(c, ','))
+        return -1;
+    first = false;
+    protoSkipSpace(c);
+    return 1;
+}
+
+static inline bool protoSkipValue(ProtoCursor &c, int depth)
+{
+    protoSkipSpace(c);
+    if (c.p >= c.end || depth > PROTO_MAX_DEPTH)
+        return false;
+
+    switch (*c.p)
+    {
+    case '"':
+    {
+        ProtoSpan ignored;
+        return protoParseString(c, ignored);
+    }
+    case '{':
+    {
+        c.p++;
+        bool first = true;
+        ProtoSpan key;
+        int step;
+        while ((step = protoNextMember(c, first, key)) == 1)
+        {
+            if (!protoSkipValue(c, depth + 1))
+                return false;
+        }
+        return step == 0;
+    }
+    case '[':
+    {
+        c.p++;
+        bool first = true;
+        int step;
+        while ((step = protoNextElement(c, first)) == 1)
+        {
+            if (!protoSkipValue(c, depth + 1))
+                return false;
+        }
+        return step == 0;
+    }
+    case 't':
+        return protoLiteral(c, "true");
+    case 'f':
+        return protoLiteral(c, "false");
+    case 'n':
+        return protoLiteral(c, "null");
+    default:
+    {
+        double value;
+        bool integral;
+        int64_t integer;
+        return protoParseNumber(c, value, integral, integer);
+    }
+    }
+}
+
+// Typed readers for the value under the cursor; false on a type mismatch
+
+static inline bool protoReadRaw(ProtoCursor &c, ProtoSpan &out)
+{
+    protoSkipSpace(c);
+    const char *start = c.p;
+    if (!protoSkipValue(c))
+        return false;
+    out = {start, (size_t)(c.p - start)};
+    return true;
+}
+
+static inline bool protoReadString(ProtoCursor &c, ProtoSpan &out)
+{
+    protoSkipSpace(c);
+    if (protoLiteral(c, "null"))
+    {
+        out = {nullptr, 0};
+        return true;
+    }
+    return protoParseString(c, out);
+}
+
+static inline bool protoReadInt(ProtoCursor &c, int64_t &out, int64_t min, int64_t max)
+{
+    double value;
+    bool integral;
+    if (!protoParseNumber(c, value, integral, out))
+        return false;
+    return integral && out >= min && out <= max;
+}
+
+static inline bool protoReadFloat(ProtoCursor &c, float &out)
+{
+    protoSkipSpace(c);
+    if (protoLiteral(c, "null"))
+    {
+        out = NAN;
+        return true;
+    }
+    double value;
+    bool integral;
+    int64_t integer;
+    if (!protoParseNumber(c, value, integral, integer))
+        return false;
+    out = (float)value;
+    return true;
+}
+
+static inline bool protoReadBool(ProtoCursor &c, bool &out)
+{
+    protoSkipSpace(c);
+    if (protoLiteral(c, "true"))
+        out = true;
+    else if (protoLiteral(c, "false"))
+        out = false;
+    else
+        return false;
+    return true;
+}
+
+template <typename T>
+static inline bool protoReadNumber(ProtoCursor &c, T &out, int64_t min, int64_t max)
+{
+    int64_t value;
+    if (!protoReadInt(c, value, min, max))
+        return false;
+    out = (T)value;
+    return true;
+}
+
+// Finds a member of a raw object span, such as a response payload
+static inline bool protoFindMember(ProtoSpan object, const char *name, ProtoSpan &value)
+{
+    if (!object.data)
+        return false;
+    ProtoCursor c = {object.data, object.data + object.length};
+    if (!protoConsume(c, '{'))
+        return false;
+
+    bool first = true;
+    ProtoSpan key;
+    while (protoNextMember(c, first, key) == 1)
+    {
+        if (protoSpanIs(key, name))
+            return protoReadRaw(c, value);
+        if (!protoSkipValue(c))
+            return false;
+    }
+    return false;
+}
+
+static inline bool protoParseMetadata(ProtoCursor &c, MessageMetadata &meta)
+{
+    if (!protoConsume(c, '{'))
+        return false;
+
+    bool first = true;
+    ProtoSpan key;
+    int step;
+    while ((step = protoNextMember(c, first, key)) == 1)
+    {
+        bool ok;
+        if (protoSpanIs(key, "timestamp"))
+            ok = protoReadNumber(c, meta.timestamp, 0, UINT32_MAX);
+        else if (protoSpanIs(key, "sampling_rate_ms"))
+            ok = protoReadNumber(c, meta.samplingRateMs, INT32_MIN, INT32_MAX);
+        else if (protoSpanIs(key, "sequence"))
+            ok = protoReadNumber(c, meta.sequence, 0, UINT32_MAX);
+        else if (protoSpanIs(key, "keyframe"))
+            ok = protoReadBool(c, meta.keyframe);
+        else if (protoSpanIs(key, "calibration_id"))
+            ok = protoReadNumber(c, meta.calibrationId, 0, UINT32_MAX);
+        else if (protoSpanIs(key, "host_time_us"))
+            ok = meta.hasHostTime = protoReadInt(c, meta.hostTimeUs, INT64_MIN, INT64_MAX);
+        else if (protoSpanIs(key, "received_us"))
+            ok = protoReadInt(c, meta.receivedUs, INT64_MIN, INT64_MAX);
+        else if (protoSpanIs(key, "sent_us"))
+            ok = protoReadInt(c, meta.sentUs, INT64_MIN, INT64_MAX);
+        else
+            ok = protoSkipValue(c);
+        if (!ok)
+            return false;
+    }
+    return step == 0;
+}
+
+static inline bool protoParseChannel(ProtoCursor &c, DataChannel &channel)
+{
+    if (!protoConsume(c, '{'))
+        return false;
+
+    bool first = true;
+    ProtoSpan key;
+    int step;
+    while ((step = protoNextMember(c, first, key)) == 1)
+    {
+        bool ok;
+        if (protoSpanIs(key, "channel"))
+            ok = protoReadNumber(c, channel.channel, 1, PROTO_MAX_CHANNELS);
+        else if (protoSpanIs(key, "status"))
+        {
+            ProtoSpan status;
+            ok = protoParseString(c, status);
+            channel.ok = ok && protoSpanIs(status, "ok");
+        }
+        else if (protoSpanIs(key, "temperature_c"))
+            ok = protoReadFloat(c, channel.temperatureC);
+        else if (protoSpanIs(key, "fault_code"))
+            ok = protoReadNumber(c, channel.faultCode, 0, UINT8_MAX);
+        else
+            ok = protoSkipValue(c);
+        if (!ok)
+            return false;
+    }
+    return step == 0 && channel.channel != 0;
+}
+
+static inline bool protoParseChannels(ProtoCursor &c, DataMessage &data)
+{
+    if (!protoConsume(c, '['))
+        return false;
+
+    bool first = true;
+    int step;
+    while ((step = protoNextElement(c, first)) == 1)
+    {
+        if (data.channelCount == PROTO_MAX_CHANNELS)
+            return false;
+        if (!protoParseChannel(c, data.channels[data.channelCount++]))
+            return false;
+    }
+    return step == 0;
+}
+
+static inline bool protoParseDeviceInfo(ProtoSpan payload, DeviceInfo &info)
+{
+    ProtoCursor c = {payload.data, payload.data + payload.length};
+    if (!protoConsume(c, '{'))
+        return false;
+
+    bool first = true;
+    ProtoSpan key;
+    int step;
+    while ((step = protoNextMember(c, first, key)) == 1)
+    {
+        bool ok;
+        if (protoSpanIs(key, "serial_number"))
+            ok = protoReadString(c, info.serialNumber);
+        else if (protoSpanIs(key, "firmware_version"))
+            ok = protoReadString(c, info.firmwareVersion);
+        else if (protoSpanIs(key, "model"))
+            ok = protoReadString(c, info.model);
+        else if (protoSpanIs(key, "wifi_configured"))
+            ok = protoReadBool(c, info.wifiConfigured);
+        else if (protoSpanIs(key, "sampling_rate_ms"))
+            ok = protoReadNumber(c, info.samplingRateMs, INT32_MIN, INT32_MAX);
+        else if (protoSpanIs(key, "effective_sampling_rate_ms"))
+            ok = protoReadNumber(c, info.effectiveSamplingRateMs, INT32_MIN, INT32_MAX);
+        else if (protoSpanIs(key, "clock_synced"))
+            ok = protoReadBool(c, info.clockSynced);
+        else
+            ok = protoSkipValue(c);
+        if (!ok)
+            return false;
+    }
+    return step == 0;
+}
+
+// Decodes one line (a trailing \r\n is fine). False if the bytes are not a
+// single well-formed message or a known member has the wrong type; an
+// unmodelled "type" decodes as MSG_UNKNOWN.
+static inline bool decodeMessage(const char *bytes, size_t length, Message &out)
+{
+    memset(&out, 0, sizeof(out));
+    ProtoCursor c = {bytes, bytes + length};
+    if (!protoConsume(c, '{'))
+        return false;
+
+    // Members arrive in any order (responses set "type" last), so collect
+    // them first and sort them into the typed message after
+    ProtoSpan deviceId = {}, firmwareVersion = {}, model = {}, requestId = {}, payload = {};
+    MessageMetadata meta = {};
+    DataMessage &data = out.data;
+    UpdateAvailableMessage &update = out.update;
+
+    bool first = true;
+    ProtoSpan key;
+    int step;
+    while ((step = protoNextMember(c, first, key)) == 1)
+    {
+        bool ok;
+        if (protoSpanIs(key, "type"))
+            ok = protoParseString(c, out.typeName);
+        else if (protoSpanIs(key, "device_id"))
+            ok = protoReadString(c, deviceId);
+        else if (protoSpanIs(key, "firmware_version"))
+            ok = protoReadString(c, firmwareVersion);
+        else if (protoSpanIs(key, "model"))
+            ok = protoReadString(c, model);
+        else if (protoSpanIs(key, "metadata"))
+            ok = protoParseMetadata(c, meta);
+        else if (protoSpanIs(key, "channels"))
+            ok = protoParseChannels(c, data);
+        else if (protoSpanIs(key, "payload"))
+            ok = protoReadRaw(c, payload) && payload.data[0] == '{';
+        else if (protoSpanIs(key, "request_id"))
+            ok = protoReadRaw(c, requestId);
+        else if (protoSpanIs(key, "version"))
+            ok = protoReadString(c, update.version);
+        else if (protoSpanIs(key, "firmware_url"))
+            ok = protoReadString(c, update.firmwareUrl);
+        else if (protoSpanIs(key, "signature_url"))
+            ok = protoReadString(c, update.signatureUrl);
+        else if (protoSpanIs(key, "changelog"))
+            ok = protoReadString(c, update.changelog);
+        else
+            ok = protoSkipValue(c);
+        if (!ok)
+            return false;
+    }
+    protoSkipSpace(c);
+    if (step != 0 || c.p != c.end || !out.typeName.data)
+        return false;
+
+    for (uint8_t type = MSG_DATA; type < MSG_TYPE_COUNT; type++)
+    {
+        if (protoSpanIs(out.typeName, MESSAGE_TYPE_NAMES[type]))
+            out.type = (MessageType)type;
+    }
+
+    switch (out.type)
+    {
+    case MSG_DATA:
+        data.deviceId = deviceId;
+        data.firmwareVersion = firmwareVersion;
+        data.metadata = meta;
+        break;
+    case MSG_READY:
+        out.ready = {deviceId, firmwareVersion, model, meta};
+        break;
+    case MSG_CONFIGURATION:
+    case MSG_DEVICE_INFO:
+    case MSG_ERROR:
+    {
+        ResponseMessage &response = out.response;
+        response = {deviceId, requestId, meta, payload, {}, {}};
+        ProtoSpan value;
+        if (out.type == MSG_CONFIGURATION && protoFindMember(payload, "result", value) && value.data[0] == '"')
+            response.result = {value.data + 1, value.length - 2};
+        if (out.type == MSG_ERROR && protoFindMember(payload, "error", value) && value.data[0] == '"')
+            response.error = {value.data + 1, value.length - 2};
+        if (out.type == MSG_DEVICE_INFO && payload.data && !protoParseDeviceInfo(payload, out.deviceInfo))
+            return false;
+        break;
+    }
+    default:
+        break;
+    }
+    return true;
+}
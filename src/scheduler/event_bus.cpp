@@ -0,0 +1,169 @@
+#include <atomic>
+#include "event_bus.h"
+
+// Bounded MPMC queue after Vyukov: every cell carries a sequence number
+// that says whether it is free for the producer at a given position or
+// holds an event for the consumer, so both sides claim cells with one
+// compare-and-swap and never take a lock.
+
+static const uint32_t QUEUE_MASK = BUS_QUEUE_DEPTH - 1;
+static_assert((BUS_QUEUE_DEPTH & QUEUE_MASK) == 0, "BUS_QUEUE_DEPTH must be a power of two");
+
+struct BusCell
+{
+    std::atomic<uint32_t> sequence;
+    BusEvent event;
+};
+
+struct BusQueue
+{
+    BusCell cells[BUS_QUEUE_DEPTH];
+    std::atomic<uint32_t> enqueuePos;
+    std::atomic<uint32_t> dequeuePos;
+    std::atomic<uint32_t> dropped;
+};
+
+struct BusSubscriber
+{
+    uint32_t typeMask;
+    BusWake wake;
+    void *context;
+    BusQueue queue;
+};
+
+static BusSubscriber subscribers[BUS_MAX_SUBSCRIBERS];
+static std::atomic<int> subscriberCount(0);
+
+static void resetQueue(BusQueue &queue)
+{
+    for (uint32_t i = 0; i < BUS_QUEUE_DEPTH; i++)
+    {
+        queue.cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    queue.enqueuePos.store(0, std::memory_order_relaxed);
+    queue.dequeuePos.store(0, std::memory_order_relaxed);
+    queue.dropped.store(0, std::memory_order_relaxed);
+}
+
+static bool enqueue(BusQueue &queue, const BusEvent &event)
+{
+    uint32_t pos = queue.enqueuePos.load(std::memory_order_relaxed);
+    BusCell *cell;
+
+    for (;;)
+    {
+        cell = &queue.cells[pos & QUEUE_MASK];
+        uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(sequence - pos);
+
+        if (diff == 0)
+        {
+            if (queue.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false; // Full: the consumer has not freed this cell yet
+        }
+        else
+        {
+            pos = queue.enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->event = event;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+static bool dequeue(BusQueue &queue, BusEvent &event)
+{
+    uint32_t pos = queue.dequeuePos.load(std::memory_order_relaxed);
+    BusCell *cell;
+
+    for (;;)
+    {
+        cell = &queue.cells[pos & QUEUE_MASK];
+        uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+        int32_t diff = (int32_t)(sequence - (pos + 1));
+
+        if (diff == 0)
+        {
+            if (queue.dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false; // Empty
+        }
+        else
+        {
+            pos = queue.dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    event = cell->event;
+    cell->sequence.store(pos + BUS_QUEUE_DEPTH, std::memory_order_release);
+    return true;
+}
+
+int busSubscribe(uint32_t typeMask, BusWake wake, void *context)
+{
+    int id = subscriberCount.load(std::memory_order_relaxed);
+    if (id >= BUS_MAX_SUBSCRIBERS)
+        return -1;
+
+    BusSubscriber &subscriber = subscribers[id];
+    subscriber.typeMask = typeMask;
+    subscriber.wake = wake;
+    subscriber.context = context;
+    resetQueue(subscriber.queue);
+
+    // Publish the slot only once it is fully set up
+    subscriberCount.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+bool busPublish(const BusEvent &event)
+{
+    bool delivered = true;
+    int count = subscriberCount.load(std::memory_order_acquire);
+
+    for (int id = 0; id < count; id++)
+    {
+        BusSubscriber &subscriber = subscribers[id];
+        if (!(subscriber.typeMask & BUS_MASK(event.type)))
+            continue;
+
+        if (enqueue(subscriber.queue, event))
+        {
+            if (subscriber.wake)
+                subscriber.wake(subscriber.context);
+        }
+        else
+        {
+            subscriber.queue.dropped.fetch_add(1, std::memory_order_relaxed);
+            delivered = false;
+        }
+    }
+    return delivered;
+}
+
+bool busPoll(int subscriber, BusEvent &event)
+{
+    if (subscriber < 0 || subscriber >= subscriberCount.load(std::memory_order_acquire))
+        return false;
+    return dequeue(subscribers[subscriber].queue, event);
+}
+
+uint32_t busDropped(int subscriber)
+{
+    if (subscriber < 0 || subscriber >= subscriberCount.load(std::memory_order_acquire))
+        return 0;
+    return subscribers[subscriber].queue.dropped.load(std::memory_order_relaxed);
+}
+
+void busReset()
+{
+    subscriberCount.store(0, std::memory_order_release);
+}
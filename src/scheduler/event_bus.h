@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+
+// Typed publish/subscribe between subsystems. Each subscriber owns a
+// bounded lock-free queue in static storage; publishing copies the event
+// into every interested queue and calls the subscriber's wake hook, so
+// publishers never block and nothing is allocated. Plain C++ with no
+// Arduino or FreeRTOS dependencies.
+
+enum BusEventType : uint8_t
+{
+    BUS_WIFI_CONNECTED,    // value: RSSI in dBm
+    BUS_WIFI_DISCONNECTED,
+    BUS_SETUP_MODE,        // Captive portal started
+    BUS_ROAST_STARTED,     // value: hottest channel temperature, 0.01 C
+    BUS_ROAST_ENDED,       // value: roast duration in seconds
+    BUS_HOST_CONNECTED,    // Host reported it reads the serial port
+    BUS_HOST_DISCONNECTED,
+    BUS_DATA_SENT,         // A telemetry frame was queued or published
+    BUS_FACTORY_RESET,     // Settings cleared; restarting shortly
+    BUS_EVENT_TYPES,
+};
+
+#define BUS_MASK(type) (1u << (type))
+
+#define BUS_MAX_SUBSCRIBERS 8
+#define BUS_QUEUE_DEPTH 16 // Power of two
+
+struct BusEvent
+{
+    uint8_t type;
+    uint32_t timestampMs;
+    int64_t hostTimeUs; // 0 when the clock is not synced
+    int32_t value;
+};
+
+// Called after an event lands in the subscriber's queue, on the publishing
+// task; typically notifies the subscriber's task
+typedef void (*BusWake)(void *context);
+
+// Subscribe during setup, before the subscriber's publishers start.
+// Returns the subscriber id, or -1 when all slots are taken.
+int busSubscribe(uint32_t typeMask, BusWake wake, void *context);
+
+// Task context only. False if any interested queue was full.
+bool busPublish(const BusEvent &event);
+
+bool busPoll(int subscriber, BusEvent &event);
+uint32_t busDropped(int subscriber);
+
+// Drops all subscribers; for tests and reinitialization
+void busReset();
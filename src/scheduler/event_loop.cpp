@@ -0,0 +1,37 @@
+#include "event_loop.h"
+
+// loop() sleeps on its own task notification value. Event sources OR in
+// bits; timed work (sampling, batch flush) is expressed as the wait timeout.
+
+static TaskHandle_t loopTaskHandle = nullptr;
+
+void eventLoopBegin()
+{
+    // setup() and loop() share the Arduino loop task
+    loopTaskHandle = xTaskGetCurrentTaskHandle();
+}
+
+void eventLoopSignal(uint32_t events)
+{
+    if (loopTaskHandle)
+    {
+        xTaskNotify(loopTaskHandle, events, eSetBits);
+    }
+}
+
+void IRAM_ATTR eventLoopSignalFromISR(uint32_t events)
+{
+    if (loopTaskHandle)
+    {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(loopTaskHandle, events, eSetBits, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+uint32_t eventLoopWait(unsigned long timeoutMs)
+{
+    uint32_t events = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &events, pdMS_TO_TICKS(timeoutMs));
+    return events;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <Arduino.h>
+
+// Wake reasons delivered to loop() as task notification bits
+#define EVENT_COMMAND 0x01 // A command changed state the loop schedules on
+#define EVENT_WIFI 0x02
+#define EVENT_BUTTON 0x04
+#define EVENT_BUS 0x08 // Events queued for the loop on the event bus
+
+void eventLoopBegin();
+void eventLoopSignal(uint32_t events);
+void eventLoopSignalFromISR(uint32_t events);
+uint32_t eventLoopWait(unsigned long timeoutMs);
@@ -0,0 +1,96 @@
+#include <limits.h>
+#include "calibration.h"
+
+// Plain C++ only so tools/calibration_check.cpp can test it off-target
+
+bool calibrationBuild(const CalibrationPoints &points, CalibrationCurve &curve, const char *&error)
+{
+    if (points.count < 1 || points.count > CALIBRATION_MAX_POINTS)
+    {
+        error = "Invalid calibration: 1-16 points";
+        return false;
+    }
+
+    for (uint8_t i = 0; i < points.count; i++)
+    {
+        int32_t raw = points.rawMilliC[i];
+        int32_t actual = points.actualMilliC[i];
+        if (raw < CALIBRATION_MIN_C * 1000 || raw > CALIBRATION_MAX_C * 1000 ||
+            actual < CALIBRATION_MIN_C * 1000 || actual > CALIBRATION_MAX_C * 1000)
+        {
+            error = "Invalid calibration: point outside -270 to 1820 C";
+            return false;
+        }
+        if (actual - raw > CALIBRATION_MAX_OFFSET_MC || raw - actual > CALIBRATION_MAX_OFFSET_MC)
+        {
+            error = "Invalid calibration: correction over 50 C";
+            return false;
+        }
+        if (i > 0 && raw - points.rawMilliC[i - 1] < CALIBRATION_MIN_SPACING_MC)
+        {
+            error = "Invalid calibration: raw points must rise by at least 1 C";
+            return false;
+        }
+    }
+
+    CalibrationCurve built;
+    built.count = points.count;
+    built.lastSegment = points.count >= 2 ? points.count - 2 : 0;
+    for (uint8_t i = 0; i < CALIBRATION_MAX_POINTS; i++)
+    {
+        bool used = i < points.count;
+        built.knotMilliC[i] = used ? points.rawMilliC[i] : INT32_MAX;
+        built.baseMilliC[i] = used ? points.actualMilliC[i] : 0;
+        built.slopeQ24[i] = 1 << 24;
+    }
+
+    for (uint8_t i = 0; i + 1 < points.count; i++)
+    {
+        double slope = (double)(points.actualMilliC[i + 1] - points.actualMilliC[i]) /
+                       (points.rawMilliC[i + 1] - points.rawMilliC[i]);
+        if (slope < CALIBRATION_MIN_SLOPE || slope > CALIBRATION_MAX_SLOPE)
+        {
+            error = "Invalid calibration: segment slope outside 0.5-2";
+            return false;
+        }
+        built.slopeQ24[i] = (int32_t)lround(slope * (1 << 24));
+    }
+
+    curve = built;
+    return true;
+}
+
+uint32_t calibrationSetId(const CalibrationSet &set)
+{
+    // FNV-1a over each calibrated channel's points
+    uint32_t hash = 2166136261u;
+    bool any = false;
+    auto mix = [&](uint32_t value)
+    {
+        for (int shift = 0; shift < 32; shift += 8)
+        {
+            hash ^= (value >> shift) & 0xFF;
+            hash *= 16777619u;
+        }
+    };
+
+    for (uint8_t ch = 0; ch < MAX_THERMOCOUPLE_CHANNELS; ch++)
+    {
+        const CalibrationCurve &curve = set.curves[ch];
+        if (curve.count == 0)
+            continue;
+
+        any = true;
+        mix(ch);
+        mix(curve.count);
+        for (uint8_t i = 0; i < curve.count; i++)
+        {
+            mix(curve.knotMilliC[i]);
+            mix(curve.baseMilliC[i]);
+        }
+    }
+
+    if (!any)
+        return 0;
+    return hash != 0 ? hash : 1;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include "common/temperature_sample.h"
+
+// Per-channel piecewise-linear correction from the reading a probe gives
+// to the temperature it should have given. Applied in fixed point in the
+// acquisition pass; below the first and above the last point the end
+// segments are extended. One point is a plain offset.
+
+#define CALIBRATION_MAX_POINTS 16
+
+// Bounds on uploaded curves, to catch unit mix-ups rather than drift
+#define CALIBRATION_MIN_C -270
+#define CALIBRATION_MAX_C 1820
+#define CALIBRATION_MIN_SPACING_MC 1000 // Between raw points
+#define CALIBRATION_MAX_OFFSET_MC 50000
+#define CALIBRATION_MIN_SLOPE 0.5
+#define CALIBRATION_MAX_SLOPE 2.0
+
+// As uploaded and as stored in NVS, in milli-degrees C
+struct CalibrationPoints
+{
+    uint8_t count;
+    int32_t rawMilliC[CALIBRATION_MAX_POINTS];    // Strictly increasing
+    int32_t actualMilliC[CALIBRATION_MAX_POINTS];
+};
+
+// Ready to apply: knots padded with INT32_MAX so the search always runs
+// over all 16 slots, and one slope per segment so there is no division
+struct CalibrationCurve
+{
+    uint8_t count; // 0 = uncalibrated
+    uint8_t lastSegment;
+    int32_t knotMilliC[CALIBRATION_MAX_POINTS];
+    int32_t baseMilliC[CALIBRATION_MAX_POINTS];
+    int32_t slopeQ24[CALIBRATION_MAX_POINTS];
+};
+
+struct CalibrationSet
+{
+    CalibrationCurve curves[MAX_THERMOCOUPLE_CHANNELS];
+    uint32_t id; // Reported in frames; 0 = no channel calibrated
+};
+
+// Validates points and builds the curve. On failure curve is untouched
+// and error says why.
+bool calibrationBuild(const CalibrationPoints &points, CalibrationCurve &curve, const char *&error);
+
+// Hash of every channel's curve: the same calibration gives the same ID
+// across reboots and units
+uint32_t calibrationSetId(const CalibrationSet &set);
+
+static inline int32_t calibrationApplyMilliC(const CalibrationCurve &curve, int32_t rawMilliC)
+{
+    // Fixed four-step search for the last knot at or below the reading;
+    // each step is a compare and a conditional add, no branch
+    uint32_t pos = 0;
+    pos += curve.knotMilliC[pos + 8] <= rawMilliC ? 8 : 0;
+    pos += curve.knotMilliC[pos + 4] <= rawMilliC ? 4 : 0;
+    pos += curve.knotMilliC[pos + 2] <= rawMilliC ? 2 : 0;
+    pos += curve.knotMilliC[pos + 1] <= rawMilliC ? 1 : 0;
+    uint32_t segment = pos < curve.lastSegment ? pos : curve.lastSegment;
+
+    int64_t delta = (int64_t)(rawMilliC - curve.knotMilliC[segment]) * curve.slopeQ24[segment];
+    return curve.baseMilliC[segment] + (int32_t)((delta + (1 << 23)) >> 24);
+}
+
+static inline float calibrationApply(const CalibrationCurve &curve, float rawC)
+{
+    return calibrationApplyMilliC(curve, (int32_t)lrintf(rawC * 1000.0f)) / 1000.0f;
+}
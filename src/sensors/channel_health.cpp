@@ -0,0 +1,66 @@
+#include "channel_health.h"
+
+// Plain C++ only so the recovery policy can be exercised off-target
+
+static void scheduleRetry(ChannelHealth &health, unsigned long now)
+{
+    health.online = false;
+    health.nextRetryMs = now + health.backoffMs;
+}
+
+void channelHealthInit(ChannelHealth &health, bool online, unsigned long now)
+{
+    health.consecutiveFaults = 0;
+    health.backoffMs = CHANNEL_RETRY_MIN_MS;
+    health.recoveries = 0;
+    health.online = online;
+    health.nextRetryMs = now + health.backoffMs;
+}
+
+void channelHealthReportOk(ChannelHealth &health)
+{
+    // Only a good reading proves the chip is back, so backoff resets here
+    // rather than on a successful begin()
+    health.consecutiveFaults = 0;
+    health.backoffMs = CHANNEL_RETRY_MIN_MS;
+}
+
+void channelHealthReportFault(ChannelHealth &health, uint8_t fault, unsigned long now)
+{
+    // Open or shorted probes are wiring faults the chip reports correctly;
+    // re-initializing it would not help
+    if (!(fault & CHANNEL_FAULT_NO_RESPONSE))
+    {
+        health.consecutiveFaults = 0;
+        return;
+    }
+
+    if (++health.consecutiveFaults >= CHANNEL_FAULT_THRESHOLD)
+    {
+        health.consecutiveFaults = 0;
+        scheduleRetry(health, now);
+    }
+}
+
+bool channelHealthRetryDue(const ChannelHealth &health, unsigned long now)
+{
+    return !health.online && (long)(now - health.nextRetryMs) >= 0;
+}
+
+void channelHealthRetryResult(ChannelHealth &health, bool ok, unsigned long now)
+{
+    if (ok)
+    {
+        health.online = true;
+        health.recoveries++;
+    }
+
+    // Keep doubling until a reading succeeds, so a chip that accepts
+    // begin() but still returns garbage backs off too
+    health.backoffMs = health.backoffMs * 2 > CHANNEL_RETRY_MAX_MS ? CHANNEL_RETRY_MAX_MS : health.backoffMs * 2;
+
+    if (!ok)
+    {
+        scheduleRetry(health, now);
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+
+// Per-channel fault bits carried in data frames. The low bits match the
+// MAX31855 error bits; the high bits are firmware-detected conditions.
+#define CHANNEL_FAULT_OPEN 0x01
+#define CHANNEL_FAULT_SHORT_GND 0x02
+#define CHANNEL_FAULT_SHORT_VCC 0x04
+#define CHANNEL_FAULT_TC_RANGE 0x08    // Hot junction out of range (MAX31856)
+#define CHANNEL_FAULT_CJ_RANGE 0x10    // Cold junction out of range (MAX31856)
+#define CHANNEL_FAULT_LIMIT 0x20       // A high/low threshold tripped, with one of the two above
+#define CHANNEL_FAULT_NO_RESPONSE 0x40 // Chip absent or bus stuck
+#define CHANNEL_FAULT_OFFLINE 0x80     // Waiting for background re-init
+
+// Bus faults in a row before the chip is taken offline
+#define CHANNEL_FAULT_THRESHOLD 3
+
+// Re-init backoff bounds
+#define CHANNEL_RETRY_MIN_MS 500UL
+#define CHANNEL_RETRY_MAX_MS 30000UL
+
+struct ChannelHealth
+{
+    bool online;
+    uint8_t consecutiveFaults;
+    unsigned long backoffMs;
+    unsigned long nextRetryMs;
+    uint32_t recoveries;
+};
+
+void channelHealthInit(ChannelHealth &health, bool online, unsigned long now);
+void channelHealthReportOk(ChannelHealth &health);
+void channelHealthReportFault(ChannelHealth &health, uint8_t fault, unsigned long now);
+bool channelHealthRetryDue(const ChannelHealth &health, unsigned long now);
+void channelHealthRetryResult(ChannelHealth &health, bool ok, unsigned long now);
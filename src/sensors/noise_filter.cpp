@@ -0,0 +1,230 @@
+#include <math.h>
+#include <string.h>
+#include "noise_filter.h"
+
+// Median-of-N spike rejection followed by a scalar Kalman filter. State is
+// stored channel-innermost so each stage is a fixed-length loop over all
+// channels with no data-dependent branches.
+
+static uint8_t medianWindow = 1;      // 1 = no spike rejection
+static float processNoise = 0.0f;     // Kalman q (C^2 per sample)
+static float measurementNoise = 0.0f; // Kalman r (C^2); 0 = pass through
+
+static float history[NOISE_FILTER_MAX_MEDIAN][MAX_THERMOCOUPLE_CHANNELS];
+static float estimate[MAX_THERMOCOUPLE_CHANNELS];
+static float variance[MAX_THERMOCOUPLE_CHANNELS];
+static bool seeded[MAX_THERMOCOUPLE_CHANNELS];
+static uint8_t historyNext = 0;
+
+// The stages are written once against Lanes: one channel per step, or
+// every channel at once as a GCC vector. Lanes never hold NaN, so min/max
+// are plain compares in both paths and the results match bit for bit.
+// The S3's PIE unit has no float lanes, so on target the vector path is
+// split back into FPU instructions; it pays off on hosts with SIMD.
+#if NOISE_FILTER_VECTOR
+typedef float Lanes __attribute__((vector_size(MAX_THERMOCOUPLE_CHANNELS * sizeof(float))));
+static const int LANE_STEP = MAX_THERMOCOUPLE_CHANNELS;
+
+static inline Lanes load(const float *p)
+{
+    Lanes v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void store(float *p, Lanes v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline Lanes broadcast(float x)
+{
+    return Lanes{} + x;
+}
+#else
+typedef float Lanes;
+static const int LANE_STEP = 1;
+
+static inline Lanes load(const float *p)
+{
+    return *p;
+}
+
+static inline void store(float *p, Lanes v)
+{
+    *p = v;
+}
+
+static inline Lanes broadcast(float x)
+{
+    return x;
+}
+#endif
+
+static inline Lanes lanesMin(Lanes a, Lanes b)
+{
+    return a < b ? a : b;
+}
+
+static inline Lanes lanesMax(Lanes a, Lanes b)
+{
+    return a < b ? b : a;
+}
+
+static inline void sortPair(Lanes &a, Lanes &b)
+{
+    Lanes low = lanesMin(a, b);
+    b = lanesMax(a, b);
+    a = low;
+}
+
+// window[0..medianWindow) holds the most recent readings, oldest first
+static void medianStage(const float window[][MAX_THERMOCOUPLE_CHANNELS], float *out)
+{
+    if (medianWindow == 3)
+    {
+        for (int ch = 0; ch < MAX_THERMOCOUPLE_CHANNELS; ch += LANE_STEP)
+        {
+            Lanes a = load(&window[0][ch]), b = load(&window[1][ch]), c = load(&window[2][ch]);
+            store(&out[ch], lanesMax(lanesMin(a, b), lanesMin(lanesMax(a, b), c)));
+        }
+    }
+    else if (medianWindow == 5)
+    {
+        // 7-exchange selection network for the middle of five
+        for (int ch = 0; ch < MAX_THERMOCOUPLE_CHANNELS; ch += LANE_STEP)
+        {
+            Lanes p0 = load(&window[0][ch]), p1 = load(&window[1][ch]), p2 = load(&window[2][ch]);
+            Lanes p3 = load(&window[3][ch]), p4 = load(&window[4][ch]);
+            sortPair(p0, p1);
+            sortPair(p3, p4);
+            sortPair(p0, p3);
+            sortPair(p1, p4);
+            sortPair(p1, p2);
+            sortPair(p2, p3);
+            sortPair(p1, p2);
+            store(&out[ch], p2);
+        }
+    }
+    else
+    {
+        for (int ch = 0; ch < MAX_THERMOCOUPLE_CHANNELS; ch += LANE_STEP)
+        {
+            store(&out[ch], load(&window[0][ch]));
+        }
+    }
+}
+
+static void kalmanStage(float *values)
+{
+    const Lanes q = broadcast(processNoise);
+    const Lanes r = broadcast(measurementNoise);
+    const Lanes one = broadcast(1.0f);
+    for (int ch = 0; ch < MAX_THERMOCOUPLE_CHANNELS; ch += LANE_STEP)
+    {
+        Lanes predicted = load(&variance[ch]) + q;
+        Lanes gain = predicted / (predicted + r);
+        Lanes current = load(&estimate[ch]);
+        current += gain * (load(&values[ch]) - current);
+        store(&estimate[ch], current);
+        store(&variance[ch], (one - gain) * predicted);
+        store(&values[ch], current);
+    }
+}
+
+void configureNoiseFilter(uint8_t window, float q, float r)
+{
+    medianWindow = (window == 3 || window == 5) ? window : 1;
+    measurementNoise = r > 0.0f ? r : 0.0f;
+    // A q of 0 saved by older firmware would freeze the output
+    processNoise = q > 0.0f ? q : (measurementNoise > 0.0f ? NOISE_FILTER_DEFAULT_Q : 0.0f);
+    resetNoiseFilter();
+}
+
+void resetNoiseFilter()
+{
+    for (int ch = 0; ch < MAX_THERMOCOUPLE_CHANNELS; ch++)
+    {
+        seeded[ch] = false;
+    }
+}
+
+void applyNoiseFilter(TemperatureSample &sample)
+{
+    if (medianWindow == 1 && measurementNoise == 0.0f)
+        return;
+
+    // Faulted channels drop their state and re-seed from the next good
+    // reading so a stale estimate never bleeds across a probe swap
+    for (int ch = 0; ch < sample.channelCount; ch++)
+    {
+        float value = sample.temperatureC[ch];
+        if (isnan(value))
+        {
+            seeded[ch] = false;
+            continue;
+        }
+
+        if (!seeded[ch])
+        {
+            for (int k = 0; k < NOISE_FILTER_MAX_MEDIAN; k++)
+            {
+                history[k][ch] = value;
+            }
+            estimate[ch] = value;
+            variance[ch] = measurementNoise;
+            seeded[ch] = true;
+        }
+    }
+
+    // Unused or faulted lanes carry their last value so the channel loops
+    // stay branch-free; they are masked off again on the way out
+    for (int ch = 0; ch < MAX_THERMOCOUPLE_CHANNELS; ch++)
+    {
+        bool valid = ch < sample.channelCount && !isnan(sample.temperatureC[ch]);
+        uint8_t previous = (historyNext + NOISE_FILTER_MAX_MEDIAN - 1) % NOISE_FILTER_MAX_MEDIAN;
+        history[historyNext][ch] = valid ? sample.temperatureC[ch] : history[previous][ch];
+    }
+    historyNext = (historyNext + 1) % NOISE_FILTER_MAX_MEDIAN;
+
+    // Unroll the most recent slots of the ring into a contiguous window
+    float ordered[NOISE_FILTER_MAX_MEDIAN][MAX_THERMOCOUPLE_CHANNELS] = {};
+    for (int k = 0; k < medianWindow; k++)
+    {
+        uint8_t slot = (historyNext + NOISE_FILTER_MAX_MEDIAN - medianWindow + k) % NOISE_FILTER_MAX_MEDIAN;
+        for (int ch = 0; ch < MAX_THERMOCOUPLE_CHANNELS; ch++)
+        {
+            ordered[k][ch] = history[slot][ch];
+        }
+    }
+
+    float filtered[MAX_THERMOCOUPLE_CHANNELS];
+    medianStage(ordered, filtered);
+    if (measurementNoise > 0.0f)
+    {
+        kalmanStage(filtered);
+    }
+
+    for (int ch = 0; ch < sample.channelCount; ch++)
+    {
+        if (!isnan(sample.temperatureC[ch]))
+        {
+            sample.temperatureC[ch] = filtered[ch];
+        }
+    }
+}
+
+uint8_t noiseFilterMedianWindow()
+{
+    return medianWindow;
+}
+
+float noiseFilterProcessNoise()
+{
+    return processNoise;
+}
+
+float noiseFilterMeasurementNoise()
+{
+    return measurementNoise;
+}
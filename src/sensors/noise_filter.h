@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+#include "common/temperature_sample.h"
+
+// Largest supported spike-rejection window
+#define NOISE_FILTER_MAX_MEDIAN 5
+
+// Kalman q used when none is given. q must be positive whenever r is:
+// with q = 0 the gain decays to zero and the output stops following the
+// probe.
+#define NOISE_FILTER_DEFAULT_Q 0.01f
+
+// Build with -DNOISE_FILTER_VECTOR=1 to run each stage on all channels as
+// one GCC vector instead of a per-channel loop. Both paths give identical
+// results; tools/noise_filter_check.cpp checks that and times them.
+#ifndef NOISE_FILTER_VECTOR
+#define NOISE_FILTER_VECTOR 0
+#endif
+
+void configureNoiseFilter(uint8_t medianWindow, float processNoise, float measurementNoise);
+void resetNoiseFilter();
+void applyNoiseFilter(TemperatureSample &sample);
+uint8_t noiseFilterMedianWindow();
+float noiseFilterProcessNoise();
+float noiseFilterMeasurementNoise();
@@ -0,0 +1,144 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include "common/temperature_sample.h"
+#include "calibration.h"
+#include "channel_health.h"
+#include "thermocouple_linearization.h"
+
+// Thermocouple channels with the amplifier chip and channel count fixed at
+// compile time. Each build gets one inlined acquisition pass over its
+// chips, with no per-read dispatch. A chip type provides:
+//
+//   explicit Chip(uint8_t csPin);
+//   bool begin();                                 // Also used for re-init
+//   float readCelsius(uint8_t &fault);            // NaN with CHANNEL_FAULT_* bits set
+//   void setType(const ThermocoupleTable *table); // nullptr = chip default (K)
+//   static bool supportsType(const ThermocoupleTable *table);
+//   static constexpr bool SOFTWARE_LINEARIZATION; // Takes linearize() below
+//   float linearize(float reportedC, const ThermocoupleTable &table);
+//
+// Plain C++ only, so tools/sensor_bench.cpp can build it on a host.
+
+template <typename Chip, uint8_t N>
+class SensorArray
+{
+public:
+    static_assert(N >= 1 && N <= MAX_THERMOCOUPLE_CHANNELS, "channel count out of range");
+    static constexpr uint8_t CHANNELS = N;
+
+    // Chip selects for the first N channels
+    explicit SensorArray(const uint8_t *csPins) : SensorArray(csPins, std::make_index_sequence<N>()) {}
+
+    Chip &chip(uint8_t index) { return chips[index]; }
+
+    // Sets a channel's thermocouple type, nullptr for the chip's own
+    // conversion. The software conversion is picked here, so reads do not
+    // test for a table.
+    void setType(uint8_t index, const ThermocoupleTable *table)
+    {
+        chips[index].setType(table);
+        tables[index] = table;
+        converters[index] = table ? tableConversion : chipConversion;
+    }
+
+    // One pass across every channel. Offline channels are skipped
+    // without touching the bus.
+    void read(TemperatureSample &sample, ChannelHealth *health, const CalibrationSet &calibration)
+    {
+        sample.channelCount = N;
+        sample.calibrationId = calibration.id;
+        for (uint8_t i = 0; i < N; i++)
+        {
+            readChannel(i, sample, health[i], calibration.curves[i]);
+        }
+    }
+
+private:
+    typedef float (*Converter)(Chip &chip, float reportedC, const ThermocoupleTable *table);
+
+    template <size_t... I>
+    SensorArray(const uint8_t *csPins, std::index_sequence<I...>)
+        : chips{Chip(csPins[I])...}, converters{((void)I, chipConversion)...}
+    {
+    }
+
+    static float chipConversion(Chip &, float reportedC, const ThermocoupleTable *) { return reportedC; }
+    static float tableConversion(Chip &chip, float reportedC, const ThermocoupleTable *table)
+    {
+        return chip.linearize(reportedC, *table);
+    }
+
+    inline __attribute__((always_inline)) void readChannel(uint8_t index, TemperatureSample &sample,
+                                                           ChannelHealth &health, const CalibrationCurve &curve)
+    {
+        sample.temperatureC[index] = NAN;
+        sample.fault[index] = 0;
+
+        if (!health.online)
+        {
+            sample.fault[index] = CHANNEL_FAULT_OFFLINE;
+            return;
+        }
+
+        uint8_t fault = 0;
+        float tempC = chips[index].readCelsius(fault);
+        if (isnan(tempC))
+        {
+            sample.fault[index] = fault;
+            channelHealthReportFault(health, fault, sample.timestamp);
+            return;
+        }
+
+        channelHealthReportOk(health);
+
+        if constexpr (Chip::SOFTWARE_LINEARIZATION)
+            tempC = converters[index](chips[index], tempC, tables[index]);
+
+        // Probe correction last, on the linearized temperature
+        if (curve.count)
+            tempC = calibrationApply(curve, tempC);
+
+        sample.temperatureC[index] = tempC;
+    }
+
+    Chip chips[N];
+    const ThermocoupleTable *tables[N] = {};
+    Converter converters[N]; // Chosen by setType()
+};
+
+// Stand-in amplifier for bench setups without thermocouples: a roast-like
+// ramp per channel with a little deterministic noise
+class SimulatedChip
+{
+public:
+    static constexpr bool SOFTWARE_LINEARIZATION = false;
+
+    explicit SimulatedChip(uint8_t csPin) : seed(csPin * 2654435761u + 1), offsetC((csPin % 4) * 1.5f) {}
+
+    bool begin()
+    {
+        reads = 0;
+        return true;
+    }
+
+    float readCelsius(uint8_t &fault)
+    {
+        fault = 0;
+        seed = seed * 1664525u + 1013904223u;
+        float noise = (int32_t)(seed >> 24) / 1280.0f - 0.1f; // +/-0.1 C
+        float rampC = 25.0f + reads++ * 0.25f;
+        return (rampC < 230.0f ? rampC : 230.0f) + offsetC + noise;
+    }
+
+    void setType(const ThermocoupleTable *) {}
+    static bool supportsType(const ThermocoupleTable *) { return true; }
+    float linearize(float reportedC, const ThermocoupleTable &) { return reportedC; }
+
+private:
+    uint32_t seed;
+    float offsetC; // Keeps channels apart on a plot
+    uint32_t reads = 0;
+};
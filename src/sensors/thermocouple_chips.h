@@ -0,0 +1,247 @@
+#pragma once
+#include <Arduino.h>
+#include <SPI.h>
+#include "sensor_array.h"
+
+// Amplifier chip and channel count are build flags, e.g. in platformio.ini:
+//
+//   -DTHERMOCOUPLE_CHIP=THERMOCOUPLE_CHIP_MAX31856
+//   -DTHERMOCOUPLE_CHANNELS=4
+//
+// Without them the build reads one MAX31855. Only the selected chip's
+// adapter and library are compiled in.
+
+#define THERMOCOUPLE_CHIP_MAX31855 1
+#define THERMOCOUPLE_CHIP_MAX31856 2
+#define THERMOCOUPLE_CHIP_MAX6675 3
+#define THERMOCOUPLE_CHIP_SIMULATED 4
+
+#ifndef THERMOCOUPLE_CHIP
+#define THERMOCOUPLE_CHIP THERMOCOUPLE_CHIP_MAX31855
+#endif
+
+#ifndef THERMOCOUPLE_CHANNELS
+#define THERMOCOUPLE_CHANNELS 1
+#endif
+
+#if THERMOCOUPLE_CHIP == THERMOCOUPLE_CHIP_MAX31855
+#include <Adafruit_MAX31855.h>
+
+// Converts as K-type only; other types are corrected in software
+class Max31855Chip
+{
+public:
+    static constexpr bool SOFTWARE_LINEARIZATION = true;
+
+    explicit Max31855Chip(uint8_t csPin) : device(csPin) {}
+
+    // begin() succeeds without a chip; a frame with every fault bit set
+    // means MISO is floating
+    bool begin() { return device.begin() && device.readError() != MAX31855_FAULT_ALL; }
+
+    // NaN is the chip's fault flag, so the healthy path costs one read
+    float readCelsius(uint8_t &fault)
+    {
+        float tempC = device.readCelsius();
+        if (isnan(tempC))
+        {
+            fault = device.readError() & MAX31855_FAULT_ALL;
+            if (fault == 0 || fault == MAX31855_FAULT_ALL)
+                fault = CHANNEL_FAULT_NO_RESPONSE;
+        }
+        return tempC;
+    }
+
+    void setType(const ThermocoupleTable *) {}
+    static bool supportsType(const ThermocoupleTable *) { return true; }
+
+    // Recover the junction EMF from the chip's linear K-type result and
+    // run it through the NIST table for the configured type
+    float linearize(float reportedC, const ThermocoupleTable &table)
+    {
+        float coldJunctionC = device.readInternal();
+        int32_t emf = max31855ThermocoupleEmf(reportedC, coldJunctionC);
+        return linearizeThermocouple(table, emf, (int32_t)(coldJunctionC * 1000.0f)) / 1000.0f;
+    }
+
+private:
+    Adafruit_MAX31855 device;
+};
+
+typedef Max31855Chip ThermocoupleChip;
+#define THERMOCOUPLE_CHIP_NAME "MAX31855"
+
+#elif THERMOCOUPLE_CHIP == THERMOCOUPLE_CHIP_MAX31856
+#include <Adafruit_MAX31856.h>
+
+// Linearizes every supported type itself, so no software tables
+class Max31856Chip
+{
+public:
+    static constexpr bool SOFTWARE_LINEARIZATION = false;
+
+    explicit Max31856Chip(uint8_t csPin) : device(csPin) {}
+
+    // Continuous conversion keeps reads to register fetches instead of a
+    // 250 ms one-shot wait. A fault register of all ones means MISO is
+    // floating.
+    bool begin()
+    {
+        started = device.begin();
+        if (!started)
+            return false;
+        device.setThermocoupleType(chipType);
+        device.setConversionMode(MAX31856_CONTINUOUS);
+        return device.readFault() != 0xFF;
+    }
+
+    // Two transfers: the chip reports faults in a register of its own
+    // rather than in the temperature word
+    float readCelsius(uint8_t &fault)
+    {
+        uint8_t chipFault = device.readFault();
+        if (chipFault == 0xFF)
+        {
+            fault = CHANNEL_FAULT_NO_RESPONSE;
+            return NAN;
+        }
+        if (chipFault)
+        {
+            fault = faultBits(chipFault);
+            return NAN;
+        }
+        return device.readThermocoupleTemperature();
+    }
+
+    void setType(const ThermocoupleTable *table)
+    {
+        chipType = table ? typeFor(table->type) : MAX31856_TCTYPE_K;
+        if (started)
+            device.setThermocoupleType(chipType);
+    }
+
+    static bool supportsType(const ThermocoupleTable *) { return true; }
+    float linearize(float reportedC, const ThermocoupleTable &) { return reportedC; }
+
+private:
+    // Every status bit is decoded. OVUV does not say which rail the input
+    // is shorted to, and a HIGH or LOW threshold sets the limit bit next
+    // to the junction it tripped on.
+    static uint8_t faultBits(uint8_t chipFault)
+    {
+        uint8_t fault = 0;
+        if (chipFault & MAX31856_FAULT_OPEN)
+            fault |= CHANNEL_FAULT_OPEN;
+        if (chipFault & MAX31856_FAULT_OVUV)
+            fault |= CHANNEL_FAULT_SHORT_GND | CHANNEL_FAULT_SHORT_VCC;
+        if (chipFault & (MAX31856_FAULT_TCRANGE | MAX31856_FAULT_TCHIGH | MAX31856_FAULT_TCLOW))
+            fault |= CHANNEL_FAULT_TC_RANGE;
+        if (chipFault & (MAX31856_FAULT_CJRANGE | MAX31856_FAULT_CJHIGH | MAX31856_FAULT_CJLOW))
+            fault |= CHANNEL_FAULT_CJ_RANGE;
+        if (chipFault & (MAX31856_FAULT_TCHIGH | MAX31856_FAULT_TCLOW | MAX31856_FAULT_CJHIGH | MAX31856_FAULT_CJLOW))
+            fault |= CHANNEL_FAULT_LIMIT;
+        return fault;
+    }
+
+    static max31856_thermocoupletype_t typeFor(char type)
+    {
+        switch (type)
+        {
+        case 'B':
+            return MAX31856_TCTYPE_B;
+        case 'E':
+            return MAX31856_TCTYPE_E;
+        case 'J':
+            return MAX31856_TCTYPE_J;
+        case 'N':
+            return MAX31856_TCTYPE_N;
+        case 'R':
+            return MAX31856_TCTYPE_R;
+        case 'S':
+            return MAX31856_TCTYPE_S;
+        case 'T':
+            return MAX31856_TCTYPE_T;
+        default:
+            return MAX31856_TCTYPE_K;
+        }
+    }
+
+    Adafruit_MAX31856 device;
+    max31856_thermocoupletype_t chipType = MAX31856_TCTYPE_K;
+    bool started = false; // The SPI device is only set up by begin()
+};
+
+typedef Max31856Chip ThermocoupleChip;
+#define THERMOCOUPLE_CHIP_NAME "MAX31856"
+
+#elif THERMOCOUPLE_CHIP == THERMOCOUPLE_CHIP_MAX6675
+
+// K-type only with no cold-junction readout, so nothing to correct in
+// software. Read over the shared SPI bus as one 16-bit word. Selecting the
+// chip aborts the conversion in progress, so sampling faster than 220 ms
+// returns stale readings.
+class Max6675Chip
+{
+public:
+    static constexpr bool SOFTWARE_LINEARIZATION = false;
+
+    explicit Max6675Chip(uint8_t csPin) : csPin(csPin) {}
+
+    // Bit 1 always reads 0 on a real chip; set means MISO is floating
+    bool begin()
+    {
+        pinMode(csPin, OUTPUT);
+        digitalWrite(csPin, HIGH);
+        return (readRaw() & RAW_DEVICE_ID) == 0;
+    }
+
+    float readCelsius(uint8_t &fault)
+    {
+        uint16_t raw = readRaw();
+        if (raw & RAW_DEVICE_ID)
+        {
+            fault = CHANNEL_FAULT_NO_RESPONSE;
+            return NAN;
+        }
+        if (raw & RAW_OPEN)
+        {
+            fault = CHANNEL_FAULT_OPEN;
+            return NAN;
+        }
+        return (raw >> 3) * 0.25f;
+    }
+
+    void setType(const ThermocoupleTable *) {}
+    static bool supportsType(const ThermocoupleTable *table) { return table == nullptr || table->type == 'K'; }
+    float linearize(float reportedC, const ThermocoupleTable &) { return reportedC; }
+
+private:
+    static const uint16_t RAW_OPEN = 0x0004;
+    static const uint16_t RAW_DEVICE_ID = 0x0002;
+
+    uint16_t readRaw()
+    {
+        SPI.beginTransaction(SPISettings(4000000, MSBFIRST, SPI_MODE0));
+        digitalWrite(csPin, LOW);
+        uint16_t raw = SPI.transfer16(0);
+        digitalWrite(csPin, HIGH);
+        SPI.endTransaction();
+        return raw;
+    }
+
+    uint8_t csPin;
+};
+
+typedef Max6675Chip ThermocoupleChip;
+#define THERMOCOUPLE_CHIP_NAME "MAX6675"
+
+#elif THERMOCOUPLE_CHIP == THERMOCOUPLE_CHIP_SIMULATED
+
+typedef SimulatedChip ThermocoupleChip;
+#define THERMOCOUPLE_CHIP_NAME "simulated"
+
+#else
+#error "THERMOCOUPLE_CHIP must be one of the THERMOCOUPLE_CHIP_* values"
+#endif
+
+typedef SensorArray<ThermocoupleChip, THERMOCOUPLE_CHANNELS> ThermocoupleArray;
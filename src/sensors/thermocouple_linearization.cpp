@@ -0,0 +1,297 @@
+#include <stddef.h>
+#include "thermocouple_linearization.h"
+
+// NIST ITS-90 reference functions E(t) in mV, evaluated at compile time
+// into fixed-point tables. Conversion at runtime is a table lookup and
+// one interpolation regardless of thermocouple type.
+
+namespace
+{
+
+constexpr double EMF_UNITS_PER_MV = 1e5; // 10 nV units
+
+constexpr double polynomial(const double *c, size_t n, double t)
+{
+    double result = 0.0;
+    for (size_t i = n; i > 0; i--)
+    {
+        result = result * t + c[i - 1];
+    }
+    return result;
+}
+
+// std::exp is not constexpr; halve until small, Taylor, then square back
+constexpr double constexprExp(double x)
+{
+    int halvings = 0;
+    while (x > 0.5 || x < -0.5)
+    {
+        x /= 2.0;
+        halvings++;
+    }
+
+    double term = 1.0;
+    double sum = 1.0;
+    for (int i = 1; i < 20; i++)
+    {
+        term *= x / i;
+        sum += term;
+    }
+
+    for (int i = 0; i < halvings; i++)
+    {
+        sum *= sum;
+    }
+    return sum;
+}
+
+template <size_t N>
+constexpr size_t count(const double (&)[N])
+{
+    return N;
+}
+
+// Type B
+constexpr double B_0[] = {0.0, -0.246508183460E-03, 0.590404211710E-05, -0.132579316360E-08,
+                          0.156682919010E-11, -0.169445292400E-14, 0.629903470940E-18};
+constexpr double B_1[] = {-0.389381686210E+01, 0.285717474700E-01, -0.848851047850E-04,
+                          0.157852801640E-06, -0.168353448640E-09, 0.111097940130E-12,
+                          -0.445154310330E-16, 0.989756408210E-20, -0.937913302890E-24};
+
+constexpr double emfB(double t)
+{
+    return t < 630.615 ? polynomial(B_0, count(B_0), t) : polynomial(B_1, count(B_1), t);
+}
+
+// Type E
+constexpr double E_0[] = {0.0, 0.586655087080E-01, 0.454109771240E-04, -0.779980486860E-06,
+                          -0.258001608430E-07, -0.594525830570E-09, -0.932140586670E-11,
+                          -0.102876055340E-12, -0.803701236210E-15, -0.439794973910E-17,
+                          -0.164147763550E-19, -0.396736195160E-22, -0.558273287210E-25,
+                          -0.346578420130E-28};
+constexpr double E_1[] = {0.0, 0.586655087100E-01, 0.450322755820E-04, 0.289084072120E-07,
+                          -0.330568966520E-09, 0.650244032700E-12, -0.191974955040E-15,
+                          -0.125366004970E-17, 0.214892175690E-20, -0.143880417820E-23,
+                          0.359608994810E-27};
+
+constexpr double emfE(double t)
+{
+    return t < 0.0 ? polynomial(E_0, count(E_0), t) : polynomial(E_1, count(E_1), t);
+}
+
+// Type J
+constexpr double J_0[] = {0.0, 0.503811878150E-01, 0.304758369300E-04, -0.856810657200E-07,
+                          0.132281952950E-09, -0.170529583370E-12, 0.209480906970E-15,
+                          -0.125383953360E-18, 0.156317256970E-22};
+constexpr double J_1[] = {0.296456256810E+03, -0.149761277860E+01, 0.317871039240E-02,
+                          -0.318476867010E-05, 0.157208190040E-08, -0.306913690560E-12};
+
+constexpr double emfJ(double t)
+{
+    return t < 760.0 ? polynomial(J_0, count(J_0), t) : polynomial(J_1, count(J_1), t);
+}
+
+// Type K (the positive range adds an exponential term)
+constexpr double K_0[] = {0.0, 0.394501280250E-01, 0.236223735980E-04, -0.328589067840E-06,
+                          -0.499048287770E-08, -0.675090591730E-10, -0.574103274280E-12,
+                          -0.310888728940E-14, -0.104516093650E-16, -0.198892668780E-19,
+                          -0.163226974860E-22};
+constexpr double K_1[] = {-0.176004136860E-01, 0.389212049750E-01, 0.185587700320E-04,
+                          -0.994575928740E-07, 0.318409457190E-09, -0.560728448890E-12,
+                          0.560750590590E-15, -0.320207200030E-18, 0.971511471520E-22,
+                          -0.121047212750E-25};
+constexpr double K_A[] = {0.118597600000E+00, -0.118343200000E-03, 0.126968600000E+03};
+
+constexpr double emfK(double t)
+{
+    if (t < 0.0)
+        return polynomial(K_0, count(K_0), t);
+    double d = t - K_A[2];
+    return polynomial(K_1, count(K_1), t) + K_A[0] * constexprExp(K_A[1] * d * d);
+}
+
+// Type N
+constexpr double N_0[] = {0.0, 0.261591059620E-01, 0.109574842280E-04, -0.938411115540E-07,
+                          -0.464120397590E-10, -0.263033577160E-11, -0.226534380030E-13,
+                          -0.760893007910E-16, -0.934196678350E-19};
+constexpr double N_1[] = {0.0, 0.259293946010E-01, 0.157101418800E-04, 0.438256272370E-07,
+                          -0.252611697940E-09, 0.643118193390E-12, -0.100634715190E-14,
+                          0.997453389920E-18, -0.608632456070E-21, 0.208492293390E-24,
+                          -0.306821961510E-28};
+
+constexpr double emfN(double t)
+{
+    return t < 0.0 ? polynomial(N_0, count(N_0), t) : polynomial(N_1, count(N_1), t);
+}
+
+// Type R
+constexpr double R_0[] = {0.0, 0.528961729765E-02, 0.139166589782E-04, -0.238855693017E-07,
+                          0.356916001063E-10, -0.462347666298E-13, 0.500777441034E-16,
+                          -0.373105886191E-19, 0.157716482367E-22, -0.281038625251E-26};
+constexpr double R_1[] = {0.295157925316E+01, -0.252061251332E-02, 0.159564501865E-04,
+                          -0.764085947576E-08, 0.205305291024E-11, -0.293359668173E-15};
+constexpr double R_2[] = {0.152232118209E+03, -0.268819888545E+00, 0.171280280471E-03,
+                          -0.345895706453E-07, -0.934633971046E-14};
+
+constexpr double emfR(double t)
+{
+    if (t < 1064.18)
+        return polynomial(R_0, count(R_0), t);
+    if (t < 1664.5)
+        return polynomial(R_1, count(R_1), t);
+    return polynomial(R_2, count(R_2), t);
+}
+
+// Type S
+constexpr double S_0[] = {0.0, 0.540313308631E-02, 0.125934289740E-04, -0.232477968689E-07,
+                          0.322028823036E-10, -0.331465196389E-13, 0.255744251786E-16,
+                          -0.125068871393E-19, 0.271443176145E-23};
+constexpr double S_1[] = {0.132900444085E+01, 0.334509311344E-02, 0.654805192818E-05,
+                          -0.164856259209E-08, 0.129989605174E-13};
+constexpr double S_2[] = {0.146628232636E+03, -0.258430516752E+00, 0.163693574641E-03,
+                          -0.330439046987E-07, -0.943223690612E-14};
+
+constexpr double emfS(double t)
+{
+    if (t < 1064.18)
+        return polynomial(S_0, count(S_0), t);
+    if (t < 1664.5)
+        return polynomial(S_1, count(S_1), t);
+    return polynomial(S_2, count(S_2), t);
+}
+
+// Type T
+constexpr double T_0[] = {0.0, 0.387481063640E-01, 0.441944343470E-04, 0.118443231050E-06,
+                          0.200329735540E-07, 0.901380195590E-09, 0.226511565930E-10,
+                          0.360711542050E-12, 0.384939398830E-14, 0.282135219250E-16,
+                          0.142515947790E-18, 0.487686622860E-21, 0.107955392700E-23,
+                          0.139450270620E-26, 0.797951539270E-30};
+constexpr double T_1[] = {0.0, 0.387481063640E-01, 0.332922278800E-04, 0.206182434040E-06,
+                          -0.218822568460E-08, 0.109968809280E-10, -0.308157587720E-13,
+                          0.454791352900E-16, -0.275129016730E-19};
+
+constexpr double emfT(double t)
+{
+    return t < 0.0 ? polynomial(T_0, count(T_0), t) : polynomial(T_1, count(T_1), t);
+}
+
+constexpr size_t tableSize(int minC, int maxC)
+{
+    return (maxC - minC) / THERMOCOUPLE_TABLE_STEP_C + 1;
+}
+
+template <size_t N>
+struct EmfTable
+{
+    int32_t emf[N];
+};
+
+template <size_t N>
+constexpr EmfTable<N> buildTable(int minC, double (*emf)(double))
+{
+    EmfTable<N> table{};
+    for (size_t i = 0; i < N; i++)
+    {
+        double mv = emf(minC + (double)(i * THERMOCOUPLE_TABLE_STEP_C));
+        double units = mv * EMF_UNITS_PER_MV;
+        table.emf[i] = (int32_t)(units < 0 ? units - 0.5 : units + 0.5);
+    }
+    return table;
+}
+
+// Ranges are the NIST validity limits rounded inward to the table step.
+// B is non-monotonic below ~21 C but unusable there anyway.
+constexpr EmfTable<tableSize(0, 1820)> TABLE_B = buildTable<tableSize(0, 1820)>(0, emfB);
+constexpr EmfTable<tableSize(-270, 1000)> TABLE_E = buildTable<tableSize(-270, 1000)>(-270, emfE);
+constexpr EmfTable<tableSize(-210, 1200)> TABLE_J = buildTable<tableSize(-210, 1200)>(-210, emfJ);
+constexpr EmfTable<tableSize(-270, 1370)> TABLE_K = buildTable<tableSize(-270, 1370)>(-270, emfK);
+constexpr EmfTable<tableSize(-270, 1300)> TABLE_N = buildTable<tableSize(-270, 1300)>(-270, emfN);
+constexpr EmfTable<tableSize(-50, 1760)> TABLE_R = buildTable<tableSize(-50, 1760)>(-50, emfR);
+constexpr EmfTable<tableSize(-50, 1760)> TABLE_S = buildTable<tableSize(-50, 1760)>(-50, emfS);
+constexpr EmfTable<tableSize(-270, 400)> TABLE_T = buildTable<tableSize(-270, 400)>(-270, emfT);
+
+template <size_t N>
+constexpr ThermocoupleTable describe(char type, int minC, const EmfTable<N> &table)
+{
+    return {type, (int16_t)minC, (uint16_t)N, table.emf};
+}
+
+const ThermocoupleTable TABLES[] = {
+    describe('B', 0, TABLE_B),
+    describe('E', -270, TABLE_E),
+    describe('J', -210, TABLE_J),
+    describe('K', -270, TABLE_K),
+    describe('N', -270, TABLE_N),
+    describe('R', -50, TABLE_R),
+    describe('S', -50, TABLE_S),
+    describe('T', -270, TABLE_T),
+};
+
+// The MAX31855 converts assuming a fixed K-type slope of 41.276 uV/C
+constexpr float MAX31855_EMF_UNITS_PER_C = 0.041276f * EMF_UNITS_PER_MV;
+
+} // namespace
+
+const ThermocoupleTable *thermocoupleTable(char type)
+{
+    for (const ThermocoupleTable &table : TABLES)
+    {
+        if (table.type == type)
+            return &table;
+    }
+    return nullptr;
+}
+
+int32_t thermocoupleEmfFromMilliC(const ThermocoupleTable &table, int32_t milliC)
+{
+    const int32_t stepMilliC = THERMOCOUPLE_TABLE_STEP_C * 1000;
+    int32_t offset = milliC - table.minC * 1000;
+
+    // Clamp to the table ends rather than extrapolate
+    int32_t maxOffset = (table.size - 1) * stepMilliC;
+    offset = offset < 0 ? 0 : (offset > maxOffset ? maxOffset : offset);
+
+    int32_t index = offset / stepMilliC;
+    int32_t fraction = offset - index * stepMilliC;
+    int32_t next = index + (index + 1 < table.size);
+
+    int32_t low = table.emf[index];
+    int32_t high = table.emf[next];
+    return low + (int32_t)((int64_t)(high - low) * fraction / stepMilliC);
+}
+
+int32_t thermocoupleMilliCFromEmf(const ThermocoupleTable &table, int32_t emf)
+{
+    // Branch-light lower bound over the monotonic EMF table
+    const int32_t *base = table.emf;
+    uint16_t length = table.size - 1;
+    while (length > 1)
+    {
+        uint16_t half = length / 2;
+        base += (base[half] <= emf) ? half : 0;
+        length -= half;
+    }
+
+    int32_t low = base[0];
+    int32_t high = base[1];
+    int32_t index = base - table.emf;
+    int32_t segmentMilliC = (table.minC + index * THERMOCOUPLE_TABLE_STEP_C) * 1000;
+
+    if (high == low)
+        return segmentMilliC;
+
+    // Interpolate within the segment; the ends extrapolate linearly
+    return segmentMilliC + (int32_t)((int64_t)(emf - low) * (THERMOCOUPLE_TABLE_STEP_C * 1000) / (high - low));
+}
+
+int32_t linearizeThermocouple(const ThermocoupleTable &table, int32_t thermocoupleEmf, int32_t coldJunctionMilliC)
+{
+    // Cold-junction compensation: add the EMF the reference junction hides
+    int32_t totalEmf = thermocoupleEmf + thermocoupleEmfFromMilliC(table, coldJunctionMilliC);
+    return thermocoupleMilliCFromEmf(table, totalEmf);
+}
+
+int32_t max31855ThermocoupleEmf(float reportedC, float coldJunctionC)
+{
+    return (int32_t)((reportedC - coldJunctionC) * MAX31855_EMF_UNITS_PER_C);
+}
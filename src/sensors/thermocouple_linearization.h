@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+
+// Table resolution for the piecewise-linear NIST ITS-90 fit; 5 C keeps
+// every type within 0.05 C of the reference functions
+#define THERMOCOUPLE_TABLE_STEP_C 5
+
+// EMF in 10 nV units sampled every THERMOCOUPLE_TABLE_STEP_C from minC
+struct ThermocoupleTable
+{
+    char type;
+    int16_t minC;
+    uint16_t size;
+    const int32_t *emf;
+};
+
+const ThermocoupleTable *thermocoupleTable(char type);
+int32_t thermocoupleEmfFromMilliC(const ThermocoupleTable &table, int32_t milliC);
+int32_t thermocoupleMilliCFromEmf(const ThermocoupleTable &table, int32_t emf);
+int32_t linearizeThermocouple(const ThermocoupleTable &table, int32_t thermocoupleEmf, int32_t coldJunctionMilliC);
+int32_t max31855ThermocoupleEmf(float reportedC, float coldJunctionC);
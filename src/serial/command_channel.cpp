@@ -0,0 +1,94 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include "command_channel.h"
+#include "line_reader.h"
+#include "scheduler/event_loop.h"
+#include "trace/trace_recorder.h"
+
+// Commands are read and executed on their own task, woken by the UART
+// driver's (or USB CDC's) receive callback. It runs above the loop task on
+// the same core, so a command only ever waits for the loop's current
+// state-locked step. Unread lines stay queued in the RX buffer.
+
+static const UBaseType_t COMMAND_TASK_PRIORITY = 3;
+static const uint32_t COMMAND_TASK_STACK = 8192;
+
+static TaskHandle_t commandTaskHandle = nullptr;
+static SemaphoreHandle_t stateMutex = nullptr;
+static CommandHandler commandHandler = nullptr;
+static CommandRejectHandler rejectHandler = nullptr;
+static volatile bool resyncRequested = false;
+
+static char line[COMMAND_MAX_LENGTH];
+
+static void commandTask(void *)
+{
+    LineReader reader;
+    lineReaderInit(reader, line, sizeof(line));
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        if (resyncRequested)
+        {
+            resyncRequested = false;
+            lineReaderResync(reader);
+        }
+
+        while (Serial.available())
+        {
+            LineStatus status = lineReaderPush(reader, Serial.read());
+            if (status == LINE_PENDING)
+                continue;
+
+            int64_t receivedUs = esp_timer_get_time();
+
+            traceBegin(TRACE_COMMAND);
+            acquireStateLock();
+            if (status == LINE_READY)
+                commandHandler(line, receivedUs);
+            else
+                rejectHandler(status, receivedUs);
+            releaseStateLock();
+            traceEnd(TRACE_COMMAND);
+
+            // Let the loop pick up changed rates or deferred work
+            eventLoopSignal(EVENT_COMMAND);
+        }
+    }
+}
+
+void commandChannelBegin(CommandHandler handler, CommandRejectHandler reject)
+{
+    commandHandler = handler;
+    rejectHandler = reject;
+    stateMutex = xSemaphoreCreateMutex();
+
+    xTaskCreatePinnedToCore(commandTask, "commands", COMMAND_TASK_STACK, nullptr,
+                            COMMAND_TASK_PRIORITY, &commandTaskHandle, ARDUINO_RUNNING_CORE);
+
+#if ARDUINO_USB_CDC_ON_BOOT
+    Serial.onEvent(ARDUINO_USB_CDC_RX_EVENT, [](void *, esp_event_base_t, int32_t, void *)
+                   { xTaskNotifyGive(commandTaskHandle); });
+#else
+    Serial.onReceive([]()
+                     { xTaskNotifyGive(commandTaskHandle); });
+#endif
+}
+
+void commandChannelResync()
+{
+    // Applied before the next bytes are read, on the command task
+    resyncRequested = true;
+}
+
+void acquireStateLock()
+{
+    xSemaphoreTake(stateMutex, portMAX_DELAY);
+}
+
+void releaseStateLock()
+{
+    xSemaphoreGive(stateMutex);
+}
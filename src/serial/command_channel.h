@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include "line_reader.h"
+#include "sensors/calibration.h"
+
+// Longest command line accepted, sized for the longest command: a full
+// calibration upload. A point takes up to 72 bytes as hosts print floats
+// ({"raw_c": -269.99999999999997, "actual_c": ...}, with separators),
+// plus room for the channel and a request_id. A longer line is answered
+// with an error, never truncated.
+#define COMMAND_MAX_LENGTH (CALIBRATION_MAX_POINTS * 72 + 256)
+
+typedef void (*CommandHandler)(const char *command, int64_t receivedUs);
+
+// Called instead of the handler for a line that cannot be run: one too
+// long (LINE_TOO_LONG) or one a resync dropped (LINE_DROPPED)
+typedef void (*CommandRejectHandler)(LineStatus status, int64_t receivedUs);
+
+void commandChannelBegin(CommandHandler handler, CommandRejectHandler reject);
+
+// Drops the partial line and input up to the next line ending. Called on
+// entering light sleep, since the UART wake loses the first bytes. A line
+// it drops is rejected, so the host hears to resend it.
+void commandChannelResync();
+void acquireStateLock();
+void releaseStateLock();
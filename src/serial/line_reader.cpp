@@ -0,0 +1,55 @@
+#include "line_reader.h"
+
+void lineReaderInit(LineReader &reader, char *buffer, size_t capacity)
+{
+    reader.buffer = buffer;
+    reader.capacity = capacity;
+    reader.length = 0;
+    reader.resyncing = false;
+    reader.discarded = false;
+    reader.overflowed = false;
+}
+
+void lineReaderResync(LineReader &reader)
+{
+    reader.discarded = reader.length > 0 || reader.overflowed;
+    reader.length = 0;
+    reader.resyncing = true;
+    reader.overflowed = false;
+}
+
+LineStatus lineReaderPush(LineReader &reader, char c)
+{
+    if (c == '\n' || c == '\r')
+    {
+        bool discarded = reader.discarded;
+        bool overflowed = reader.overflowed;
+        size_t length = reader.length;
+        reader.resyncing = false;
+        reader.discarded = false;
+        reader.overflowed = false;
+        reader.length = 0;
+
+        if (discarded)
+            return LINE_DROPPED;
+        if (overflowed)
+            return LINE_TOO_LONG;
+        if (length == 0)
+            return LINE_PENDING;
+        reader.buffer[length] = '\0';
+        return LINE_READY;
+    }
+
+    if (reader.resyncing)
+    {
+        reader.discarded = true;
+        return LINE_PENDING;
+    }
+    if (reader.overflowed)
+        return LINE_PENDING;
+    if (reader.length < reader.capacity - 1)
+        reader.buffer[reader.length++] = c;
+    else
+        reader.overflowed = true;
+    return LINE_PENDING;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <stddef.h>
+#include <stdbool.h>
+
+// Assembles command lines from received bytes. Plain C++ with no Arduino
+// dependencies; the caller owns the buffer and feeds it one byte at a time.
+//
+// After a UART wake from light sleep the first bytes of a line are lost, so
+// what arrives is the tail of a command. A resync drops any partial line
+// and everything up to the next line ending, so a garbled line is never
+// handed on; hosts send a blank line first to wake the device. If that
+// drops anything but line endings, the line end reports it so the host
+// can be told to resend.
+
+enum LineStatus
+{
+    LINE_PENDING,  // No complete line yet
+    LINE_READY,    // buffer holds a complete line, NUL terminated
+    LINE_TOO_LONG, // A line that did not fit ended; it was dropped
+    LINE_DROPPED,  // A resync discarded the (partial) line that just ended
+};
+
+struct LineReader
+{
+    char *buffer;
+    size_t capacity;
+    size_t length;
+    bool resyncing;
+    bool discarded; // Resyncing has dropped a byte of the current line
+    bool overflowed;
+};
+
+void lineReaderInit(LineReader &reader, char *buffer, size_t capacity);
+
+// Discards input up to and including the next line ending
+void lineReaderResync(LineReader &reader);
+
+// Adds one byte. Empty lines are skipped; a line longer than capacity - 1
+// is never handed on in part.
+LineStatus lineReaderPush(LineReader &reader, char c);
@@ -0,0 +1,274 @@
+#include <atomic>
+#include <stdarg.h>
+#if !ARDUINO_USB_CDC_ON_BOOT
+#include <driver/uart.h>
+#endif
+#include "serial_tx.h"
+#include "scheduler/event_bus.h"
+#include "trace/trace_recorder.h"
+
+// Frames are queued by the loop and the command task and written out by a
+// writer task, so a host that stops reading only ever stalls the writer.
+// Responses and telemetry have separate rings: the writer drains
+// responses first, and telemetry is dropped per policy when its ring
+// fills while a response waits for room instead.
+//
+// A response waits at most for the frame already on the wire. The writer
+// holds off until each frame has left the UART before picking the next,
+// so the driver never holds a backlog of telemetry ahead of a response.
+// At 115200 baud a 4-channel data frame alone takes about 30 ms, past the
+// 20 ms command latency bound; the 20 ms bound holds only in builds that
+// opt in to 921600 (the esp32-s3-fast-uart environment). The default stays
+// 115200 so existing hosts and terminals keep working.
+// tools/command_latency_sim.cpp models the writer at each rate.
+
+#ifndef SERIAL_BAUD
+#define SERIAL_BAUD 115200 // Ignored by native USB CDC
+#endif
+static const size_t SERIAL_RX_BUFFER = 2048; // A few command lines
+static const size_t SERIAL_LOG_LINE = 256;   // Longer diagnostics are cut
+#if !ARDUINO_USB_CDC_ON_BOOT
+static const size_t SERIAL_TX_BUFFER = 4096; // UART driver ring
+static const uart_port_t SERIAL_UART = UART_NUM_0;
+static const uint32_t SERIAL_DRAIN_TIMEOUT_MS = 2000; // 16 KB at 115200 takes 1.4 s
+#else
+static const uint32_t SERIAL_TX_TIMEOUT_MS = 100; // Give up on a stalled host
+#endif
+
+static const size_t TELEMETRY_RING_SIZE = 16384;
+static const size_t RESPONSE_RING_SIZE = 4096;
+
+static const UBaseType_t WRITER_TASK_PRIORITY = 2;
+static const uint32_t WRITER_TASK_STACK = 4096;
+
+static uint8_t telemetryStorage[TELEMETRY_RING_SIZE];
+static uint8_t responseStorage[RESPONSE_RING_SIZE];
+static TxRing telemetryRing;
+static TxRing responseRing;
+static TxDropPolicy telemetryPolicy = TX_DROP_OLDEST;
+static std::atomic<bool> hostReading(true); // Until the host says otherwise
+
+// queueMutex guards the rings; portMutex keeps the writer and an oversized
+// response from interleaving on the wire, and guards writeBuffer. When
+// both are held, portMutex is taken first.
+static SemaphoreHandle_t queueMutex = nullptr;
+static SemaphoreHandle_t portMutex = nullptr;
+static TaskHandle_t writerTaskHandle = nullptr;
+
+// Each frame is copied out here and handed to the driver in one write,
+// which lets USB fill whole 64-byte bulk packets
+static uint8_t writeBuffer[TELEMETRY_RING_SIZE];
+
+// Returns once the last write has left the UART. USB CDC needs no wait:
+// it drains far faster than frames are produced.
+static void waitForWire()
+{
+#if !ARDUINO_USB_CDC_ON_BOOT
+    uart_wait_tx_done(SERIAL_UART, pdMS_TO_TICKS(SERIAL_DRAIN_TIMEOUT_MS));
+#endif
+}
+
+static void writerTask(void *)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        for (;;)
+        {
+            xSemaphoreTake(portMutex, portMAX_DELAY);
+            xSemaphoreTake(queueMutex, portMAX_DELAY);
+            TxRing *ring = responseRing.frames > 0 ? &responseRing : &telemetryRing;
+            const uint8_t *frame;
+            size_t length = txRingPeek(*ring, &frame);
+            if (length > 0)
+            {
+                memcpy(writeBuffer, frame, length);
+                txRingPop(*ring);
+            }
+            xSemaphoreGive(queueMutex);
+
+            if (length == 0)
+            {
+                xSemaphoreGive(portMutex);
+                break;
+            }
+
+            traceBegin(TRACE_SERIAL_WRITE);
+            Serial.write(writeBuffer, length);
+            traceEnd(TRACE_SERIAL_WRITE);
+            waitForWire();
+            xSemaphoreGive(portMutex);
+
+            xSemaphoreTake(queueMutex, portMAX_DELAY);
+            ring->sent++;
+            xSemaphoreGive(queueMutex);
+        }
+    }
+}
+
+void serialTxBegin()
+{
+    queueMutex = xSemaphoreCreateMutex();
+    portMutex = xSemaphoreCreateMutex();
+    txRingInit(telemetryRing, telemetryStorage, TELEMETRY_RING_SIZE);
+    txRingInit(responseRing, responseStorage, RESPONSE_RING_SIZE);
+
+    Serial.setRxBufferSize(SERIAL_RX_BUFFER);
+#if !ARDUINO_USB_CDC_ON_BOOT
+    Serial.setTxBufferSize(SERIAL_TX_BUFFER);
+#else
+    Serial.setTxTimeoutMs(SERIAL_TX_TIMEOUT_MS);
+#endif
+    Serial.begin(SERIAL_BAUD);
+
+    xTaskCreatePinnedToCore(writerTask, "serial_tx", WRITER_TASK_STACK, nullptr,
+                            WRITER_TASK_PRIORITY, &writerTaskHandle, ARDUINO_RUNNING_CORE);
+}
+
+// A response too big for its ring goes straight out, once the writer
+// finishes the frame in flight. It is built in writeBuffer and written in
+// one piece with its line ending; only a frame larger than that buffer is
+// streamed, still under the port lock.
+template <typename Fill, typename Stream>
+static bool sendOversized(TxRing &ring, TxClass txClass, size_t length, Fill fill, Stream stream)
+{
+    if (txClass != TX_RESPONSE || length <= txRingMaxFrame(ring))
+        return false;
+
+    xSemaphoreTake(portMutex, portMAX_DELAY);
+    if (length <= sizeof(writeBuffer))
+    {
+        fill(writeBuffer);
+        writeBuffer[length - 2] = '\r';
+        writeBuffer[length - 1] = '\n';
+        Serial.write(writeBuffer, length);
+    }
+    else
+    {
+        stream();
+        Serial.write((const uint8_t *)"\r\n", 2);
+    }
+    waitForWire();
+    xSemaphoreGive(portMutex);
+
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    ring.queued++;
+    ring.sent++;
+    xSemaphoreGive(queueMutex);
+    return true;
+}
+
+// fill writes the frame body, length - 2 bytes, into its ring slot. False
+// if telemetry was dropped instead.
+template <typename Fill>
+static bool queueFrame(TxRing &ring, TxClass txClass, size_t length, Fill fill)
+{
+    for (;;)
+    {
+        xSemaphoreTake(queueMutex, portMAX_DELAY);
+        TxDropPolicy policy = txClass == TX_TELEMETRY ? telemetryPolicy : TX_NEVER_DROP;
+        uint8_t *slot = txRingPush(ring, length, policy);
+        if (slot)
+        {
+            fill(slot);
+            slot[length - 2] = '\r';
+            slot[length - 1] = '\n';
+        }
+        xSemaphoreGive(queueMutex);
+        xTaskNotifyGive(writerTaskHandle);
+
+        // Telemetry never waits; a response waits for the writer to make room
+        if (slot || txClass == TX_TELEMETRY)
+            return slot != nullptr;
+        vTaskDelay(1);
+    }
+}
+
+void sendJson(JsonDocument &doc, TxClass txClass)
+{
+    size_t length = measureJson(doc) + 2; // Trailing \r\n
+    TxRing &ring = txClass == TX_TELEMETRY ? telemetryRing : responseRing;
+
+    auto fill = [&](uint8_t *slot)
+    { serializeJson(doc, (char *)slot, length); };
+    if (sendOversized(ring, txClass, length, fill, [&]()
+                      { serializeJson(doc, Serial); }))
+        return;
+
+    queueFrame(ring, txClass, length, fill);
+}
+
+bool sendFrame(const char *frame, size_t frameLength, TxClass txClass)
+{
+    size_t length = frameLength + 2;
+    TxRing &ring = txClass == TX_TELEMETRY ? telemetryRing : responseRing;
+
+    auto fill = [&](uint8_t *slot)
+    { memcpy(slot, frame, frameLength); };
+    if (sendOversized(ring, txClass, length, fill, [&]()
+                      { Serial.write((const uint8_t *)frame, frameLength); }))
+        return true;
+
+    return queueFrame(ring, txClass, length, fill);
+}
+
+void serialLog(const char *format, ...)
+{
+    char line[SERIAL_LOG_LINE];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    if (length >= 0)
+        sendFrame(line, (size_t)length < sizeof(line) ? length : sizeof(line) - 1, TX_RESPONSE);
+}
+
+void setTxDropPolicy(TxDropPolicy policy)
+{
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    telemetryPolicy = policy == TX_DROP_NEWEST ? TX_DROP_NEWEST : TX_DROP_OLDEST;
+    xSemaphoreGive(queueMutex);
+}
+
+void setTelemetryEvictHandler(TxEvictHandler handler)
+{
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    telemetryRing.onEvict = handler;
+    xSemaphoreGive(queueMutex);
+}
+
+TxDropPolicy txDropPolicy()
+{
+    return telemetryPolicy;
+}
+
+TxClassStats txStats(TxClass txClass)
+{
+    const TxRing &ring = txClass == TX_TELEMETRY ? telemetryRing : responseRing;
+
+    xSemaphoreTake(queueMutex, portMAX_DELAY);
+    TxClassStats stats = {ring.queued, ring.sent, ring.dropped, ring.used};
+    xSemaphoreGive(queueMutex);
+    return stats;
+}
+
+void setHostConnected(bool connected)
+{
+    hostReading = connected;
+
+    // Published on every report, repeats included, so LEDs resync
+    BusEvent event = {(uint8_t)(connected ? BUS_HOST_CONNECTED : BUS_HOST_DISCONNECTED), (uint32_t)millis(), 0, 0};
+    busPublish(event);
+}
+
+bool hostConnected()
+{
+    return hostReading.load();
+}
+
+bool txTelemetryBacklogged()
+{
+    return telemetryRing.used > TELEMETRY_RING_SIZE / 4;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "tx_ring.h"
+
+enum TxClass
+{
+    TX_RESPONSE,  // Command responses and notices; never dropped
+    TX_TELEMETRY, // Data frames; dropped per policy when the host lags
+};
+
+void serialTxBegin();
+void sendJson(JsonDocument &doc, TxClass txClass = TX_RESPONSE);
+
+// Queues an already-encoded frame (no line terminator); see protocol.h.
+// False if telemetry was dropped at once under TX_DROP_NEWEST.
+bool sendFrame(const char *frame, size_t length, TxClass txClass = TX_RESPONSE);
+
+// Diagnostic text for the serial monitor, printf-style, one line per call
+// with the line ending added. Queued with responses, so it never lands
+// inside a frame; nothing else may write to Serial directly.
+void serialLog(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+void setTxDropPolicy(TxDropPolicy policy);
+TxDropPolicy txDropPolicy();
+
+// Called under the queue lock for each telemetry frame evicted by
+// drop_oldest; it must not send anything itself
+void setTelemetryEvictHandler(TxEvictHandler handler);
+
+struct TxClassStats
+{
+    uint32_t queued;
+    uint32_t sent;
+    uint32_t dropped;
+    size_t pendingBytes;
+};
+TxClassStats txStats(TxClass txClass);
+
+// Whether a host reads the port, as it last reported with
+// update_connection_status. Changes are published on the event bus.
+void setHostConnected(bool connected);
+bool hostConnected();
+
+// True while telemetry is piling up faster than the link drains it; bulk
+// senders such as backfill replay hold off until it clears
+bool txTelemetryBacklogged();
@@ -0,0 +1,159 @@
+#include <string.h>
+#include "tx_ring.h"
+
+static const size_t HEADER_SIZE = 2;
+static const uint16_t WRAP_MARKER = 0xFFFF; // Rest of the buffer is padding
+
+static uint16_t readLength(const TxRing &ring, size_t offset)
+{
+    uint16_t length;
+    memcpy(&length, ring.data + offset, HEADER_SIZE);
+    return length;
+}
+
+// Moves head past padding left at the end of the buffer by a wrapped push
+static void skipPadding(TxRing &ring)
+{
+    if (ring.frames == 0)
+    {
+        ring.head = ring.tail = ring.used = 0;
+        return;
+    }
+
+    size_t remaining = ring.capacity - ring.head;
+    if (remaining < HEADER_SIZE || readLength(ring, ring.head) == WRAP_MARKER)
+    {
+        ring.used -= remaining;
+        ring.head = 0;
+    }
+}
+
+// Contiguous space for a record of `need` bytes, wrapping to the start of
+// the buffer if the end is too short. Returns the offset or SIZE_MAX.
+static size_t reserve(TxRing &ring, size_t need)
+{
+    if (ring.frames == 0)
+    {
+        ring.head = ring.tail = ring.used = 0;
+        return need <= ring.capacity ? 0 : SIZE_MAX;
+    }
+
+    if (ring.tail > ring.head || (ring.tail == ring.head && ring.used == 0))
+    {
+        size_t atEnd = ring.capacity - ring.tail;
+        if (need <= atEnd)
+            return ring.tail;
+
+        // Pad out the end and start again at 0, in front of head
+        if (need <= ring.head)
+        {
+            if (atEnd >= HEADER_SIZE)
+            {
+                uint16_t marker = WRAP_MARKER;
+                memcpy(ring.data + ring.tail, &marker, HEADER_SIZE);
+            }
+            ring.used += atEnd;
+            ring.tail = 0;
+            return 0;
+        }
+        return SIZE_MAX;
+    }
+
+    // Already wrapped: free space runs from tail up to head
+    return need <= ring.head - ring.tail ? ring.tail : SIZE_MAX;
+}
+
+void txRingInit(TxRing &ring, uint8_t *storage, size_t capacity)
+{
+    memset(&ring, 0, sizeof(ring));
+    ring.data = storage;
+    ring.capacity = capacity;
+}
+
+size_t txRingMaxFrame(const TxRing &ring)
+{
+    size_t max = ring.capacity - HEADER_SIZE;
+    return max < WRAP_MARKER ? max : WRAP_MARKER - 1;
+}
+
+uint8_t *txRingPush(TxRing &ring, size_t length, TxDropPolicy policy)
+{
+    if (length > txRingMaxFrame(ring))
+    {
+        if (policy != TX_NEVER_DROP)
+            ring.dropped++;
+        return nullptr;
+    }
+
+    size_t need = HEADER_SIZE + length;
+    size_t offset = reserve(ring, need);
+
+    while (offset == SIZE_MAX && policy == TX_DROP_OLDEST && ring.frames > 0)
+    {
+        if (ring.onEvict)
+        {
+            const uint8_t *frame;
+            size_t frameLength = txRingPeek(ring, &frame);
+            ring.onEvict(frame, frameLength);
+        }
+        txRingPop(ring);
+        ring.dropped++;
+        offset = reserve(ring, need);
+    }
+
+    if (offset == SIZE_MAX)
+    {
+        if (policy != TX_NEVER_DROP)
+            ring.dropped++;
+        return nullptr;
+    }
+
+    uint16_t header = (uint16_t)length;
+    memcpy(ring.data + offset, &header, HEADER_SIZE);
+    ring.tail = offset + need;
+    ring.used += need;
+    ring.frames++;
+    ring.queued++;
+    return ring.data + offset + HEADER_SIZE;
+}
+
+size_t txRingPeek(const TxRing &ring, const uint8_t **frame)
+{
+    if (ring.frames == 0)
+        return 0;
+
+    *frame = ring.data + ring.head + HEADER_SIZE;
+    return readLength(ring, ring.head);
+}
+
+size_t txRingPeekAt(const TxRing &ring, size_t index, const uint8_t **frame)
+{
+    if (index >= ring.frames)
+        return 0;
+
+    size_t offset = ring.head;
+    for (;;)
+    {
+        if (ring.capacity - offset < HEADER_SIZE || readLength(ring, offset) == WRAP_MARKER)
+            offset = 0;
+        if (index == 0)
+            break;
+        offset += HEADER_SIZE + readLength(ring, offset);
+        index--;
+    }
+
+    *frame = ring.data + offset + HEADER_SIZE;
+    return readLength(ring, offset);
+}
+
+void txRingPop(TxRing &ring)
+{
+    if (ring.frames == 0)
+        return;
+
+    size_t record = HEADER_SIZE + readLength(ring, ring.head);
+    ring.head += record;
+    ring.used -= record;
+    ring.frames--;
+    skipPadding(ring);
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded FIFO of variable-length frames in one byte buffer. Each frame is
+// stored contiguously behind a 2-byte length so it can be handed to the
+// driver in a single write. Plain C++ with no Arduino or FreeRTOS
+// dependencies; callers provide the locking.
+
+enum TxDropPolicy
+{
+    TX_DROP_OLDEST, // Evict queued frames to make room for the new one
+    TX_DROP_NEWEST, // Keep what is queued, reject the new frame
+    TX_NEVER_DROP,  // Reject without counting a drop; the caller retries
+};
+
+// Sees a queued frame just before TX_DROP_OLDEST evicts it, so a sender
+// can account for what its frame carried
+typedef void (*TxEvictHandler)(const uint8_t *frame, size_t length);
+
+struct TxRing
+{
+    uint8_t *data;
+    size_t capacity;
+    size_t head; // Oldest frame
+    size_t tail; // Next free byte
+    size_t used; // Bytes between head and tail, wrap padding included
+    size_t frames;
+
+    uint32_t queued;
+    uint32_t sent;
+    uint32_t dropped;
+
+    TxEvictHandler onEvict; // Optional
+};
+
+void txRingInit(TxRing &ring, uint8_t *storage, size_t capacity);
+
+// Largest frame the ring can ever hold
+size_t txRingMaxFrame(const TxRing &ring);
+
+// Reserves space for a frame and returns where to write its bytes, or
+// nullptr if the policy rejected it
+uint8_t *txRingPush(TxRing &ring, size_t length, TxDropPolicy policy);
+
+// Oldest frame and its length; 0 when empty
+size_t txRingPeek(const TxRing &ring, const uint8_t **frame);
+
+// Frame index places behind the oldest, walking the ring; 0 past the end
+size_t txRingPeekAt(const TxRing &ring, size_t index, const uint8_t **frame);
+void txRingPop(TxRing &ring);
@@ -0,0 +1,155 @@
+#include "status_leds.h"
+#include "common/connection_state.h"
+#include "scheduler/event_bus.h"
+#include "wifi/wifi_manager.h"
+
+static const UBaseType_t LED_TASK_PRIORITY = 1;
+static const uint32_t LED_TASK_STACK = 2048;
+
+static const unsigned long DATA_BLINK_MS = 50;
+static const unsigned long SETUP_BLINK_MS = 500;
+static const unsigned long RESET_BLINK_MS = 100;
+static const int RESET_BLINKS = 10;
+
+static uint8_t connLed;
+static uint8_t dataLed;
+static TaskHandle_t ledTaskHandle = nullptr;
+static int busSubscriber = -1;
+
+// Owned by the LED task
+static ConnectionState state = DISCONNECTED;
+static unsigned long dataOffAt = 0; // 0 = data LED not blinking
+static unsigned long setupToggleAt = 0;
+
+static void showState(ConnectionState next)
+{
+    state = next;
+
+    switch (state)
+    {
+    case DISCONNECTED:
+        digitalWrite(connLed, HIGH); // OFF
+        digitalWrite(dataLed, HIGH); // OFF
+        break;
+
+    case SETUP_MODE:
+        // The data LED blinks from the task loop
+        digitalWrite(connLed, HIGH); // OFF
+        break;
+
+    case CONNECTED:
+        digitalWrite(connLed, LOW);  // ON (solid)
+        digitalWrite(dataLed, HIGH); // OFF
+        break;
+
+    case TRANSMITTING:
+        digitalWrite(connLed, LOW); // ON
+        digitalWrite(dataLed, LOW); // ON (brief)
+        break;
+    }
+}
+
+static void blinkForReset()
+{
+    for (int i = 0; i < RESET_BLINKS; i++)
+    {
+        digitalWrite(connLed, !digitalRead(connLed));
+        digitalWrite(dataLed, !digitalRead(dataLed));
+        vTaskDelay(pdMS_TO_TICKS(RESET_BLINK_MS));
+    }
+}
+
+static void handleEvent(const BusEvent &event, unsigned long now)
+{
+    switch (event.type)
+    {
+    case BUS_WIFI_CONNECTED:
+    case BUS_HOST_CONNECTED:
+        showState(CONNECTED);
+        break;
+    case BUS_WIFI_DISCONNECTED:
+    case BUS_HOST_DISCONNECTED:
+        showState(DISCONNECTED);
+        break;
+    case BUS_SETUP_MODE:
+        showState(SETUP_MODE);
+        setupToggleAt = now;
+        break;
+    case BUS_DATA_SENT:
+        // Settle on the WiFi state, then a short data blink
+        if (state == SETUP_MODE)
+            break;
+        showState(wifiIsConfigured() ? CONNECTED : DISCONNECTED);
+        digitalWrite(dataLed, LOW);
+        dataOffAt = now + DATA_BLINK_MS;
+        if (dataOffAt == 0)
+            dataOffAt = 1;
+        break;
+    case BUS_FACTORY_RESET:
+        blinkForReset();
+        break;
+    }
+}
+
+static void ledTask(void *)
+{
+    for (;;)
+    {
+        // Sleep until an event arrives or the next blink edge is due
+        unsigned long now = millis();
+        TickType_t wait = portMAX_DELAY;
+        if (dataOffAt != 0)
+        {
+            long untilOff = (long)(dataOffAt - now);
+            wait = pdMS_TO_TICKS(max(untilOff, 0L));
+        }
+        if (state == SETUP_MODE)
+        {
+            long untilToggle = (long)(setupToggleAt - now);
+            wait = min(wait, (TickType_t)pdMS_TO_TICKS(max(untilToggle, 0L)));
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        now = millis();
+        BusEvent event;
+        while (busPoll(busSubscriber, event))
+        {
+            handleEvent(event, now);
+        }
+
+        if (dataOffAt != 0 && (long)(now - dataOffAt) >= 0)
+        {
+            digitalWrite(dataLed, HIGH);
+            dataOffAt = 0;
+        }
+        if (state == SETUP_MODE && (long)(now - setupToggleAt) >= 0)
+        {
+            digitalWrite(dataLed, !digitalRead(dataLed));
+            setupToggleAt = now + SETUP_BLINK_MS;
+        }
+    }
+}
+
+void statusLedsBegin(uint8_t connPin, uint8_t dataPin)
+{
+    connLed = connPin;
+    dataLed = dataPin;
+    pinMode(connLed, OUTPUT);
+    pinMode(dataLed, OUTPUT);
+    digitalWrite(connLed, HIGH); // OFF (active LOW)
+    digitalWrite(dataLed, HIGH); // OFF (active LOW)
+
+    busSubscriber = busSubscribe(BUS_MASK(BUS_WIFI_CONNECTED) | BUS_MASK(BUS_WIFI_DISCONNECTED) |
+                                     BUS_MASK(BUS_SETUP_MODE) | BUS_MASK(BUS_HOST_CONNECTED) |
+                                     BUS_MASK(BUS_HOST_DISCONNECTED) | BUS_MASK(BUS_DATA_SENT) |
+                                     BUS_MASK(BUS_FACTORY_RESET),
+                                 [](void *)
+                                 {
+                                     if (ledTaskHandle)
+                                         xTaskNotifyGive(ledTaskHandle);
+                                 },
+                                 nullptr);
+
+    xTaskCreatePinnedToCore(ledTask, "leds", LED_TASK_STACK, nullptr,
+                            LED_TASK_PRIORITY, &ledTaskHandle, ARDUINO_RUNNING_CORE);
+}
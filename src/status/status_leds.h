@@ -0,0 +1,8 @@
+#pragma once
+#include <Arduino.h>
+
+// Drives the connection and data LEDs (active LOW) from its own task,
+// as an event bus subscriber: WiFi and setup-mode changes, host connect
+// and disconnect reports, sent frames and factory reset. Nothing else
+// writes the LED pins, so the sampling path never waits on a blink.
+void statusLedsBegin(uint8_t connPin, uint8_t dataPin);
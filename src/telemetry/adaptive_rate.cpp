@@ -0,0 +1,140 @@
+#include <math.h>
+#include "adaptive_rate.h"
+
+// Derivatives are taken over a baseline of at least this long so probe
+// quantization (0.25 C on the MAX31855) does not read as a fast slope
+static const unsigned long SLOPE_BASELINE_MS = 2000;
+
+// Steady-state back-off per computed slope: interval grows by 1/4 up to
+// the max
+static const uint32_t BACKOFF_NUMERATOR = 5;
+static const uint32_t BACKOFF_DENOMINATOR = 4;
+
+static AdaptiveRateConfig config = {false, 500, 5000, 0.5f, 0.05f};
+static uint32_t currentIntervalMs = 500;
+static bool probeTripped = false; // Counts as dynamic at the next evaluation
+
+struct ChannelTrend
+{
+    bool haveReference;
+    bool haveSlope;
+    unsigned long referenceTime;
+    float referenceTemp;
+    float slope;
+};
+
+static ChannelTrend trends[MAX_THERMOCOUPLE_CHANNELS];
+
+void configureAdaptiveRate(const AdaptiveRateConfig &newConfig)
+{
+    config = newConfig;
+    currentIntervalMs = config.minIntervalMs;
+    probeTripped = false;
+
+    for (int ch = 0; ch < MAX_THERMOCOUPLE_CHANNELS; ch++)
+    {
+        trends[ch].haveReference = false;
+        trends[ch].haveSlope = false;
+    }
+}
+
+const AdaptiveRateConfig &adaptiveRateConfig()
+{
+    return config;
+}
+
+uint32_t adaptiveRateUpdate(const TemperatureSample &sample)
+{
+    bool dynamic = probeTripped;
+    bool evaluated = false; // Some channel closed a baseline this sample
+
+    for (int ch = 0; ch < sample.channelCount; ch++)
+    {
+        ChannelTrend &trend = trends[ch];
+        float temp = sample.temperatureC[ch];
+
+        if (isnan(temp))
+        {
+            trend.haveReference = false;
+            trend.haveSlope = false;
+            continue;
+        }
+
+        if (!trend.haveReference)
+        {
+            trend.referenceTime = sample.timestamp;
+            trend.referenceTemp = temp;
+            trend.haveReference = true;
+            continue;
+        }
+
+        unsigned long elapsed = sample.timestamp - trend.referenceTime;
+        if (elapsed < SLOPE_BASELINE_MS)
+            continue;
+
+        float seconds = elapsed / 1000.0f;
+        float slope = (temp - trend.referenceTemp) / seconds;
+        evaluated = true;
+
+        if (fabsf(slope) >= config.slopeThreshold)
+            dynamic = true;
+
+        if (trend.haveSlope && fabsf(slope - trend.slope) / seconds >= config.accelThreshold)
+            dynamic = true;
+
+        trend.slope = slope;
+        trend.haveSlope = true;
+        trend.referenceTime = sample.timestamp;
+        trend.referenceTemp = temp;
+    }
+
+    if (evaluated)
+        probeTripped = false;
+
+    // Fast attack, slow release. Samples inside the baseline window say
+    // nothing about the trend, so they hold the interval rather than
+    // back off.
+    if (dynamic)
+    {
+        currentIntervalMs = config.minIntervalMs;
+    }
+    else if (evaluated)
+    {
+        uint32_t next = currentIntervalMs * BACKOFF_NUMERATOR / BACKOFF_DENOMINATOR;
+        currentIntervalMs = next > config.maxIntervalMs ? config.maxIntervalMs : next;
+    }
+
+    return currentIntervalMs;
+}
+
+bool adaptiveRateProbe(const TemperatureSample &probe)
+{
+    if (currentIntervalMs <= config.minIntervalMs)
+        return false;
+
+    for (int ch = 0; ch < probe.channelCount; ch++)
+    {
+        const ChannelTrend &trend = trends[ch];
+        float temp = probe.temperatureC[ch];
+        if (!trend.haveReference || isnan(temp))
+            continue;
+
+        // A probe is one unfiltered reading, checked many times per slow
+        // interval, so it needs a change noise cannot fake: as much as the
+        // slope threshold moves over a baseline, measured from the
+        // reference and from where the last slope projected the reading
+        unsigned long elapsed = probe.timestamp - trend.referenceTime;
+        float seconds = elapsed / 1000.0f;
+        float band = config.slopeThreshold * (elapsed < SLOPE_BASELINE_MS ? SLOPE_BASELINE_MS : elapsed) / 1000.0f;
+        float projected = trend.referenceTemp + (trend.haveSlope ? trend.slope * seconds : 0.0f);
+
+        if (fabsf(temp - trend.referenceTemp) >= band || fabsf(temp - projected) >= band)
+        {
+            // Held until a sample closes a baseline and judges the trend
+            currentIntervalMs = config.minIntervalMs;
+            probeTripped = true;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <stdint.h>
+#include "common/temperature_sample.h"
+
+struct AdaptiveRateConfig
+{
+    bool enabled;
+    uint32_t minIntervalMs;
+    uint32_t maxIntervalMs;
+    float slopeThreshold; // C/s rate of change that forces the fast rate
+    float accelThreshold; // C/s^2 change in rate of change that does too
+};
+
+void configureAdaptiveRate(const AdaptiveRateConfig &config);
+const AdaptiveRateConfig &adaptiveRateConfig();
+uint32_t adaptiveRateUpdate(const TemperatureSample &sample);
+
+// Checks a reading taken between samples while the interval is above
+// min_rate_ms. True when the change since the last baseline already
+// crosses a threshold: the interval drops to min_rate_ms and the caller
+// should sample now instead of waiting out the slow interval.
+bool adaptiveRateProbe(const TemperatureSample &probe);
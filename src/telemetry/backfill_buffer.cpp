@@ -0,0 +1,119 @@
+#include <atomic>
+#include <string.h>
+#include <esp_heap_caps.h>
+#include "backfill_buffer.h"
+#include "sample_batch.h"
+#include "sample_ring.h"
+#include "clock/clock_sync.h"
+#include "serial/serial_tx.h"
+
+// Samples taken while no host reads Serial, oldest first. When full the
+// oldest sample is overwritten so the buffer always holds the latest
+// stretch of the outage.
+static const size_t BACKFILL_SLOTS_PSRAM = 16384;  // ~4.5 h at 1 s, ~700 KB
+static const size_t BACKFILL_SLOTS_INTERNAL = 256; // Fallback without PSRAM
+
+static SampleRing ring;
+static std::atomic<uint32_t> shedSamples(0); // Replayed, then shed by the TX queue
+
+static const char BACKFILL_FRAME_START[] = "{\"type\":\"data_backfill\"";
+
+// A replayed frame the TX queue evicts takes its samples with it; count
+// them. Runs under the TX queue lock.
+static void onTelemetryEvicted(const uint8_t *frame, size_t length)
+{
+    size_t start = sizeof(BACKFILL_FRAME_START) - 1;
+    if (length < start || memcmp(frame, BACKFILL_FRAME_START, start) != 0)
+        return;
+
+    ProtoSpan metadata, count;
+    if (!protoFindMember({(const char *)frame, length}, "metadata", metadata) ||
+        !protoFindMember(metadata, "sample_count", count))
+        return;
+
+    ProtoCursor c = {count.data, count.data + count.length};
+    int64_t samples;
+    if (protoReadInt(c, samples, 0, BACKFILL_FRAME_SAMPLES))
+        shedSamples += (uint32_t)samples;
+}
+
+void backfillBegin()
+{
+    size_t slots = BACKFILL_SLOTS_PSRAM;
+    void *storage = heap_caps_calloc(slots, sizeof(TemperatureSample), MALLOC_CAP_SPIRAM);
+    if (!storage)
+    {
+        serialLog("⚠ No PSRAM for backfill buffer, using a small internal one");
+        slots = BACKFILL_SLOTS_INTERNAL;
+        storage = calloc(slots, sizeof(TemperatureSample));
+    }
+    sampleRingInit(ring, (TemperatureSample *)storage, slots);
+    setTelemetryEvictHandler(onTelemetryEvicted);
+}
+
+void backfillStore(const TemperatureSample &sample)
+{
+    sampleRingPush(ring, sample);
+}
+
+bool backfillPending()
+{
+    return ring.count > 0;
+}
+
+bool sendBackfillFrame()
+{
+    if (ring.count == 0)
+        return false;
+
+    TemperatureSample frame[BACKFILL_FRAME_SAMPLES];
+    uint16_t frameCount = sampleRingTake(ring, frame, BACKFILL_FRAME_SAMPLES);
+
+    // Same layout as data_batch; the type keeps old samples off live plots
+    static char encoded[SAMPLE_FRAME_BYTES(BACKFILL_FRAME_SAMPLES)];
+    ProtoWriter w;
+    beginSampleFrame(w, encoded, sizeof(encoded), "data_backfill");
+    protoKey(w, "timestamp");
+    protoInt(w, (uint32_t)frame[0].timestamp);
+    protoKey(w, "sample_count");
+    protoInt(w, frameCount);
+    protoKey(w, "backfill");
+    protoBool(w, true);
+    protoKey(w, "remaining");
+    protoInt(w, ring.count);
+    protoKey(w, "dropped");
+    protoInt(w, backfillDropped());
+    if (frame[0].calibrationId != 0)
+    {
+        protoKey(w, "calibration_id");
+        protoInt(w, frame[0].calibrationId);
+    }
+    if (clockSyncValid())
+    {
+        protoKey(w, "host_time_us");
+        protoInt(w, clockSyncToHostUs(frame[0].deviceTimeUs));
+    }
+    size_t length = finishSampleFrame(w, frame, frameCount);
+
+    // Rejected at once under drop_newest: the samples are gone as well
+    if (length > 0 && !sendFrame(encoded, length, TX_TELEMETRY))
+    {
+        shedSamples += frameCount;
+    }
+    return true;
+}
+
+size_t backfillDepth()
+{
+    return ring.count;
+}
+
+size_t backfillCapacity()
+{
+    return ring.slots;
+}
+
+uint32_t backfillDropped()
+{
+    return ring.dropped + shedSamples;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <Arduino.h>
+#include "common/temperature_sample.h"
+
+// Samples replayed per data_backfill frame. With four channels a frame is
+// about 860 bytes, so it can hold the next live reading back about 75 ms
+// at the default 115200 baud, or 10 ms at 921600. The loop only replays
+// while the telemetry queue is not backlogged.
+#define BACKFILL_FRAME_SAMPLES 16
+
+void backfillBegin();
+void backfillStore(const TemperatureSample &sample);
+bool backfillPending();
+
+// Sends the oldest buffered samples as one data_backfill frame
+bool sendBackfillFrame();
+
+size_t backfillDepth();
+size_t backfillCapacity();
+
+// Samples lost: overwritten while the buffer was full, or replayed in a
+// frame the TX queue then shed
+uint32_t backfillDropped();
@@ -0,0 +1,76 @@
+#include <math.h>
+#include "deadband.h"
+
+// Off (every channel, every frame) until a threshold is configured
+static float thresholdC = 0.0f;
+static unsigned long keyframeIntervalMs = 10000;
+
+static bool keyframeRequested = true;
+static unsigned long lastKeyframeTime = 0;
+static float reportedC[MAX_THERMOCOUPLE_CHANNELS];
+static uint8_t reportedFault[MAX_THERMOCOUPLE_CHANNELS];
+
+static uint32_t dataSequence = 0;
+
+void configureDeadband(float newThresholdC, unsigned long newKeyframeIntervalMs)
+{
+    thresholdC = newThresholdC;
+    keyframeIntervalMs = newKeyframeIntervalMs;
+    keyframeRequested = true;
+}
+
+bool deadbandEnabled()
+{
+    return thresholdC > 0.0f;
+}
+
+float deadbandThresholdC()
+{
+    return thresholdC;
+}
+
+unsigned long deadbandKeyframeIntervalMs()
+{
+    return keyframeIntervalMs;
+}
+
+void deadbandForceKeyframe()
+{
+    keyframeRequested = true;
+}
+
+ChannelMask deadbandSelect(const TemperatureSample &sample, bool &keyframe)
+{
+    ChannelMask all = (ChannelMask)((1u << sample.channelCount) - 1);
+
+    keyframe = !deadbandEnabled() || keyframeRequested ||
+               sample.timestamp - lastKeyframeTime >= keyframeIntervalMs;
+
+    ChannelMask mask = 0;
+    for (int i = 0; i < sample.channelCount; i++)
+    {
+        // A fault appearing, clearing or changing kind is always news
+        bool changed = sample.fault[i] != reportedFault[i] ||
+                       (!sample.fault[i] && fabsf(sample.temperatureC[i] - reportedC[i]) > thresholdC);
+
+        if (keyframe || changed)
+        {
+            mask |= (ChannelMask)(1u << i);
+            reportedC[i] = sample.temperatureC[i];
+            reportedFault[i] = sample.fault[i];
+        }
+    }
+
+    if (keyframe)
+    {
+        keyframeRequested = false;
+        lastKeyframeTime = sample.timestamp;
+        return all;
+    }
+    return mask;
+}
+
+uint32_t nextDataSequence()
+{
+    return dataSequence++;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+#include "common/temperature_sample.h"
+
+// Channels that changed since their last report, one bit per channel
+typedef uint8_t ChannelMask;
+
+void configureDeadband(float thresholdC, unsigned long keyframeIntervalMs);
+bool deadbandEnabled();
+float deadbandThresholdC();
+unsigned long deadbandKeyframeIntervalMs();
+void deadbandForceKeyframe();
+
+// Picks the channels worth reporting; an empty mask means skip the frame.
+// Sets keyframe when every channel must go out regardless of change.
+ChannelMask deadbandSelect(const TemperatureSample &sample, bool &keyframe);
+
+// Shared by data and data_batch frames so the host can spot gaps
+uint32_t nextDataSequence();
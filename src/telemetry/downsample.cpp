@@ -0,0 +1,122 @@
+#include <math.h>
+#include "downsample.h"
+
+// Plain C++ only so tools/downsample_bench.cpp can run it on a host
+
+#define DOWNSAMPLE_MIN_TARGET 3 // First row, one bucket, last row
+
+void downsampleBegin(Downsample &ds, uint32_t count, uint32_t target, uint8_t channels, SeriesRead read,
+                     void *context)
+{
+    ds.read = read;
+    ds.context = context;
+    ds.count = count;
+    ds.channels = channels < MAX_THERMOCOUPLE_CHANNELS ? channels : MAX_THERMOCOUPLE_CHANNELS;
+    if (target != 0 && target < DOWNSAMPLE_MIN_TARGET)
+        target = DOWNSAMPLE_MIN_TARGET;
+    ds.target = (target == 0 || target >= count) ? count : target;
+    ds.emitted = 0;
+    ds.failed = false;
+}
+
+// Rows between the first and last are split evenly into target - 2
+// buckets; integer maths so every bucket edge is exact
+static uint32_t bucketStart(const Downsample &ds, uint32_t bucket)
+{
+    return 1 + (uint32_t)((uint64_t)bucket * (ds.count - 2) / (ds.target - 2));
+}
+
+static bool keep(Downsample &ds, uint32_t row, uint32_t &index, SeriesPoint &point)
+{
+    if (!ds.read(ds.context, row, point))
+    {
+        ds.failed = true;
+        return false;
+    }
+    index = row;
+    ds.previous = point;
+    ds.emitted++;
+    return true;
+}
+
+bool downsampleNext(Downsample &ds, uint32_t &index, SeriesPoint &point)
+{
+    if (ds.failed || ds.emitted >= ds.target)
+        return false;
+
+    // Not reducing, or the fixed end rows
+    if (ds.target == ds.count || ds.emitted == 0)
+        return keep(ds, ds.emitted, index, point);
+    if (ds.emitted == ds.target - 1)
+        return keep(ds, ds.count - 1, index, point);
+
+    uint32_t bucket = ds.emitted - 1;
+    uint32_t start = bucketStart(ds, bucket);
+    uint32_t end = bucketStart(ds, bucket + 1);
+    uint32_t nextEnd = bucket + 1 == ds.target - 2 ? ds.count : bucketStart(ds, bucket + 2);
+
+    // Third vertex: the average of the next bucket, per channel over the
+    // rows that did not fault. Times are relative to the previous kept row.
+    const SeriesPoint &a = ds.previous;
+    float sumX = 0;
+    float sumY[MAX_THERMOCOUPLE_CHANNELS] = {};
+    uint32_t valid[MAX_THERMOCOUPLE_CHANNELS] = {};
+    SeriesPoint row;
+    for (uint32_t i = end; i < nextEnd; i++)
+    {
+        if (!ds.read(ds.context, i, row))
+        {
+            ds.failed = true;
+            return false;
+        }
+        sumX += (float)(int32_t)(row.timestampMs - a.timestampMs);
+        for (uint8_t ch = 0; ch < ds.channels; ch++)
+        {
+            if (!isnan(row.temperatureC[ch]))
+            {
+                sumY[ch] += row.temperatureC[ch];
+                valid[ch]++;
+            }
+        }
+    }
+    float cX = sumX / (nextEnd - end);
+    float cY[MAX_THERMOCOUPLE_CHANNELS];
+    for (uint8_t ch = 0; ch < ds.channels; ch++)
+    {
+        cY[ch] = valid[ch] ? sumY[ch] / valid[ch] : NAN;
+    }
+
+    // Keep the row spanning the largest triangle with the previous kept
+    // row and that average. Twice the area, as only the order matters.
+    float bestArea = -1;
+    uint32_t best = start;
+    for (uint32_t i = start; i < end; i++)
+    {
+        if (!ds.read(ds.context, i, row))
+        {
+            ds.failed = true;
+            return false;
+        }
+        float bX = (float)(int32_t)(row.timestampMs - a.timestampMs);
+        float area = 0;
+        for (uint8_t ch = 0; ch < ds.channels; ch++)
+        {
+            float aY = a.temperatureC[ch];
+            float bY = row.temperatureC[ch];
+            if (isnan(aY) || isnan(bY) || isnan(cY[ch]))
+                continue;
+            area += fabsf(bX * (cY[ch] - aY) - cX * (bY - aY));
+        }
+        if (area > bestArea)
+        {
+            bestArea = area;
+            best = i;
+            point = row;
+        }
+    }
+
+    index = best;
+    ds.previous = point;
+    ds.emitted++;
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+#include "common/temperature_sample.h"
+
+// Largest-Triangle-Three-Buckets reduction of a multi-channel series,
+// run as a cursor so rows can be sent a frame at a time. Memory is the
+// cursor itself, whatever the series length; each source row is read at
+// most twice. All channels share the kept rows, chosen by the triangle
+// area summed across channels, so one timestamp column serves them all.
+
+// One row of a series; NaN where the channel faulted
+struct SeriesPoint
+{
+    uint32_t timestampMs;
+    float temperatureC[MAX_THERMOCOUPLE_CHANNELS];
+};
+
+// Fetches row index (0 = oldest) of the series; false if it is gone
+typedef bool (*SeriesRead)(void *context, uint32_t index, SeriesPoint &point);
+
+struct Downsample
+{
+    SeriesRead read;
+    void *context;
+    uint32_t count;  // Rows in the series
+    uint32_t target; // Rows kept; count when not reducing
+    uint8_t channels;
+    uint32_t emitted;
+    SeriesPoint previous; // Last kept row, the triangles' first vertex
+    bool failed;
+};
+
+// Keeps at most target rows (0 = all). LTTB needs at least 3.
+void downsampleBegin(Downsample &ds, uint32_t count, uint32_t target, uint8_t channels, SeriesRead read,
+                     void *context);
+
+// The next kept row and its source index; false when done or if a read
+// failed (check ds.failed)
+bool downsampleNext(Downsample &ds, uint32_t &index, SeriesPoint &point);
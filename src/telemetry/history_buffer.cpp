@@ -0,0 +1,177 @@
+#include <esp_heap_caps.h>
+#include "history_buffer.h"
+#include "downsample.h"
+#include "sample_batch.h"
+#include "serial/serial_tx.h"
+
+// Every sample, oldest first, overwriting the oldest when full. Queries
+// read it in place: rows are chosen a frame at a time as the link drains,
+// so a reduced hour costs no more memory than a reduced minute.
+static const size_t HISTORY_SLOTS_PSRAM = 65536;  // ~18 h at 1 s, 1.3 MB
+static const size_t HISTORY_SLOTS_INTERNAL = 512; // Fallback without PSRAM
+
+static SeriesPoint *rows = nullptr;
+static size_t slots = 0; // Power of two, so sequence numbers may wrap
+static uint32_t written = 0;
+
+static struct
+{
+    bool active;
+    uint32_t firstSeq;
+    uint32_t sent;
+    uint32_t frame;
+    uint32_t frames;
+    uint8_t channels;
+    Downsample ds;
+} query;
+
+void historyBegin()
+{
+    slots = HISTORY_SLOTS_PSRAM;
+    rows = (SeriesPoint *)heap_caps_calloc(slots, sizeof(SeriesPoint), MALLOC_CAP_SPIRAM);
+    if (!rows)
+    {
+        serialLog("⚠ No PSRAM for history, using a small internal buffer");
+        slots = HISTORY_SLOTS_INTERNAL;
+        rows = (SeriesPoint *)calloc(slots, sizeof(SeriesPoint));
+    }
+}
+
+void historyStore(const TemperatureSample &sample)
+{
+    if (!rows)
+        return;
+
+    SeriesPoint &row = rows[written & (slots - 1)];
+    row.timestampMs = sample.timestamp;
+    for (uint8_t ch = 0; ch < MAX_THERMOCOUPLE_CHANNELS; ch++)
+    {
+        row.temperatureC[ch] = ch < sample.channelCount && sample.fault[ch] == 0 ? sample.temperatureC[ch] : NAN;
+    }
+    written++;
+}
+
+size_t historyDepth()
+{
+    return written < slots ? written : slots;
+}
+
+size_t historyCapacity()
+{
+    return slots;
+}
+
+// A row is gone once the ring has lapped it
+static bool readRow(void *, uint32_t index, SeriesPoint &point)
+{
+    uint32_t seq = query.firstSeq + index;
+    if (written - seq > slots)
+        return false;
+    point = rows[seq & (slots - 1)];
+    return true;
+}
+
+HistoryQuery historyStartQuery(uint32_t sinceMs, uint32_t maxPoints, uint8_t channels)
+{
+    uint32_t oldest = written - historyDepth();
+    uint32_t first = oldest;
+
+    // Rows are in time order: binary search for the first one in range
+    if (sinceMs != 0)
+    {
+        uint32_t low = 0;
+        uint32_t high = historyDepth();
+        while (low < high)
+        {
+            uint32_t mid = low + (high - low) / 2;
+            if ((int32_t)(rows[(oldest + mid) & (slots - 1)].timestampMs - sinceMs) >= 0)
+                high = mid;
+            else
+                low = mid + 1;
+        }
+        first = oldest + low;
+    }
+
+    query.active = false;
+    query.firstSeq = first;
+    query.sent = 0;
+    query.frame = 0;
+    query.channels = channels;
+    downsampleBegin(query.ds, written - first, maxPoints, channels, readRow, nullptr);
+
+    HistoryQuery result;
+    result.rows = query.ds.count;
+    result.points = query.ds.target;
+    result.frames = (result.points + HISTORY_FRAME_POINTS - 1) / HISTORY_FRAME_POINTS;
+    query.frames = result.frames;
+    query.active = result.points > 0;
+    return result;
+}
+
+bool historyPending()
+{
+    return query.active;
+}
+
+void historyCancel()
+{
+    query.active = false;
+}
+
+bool sendHistoryFrame()
+{
+    if (!query.active)
+        return false;
+
+    // Same columns as data_batch
+    static TemperatureSample frame[HISTORY_FRAME_POINTS];
+    uint16_t frameCount = 0;
+    uint32_t index;
+    SeriesPoint point;
+    while (frameCount < HISTORY_FRAME_POINTS && downsampleNext(query.ds, index, point))
+    {
+        TemperatureSample &sample = frame[frameCount++];
+        sample = {};
+        sample.timestamp = point.timestampMs;
+        sample.channelCount = query.channels;
+        for (uint8_t ch = 0; ch < query.channels; ch++)
+        {
+            sample.temperatureC[ch] = point.temperatureC[ch];
+        }
+    }
+    query.sent += frameCount;
+
+    static char encoded[SAMPLE_FRAME_BYTES(HISTORY_FRAME_POINTS)];
+    ProtoWriter w;
+    beginSampleFrame(w, encoded, sizeof(encoded), "history");
+    protoKey(w, "timestamp");
+    protoInt(w, frameCount > 0 ? (uint32_t)frame[0].timestamp : 0);
+    protoKey(w, "sample_count");
+    protoInt(w, frameCount);
+    protoKey(w, "frame");
+    protoInt(w, query.frame++);
+    protoKey(w, "frames");
+    protoInt(w, query.frames);
+
+    // The ring lapped the query; what was sent is still valid
+    protoKey(w, "remaining");
+    protoInt(w, query.ds.failed ? 0 : query.ds.target - query.sent);
+    protoKey(w, "downsampled");
+    protoBool(w, query.ds.target < query.ds.count);
+    if (query.ds.failed)
+    {
+        protoKey(w, "truncated");
+        protoBool(w, true);
+    }
+    size_t length = finishSampleFrame(w, frame, frameCount);
+
+    // Bulk rows queue as telemetry, like backfill: the loop paces on that
+    // ring, and an export never holds up command responses. A frame shed
+    // under the drop policy shows as a gap in "frame".
+    if (length > 0)
+    {
+        sendFrame(encoded, length, TX_TELEMETRY);
+    }
+    query.active = !query.ds.failed && query.sent < query.ds.target;
+    return true;
+}
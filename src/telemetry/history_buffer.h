@@ -0,0 +1,35 @@
+#pragma once
+#include <Arduino.h>
+#include "common/temperature_sample.h"
+
+// Rows per history frame; like backfill, small enough that one frame
+// barely delays the next live reading
+#define HISTORY_FRAME_POINTS 32
+
+// Largest reduced series a query may ask for
+#define HISTORY_MAX_POINTS 20000
+
+struct HistoryQuery
+{
+    uint32_t rows;   // Stored rows in the requested range
+    uint32_t points; // Rows that will be sent
+    uint32_t frames;
+};
+
+void historyBegin();
+
+// Every sample is kept, whether or not it was sent
+void historyStore(const TemperatureSample &sample);
+
+// Queues the rows taken at or after sinceMs (device millis, 0 = all that
+// is retained), reduced with LTTB to at most maxPoints (0 = every row).
+// Replaces a query still in progress.
+HistoryQuery historyStartQuery(uint32_t sinceMs, uint32_t maxPoints, uint8_t channels);
+bool historyPending();
+void historyCancel();
+
+// Sends the next rows of the query as one history frame
+bool sendHistoryFrame();
+
+size_t historyDepth();
+size_t historyCapacity();
@@ -0,0 +1,143 @@
+#include "sample_batch.h"
+#include "config/config.h"
+#include "common/device_identity.h"
+#include "clock/clock_sync.h"
+#include "serial/serial_tx.h"
+#include "deadband.h"
+#include "mqtt/mqtt_publisher.h"
+#include "trace/trace_recorder.h"
+
+// Batching is off (one frame per sample) until configured
+static uint16_t batchMaxSamples = 1;
+static unsigned long batchMaxAgeMs = 0;
+
+static TemperatureSample batchSamples[SAMPLE_BATCH_CAPACITY];
+static uint16_t batchCount = 0;
+static int batchRateMs = 0;          // Sampling interval when the batch was opened
+static ChannelMask batchChannels = 0; // Deadband selections of its samples, combined
+
+void configureSampleBatch(uint16_t maxSamples, unsigned long maxAgeMs)
+{
+    // Never drop what is already buffered under the old settings
+    flushSampleBatch();
+
+    batchMaxSamples = constrain(maxSamples, (uint16_t)1, (uint16_t)SAMPLE_BATCH_CAPACITY);
+    batchMaxAgeMs = maxAgeMs;
+}
+
+bool sampleBatchEnabled()
+{
+    return batchMaxSamples > 1;
+}
+
+uint16_t sampleBatchMaxSamples()
+{
+    return batchMaxSamples;
+}
+
+unsigned long sampleBatchMaxAgeMs()
+{
+    return batchMaxAgeMs;
+}
+
+void addSampleToBatch(const TemperatureSample &sample, ChannelMask channels, int samplingRateMs)
+{
+    // A frame carries one calibration_id, so a new calibration starts a new one
+    if (batchCount >= SAMPLE_BATCH_CAPACITY ||
+        (batchCount > 0 && batchSamples[0].calibrationId != sample.calibrationId))
+    {
+        flushSampleBatch();
+    }
+    if (batchCount == 0)
+    {
+        batchRateMs = samplingRateMs;
+        batchChannels = 0;
+    }
+    batchChannels |= channels;
+    batchSamples[batchCount++] = sample;
+}
+
+bool sampleBatchDue(unsigned long now)
+{
+    if (batchCount == 0)
+        return false;
+
+    if (batchCount >= batchMaxSamples)
+        return true;
+
+    return batchMaxAgeMs > 0 && now - batchSamples[0].timestamp >= batchMaxAgeMs;
+}
+
+unsigned long sampleBatchMsUntilDue(unsigned long now)
+{
+    // Nothing waiting on a deadline; size-triggered flushes happen on add
+    if (batchCount == 0 || batchMaxAgeMs == 0)
+        return ULONG_MAX;
+
+    unsigned long age = now - batchSamples[0].timestamp;
+    return age >= batchMaxAgeMs ? 0 : batchMaxAgeMs - age;
+}
+
+void beginSampleFrame(ProtoWriter &w, char *buffer, size_t capacity, const char *type)
+{
+    protoWriterInit(w, buffer, capacity);
+    protoBeginObject(w);
+    protoKey(w, "type");
+    protoString(w, protoSpan(type));
+    protoKey(w, "device_id");
+    protoString(w, protoSpan(deviceSerialNumber()));
+    protoKey(w, "firmware_version");
+    protoString(w, protoSpan(FIRMWARE_VERSION));
+    protoKey(w, "metadata");
+    protoBeginObject(w);
+}
+
+size_t finishSampleFrame(ProtoWriter &w, const TemperatureSample *samples, uint16_t count, ChannelMask channels)
+{
+    return protoFinishSampleColumns(w, samples, count, channels);
+}
+
+bool flushSampleBatch()
+{
+    if (batchCount == 0)
+        return false;
+
+    TraceScope trace(TRACE_BATCH_FLUSH);
+    const TemperatureSample &first = batchSamples[0];
+
+    // Shared envelope once per frame, then one column per channel
+    static char frame[SAMPLE_FRAME_BYTES(SAMPLE_BATCH_CAPACITY)];
+    ProtoWriter w;
+    beginSampleFrame(w, frame, sizeof(frame), "data_batch");
+    protoKey(w, "timestamp");
+    protoInt(w, (uint32_t)first.timestamp);
+    protoKey(w, "sampling_rate_ms");
+    protoInt(w, batchRateMs);
+    protoKey(w, "sample_count");
+    protoInt(w, batchCount);
+    protoKey(w, "sequence");
+    protoInt(w, nextDataSequence());
+    if (first.calibrationId != 0)
+    {
+        protoKey(w, "calibration_id");
+        protoInt(w, first.calibrationId);
+    }
+    if (clockSyncValid())
+    {
+        protoKey(w, "host_time_us");
+        protoInt(w, clockSyncToHostUs(first.deviceTimeUs));
+    }
+    size_t length = finishSampleFrame(w, batchSamples, batchCount, batchChannels);
+
+    if (hostConnected() && length > 0)
+    {
+        sendFrame(frame, length, TX_TELEMETRY);
+    }
+    if (length > 0)
+    {
+        mqttPublishFrame(MQTT_TOPIC_DATA, frame, length);
+    }
+
+    batchCount = 0;
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <Arduino.h>
+#include "common/temperature_sample.h"
+#include "deadband.h"
+#include "protocol/protocol.h"
+
+// Upper bound on samples held before a batch frame is forced out
+#define SAMPLE_BATCH_CAPACITY 64
+
+// Encoded size of a columnar frame of this many samples: envelope and
+// metadata, then per sample a time offset and four channels with faults
+#define SAMPLE_FRAME_BYTES(samples) (512 + (samples) * 64)
+
+void configureSampleBatch(uint16_t maxSamples, unsigned long maxAgeMs);
+bool sampleBatchEnabled();
+uint16_t sampleBatchMaxSamples();
+unsigned long sampleBatchMaxAgeMs();
+// channels is the sample's deadband selection. A batch has a column for
+// each channel selected in any of its samples, with every sample's value;
+// a channel unchanged throughout the batch is left out.
+void addSampleToBatch(const TemperatureSample &sample, ChannelMask channels, int samplingRateMs);
+bool sampleBatchDue(unsigned long now);
+unsigned long sampleBatchMsUntilDue(unsigned long now);
+bool flushSampleBatch();
+
+// data_batch, data_backfill and history frames share one columnar layout,
+// encoded with the protocol.h writer so temperatures carry the same fixed
+// point as data frames. beginSampleFrame() writes the envelope and opens
+// "metadata" for the caller's members; finishSampleFrame() closes it, adds
+// the timestamp_offsets_ms and per-channel columns, for the channels in
+// channels, and returns the frame length, or 0 if it did not fit.
+void beginSampleFrame(ProtoWriter &w, char *buffer, size_t capacity, const char *type);
+size_t finishSampleFrame(ProtoWriter &w, const TemperatureSample *samples, uint16_t count,
+                         ChannelMask channels = 0xFF);
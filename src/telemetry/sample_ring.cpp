@@ -0,0 +1,41 @@
+#include "sample_ring.h"
+
+void sampleRingInit(SampleRing &ring, TemperatureSample *storage, size_t slots)
+{
+    ring.samples = storage;
+    ring.slots = storage ? slots : 0;
+    ring.head = 0;
+    ring.count = 0;
+    ring.dropped = 0;
+}
+
+void sampleRingPush(SampleRing &ring, const TemperatureSample &sample)
+{
+    if (ring.slots == 0)
+        return;
+
+    if (ring.count == ring.slots)
+    {
+        ring.head = (ring.head + 1) % ring.slots;
+        ring.count--;
+        ring.dropped++;
+    }
+    ring.samples[(ring.head + ring.count) % ring.slots] = sample;
+    ring.count++;
+}
+
+uint16_t sampleRingTake(SampleRing &ring, TemperatureSample *out, uint16_t max)
+{
+    // Copied out so the caller's columns are contiguous across the wrap
+    uint16_t taken = 0;
+    while (taken < max && taken < ring.count)
+    {
+        const TemperatureSample &sample = ring.samples[(ring.head + taken) % ring.slots];
+        if (taken > 0 && sample.calibrationId != out[0].calibrationId)
+            break;
+        out[taken++] = sample;
+    }
+    ring.head = ring.slots ? (ring.head + taken) % ring.slots : 0;
+    ring.count -= taken;
+    return taken;
+}
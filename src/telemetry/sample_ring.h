@@ -0,0 +1,23 @@
+#pragma once
+#include <stddef.h>
+#include "common/temperature_sample.h"
+
+// FIFO of samples in caller storage that overwrites the oldest when full,
+// so it always holds the latest stretch. Plain C++ with no Arduino
+// dependencies; callers provide the locking.
+
+struct SampleRing
+{
+    TemperatureSample *samples;
+    size_t slots;
+    size_t head; // Oldest sample
+    size_t count;
+    uint32_t dropped;
+};
+
+void sampleRingInit(SampleRing &ring, TemperatureSample *storage, size_t slots);
+void sampleRingPush(SampleRing &ring, const TemperatureSample &sample);
+
+// Moves up to max of the oldest samples into out and returns how many. A
+// frame carries one calibration_id, so it stops where that changes.
+uint16_t sampleRingTake(SampleRing &ring, TemperatureSample *out, uint16_t max);
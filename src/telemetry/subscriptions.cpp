@@ -0,0 +1,119 @@
+#include "subscriptions.h"
+#include "serial/serial_tx.h"
+#include "common/device_identity.h"
+
+static const char *const topicNames[SUB_TOPIC_COUNT] = {"status", "metrics"};
+static const char *const deltaTypes[SUB_TOPIC_COUNT] = {"status_delta", "metrics_delta"};
+
+static SubscriptionSnapshot snapshotFn = nullptr;
+static uint8_t topics = 0;
+static unsigned long intervalMs = 1000;
+static unsigned long lastCheck = 0;
+
+// What the host was last told, per topic; empty until the first push
+static JsonDocument reported[SUB_TOPIC_COUNT];
+static bool reportedValid[SUB_TOPIC_COUNT];
+
+void subscriptionsBegin(SubscriptionSnapshot snapshot)
+{
+    snapshotFn = snapshot;
+}
+
+void configureSubscriptions(uint8_t newTopics, unsigned long newIntervalMs)
+{
+    topics = newTopics & (SUB_MASK(SUB_TOPIC_COUNT) - 1);
+    intervalMs = newIntervalMs;
+
+    // Check straight away, and start each topic from a full snapshot
+    lastCheck = millis() - intervalMs;
+    for (uint8_t i = 0; i < SUB_TOPIC_COUNT; i++)
+    {
+        reported[i].clear();
+        reportedValid[i] = false;
+    }
+}
+
+uint8_t subscribedTopics()
+{
+    return topics;
+}
+
+unsigned long subscriptionIntervalMs()
+{
+    return intervalMs;
+}
+
+const char *subscriptionTopicName(SubscriptionTopic topic)
+{
+    return topic < SUB_TOPIC_COUNT ? topicNames[topic] : "";
+}
+
+bool parseSubscriptionTopic(const char *name, SubscriptionTopic &topic)
+{
+    for (uint8_t i = 0; i < SUB_TOPIC_COUNT; i++)
+    {
+        if (name && strcmp(name, topicNames[i]) == 0)
+        {
+            topic = (SubscriptionTopic)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned long subscriptionMsUntilDue(unsigned long now)
+{
+    if (!topics)
+        return ULONG_MAX;
+
+    unsigned long elapsed = now - lastCheck;
+    return elapsed >= intervalMs ? 0 : intervalMs - elapsed;
+}
+
+static void publishDelta(SubscriptionTopic topic, unsigned long now)
+{
+    JsonDocument current;
+    snapshotFn(topic, current.to<JsonObject>());
+
+    JsonDocument doc;
+    doc["type"] = deltaTypes[topic];
+    doc["device_id"] = deviceSerialNumber();
+    JsonObject meta = doc["metadata"].to<JsonObject>();
+    meta["timestamp"] = now;
+    meta["full"] = !reportedValid[topic];
+
+    // Whole members are compared, so a nested object goes out entire when
+    // any part of it changes; members that disappeared are sent as null
+    JsonObject changes = doc["payload"].to<JsonObject>();
+    JsonObject previous = reported[topic].as<JsonObject>();
+    for (JsonPair member : current.as<JsonObject>())
+    {
+        if (!reportedValid[topic] || previous[member.key()] != member.value())
+            changes[member.key()] = member.value();
+    }
+    for (JsonPair member : previous)
+    {
+        if (current[member.key()].isNull())
+            changes[member.key()] = nullptr;
+    }
+
+    if (changes.size() > 0)
+    {
+        sendJson(doc);
+    }
+    reported[topic] = current;
+    reportedValid[topic] = true;
+}
+
+void serviceSubscriptions(unsigned long now)
+{
+    if (!topics || !snapshotFn || now - lastCheck < intervalMs)
+        return;
+    lastCheck = now;
+
+    for (uint8_t i = 0; i < SUB_TOPIC_COUNT; i++)
+    {
+        if (topics & SUB_MASK(i))
+            publishDelta((SubscriptionTopic)i, now);
+    }
+}
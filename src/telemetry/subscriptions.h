@@ -0,0 +1,33 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Pushed groups of device state; the host subscribes instead of polling
+// get_device_info
+enum SubscriptionTopic : uint8_t
+{
+    SUB_STATUS,  // Connectivity, modes and channel health
+    SUB_METRICS, // Queue depths, counters and link quality
+    SUB_TOPIC_COUNT,
+};
+
+#define SUB_MASK(topic) (1u << (topic))
+
+// Fills the current state of one topic as flat members
+typedef void (*SubscriptionSnapshot)(SubscriptionTopic topic, JsonObject out);
+
+void subscriptionsBegin(SubscriptionSnapshot snapshot);
+
+// Replaces the subscribed set; the next check sends each topic in full
+void configureSubscriptions(uint8_t topics, unsigned long intervalMs);
+uint8_t subscribedTopics();
+unsigned long subscriptionIntervalMs();
+
+const char *subscriptionTopicName(SubscriptionTopic topic);
+bool parseSubscriptionTopic(const char *name, SubscriptionTopic &topic);
+
+unsigned long subscriptionMsUntilDue(unsigned long now);
+
+// Sends a <topic>_delta frame with the members that changed since the
+// last one, if any
+void serviceSubscriptions(unsigned long now);
@@ -0,0 +1,283 @@
+#include <Preferences.h>
+#include <ArduinoJson.h>
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include "trace_recorder.h"
+#include "serial/serial_tx.h"
+#include "common/device_identity.h"
+
+// Events go into the lock-free ring in trace_ring.h. Each tag packs name,
+// phase and thread into the 12 bits the ring leaves to the caller.
+//
+// The ring lives in .noinit RAM, which a panic or watchdog reset leaves
+// alone, so the events leading up to a crash are still there on the next
+// boot to be saved.
+
+static const uint32_t TRACE_MAGIC = 0x54524331; // "TRC1"
+static const uint8_t TRACE_MAX_THREADS = 16;
+static const size_t TRACE_THREAD_NAME = 12;
+static const size_t TRACE_CHUNK_EVENTS = 32; // Keeps a frame within the response ring
+
+static const uint32_t TAG_NAME_MASK = 0x3F;
+static const uint32_t TAG_PHASE_SHIFT = 6;
+static const uint32_t TAG_THREAD_SHIFT = 8;
+
+enum TracePhase : uint8_t
+{
+    PHASE_BEGIN,
+    PHASE_END,
+    PHASE_INSTANT,
+};
+
+static const char *const traceNames[TRACE_NAME_COUNT] = {
+    "loop", "sample", "command", "wifi_check", "wifi_connect", "wifi_drop",
+    "batch_flush", "serial_write", "mqtt_publish", "ota_check", "ota_update",
+    "ota_release", "ota_signature", "ota_download", "ota_verify", "ota_commit"};
+
+// Indexed by the 2-bit phase field; the unused value reads as an instant
+static const char *const phaseCodes[4] = {"B", "E", "i", "i"};
+
+struct TraceStore
+{
+    uint32_t magic;
+    TraceRing events;
+    char threadNames[TRACE_MAX_THREADS][TRACE_THREAD_NAME];
+};
+
+// Newest events in order, as saved to NVS after a crash
+struct CrashTrace
+{
+    uint32_t count;
+    uint32_t slots[TRACE_CRASH_EVENTS][2];
+    char threadNames[TRACE_MAX_THREADS][TRACE_THREAD_NAME];
+};
+
+static __NOINIT_ATTR TraceStore store;
+
+static TaskHandle_t threadHandles[TRACE_MAX_THREADS];
+static uint8_t threadCount = 0;
+static portMUX_TYPE threadLock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool recording = false;
+static bool crashSaved = false;
+static uint32_t overheadNs = 0;
+
+static uint8_t currentThread()
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    uint8_t count = __atomic_load_n(&threadCount, __ATOMIC_ACQUIRE);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (threadHandles[i] == self)
+            return i;
+    }
+
+    // First event from this task: register it once
+    portENTER_CRITICAL(&threadLock);
+    uint8_t id = threadCount;
+    if (id < TRACE_MAX_THREADS)
+    {
+        threadHandles[id] = self;
+        strlcpy(store.threadNames[id], pcTaskGetName(self), TRACE_THREAD_NAME);
+        __atomic_store_n(&threadCount, id + 1, __ATOMIC_RELEASE);
+    }
+    else
+    {
+        id = TRACE_MAX_THREADS - 1; // Overflow tasks share the last row
+    }
+    portEXIT_CRITICAL(&threadLock);
+    return id;
+}
+
+static void record(TraceName name, TracePhase phase)
+{
+    if (!recording)
+        return;
+
+    uint32_t timestamp = (uint32_t)esp_timer_get_time();
+    uint32_t tag = name | (phase << TAG_PHASE_SHIFT) | (currentThread() << TAG_THREAD_SHIFT);
+
+    traceRingWrite(store.events, timestamp, tag);
+}
+
+void traceBegin(TraceName name)
+{
+    record(name, PHASE_BEGIN);
+}
+
+void traceEnd(TraceName name)
+{
+    record(name, PHASE_END);
+}
+
+void traceInstant(TraceName name)
+{
+    record(name, PHASE_INSTANT);
+}
+
+static void saveCrashTrace()
+{
+    CrashTrace *crash = (CrashTrace *)calloc(1, sizeof(CrashTrace));
+    if (!crash)
+        return;
+
+    // A slot the crash stopped mid-write fails the ring's own checks
+    crash->count = traceRingSnapshot(store.events, crash->slots, TRACE_CRASH_EVENTS);
+    memcpy(crash->threadNames, store.threadNames, sizeof(store.threadNames));
+    for (uint8_t i = 0; i < TRACE_MAX_THREADS; i++)
+    {
+        crash->threadNames[i][TRACE_THREAD_NAME - 1] = '\0';
+    }
+
+    Preferences tracePrefs;
+    tracePrefs.begin("trace", false);
+    tracePrefs.putBytes("crash", crash, sizeof(CrashTrace));
+    tracePrefs.end();
+    free(crash);
+}
+
+void traceRecorderBegin()
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool crashed = reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT ||
+                   reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT;
+
+    if (crashed && store.magic == TRACE_MAGIC)
+    {
+        saveCrashTrace();
+    }
+
+    Preferences tracePrefs;
+    tracePrefs.begin("trace", true);
+    crashSaved = tracePrefs.getBytesLength("crash") == sizeof(CrashTrace);
+    tracePrefs.end();
+
+    memset(&store, 0, sizeof(store));
+    store.magic = TRACE_MAGIC;
+    recording = true;
+
+    // Cost of one event, measured on the ring itself and then discarded
+    const int samples = 256;
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < samples; i++)
+    {
+        traceInstant(TRACE_LOOP);
+    }
+    overheadNs = (uint32_t)((esp_timer_get_time() - start) * 1000 / samples);
+    memset(&store.events, 0, sizeof(store.events));
+}
+
+bool traceHasCrashDump()
+{
+    return crashSaved;
+}
+
+uint32_t traceOverheadNs()
+{
+    return overheadNs;
+}
+
+bool sendTraceDump(bool crash)
+{
+    // Heap rather than the caller's stack: up to 8 KB, PSRAM when present
+    uint32_t(*events)[2] = (uint32_t(*)[2])malloc(sizeof(uint32_t[TRACE_CAPACITY][2]));
+    char(*threadNames)[TRACE_THREAD_NAME] = (char(*)[TRACE_THREAD_NAME])malloc(sizeof(store.threadNames));
+    size_t count = 0;
+    bool ok = events && threadNames;
+
+    if (ok && crash)
+    {
+        CrashTrace *saved = (CrashTrace *)malloc(sizeof(CrashTrace));
+        Preferences tracePrefs;
+        tracePrefs.begin("trace", true);
+        ok = saved && tracePrefs.getBytes("crash", saved, sizeof(CrashTrace)) == sizeof(CrashTrace);
+        tracePrefs.end();
+
+        if (ok)
+        {
+            count = min(saved->count, (uint32_t)TRACE_CRASH_EVENTS);
+            memcpy(events, saved->slots, count * sizeof(events[0]));
+            memcpy(threadNames, saved->threadNames, sizeof(store.threadNames));
+        }
+        free(saved);
+    }
+    else if (ok)
+    {
+        count = traceRingSnapshot(store.events, events, TRACE_CAPACITY);
+        memcpy(threadNames, store.threadNames, sizeof(store.threadNames));
+    }
+
+    if (!ok || count == 0)
+    {
+        free(events);
+        free(threadNames);
+        return false;
+    }
+
+    size_t chunks = (count + TRACE_CHUNK_EVENTS - 1) / TRACE_CHUNK_EVENTS;
+    uint32_t previous = events[0][0];
+    uint64_t unwrapped = previous;
+
+    for (size_t chunk = 0; chunk < chunks; chunk++)
+    {
+        JsonDocument doc;
+        doc["type"] = "trace";
+        doc["device_id"] = deviceSerialNumber();
+
+        JsonObject meta = doc["metadata"].to<JsonObject>();
+        meta["source"] = crash ? "crash" : "live";
+        meta["chunk"] = chunk;
+        meta["chunks"] = chunks;
+        meta["event_count"] = count;
+        meta["overhead_ns"] = overheadNs;
+
+        JsonArray traceEvents = doc["traceEvents"].to<JsonArray>();
+
+        // Thread names once, as Chrome metadata events
+        if (chunk == 0)
+        {
+            for (uint8_t tid = 0; tid < TRACE_MAX_THREADS; tid++)
+            {
+                if (threadNames[tid][0] == '\0')
+                    continue;
+                JsonObject thread = traceEvents.add<JsonObject>();
+                thread["name"] = "thread_name";
+                thread["ph"] = "M";
+                thread["pid"] = 1;
+                thread["tid"] = tid;
+                thread["args"]["name"] = threadNames[tid];
+            }
+        }
+
+        size_t end = min(count, (chunk + 1) * TRACE_CHUNK_EVENTS);
+        for (size_t i = chunk * TRACE_CHUNK_EVENTS; i < end; i++)
+        {
+            // Extend the 32-bit clock; events are in claim order, so a
+            // small negative step is a cross-core race, not a wrap
+            unwrapped += (int64_t)(int32_t)(events[i][0] - previous);
+            previous = events[i][0];
+
+            uint32_t tag = events[i][1];
+            uint8_t name = tag & TAG_NAME_MASK;
+            uint8_t phase = (tag >> TAG_PHASE_SHIFT) & 0x3;
+
+            JsonObject event = traceEvents.add<JsonObject>();
+            event["name"] = name < TRACE_NAME_COUNT ? traceNames[name] : "unknown";
+            event["ph"] = phaseCodes[phase];
+            event["ts"] = unwrapped;
+            event["pid"] = 1;
+            event["tid"] = (tag >> TAG_THREAD_SHIFT) & 0xF;
+            if (phase == PHASE_INSTANT)
+            {
+                event["s"] = "t";
+            }
+        }
+
+        sendJson(doc);
+    }
+
+    free(events);
+    free(threadNames);
+    return true;
+}
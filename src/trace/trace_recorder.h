@@ -0,0 +1,54 @@
+#pragma once
+#include <Arduino.h>
+#include "trace_ring.h"
+
+// Spans and markers recorded into a fixed ring and dumped as Chrome/Perfetto
+// trace events. Add names at the end so saved crash traces stay readable.
+enum TraceName : uint8_t
+{
+    TRACE_LOOP,          // loop() work between waits
+    TRACE_SAMPLE,        // readAndTransmitTemperatures()
+    TRACE_COMMAND,       // One command, parse through response
+    TRACE_WIFI_CHECK,    // monitorWiFiConnection() when due
+    TRACE_WIFI_CONNECT,  // Saved-network join started, then finished
+    TRACE_WIFI_DROP,     // STA disconnected (instant)
+    TRACE_BATCH_FLUSH,   // flushSampleBatch()
+    TRACE_SERIAL_WRITE,  // Writer task handing one frame to the driver
+    TRACE_MQTT_PUBLISH,  // One QoS 1 publish, PUBACK included
+    TRACE_OTA_CHECK,     // checkForFirmwareUpdate()
+    TRACE_OTA_UPDATE,    // performOTAUpdate()
+    TRACE_OTA_RELEASE,   // OTA stage markers (instant)
+    TRACE_OTA_SIGNATURE,
+    TRACE_OTA_DOWNLOAD,
+    TRACE_OTA_VERIFY,
+    TRACE_OTA_COMMIT,
+    TRACE_NAME_COUNT,
+};
+
+#define TRACE_CRASH_EVENTS 256 // Newest events saved to NVS after a crash
+
+// Call first thing in setup(): saves the ring left by a crash, then
+// measures the per-event cost and starts recording
+void traceRecorderBegin();
+
+void traceBegin(TraceName name);
+void traceEnd(TraceName name);
+void traceInstant(TraceName name);
+
+// Records a span for the enclosing block
+class TraceScope
+{
+public:
+    explicit TraceScope(TraceName name) : name(name) { traceBegin(name); }
+    ~TraceScope() { traceEnd(name); }
+
+private:
+    TraceName name;
+};
+
+bool traceHasCrashDump();
+uint32_t traceOverheadNs();
+
+// Sends the live ring, or the one saved after the last crash, as trace
+// frames; false if there is nothing to send
+bool sendTraceDump(bool crash);
@@ -0,0 +1,27 @@
+#include "trace_ring.h"
+
+size_t traceRingSnapshot(const TraceRing &ring, uint32_t (*out)[2], size_t max)
+{
+    uint32_t head = __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE);
+    uint32_t span = max < TRACE_CAPACITY ? max : TRACE_CAPACITY;
+    size_t count = 0;
+
+    // Claims from head - span up, wrapping with head. Slots not yet written
+    // in this ring's life hold a zero tag and are skipped like busy ones.
+    for (uint32_t i = 0; i < span; i++)
+    {
+        uint32_t claim = head - span + i;
+        const uint32_t *slot = ring.slots[claim % TRACE_CAPACITY];
+        uint32_t expected = TRACE_TAG_DONE | (traceRingLap(claim) << TRACE_TAG_LAP_SHIFT);
+
+        uint32_t tag = __atomic_load_n(&slot[1], __ATOMIC_ACQUIRE);
+        uint32_t timestamp = __atomic_load_n(&slot[0], __ATOMIC_ACQUIRE);
+        if ((tag & ~((1u << TRACE_TAG_LAP_SHIFT) - 1)) != expected || __atomic_load_n(&slot[1], __ATOMIC_ACQUIRE) != tag)
+            continue; // Still being written, or already overwritten
+
+        out[count][0] = timestamp;
+        out[count][1] = tag;
+        count++;
+    }
+    return count;
+}
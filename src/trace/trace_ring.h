@@ -0,0 +1,61 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Lock-free ring of trace events behind the trace recorder. Each event is
+// two 32-bit words: a timestamp, and a tag whose low 12 bits belong to the
+// caller and whose next 18 hold the ring lap the event was written in. A
+// writer claims a slot with one atomic increment, takes the slot's tag
+// with a compare-and-swap that marks it busy, then stores the time and
+// the finished tag, each a single aligned store. A writer preempted for a
+// whole lap finds its slot busy or already rewritten and drops its event,
+// so two writers never mix their words. A reader takes an event only if
+// the tag is unchanged around reading the time and its lap matches the
+// slot's position. Any number of writers, no locks. Plain C++ with no
+// Arduino or FreeRTOS dependencies.
+
+#define TRACE_CAPACITY 1024 // Events kept, oldest overwritten
+
+static const uint32_t TRACE_TAG_LAP_SHIFT = 12;
+static const uint32_t TRACE_TAG_LAP_MASK = 0x3FFFF;
+static const uint32_t TRACE_TAG_BUSY = 0x40000000; // A writer is between its stores
+static const uint32_t TRACE_TAG_DONE = 0x80000000; // Set in every finished tag
+
+struct TraceRing
+{
+    uint32_t head; // Claims so far, wrapping; slot = claim % TRACE_CAPACITY
+    uint32_t slots[TRACE_CAPACITY][2];
+};
+
+// The lap range divides 2^32 / TRACE_CAPACITY, so laps stay consecutive
+// when head wraps
+static inline uint32_t traceRingLap(uint32_t claim)
+{
+    return (claim / TRACE_CAPACITY) & TRACE_TAG_LAP_MASK;
+}
+
+// tag must fit in the low TRACE_TAG_LAP_SHIFT bits. False if the event was
+// dropped: its slot was busy or already held a later lap.
+static inline bool traceRingWrite(TraceRing &ring, uint32_t timestamp, uint32_t tag)
+{
+    uint32_t claim = __atomic_fetch_add(&ring.head, 1, __ATOMIC_RELAXED);
+    uint32_t *slot = ring.slots[claim % TRACE_CAPACITY];
+    uint32_t lap = traceRingLap(claim);
+
+    uint32_t seen = __atomic_load_n(&slot[1], __ATOMIC_RELAXED);
+    do
+    {
+        // Our lap or a later one, within half the lap range
+        uint32_t ahead = ((seen >> TRACE_TAG_LAP_SHIFT) - lap) & TRACE_TAG_LAP_MASK;
+        if ((seen & TRACE_TAG_BUSY) || ((seen & TRACE_TAG_DONE) && ahead <= TRACE_TAG_LAP_MASK / 2))
+            return false;
+    } while (!__atomic_compare_exchange_n(&slot[1], &seen, TRACE_TAG_BUSY, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    __atomic_store_n(&slot[0], timestamp, __ATOMIC_RELEASE);
+    __atomic_store_n(&slot[1], TRACE_TAG_DONE | (lap << TRACE_TAG_LAP_SHIFT) | tag, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Copies complete events among the newest max claims, oldest first, into
+// out and returns how many. Tags are returned with their lap and done bit.
+size_t traceRingSnapshot(const TraceRing &ring, uint32_t (*out)[2], size_t max);
@@ -0,0 +1,74 @@
+#include "fast_connect.h"
+
+bool wifiLinkCacheUsable(const WiFiLinkCache &link)
+{
+    if (link.magic != WIFI_LINK_MAGIC || link.channel < 1 || link.channel > 14)
+        return false;
+
+    for (uint8_t byte : link.bssid)
+    {
+        if (byte != 0)
+            return true;
+    }
+    return false;
+}
+
+bool wifiLeaseReusable(const WiFiLinkCache &link, uint32_t nowS, uint32_t clockEpoch)
+{
+    // A clock set since the grant can also put nowS before it
+    return wifiLinkCacheUsable(link) && link.ip != 0 && link.clockEpoch == clockEpoch &&
+           nowS >= link.leaseObtainedS && nowS - link.leaseObtainedS < WIFI_LEASE_REUSE_S;
+}
+
+void fastConnectStart(FastConnect &join, const WiFiRadio &radio, const WiFiLinkCache &link,
+                      uint32_t nowS, uint32_t clockEpoch, unsigned long nowMs, unsigned long timeoutMs)
+{
+    join.startedMs = nowMs;
+    join.phaseStartedMs = nowMs;
+    join.timeoutMs = timeoutMs;
+    join.path = FAST_CONNECT_IDLE;
+    join.leaseReused = false;
+
+    if (wifiLinkCacheUsable(link))
+    {
+        join.state = FAST_CONNECT_DIRECTED;
+        join.leaseReused = wifiLeaseReusable(link, nowS, clockEpoch);
+        radio.beginDirected(radio.context, link, join.leaseReused);
+    }
+    else
+    {
+        join.state = FAST_CONNECT_SCAN;
+        radio.beginScan(radio.context);
+    }
+}
+
+FastConnectState fastConnectPoll(FastConnect &join, const WiFiRadio &radio, unsigned long nowMs)
+{
+    if (join.state != FAST_CONNECT_DIRECTED && join.state != FAST_CONNECT_SCAN)
+        return join.state;
+
+    if (radio.connected(radio.context))
+    {
+        join.path = join.state;
+        join.state = FAST_CONNECT_CONNECTED;
+        return join.state;
+    }
+
+    if (nowMs - join.startedMs >= join.timeoutMs)
+    {
+        radio.stop(radio.context);
+        join.state = FAST_CONNECT_FAILED;
+        return join.state;
+    }
+
+    // The AP moved channel or was replaced
+    if (join.state == FAST_CONNECT_DIRECTED && nowMs - join.phaseStartedMs >= WIFI_DIRECTED_TIMEOUT_MS)
+    {
+        radio.stop(radio.context);
+        join.state = FAST_CONNECT_SCAN;
+        join.phaseStartedMs = nowMs;
+        join.leaseReused = false;
+        radio.beginScan(radio.context);
+    }
+    return join.state;
+}
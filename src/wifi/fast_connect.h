@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+
+// Reconnect strategy with no Arduino or ESP-IDF dependencies, so
+// tools/wifi_reconnect_sim.cpp can drive it against a simulated radio
+
+#define WIFI_LINK_MAGIC 0x574C4E32 // "WLN2"
+
+// The last good association, kept in NVS. ip..dns are the DHCP lease in
+// network byte order, 0 when none is cached.
+struct WiFiLinkCache
+{
+    uint32_t magic;
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    uint32_t leaseObtainedS; // time() when DHCP granted the lease
+    uint32_t clockEpoch;     // Which run of time() leaseObtainedS is from
+};
+
+// How long after the DHCP grant a lease may be reused without asking the
+// server; well inside the shortest lease a home router hands out
+static const uint32_t WIFI_LEASE_REUSE_S = 30 * 60;
+
+// A directed join that has not come up by then is abandoned for a scan
+static const unsigned long WIFI_DIRECTED_TIMEOUT_MS = 3000;
+
+// The radio operations the strategy needs. Credentials live behind
+// context; stop() abandons an association attempt in progress.
+struct WiFiRadio
+{
+    void *context;
+    void (*beginDirected)(void *context, const WiFiLinkCache &link, bool reuseLease);
+    void (*beginScan)(void *context);
+    bool (*connected)(void *context);
+    void (*stop)(void *context);
+};
+
+enum FastConnectState : uint8_t
+{
+    FAST_CONNECT_IDLE,
+    FAST_CONNECT_DIRECTED, // Channel-locked join to the cached BSSID
+    FAST_CONNECT_SCAN,     // Full scan for the SSID, then DHCP
+    FAST_CONNECT_CONNECTED,
+    FAST_CONNECT_FAILED,
+};
+
+struct FastConnect
+{
+    FastConnectState state;
+    FastConnectState path; // DIRECTED or SCAN once connected
+    bool leaseReused;
+    unsigned long startedMs;
+    unsigned long phaseStartedMs;
+    unsigned long timeoutMs;
+};
+
+bool wifiLinkCacheUsable(const WiFiLinkCache &link);
+
+// nowS is time() in seconds and clockEpoch names its current run: time()
+// carries on across software resets but restarts on power-on, so a lease
+// from another epoch is of unknown age and never reused
+bool wifiLeaseReusable(const WiFiLinkCache &link, uint32_t nowS, uint32_t clockEpoch);
+
+// Starts a join: directed first when the cache allows it, otherwise a scan
+void fastConnectStart(FastConnect &join, const WiFiRadio &radio, const WiFiLinkCache &link,
+                      uint32_t nowS, uint32_t clockEpoch, unsigned long nowMs, unsigned long timeoutMs);
+
+// Advances the join; call until it returns CONNECTED or FAILED
+FastConnectState fastConnectPoll(FastConnect &join, const WiFiRadio &radio, unsigned long nowMs);
@@ -1,91 +1,287 @@
+#include <atomic>
+#include <time.h>
 #include <WiFi.h>
+#include <WebServer.h>
+#include <DNSServer.h>
 #include <Preferences.h>
+#include <esp_attr.h>
+#include <esp_system.h>
 #include "wifi_manager.h"
 #include "config/config.h"
-#include "common/connection_state.h"
+#include "common/device_identity.h"
 #include "setup_portal_html.h"
+#include "scheduler/event_loop.h"
+#include "scheduler/event_bus.h"
+#include "serial/serial_tx.h"
+#include "trace/trace_recorder.h"
+#include "fast_connect.h"
 
-extern Preferences preferences;
-extern String deviceId;
-extern String deviceSerialNumber;
-extern bool wifiConfigured;
-extern bool apModeActive;
-extern void setConnectionState(ConnectionState state);
-extern WebServer server;
-extern DNSServer dnsServer;
+// Credentials and the link cache live in the shared "config" namespace
+static Preferences preferences;
 
-bool connectToWiFi(const char *ssid, const char *password)
+// Setup portal, served while setupMode is set
+static WebServer server(80);
+static DNSServer dnsServer;
+
+// Owned here and written only by the loop task; other tasks read them and
+// learn about transitions from the event bus
+static std::atomic<bool> configured(false);
+static std::atomic<bool> setupMode(false);
+static unsigned long lastWiFiCheck = 0;
+
+// Joins run in the background: beginSavedWiFi() or a dropped link starts
+// one and monitorWiFiConnection() finishes it, giving up after 15 s
+static const unsigned long JOIN_TIMEOUT_MS = 15000;
+static std::atomic<bool> joining(false);
+static FastConnect join;
+static String joinSsid;
+static String joinPassword;
+
+static WiFiLinkCache linkCache;
+
+// Survive software resets along with time(); garbage after a power cycle
+RTC_NOINIT_ATTR static uint32_t clockEpochMagic;
+RTC_NOINIT_ATTR static uint32_t clockEpoch;
+static bool clockEpochChecked = false;
+static bool staticLease = false; // Running on a reused lease, not DHCP
+static unsigned long lastConnectMs = 0;
+static const char *lastConnectPath = "none";
+
+static void publishWiFiEvent(BusEventType type, int32_t value = 0)
 {
-    Serial.printf("Connecting to WiFi: %s\n", ssid);
+    BusEvent event = {type, (uint32_t)millis(), 0, value};
+    busPublish(event);
+}
+
+static void handleRoot();
+static void handleScan();
+static void handleConnect();
+
+bool wifiIsConfigured()
+{
+    return configured.load();
+}
+
+bool wifiSetupModeActive()
+{
+    return setupMode.load();
+}
+
+bool wifiJoining()
+{
+    return joining.load();
+}
+
+unsigned long wifiLastConnectMs()
+{
+    return lastConnectMs;
+}
+
+const char *wifiLastConnectPath()
+{
+    return lastConnectPath;
+}
+
+static void radioBeginDirected(void *, const WiFiLinkCache &link, bool reuseLease)
+{
+    WiFi.mode(WIFI_STA);
+    if (reuseLease)
+    {
+        WiFi.config(IPAddress(link.ip), IPAddress(link.gateway), IPAddress(link.subnet), IPAddress(link.dns));
+    }
+    else
+    {
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    }
+    WiFi.begin(joinSsid.c_str(), joinPassword.c_str(), link.channel, link.bssid);
+}
 
+static void radioBeginScan(void *)
+{
     WiFi.mode(WIFI_STA);
-    WiFi.begin(ssid, password);
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    WiFi.begin(joinSsid.c_str(), joinPassword.c_str());
+}
 
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 30)
+static bool radioConnected(void *)
+{
+    return WiFi.status() == WL_CONNECTED;
+}
+
+static void radioStop(void *)
+{
+    WiFi.disconnect();
+}
+
+static const WiFiRadio radio = {nullptr, radioBeginDirected, radioBeginScan, radioConnected, radioStop};
+
+static uint32_t currentClockEpoch()
+{
+    if (!clockEpochChecked)
     {
-        delay(500);
-        Serial.print(".");
-        attempts++;
+        esp_reset_reason_t reason = esp_reset_reason();
+        if (clockEpochMagic != WIFI_LINK_MAGIC || reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT)
+        {
+            clockEpoch = esp_random();
+            clockEpochMagic = WIFI_LINK_MAGIC;
+        }
+        clockEpochChecked = true;
     }
-    Serial.println();
+    return clockEpoch;
+}
 
-    if (WiFi.status() == WL_CONNECTED)
+// Records the association just made; NVS is only written when it changed
+static void saveLinkCache(bool leaseFromDhcp)
+{
+    WiFiLinkCache link = linkCache;
+    link.magic = WIFI_LINK_MAGIC;
+    memcpy(link.bssid, WiFi.BSSID(), sizeof(link.bssid));
+    link.channel = WiFi.channel();
+    if (leaseFromDhcp)
     {
-        Serial.printf("✓ Connected! IP: %s, RSSI: %d dBm\n",
-                      WiFi.localIP().toString().c_str(), WiFi.RSSI());
-        return true;
+        link.ip = WiFi.localIP();
+        link.gateway = WiFi.gatewayIP();
+        link.subnet = WiFi.subnetMask();
+        link.dns = WiFi.dnsIP();
+        link.leaseObtainedS = time(nullptr);
+        link.clockEpoch = currentClockEpoch();
     }
 
-    Serial.println("✗ Connection failed");
-    return false;
+    if (memcmp(&link, &linkCache, sizeof(link)) != 0)
+    {
+        linkCache = link;
+        preferences.putBytes("wifi_link", &linkCache, sizeof(linkCache));
+    }
+}
+
+static void startJoin()
+{
+    joinSsid = preferences.getString("ssid", "");
+    joinPassword = preferences.getString("password", "");
+    if (preferences.getBytes("wifi_link", &linkCache, sizeof(linkCache)) != sizeof(linkCache))
+    {
+        memset(&linkCache, 0, sizeof(linkCache));
+    }
+
+    traceInstant(TRACE_WIFI_CONNECT);
+    fastConnectStart(join, radio, linkCache, time(nullptr), currentClockEpoch(), millis(), JOIN_TIMEOUT_MS);
+    serialLog("Connecting to WiFi: %s (%s)", joinSsid.c_str(),
+              join.state == FAST_CONNECT_DIRECTED ? (join.leaseReused ? "cached AP and lease" : "cached AP")
+                                                  : "scan");
+    joining = true;
+}
+
+bool beginSavedWiFi()
+{
+    if (preferences.getString("ssid", "").length() == 0)
+        return false;
+
+    startJoin();
+    return true;
+}
+
+static void finishJoin()
+{
+    FastConnectState state = fastConnectPoll(join, radio, millis());
+    if (state != FAST_CONNECT_CONNECTED && state != FAST_CONNECT_FAILED)
+        return;
+
+    joining = false;
+    traceInstant(TRACE_WIFI_CONNECT);
+
+    if (state == FAST_CONNECT_CONNECTED)
+    {
+        lastConnectMs = millis() - join.startedMs;
+        lastConnectPath = join.path == FAST_CONNECT_DIRECTED ? (join.leaseReused ? "cached_lease" : "cached_ap")
+                                                             : "scan";
+        staticLease = join.leaseReused;
+        saveLinkCache(!join.leaseReused);
+
+        serialLog("✓ Connected in %lu ms via %s. IP: %s, RSSI: %d dBm", lastConnectMs, lastConnectPath,
+                  WiFi.localIP().toString().c_str(), WiFi.RSSI());
+        configured = true;
+        publishWiFiEvent(BUS_WIFI_CONNECTED, WiFi.RSSI());
+    }
+    else
+    {
+        serialLog("✗ Connection failed, entering setup mode");
+        startAPMode();
+    }
 }
 
 void monitorWiFiConnection()
 {
-    extern unsigned long lastWiFiCheck;
-    // extern const unsigned long WIFI_CHECK_INTERVAL;
+    if (joining)
+    {
+        finishJoin();
+        return;
+    }
+
     if (millis() - lastWiFiCheck < WIFI_CHECK_INTERVAL)
     {
         return;
     }
     lastWiFiCheck = millis();
+    TraceScope trace(TRACE_WIFI_CHECK);
 
     if (WiFi.status() != WL_CONNECTED)
     {
-        Serial.println("WiFi disconnected, attempting reconnect...");
-        setConnectionState(DISCONNECTED);
-
-        String savedSSID = preferences.getString("ssid", "");
-        String savedPassword = preferences.getString("password", "");
+        serialLog("WiFi disconnected, attempting reconnect...");
+        publishWiFiEvent(BUS_WIFI_DISCONNECTED);
+        startJoin();
+    }
+    else if (staticLease && !wifiLeaseReusable(linkCache, time(nullptr), currentClockEpoch()))
+    {
+        // A reused lease is never renewed; hand back to DHCP before the
+        // server could give the address away
+        serialLog("Reused lease aged out, renewing over DHCP");
+        staticLease = false;
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    }
+}
 
-        if (!connectToWiFi(savedSSID.c_str(), savedPassword.c_str()))
-        {
-            Serial.println("Reconnection failed, entering setup mode");
-            startAPMode();
-        }
-        else
-        {
-            setConnectionState(CONNECTED);
-        }
+static void onWiFiEvent(arduino_event_id_t event)
+{
+    // Runs on the WiFi event task; only wake the loop from here
+    if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED && !joining)
+    {
+        traceInstant(TRACE_WIFI_DROP);
+        eventLoopSignal(EVENT_WIFI);
+    }
+    else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP && joining)
+    {
+        // Finish the background join without waiting out the loop's timeout
+        eventLoopSignal(EVENT_WIFI);
     }
 }
 
+void wifiManagerBegin()
+{
+    preferences.begin("config", false);
+    WiFi.onEvent(onWiFiEvent);
+}
+
+void requestWiFiCheck()
+{
+    // Make the next monitorWiFiConnection() pass act immediately
+    lastWiFiCheck = millis() - WIFI_CHECK_INTERVAL;
+}
+
 void startAPMode()
 {
-    apModeActive = true;
-    setConnectionState(SETUP_MODE);
+    setupMode = true;
+    publishWiFiEvent(BUS_SETUP_MODE);
 
     char apName[32];
-    sprintf(apName, "PuckPrep P61-%s", deviceId.c_str());
+    sprintf(apName, "PuckPrep P61-%s", deviceShortId());
 
-    Serial.printf("Starting AP: %s\n", apName);
+    serialLog("Starting AP: %s", apName);
 
     WiFi.mode(WIFI_AP);
     WiFi.softAP(apName, AP_PASSWORD);
 
     IPAddress apIP = WiFi.softAPIP();
-    Serial.printf("AP IP: %s\n", apIP.toString().c_str());
+    serialLog("AP IP: %s", apIP.toString().c_str());
 
     dnsServer.start(53, "*", apIP);
 
@@ -95,18 +291,23 @@ void startAPMode()
     server.onNotFound(handleRoot);
 
     server.begin();
-    Serial.println("Setup portal ready at http://192.168.4.1");
+    serialLog("Setup portal ready at http://192.168.4.1");
+}
+
+void serviceSetupPortal()
+{
+    dnsServer.processNextRequest();
+    server.handleClient();
 }
 
-void handleRoot()
+static void handleRoot()
 {
-    extern String deviceSerialNumber;
     String html = String(setupPortalHtml);
-    html.replace("%SERIAL_NUMBER%", deviceSerialNumber);
+    html.replace("%SERIAL_NUMBER%", deviceSerialNumber());
     server.send(200, "text/html", html);
 }
 
-void handleScan()
+static void handleScan()
 {
     int n = WiFi.scanNetworks();
     String json = "[";
@@ -123,12 +324,13 @@ void handleScan()
     WiFi.scanDelete();
 }
 
-void handleConnect()
+static void handleConnect()
 {
     String ssid = server.arg("ssid");
     String password = server.arg("password");
 
     WiFi.mode(WIFI_STA);
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
     WiFi.begin(ssid.c_str(), password.c_str());
 
     int attempts = 0;
@@ -142,15 +344,17 @@ void handleConnect()
     {
         preferences.putString("ssid", ssid);
         preferences.putString("password", password);
+        staticLease = false;
+        saveLinkCache(true);
 
         String json = "{\"success\":true,\"ip\":\"" + WiFi.localIP().toString() + "\"}";
         server.send(200, "application/json", json);
 
         delay(1000);
 
-        apModeActive = false;
-        wifiConfigured = true;
-        setConnectionState(CONNECTED);
+        setupMode = false;
+        configured = true;
+        publishWiFiEvent(BUS_WIFI_CONNECTED, WiFi.RSSI());
 
         dnsServer.stop();
         server.stop();
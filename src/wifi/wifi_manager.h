@@ -1,18 +1,23 @@
 #pragma once
 #include <Arduino.h>
-#include <WebServer.h>
-#include <DNSServer.h>
-#include "common/connection_state.h"
 
-bool connectToWiFi(const char *ssid, const char *password);
+// Opens the WiFi settings and hooks WiFi events; call once from setup()
+void wifiManagerBegin();
+
+bool beginSavedWiFi(); // Starts joining the saved network; false if none is saved
+bool wifiJoining();
+
+// How long the last successful join took, and whether it used the cached
+// AP ("cached_ap"), the cached AP and lease ("cached_lease") or a "scan"
+unsigned long wifiLastConnectMs();
+const char *wifiLastConnectPath();
+
+bool wifiIsConfigured();
+bool wifiSetupModeActive();
 void monitorWiFiConnection();
+void requestWiFiCheck();
 void startAPMode();
-void handleRoot();
-void handleScan();
-void handleConnect();
 
-extern WebServer server;
-extern DNSServer dnsServer;
-extern bool wifiConfigured;
-extern bool apModeActive;
-extern void setConnectionState(ConnectionState state);
+// Answers the captive portal's DNS and HTTP requests; polled by the loop
+// while setup mode is active
+void serviceSetupPortal();
@@ -0,0 +1,260 @@
+// Replays a roast through src/telemetry/adaptive_rate.cpp on a host. The
+// sampler reads the series at whatever interval the controller asks for,
+// and probes it every min_rate_ms in between as the firmware loop does;
+// probes are not samples. The samples taken are then joined by straight
+// lines and compared with every row of the full series. Reports samples
+// saved against a fixed fast rate, and checks the error against a fixed
+// rate taking the same number of samples. From the repository root:
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/adaptive_rate_replay.cpp
+//       src/telemetry/adaptive_rate.cpp src/telemetry/downsample.cpp
+//       -o adaptive_rate_replay
+//   ./adaptive_rate_replay [trace]
+//
+// trace is a recorded series as read by roast_trace.h, ideally logged at a
+// fast fixed rate. Without one, a synthetic one-hour roast at 10 Hz is
+// used. The controller checks run first either way.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "check.h"
+#include "roast_trace.h"
+#include "telemetry/adaptive_rate.h"
+
+static const AdaptiveRateConfig defaults = {true, 500, 5000, 0.5f, 0.05f};
+
+struct Replay
+{
+    std::vector<SeriesPoint> taken;
+    std::vector<uint32_t> intervals; // Interval chosen after each sample
+};
+
+static TemperatureSample readAt(const Series &series, uint32_t t)
+{
+    TemperatureSample sample = {};
+    sample.timestamp = t;
+    sample.channelCount = series.channels;
+    for (uint8_t ch = 0; ch < MAX_THERMOCOUPLE_CHANNELS; ch++)
+        sample.temperatureC[ch] = ch < series.channels ? seriesAt(series, ch, t) : NAN;
+    return sample;
+}
+
+// Samples series from its first row to its last at the controller's pace.
+// fixedMs > 0 bypasses the controller.
+static Replay replay(const Series &series, const AdaptiveRateConfig &config, uint32_t fixedMs = 0)
+{
+    configureAdaptiveRate(config);
+    Replay run;
+    auto take = [&](const TemperatureSample &sample)
+    {
+        SeriesPoint point;
+        point.timestampMs = sample.timestamp;
+        std::copy(sample.temperatureC, sample.temperatureC + MAX_THERMOCOUPLE_CHANNELS, point.temperatureC);
+        uint32_t interval = fixedMs ? fixedMs : adaptiveRateUpdate(sample);
+        run.taken.push_back(point);
+        run.intervals.push_back(interval);
+        return interval;
+    };
+
+    uint32_t end = series.rows.back().timestampMs;
+    uint32_t t = series.rows.front().timestampMs;
+    while (t <= end)
+    {
+        uint32_t next = t + take(readAt(series, t));
+
+        // The loop probes every min_rate_ms. On a trip it samples at once,
+        // after the last quiet probe, which marks where the change began.
+        bool quiet = false;
+        TemperatureSample lastQuiet;
+        for (uint32_t probe = t + config.minIntervalMs; !fixedMs && probe < next && probe <= end;
+             probe += config.minIntervalMs)
+        {
+            TemperatureSample reading = readAt(series, probe);
+            if (adaptiveRateProbe(reading))
+            {
+                if (quiet)
+                    take(lastQuiet);
+                next = probe;
+                break;
+            }
+            lastQuiet = reading;
+            quiet = true;
+        }
+        t = next;
+    }
+    return run;
+}
+
+struct Fidelity
+{
+    double maxErrorC;
+    double rmsErrorC;
+};
+
+// The taken samples joined by straight lines, against every source row
+static Fidelity fidelity(const Series &series, const std::vector<SeriesPoint> &taken)
+{
+    Series sampled;
+    sampled.rows = taken;
+    sampled.channels = series.channels;
+
+    double worst = 0, sumSq = 0;
+    size_t compared = 0;
+    for (const SeriesPoint &row : series.rows)
+    {
+        if (row.timestampMs > taken.back().timestampMs)
+            break;
+        for (uint8_t ch = 0; ch < series.channels; ch++)
+        {
+            double rebuilt = seriesAt(sampled, ch, row.timestampMs);
+            if (std::isnan(rebuilt) || std::isnan(row.temperatureC[ch]))
+                continue;
+            double error = std::fabs(rebuilt - row.temperatureC[ch]);
+            worst = std::max(worst, error);
+            sumSq += error * error;
+            compared++;
+        }
+    }
+    return {worst, compared ? std::sqrt(sumSq / compared) : 0};
+}
+
+// One noiseless channel at 100 ms resolution from a function of seconds
+template <typename Shape>
+static Series shaped(uint32_t seconds, Shape shape)
+{
+    Series series;
+    series.channels = 1;
+    for (uint32_t t = 0; t <= seconds * 1000; t += 100)
+    {
+        SeriesPoint row;
+        row.timestampMs = t;
+        row.temperatureC[0] = shape(t / 1000.0f);
+        row.temperatureC[1] = row.temperatureC[2] = row.temperatureC[3] = NAN;
+        series.rows.push_back(row);
+    }
+    return series;
+}
+
+static void checkController()
+{
+    // A ramp above the slope threshold holds the fast rate throughout; the
+    // samples inside each 2 s baseline used to back it off between slopes
+    Series ramp = shaped(300, [](float s) { return 100.0f + 1.0f * s; });
+    Replay run = replay(ramp, defaults);
+    uint32_t slowest = 0;
+    for (uint32_t interval : run.intervals)
+        slowest = std::max(slowest, interval);
+    expect(slowest == defaults.minIntervalMs, "steady 1 C/s ramp stays at the fast rate");
+
+    // A plateau backs off to the slowest rate and stays there
+    Series plateau = shaped(600, [](float) { return 215.0f; });
+    run = replay(plateau, defaults);
+    expect(run.intervals.back() == defaults.maxIntervalMs, "plateau backs off to max_rate_ms");
+
+    // Back-off only moves on samples that closed a baseline: it never
+    // grows twice within SLOPE_BASELINE_MS
+    uint32_t previous = run.intervals[0], lastGrowthMs = 0;
+    bool paced = true;
+    for (size_t i = 1; i < run.intervals.size(); i++)
+    {
+        if (run.intervals[i] > previous)
+        {
+            uint32_t at = run.taken[i].timestampMs;
+            paced = paced && (lastGrowthMs == 0 || at - lastGrowthMs >= 2000);
+            lastGrowthMs = at;
+        }
+        previous = run.intervals[i];
+    }
+    expect(paced, "interval grows at most once per 2 s baseline");
+
+    // Plateau then charge: a probe catches it, so the fast rate is back
+    // within a baseline instead of after the slow interval in progress
+    Series charge = shaped(900, [](float s) { return s < 600 ? 215.0f : 215.0f - 2.0f * (s - 600); });
+    run = replay(charge, defaults);
+    uint32_t fastAtMs = 0;
+    for (size_t i = 0; i < run.taken.size(); i++)
+    {
+        if (run.taken[i].timestampMs > 600000 && run.intervals[i] == defaults.minIntervalMs)
+        {
+            fastAtMs = run.taken[i].timestampMs;
+            break;
+        }
+    }
+    char what[80];
+    snprintf(what, sizeof(what), "charge after a plateau reaches the fast rate (%.1f s)", (fastAtMs - 600000) / 1000.0);
+    expect(fastAtMs > 600000 && fastAtMs - 600000 <= 2000, what);
+}
+
+// With checkFixed, adaptive must also have the smaller max error of the
+// two runs taking the same number of samples
+static void evaluate(const Series &series, const char *label, const AdaptiveRateConfig &config,
+                     bool checkFixed)
+{
+    Replay adaptive = replay(series, config);
+    Replay fast = replay(series, config, config.minIntervalMs);
+
+    // A fixed interval taking about as many samples as the adaptive run
+    uint32_t spanMs = series.rows.back().timestampMs - series.rows.front().timestampMs;
+    uint32_t equalMs = spanMs / (adaptive.taken.size() > 1 ? adaptive.taken.size() - 1 : 1);
+    Replay equal = replay(series, config, equalMs);
+
+    Fidelity a = fidelity(series, adaptive.taken);
+    Fidelity f = fidelity(series, fast.taken);
+    Fidelity e = fidelity(series, equal.taken);
+    printf("%s (slope %.2f C/s, accel %.3f C/s^2, %u-%u ms)\n", label, config.slopeThreshold, config.accelThreshold,
+           (unsigned)config.minIntervalMs, (unsigned)config.maxIntervalMs);
+    printf("  fixed %5u ms  %6zu samples             max %5.2f C rms %.3f C\n", (unsigned)config.minIntervalMs,
+           fast.taken.size(), f.maxErrorC, f.rmsErrorC);
+    printf("  adaptive       %6zu samples (%4.1f%% saved) max %5.2f C rms %.3f C\n", adaptive.taken.size(),
+           100.0 * (1.0 - (double)adaptive.taken.size() / fast.taken.size()), a.maxErrorC, a.rmsErrorC);
+    printf("  fixed %5u ms  %6zu samples             max %5.2f C rms %.3f C\n", (unsigned)equalMs,
+           equal.taken.size(), e.maxErrorC, e.rmsErrorC);
+
+    if (checkFixed)
+    {
+        char what[80];
+        snprintf(what, sizeof(what), "%s: max %.2f C < %.2f C fixed, same samples", label, a.maxErrorC,
+                 e.maxErrorC);
+        expect(a.maxErrorC < e.maxErrorC, what);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    checkController();
+    printf("\n");
+
+    Series series;
+    const char *source = "synthetic 1 h roast at 10 Hz";
+    if (argc >= 2)
+    {
+        if (!loadTrace(argv[1], series))
+        {
+            fprintf(stderr, "no data rows in %s\n", argv[1]);
+            return 1;
+        }
+        source = argv[1];
+    }
+    else
+    {
+        series = syntheticRoast();
+    }
+    printf("%s: %zu rows, %u channel(s)\n", source, series.rows.size(), series.channels);
+
+    evaluate(series, "defaults", defaults, true);
+    AdaptiveRateConfig loose = defaults;
+    loose.slopeThreshold = 1.0f;
+    loose.accelThreshold = 0.2f;
+    evaluate(series, "loose", loose, true);
+    // With max_rate_ms near min_rate_ms few probes fit between samples,
+    // so a charge can land inside one interval unseen, as with a fixed
+    // rate; reported, not checked
+    AdaptiveRateConfig capped = defaults;
+    capped.maxIntervalMs = 2000;
+    evaluate(series, "capped", capped, false);
+    printCheckResult();
+    return checkExitCode();
+}
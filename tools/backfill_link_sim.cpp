@@ -0,0 +1,266 @@
+// Store-and-forward over a simulated serial link. Samples taken during a
+// host outage go into the backfill ring (the real
+// src/telemetry/sample_ring.cpp); on reconnect the loop replays it as
+// data_backfill frames between live data frames, pacing on the telemetry
+// ring (the real src/serial/tx_ring.cpp) the way the loop paces on
+// txTelemetryBacklogged(). The writer drains that ring onto a UART at the
+// baud rate, one frame on the wire at a time. Frame lengths are the
+// firmware's own encodings.
+//
+// A simulated host receives every frame and checks that each sample
+// arrives exactly once and in order. It reports how long the backlog
+// takes to drain, how much of the link the replay uses, and how long live
+// samples wait behind it. From the repository root:
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/backfill_link_sim.cpp
+//       src/telemetry/sample_ring.cpp src/serial/tx_ring.cpp -o backfill_link_sim
+//   ./backfill_link_sim
+//
+// The loop's pass time is an assumption, not a measurement; see below.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "check.h"
+#include "common/temperature_sample.h"
+#include "protocol/protocol.h"
+#include "serial/tx_ring.h"
+#include "telemetry/sample_ring.h"
+
+static const uint32_t SAMPLE_PERIOD_MS = 1000;
+static const uint8_t CHANNELS = 4;
+static const size_t BACKFILL_SLOTS = 16384;      // BACKFILL_SLOTS_PSRAM
+static const uint16_t BACKFILL_FRAME_SAMPLES = 16;
+static const size_t TELEMETRY_RING_SIZE = 16384;
+static const size_t BACKLOG_BYTES = TELEMETRY_RING_SIZE / 4; // txTelemetryBacklogged()
+static const double BACKLOGGED_WAKE_US = 5000;               // calculateWakeTimeout()
+static const double PASS_US = 1000;                          // Loop pass that encodes one frame
+static const char *const DEVICE_ID = "P61-A1B2C3D4E5F6";
+
+static TemperatureSample sampleAt(uint32_t index)
+{
+    TemperatureSample s = {};
+    s.timestamp = 60000 + index * SAMPLE_PERIOD_MS;
+    s.deviceTimeUs = (int64_t)s.timestamp * 1000;
+    s.channelCount = CHANNELS;
+    for (uint8_t ch = 0; ch < CHANNELS; ch++)
+        s.temperatureC[ch] = 180.0f + (index % 700) * 0.05f + ch * 12.5f;
+    return s;
+}
+
+// As transmitSample() encodes it
+static size_t liveFrameLength(const TemperatureSample &s, uint32_t sequence)
+{
+    DataMessage msg = {};
+    msg.deviceId = protoSpan(DEVICE_ID);
+    msg.firmwareVersion = protoSpan("1.4.0");
+    msg.metadata.timestamp = s.timestamp;
+    msg.metadata.samplingRateMs = SAMPLE_PERIOD_MS;
+    msg.metadata.sequence = sequence;
+    msg.metadata.keyframe = true;
+    msg.metadata.hasHostTime = true;
+    msg.metadata.hostTimeUs = 1700000000000000LL + s.deviceTimeUs;
+    msg.channelCount = s.channelCount;
+    for (uint8_t ch = 0; ch < s.channelCount; ch++)
+        msg.channels[ch] = {(uint8_t)(ch + 1), true, s.temperatureC[ch], 0};
+    char frame[PROTO_DATA_FRAME_MAX];
+    return encodeDataMessage(msg, frame, sizeof(frame)) + 2;
+}
+
+// As sendBackfillFrame() encodes it
+static size_t backfillFrameLength(const TemperatureSample *samples, uint16_t count, const SampleRing &ring)
+{
+    static char frame[16384];
+    ProtoWriter w;
+    protoWriterInit(w, frame, sizeof(frame));
+    protoBeginObject(w);
+    protoKey(w, "type");
+    protoString(w, protoSpan("data_backfill"));
+    protoKey(w, "device_id");
+    protoString(w, protoSpan(DEVICE_ID));
+    protoKey(w, "firmware_version");
+    protoString(w, protoSpan("1.4.0"));
+    protoKey(w, "metadata");
+    protoBeginObject(w);
+    protoKey(w, "timestamp");
+    protoInt(w, (uint32_t)samples[0].timestamp);
+    protoKey(w, "sample_count");
+    protoInt(w, count);
+    protoKey(w, "backfill");
+    protoBool(w, true);
+    protoKey(w, "remaining");
+    protoInt(w, (uint32_t)ring.count);
+    protoKey(w, "dropped");
+    protoInt(w, ring.dropped);
+    protoKey(w, "host_time_us");
+    protoInt(w, 1700000000000000LL + samples[0].deviceTimeUs);
+    return protoFinishSampleColumns(w, samples, count) + 2;
+}
+
+// What the ring holds for each frame, padded to the encoded length
+struct Frame
+{
+    bool backfill;
+    uint32_t firstIndex; // Sample index of the first (or only) sample
+    uint16_t count;
+    double takenUs; // Sample time, live frames only
+};
+
+struct Result
+{
+    double drainS;        // Reconnect to the last backfill byte on the wire
+    double replayShare;   // Of the link while draining
+    double liveP99Ms;     // Sample to last byte on the wire
+    double liveMaxMs;
+    uint32_t overflowed;  // Oldest samples the ring overwrote
+    uint32_t telemetryDropped;
+    bool exactlyOnce;
+};
+
+static double percentile(std::vector<double> values, double p)
+{
+    std::sort(values.begin(), values.end());
+    return values[(size_t)(p * (values.size() - 1))];
+}
+
+static Result simulate(double bytesPerSecond, uint32_t outageSamples)
+{
+    const double byteUs = 1e6 / bytesPerSecond;
+    static TemperatureSample storage[BACKFILL_SLOTS];
+    SampleRing backfill;
+    sampleRingInit(backfill, storage, BACKFILL_SLOTS);
+    for (uint32_t i = 0; i < outageSamples; i++)
+        sampleRingPush(backfill, sampleAt(i));
+
+    static uint8_t telemetryStorage[TELEMETRY_RING_SIZE];
+    TxRing telemetry;
+    txRingInit(telemetry, telemetryStorage, TELEMETRY_RING_SIZE);
+
+    Result result = {};
+    result.overflowed = backfill.dropped;
+    result.exactlyOnce = true;
+    std::vector<double> liveMs;
+    uint32_t nextBackfill = backfill.dropped; // Oldest sample the host should get next
+    uint32_t nextLive = outageSamples;
+    uint32_t sequence = 0;
+    double wireFreeUs = 0, backfillBytes = 0, lastBackfillUs = 0;
+
+    // Writer: frames go on the wire one after the other until untilUs
+    auto runWriter = [&](double untilUs)
+    {
+        const uint8_t *bytes;
+        size_t length;
+        while (wireFreeUs <= untilUs && (length = txRingPeek(telemetry, &bytes)) > 0)
+        {
+            Frame frame;
+            memcpy(&frame, bytes, sizeof(frame));
+            txRingPop(telemetry);
+            wireFreeUs += length * byteUs;
+
+            // The host checks each stream arrives in order, with no gaps
+            uint32_t &expected = frame.backfill ? nextBackfill : nextLive;
+            result.exactlyOnce = result.exactlyOnce && frame.firstIndex == expected;
+            expected = frame.firstIndex + frame.count;
+            if (frame.backfill)
+            {
+                backfillBytes += length;
+                lastBackfillUs = wireFreeUs;
+            }
+            else
+                liveMs.push_back((wireFreeUs - frame.takenUs) / 1000);
+        }
+        wireFreeUs = std::max(wireFreeUs, untilUs);
+    };
+
+    auto push = [&](const Frame &frame, size_t length)
+    {
+        uint8_t *slot = txRingPush(telemetry, length, TX_DROP_OLDEST);
+        if (slot)
+            memcpy(slot, &frame, sizeof(frame));
+    };
+
+    // The host reconnects at 0. The loop samples on the period and replays
+    // one backfill frame per pass while the ring is not backlogged, and
+    // runs on for a few periods once the backlog is out.
+    double nextSampleUs = 0, endUs = -1;
+    uint32_t live = outageSamples;
+    for (double now = 0; endUs < 0 || now < endUs;)
+    {
+        runWriter(now);
+        if (now >= nextSampleUs)
+        {
+            push({false, live, 1, now}, liveFrameLength(sampleAt(live), sequence++));
+            live++;
+            nextSampleUs += SAMPLE_PERIOD_MS * 1000.0;
+        }
+        if (backfill.count > 0 && telemetry.used <= BACKLOG_BYTES)
+        {
+            TemperatureSample frame[BACKFILL_FRAME_SAMPLES];
+            uint16_t count = sampleRingTake(backfill, frame, BACKFILL_FRAME_SAMPLES);
+            uint32_t firstIndex = (uint32_t)((frame[0].timestamp - sampleAt(0).timestamp) / SAMPLE_PERIOD_MS);
+            push({true, firstIndex, count, 0}, backfillFrameLength(frame, count, backfill));
+            now += PASS_US;
+        }
+        else if (backfill.count > 0)
+            now += BACKLOGGED_WAKE_US;
+        else
+        {
+            if (endUs < 0)
+                endUs = now + 5.0 * SAMPLE_PERIOD_MS * 1000;
+            now = nextSampleUs;
+        }
+    }
+    runWriter(1e18);
+
+    result.drainS = lastBackfillUs / 1e6;
+    result.replayShare = lastBackfillUs > 0 ? backfillBytes * byteUs / lastBackfillUs : 0;
+    result.liveP99Ms = percentile(liveMs, 0.99);
+    result.liveMaxMs = percentile(liveMs, 1.0);
+    result.telemetryDropped = telemetry.dropped;
+    result.exactlyOnce = result.exactlyOnce && nextBackfill == outageSamples;
+    return result;
+}
+
+int main()
+{
+    struct Link
+    {
+        const char *name;
+        double bytesPerSecond;
+    };
+    const Link links[] = {{"UART 115200", 11520}, {"UART 921600", 92160}};
+    const struct
+    {
+        const char *name;
+        uint32_t samples;
+    } outages[] = {{"10 min", 600}, {"1 h", 3600}, {"4 h", 14400}, {"5.5 h", 19800}};
+
+    printf("%u channels every %u ms, %u samples per backfill frame, %zu-sample buffer\n", CHANNELS, SAMPLE_PERIOD_MS,
+           BACKFILL_FRAME_SAMPLES, BACKFILL_SLOTS);
+    printf("%-12s %-7s %9s %8s %11s %11s %10s %6s\n", "link", "outage", "drain", "replay", "live p99", "live max",
+           "overflowed", "shed");
+    for (const Link &link : links)
+    {
+        for (const auto &outage : outages)
+        {
+            Result r = simulate(link.bytesPerSecond, outage.samples);
+            printf("%-12s %-7s %7.1f s %7.0f%% %8.0f ms %8.0f ms %10u %6u\n", link.name, outage.name, r.drainS,
+                   100 * r.replayShare, r.liveP99Ms, r.liveMaxMs, r.overflowed, r.telemetryDropped);
+
+            char what[80];
+            snprintf(what, sizeof(what), "%s, %s: every sample once, in order", link.name, outage.name);
+            expect(r.exactlyOnce && r.telemetryDropped == 0, what);
+            snprintf(what, sizeof(what), "%s, %s: live frames within one period", link.name, outage.name);
+            expect(r.liveMaxMs < SAMPLE_PERIOD_MS, what);
+            if (outage.samples > BACKFILL_SLOTS)
+            {
+                snprintf(what, sizeof(what), "%s, %s: only the oldest %u samples lost", link.name, outage.name,
+                         outage.samples - (uint32_t)BACKFILL_SLOTS);
+                expect(r.overflowed == outage.samples - BACKFILL_SLOTS, what);
+            }
+        }
+    }
+    printCheckResult();
+    return checkExitCode();
+}
@@ -0,0 +1,203 @@
+// Bytes and frames per second for per-sample data frames against
+// data_batch frames, encoded with the firmware's own writers
+// (src/protocol/protocol.h). For each batch size it reports wire bytes per
+// sample, frames and bytes per second at the fastest sampling rate, the
+// highest rate each format fits into a 115200 and a 921600 baud link, and
+// host-side encode and parse time per sample, then checks that a deadband
+// channel mask leaves out the columns it excludes. From the repository root:
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/batch_throughput.cpp -o batch_throughput
+//   ./batch_throughput
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "common/temperature_sample.h"
+#include "protocol/protocol.h"
+
+static const int SAMPLE_PERIOD_MS = 100; // Fastest sampling rate
+static const double UART_115200 = 11520; // Bytes per second, 8N1
+static const double UART_921600 = 92160;
+static const char *const DEVICE_ID = "P61-A1B2C3D4E5F6";
+
+// A ramping roast with probe noise, two decimals of signal like the wire
+static std::vector<TemperatureSample> roast(size_t count, uint8_t channels)
+{
+    std::mt19937 rng(26);
+    std::normal_distribution<float> noise(0.0f, 0.3f);
+    std::vector<TemperatureSample> samples(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        TemperatureSample &s = samples[i];
+        s = {};
+        s.timestamp = 3600000 + i * SAMPLE_PERIOD_MS;
+        s.deviceTimeUs = (int64_t)s.timestamp * 1000;
+        s.channelCount = channels;
+        for (uint8_t ch = 0; ch < channels; ch++)
+            s.temperatureC[ch] = 150.0f + i * 0.01f + ch * 12.5f + noise(rng);
+    }
+    return samples;
+}
+
+static size_t encodeSingle(const TemperatureSample &s, uint32_t sequence, char *buffer, size_t capacity)
+{
+    DataMessage msg = {};
+    msg.deviceId = protoSpan(DEVICE_ID);
+    msg.firmwareVersion = protoSpan("1.4.0");
+    msg.metadata.timestamp = s.timestamp;
+    msg.metadata.samplingRateMs = SAMPLE_PERIOD_MS;
+    msg.metadata.sequence = sequence;
+    msg.metadata.keyframe = true;
+    msg.metadata.hasHostTime = true;
+    msg.metadata.hostTimeUs = 1700000000000000LL + s.deviceTimeUs;
+    msg.channelCount = s.channelCount;
+    for (uint8_t ch = 0; ch < s.channelCount; ch++)
+        msg.channels[ch] = {(uint8_t)(ch + 1), true, s.temperatureC[ch], 0};
+    return encodeDataMessage(msg, buffer, capacity);
+}
+
+// As flushSampleBatch() writes it
+static size_t encodeBatch(const TemperatureSample *samples, uint16_t count, uint32_t sequence, char *buffer,
+                          size_t capacity, uint8_t channelMask = 0xFF)
+{
+    ProtoWriter w;
+    protoWriterInit(w, buffer, capacity);
+    protoBeginObject(w);
+    protoKey(w, "type");
+    protoString(w, protoSpan("data_batch"));
+    protoKey(w, "device_id");
+    protoString(w, protoSpan(DEVICE_ID));
+    protoKey(w, "firmware_version");
+    protoString(w, protoSpan("1.4.0"));
+    protoKey(w, "metadata");
+    protoBeginObject(w);
+    protoKey(w, "timestamp");
+    protoInt(w, (uint32_t)samples[0].timestamp);
+    protoKey(w, "sampling_rate_ms");
+    protoInt(w, SAMPLE_PERIOD_MS);
+    protoKey(w, "sample_count");
+    protoInt(w, count);
+    protoKey(w, "sequence");
+    protoInt(w, sequence);
+    protoKey(w, "host_time_us");
+    protoInt(w, 1700000000000000LL + samples[0].deviceTimeUs);
+    return protoFinishSampleColumns(w, samples, count, channelMask);
+}
+
+struct Encoded
+{
+    std::vector<char> bytes;
+    std::vector<size_t> frameEnds; // Line terminators included
+};
+
+static Encoded encodeAll(const std::vector<TemperatureSample> &samples, uint16_t batch)
+{
+    Encoded out;
+    char frame[16384];
+    uint32_t sequence = 0;
+    for (size_t i = 0; i < samples.size(); i += batch)
+    {
+        uint16_t count = (uint16_t)std::min<size_t>(batch, samples.size() - i);
+        size_t length = batch == 1 ? encodeSingle(samples[i], sequence++, frame, sizeof(frame))
+                                   : encodeBatch(&samples[i], count, sequence++, frame, sizeof(frame));
+        out.bytes.insert(out.bytes.end(), frame, frame + length);
+        out.bytes.push_back('\r');
+        out.bytes.push_back('\n');
+        out.frameEnds.push_back(out.bytes.size());
+    }
+    return out;
+}
+
+template <typename Work>
+static double nsPer(size_t items, int rounds, Work work)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+        work();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds * 1e9 / ((double)items * rounds);
+}
+
+int main()
+{
+    const size_t count = 6400;
+    const uint16_t batches[] = {1, 2, 5, 10, 20, 64};
+
+    for (uint8_t channels : {1, 4})
+    {
+        std::vector<TemperatureSample> samples = roast(count, channels);
+        printf("%u channel(s), one sample every %d ms\n", channels, SAMPLE_PERIOD_MS);
+        printf("  %-6s %9s %9s %9s %11s %11s %10s %10s\n", "batch", "B/sample", "frames/s", "B/s", "max Hz 115k",
+               "max Hz 921k", "enc ns/smp", "parse ns/smp");
+
+        double single = 0;
+        for (uint16_t batch : batches)
+        {
+            Encoded encoded = encodeAll(samples, batch);
+            double perSample = (double)encoded.bytes.size() / count;
+            double samplesPerSecond = 1000.0 / SAMPLE_PERIOD_MS;
+
+            // Every frame must scan as one complete JSON value
+            bool parsed = true;
+            size_t begin = 0;
+            for (size_t end : encoded.frameEnds)
+            {
+                ProtoCursor c = {encoded.bytes.data() + begin, encoded.bytes.data() + end - 2};
+                parsed = parsed && protoSkipValue(c) && c.p == c.end;
+                begin = end;
+            }
+
+            volatile size_t sink = 0;
+            double encodeNs = nsPer(count, 20, [&] { sink = sink + encodeAll(samples, batch).bytes.size(); });
+            double parseNs = nsPer(count, 20,
+                                   [&]
+                                   {
+                                       size_t from = 0;
+                                       for (size_t end : encoded.frameEnds)
+                                       {
+                                           ProtoCursor c = {encoded.bytes.data() + from,
+                                                            encoded.bytes.data() + end - 2};
+                                           sink = sink + protoSkipValue(c);
+                                           from = end;
+                                       }
+                                   });
+
+            printf("  %-6u %9.1f %9.2f %9.0f %11.1f %11.1f %10.0f %10.0f\n", batch, perSample,
+                   samplesPerSecond / batch, perSample * samplesPerSecond, UART_115200 / perSample,
+                   UART_921600 / perSample, encodeNs, parseNs);
+
+            char what[80];
+            snprintf(what, sizeof(what), "%u ch, batch %u: %zu frames all parse", channels, batch,
+                     encoded.frameEnds.size());
+            expect(parsed && encoded.frameEnds.size() == (count + batch - 1) / batch, what);
+            if (batch == 1)
+                single = perSample;
+            if (batch == 10)
+            {
+                snprintf(what, sizeof(what), "%u ch, batch 10: %.0f%% of the per-sample bytes", channels,
+                         100 * perSample / single);
+                expect(perSample < 0.6 * single, what);
+            }
+        }
+    }
+
+    // Deadband leaves out the columns of channels unchanged in the batch
+    std::vector<TemperatureSample> samples = roast(10, 4);
+    char frame[4096];
+    size_t full = encodeBatch(samples.data(), 10, 0, frame, sizeof(frame));
+    size_t length = encodeBatch(samples.data(), 10, 0, frame, sizeof(frame), 0x05);
+    std::string masked(frame, length);
+    ProtoCursor c = {frame, frame + length};
+    printf("4 channels, batch 10: %zu bytes, %zu with channels 1 and 3 only\n", full, length);
+    expect(protoSkipValue(c) && c.p == c.end && masked.find("\"channel\":1,") != std::string::npos &&
+               masked.find("\"channel\":3,") != std::string::npos &&
+               masked.find("\"channel\":2,") == std::string::npos &&
+               masked.find("\"channel\":4,") == std::string::npos,
+           "deadband mask 0b0101: columns for channels 1 and 3 only");
+    printCheckResult();
+    return checkExitCode();
+}
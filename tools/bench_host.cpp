@@ -0,0 +1,62 @@
+// Runs the portable run_benchmark kernels on a Linux host, for comparing a
+// unit's results against a known machine. Prints the same result objects
+// the device returns.
+//
+// Needs ArduinoJson 7 and mbedtls (2.x or 3.x) headers and libraries.
+// From the repository root:
+//
+//   g++ -std=gnu++17 -O2 -Isrc -I<ArduinoJson>/src -o bench_host
+//       tools/bench_host.cpp src/diagnostics/bench_kernels.cpp
+//       src/config/config.cpp -lmbedcrypto
+//   ./bench_host
+
+#include <cstdio>
+#include <string>
+#include <ArduinoJson.h>
+#include "config/config.h"
+#include "diagnostics/bench_kernels.h"
+
+static const uint16_t SERIALIZE_ITERATIONS = 100;
+static const uint16_t SHA_ITERATIONS = 32;
+static const uint16_t RSA_ITERATIONS = 16;
+
+// Same shape as the device's four-channel keyframe
+static void buildFrame(DataMessage &msg)
+{
+    msg = {};
+    msg.deviceId = protoSpan("HOST-BASELINE");
+    msg.firmwareVersion = protoSpan(FIRMWARE_VERSION);
+    msg.metadata.timestamp = 123456;
+    msg.metadata.samplingRateMs = 1000;
+    msg.metadata.keyframe = true;
+    msg.metadata.hasHostTime = true;
+    msg.metadata.hostTimeUs = 1700000000000000LL;
+
+    msg.channelCount = PROTO_MAX_CHANNELS;
+    for (uint8_t i = 0; i < PROTO_MAX_CHANNELS; i++)
+    {
+        msg.channels[i] = {(uint8_t)(i + 1), true, 201.25f + i, 0};
+    }
+}
+
+int main()
+{
+    DataMessage frame;
+    buildFrame(frame);
+
+    JsonDocument doc;
+    doc["type"] = "benchmark";
+    JsonObject payload = doc["payload"].to<JsonObject>();
+    payload["firmware_version"] = FIRMWARE_VERSION;
+    payload["platform"] = "linux";
+
+    JsonArray results = payload["results"].to<JsonArray>();
+    writeBenchResult(results, benchSerializeFrame(frame, SERIALIZE_ITERATIONS));
+    writeBenchResult(results, benchSha256(SHA_ITERATIONS));
+    writeBenchResult(results, benchRsaVerify(FIRMWARE_SIGNING_PUBLIC_KEY, RSA_ITERATIONS));
+
+    std::string output;
+    serializeJsonPretty(doc, output);
+    printf("%s\n", output.c_str());
+    return 0;
+}
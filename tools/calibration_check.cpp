@@ -0,0 +1,334 @@
+// Host checks for src/sensors/calibration.cpp: accuracy of the fixed-point
+// curve against a double-precision reference, validation of uploaded
+// points, the calibration ID, and the cost per sample. A full 16-point
+// set_calibration line is also taken through the command line reader
+// (src/serial/line_reader.cpp) at COMMAND_MAX_LENGTH and parsed, with the
+// JSON reader in protocol.h standing in for the firmware's ArduinoJson.
+// From the repository root:
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/calibration_check.cpp
+//       src/sensors/calibration.cpp src/serial/line_reader.cpp -o calibration_check
+//   ./calibration_check        # accuracy and validation
+//   ./calibration_check bench  # also time the cost per reading
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include "check.h"
+#include "protocol/protocol.h"
+#include "sensors/calibration.h"
+#include "serial/command_channel.h"
+#include "serial/line_reader.h"
+
+static CalibrationPoints makePoints(std::initializer_list<std::pair<double, double>> pairs)
+{
+    CalibrationPoints points = {};
+    for (const auto &pair : pairs)
+    {
+        points.rawMilliC[points.count] = (int32_t)lround(pair.first * 1000);
+        points.actualMilliC[points.count] = (int32_t)lround(pair.second * 1000);
+        points.count++;
+    }
+    return points;
+}
+
+// Straightforward interpolation in double, extending the end segments
+static double reference(const CalibrationPoints &points, double rawMilliC)
+{
+    if (points.count == 1)
+        return rawMilliC + points.actualMilliC[0] - points.rawMilliC[0];
+
+    int segment = 0;
+    while (segment < points.count - 2 && rawMilliC >= points.rawMilliC[segment + 1])
+        segment++;
+    double x0 = points.rawMilliC[segment], x1 = points.rawMilliC[segment + 1];
+    double y0 = points.actualMilliC[segment], y1 = points.actualMilliC[segment + 1];
+    return y0 + (rawMilliC - x0) * (y1 - y0) / (x1 - x0);
+}
+
+// A plausible probe correction: a few degrees, smoothly varying
+static CalibrationPoints randomPoints(std::mt19937 &rng)
+{
+    CalibrationPoints points = {};
+    points.count = 1 + rng() % CALIBRATION_MAX_POINTS;
+    int32_t raw = -50000 + (int32_t)(rng() % 100000);
+    int32_t offset = (int32_t)(rng() % 10000) - 5000;
+    for (uint8_t i = 0; i < points.count; i++)
+    {
+        points.rawMilliC[i] = raw;
+        points.actualMilliC[i] = raw + offset;
+        int32_t step = 1000 + rng() % 120000;
+        int32_t drift = std::min(step / 4, 1000); // Keeps the slope near 1
+        raw += step;
+        offset += (int32_t)(rng() % (2 * drift + 1)) - drift;
+    }
+    return points;
+}
+
+static void checkAccuracy()
+{
+    std::mt19937 rng(2024);
+    double worstMilli = 0;
+    double worstFloat = 0;
+    int curves = 0;
+    for (; curves < 20000; curves++)
+    {
+        CalibrationPoints points = randomPoints(rng);
+        CalibrationCurve curve;
+        const char *error;
+        if (!calibrationBuild(points, curve, error))
+        {
+            printf("generated curve rejected: %s\n", error);
+            ok = false;
+            return;
+        }
+
+        for (int i = 0; i < 200; i++)
+        {
+            int32_t raw = -270000 + (int32_t)(rng() % 2090000);
+            double expected = reference(points, raw);
+            worstMilli = std::max(worstMilli, std::fabs(calibrationApplyMilliC(curve, raw) - expected));
+
+            float rawC = raw / 1000.0f;
+            double expectedC = reference(points, rawC * 1000.0) / 1000.0;
+            worstFloat = std::max(worstFloat, std::fabs(calibrationApply(curve, rawC) - expectedC) * 1000.0);
+        }
+    }
+
+    printf("%d random curves x 200 readings: worst error %.3f m°C (fixed point), %.3f m°C (float API)\n",
+           curves, worstMilli, worstFloat);
+    expect(worstMilli <= 1.0, "fixed point within 1 m°C of the reference");
+    expect(worstFloat <= 2.0, "float API within 2 m°C, under the 10 m°C wire resolution");
+}
+
+static void checkCases()
+{
+    CalibrationCurve curve;
+    const char *error;
+
+    CalibrationPoints offset = makePoints({{100.0, 101.5}});
+    expect(calibrationBuild(offset, curve, error) &&
+               calibrationApplyMilliC(curve, -20000) == -18500 && calibrationApplyMilliC(curve, 1200000) == 1201500,
+           "one point is a constant offset everywhere");
+
+    CalibrationPoints gain = makePoints({{0.0, 0.5}, {200.0, 203.5}, {400.0, 404.0}});
+    bool built = calibrationBuild(gain, curve, error);
+    expect(built && calibrationApplyMilliC(curve, 0) == 500 && calibrationApplyMilliC(curve, 200000) == 203500 &&
+               calibrationApplyMilliC(curve, 400000) == 404000,
+           "readings on a point map exactly to its actual value");
+    expect(built && calibrationApplyMilliC(curve, 100000) == 102000, "midpoint interpolates");
+    expect(built && calibrationApplyMilliC(curve, -100000) == -101000, "below the first point extends the first segment");
+    expect(built && calibrationApplyMilliC(curve, 600000) == 604500, "above the last point extends the last segment");
+
+    CalibrationPoints full = {};
+    full.count = CALIBRATION_MAX_POINTS;
+    for (uint8_t i = 0; i < full.count; i++)
+    {
+        full.rawMilliC[i] = i * 100000;
+        full.actualMilliC[i] = i * 100000 + i * 100;
+    }
+    built = calibrationBuild(full, curve, error);
+    expect(built && calibrationApplyMilliC(curve, 1500000) == 1501500 &&
+               calibrationApplyMilliC(curve, 1450000) == 1451450,
+           "16 points: last knot and last segment");
+
+    struct Rejected
+    {
+        const char *name;
+        CalibrationPoints points;
+    };
+    CalibrationPoints tooMany = full;
+    tooMany.count = CALIBRATION_MAX_POINTS + 1;
+    const Rejected rejected[] = {
+        {"rejects no points", {}},
+        {"rejects 17 points", tooMany},
+        {"rejects raw points out of order", makePoints({{200.0, 201.0}, {100.0, 101.0}})},
+        {"rejects raw points under 1 °C apart", makePoints({{100.0, 101.0}, {100.5, 101.5}})},
+        {"rejects a correction over 50 °C", makePoints({{100.0, 212.0}})},
+        {"rejects a segment slope over 2", makePoints({{100.0, 100.0}, {110.0, 140.0}})},
+        {"rejects a point above 1820 °C", makePoints({{1900.0, 1900.0}})},
+    };
+    for (const Rejected &r : rejected)
+    {
+        CalibrationCurve untouched = curve;
+        bool refused = !calibrationBuild(r.points, untouched, error) && memcmp(&untouched, &curve, sizeof(curve)) == 0;
+        expect(refused, r.name);
+    }
+}
+
+static void checkId()
+{
+    CalibrationSet set = {};
+    const char *error;
+    expect(calibrationSetId(set) == 0, "no calibration reports ID 0");
+
+    CalibrationPoints points = makePoints({{100.0, 101.0}, {200.0, 202.0}});
+    calibrationBuild(points, set.curves[0], error);
+    uint32_t first = calibrationSetId(set);
+    expect(first != 0 && calibrationSetId(set) == first, "ID is non-zero and stable");
+
+    CalibrationSet moved = {};
+    calibrationBuild(points, moved.curves[1], error);
+    expect(calibrationSetId(moved) != first, "same curve on another channel changes the ID");
+
+    points.actualMilliC[1] += 1;
+    calibrationBuild(points, set.curves[0], error);
+    expect(calibrationSetId(set) != first, "a 1 m°C change changes the ID");
+}
+
+// The longest set_calibration a host is likely to send: every point,
+// doubles printed to 17 digits as JavaScript and Python print them, with
+// Python's separators and a UUID request_id
+static std::string fullCalibrationCommand()
+{
+    std::string line = "{\"set_calibration\": [";
+    for (int i = 0; i < CALIBRATION_MAX_POINTS; i++)
+    {
+        char point[128];
+        double raw = -269.99999999999997 + i * 120.10000000000001;
+        snprintf(point, sizeof(point), "%s{\"raw_c\": %.17g, \"actual_c\": %.17g}", i ? ", " : "", raw,
+                 raw + 0.30000000000000004 + i * 0.1);
+        line += point;
+    }
+    return line + "], \"channel\": 4, \"request_id\": \"0f8fad5b-d9cb-469f-a165-70867728950e\"}";
+}
+
+// As the set_calibration handler reads the points
+static bool parseCalibrationCommand(const char *line, CalibrationPoints &points, int64_t &channel)
+{
+    ProtoSpan list, field;
+    ProtoSpan command = protoSpan(line);
+    if (!protoFindMember(command, "set_calibration", list) || !protoFindMember(command, "channel", field))
+        return false;
+    ProtoCursor c = {field.data, field.data + field.length};
+    if (!protoReadInt(c, channel, 1, MAX_THERMOCOUPLE_CHANNELS))
+        return false;
+
+    points = {};
+    c = {list.data, list.data + list.length};
+    bool first = true;
+    ProtoSpan point;
+    if (!protoConsume(c, '['))
+        return false;
+    while (protoNextElement(c, first) == 1)
+    {
+        if (points.count == CALIBRATION_MAX_POINTS || !protoReadRaw(c, point))
+            return false;
+        float value[2];
+        const char *names[2] = {"raw_c", "actual_c"};
+        for (int k = 0; k < 2; k++)
+        {
+            ProtoCursor v;
+            if (!protoFindMember(point, names[k], field))
+                return false;
+            v = {field.data, field.data + field.length};
+            if (!protoReadFloat(v, value[k]))
+                return false;
+        }
+        points.rawMilliC[points.count] = lroundf(value[0] * 1000.0f);
+        points.actualMilliC[points.count] = lroundf(value[1] * 1000.0f);
+        points.count++;
+    }
+    return true;
+}
+
+static void checkCommandPath()
+{
+    static char buffer[COMMAND_MAX_LENGTH];
+    LineReader reader;
+    lineReaderInit(reader, buffer, sizeof(buffer));
+
+    std::string command = fullCalibrationCommand();
+    LineStatus status = LINE_PENDING;
+    for (char c : command + "\n")
+        status = lineReaderPush(reader, c);
+    printf("16-point set_calibration: %zu bytes, limit %d\n", command.size(), COMMAND_MAX_LENGTH - 1);
+    expect(status == LINE_READY && command == buffer, "16-point command passes the line reader whole");
+
+    CalibrationPoints points;
+    CalibrationCurve curve;
+    int64_t channel = 0;
+    const char *error;
+    bool parsed = parseCalibrationCommand(buffer, points, channel);
+    expect(parsed && points.count == CALIBRATION_MAX_POINTS && channel == 4 && calibrationBuild(points, curve, error),
+           "it parses to 16 points that build a curve");
+
+    // One byte over the limit is refused outright, and the next line is fine
+    std::string over = command + std::string(COMMAND_MAX_LENGTH - command.size(), ' ');
+    for (char c : over)
+        lineReaderPush(reader, c);
+    LineStatus overStatus = lineReaderPush(reader, '\n'), nextStatus = LINE_PENDING;
+    for (char c : command + "\n")
+        nextStatus = lineReaderPush(reader, c);
+    expect(overStatus == LINE_TOO_LONG && nextStatus == LINE_READY && command == buffer,
+           "a longer line is refused, not cut; the next one is whole");
+}
+
+// Linear scan with a division per reading, for comparison
+static float naiveApply(const CalibrationPoints &points, float rawC)
+{
+    return (float)(reference(points, rawC * 1000.0) / 1000.0);
+}
+
+static void benchmark()
+{
+    const int readings = 4096;
+    const long passes = 4000;
+    std::mt19937 rng(7);
+    float raw[readings];
+    for (float &r : raw)
+        r = (rng() % 250000) / 1000.0f;
+
+    CalibrationCurve uncalibrated = {};
+    CalibrationCurve twoPoint, sixteenPoint;
+    const char *error;
+    CalibrationPoints two = makePoints({{20.0, 20.4}, {230.0, 232.1}});
+    CalibrationPoints sixteen = {};
+    sixteen.count = CALIBRATION_MAX_POINTS;
+    for (uint8_t i = 0; i < sixteen.count; i++)
+    {
+        sixteen.rawMilliC[i] = i * 16000;
+        sixteen.actualMilliC[i] = i * 16000 + (i % 3) * 300;
+    }
+    calibrationBuild(two, twoPoint, error);
+    calibrationBuild(sixteen, sixteenPoint, error);
+
+    auto time = [&](const char *name, auto apply)
+    {
+        float sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (long pass = 0; pass < passes; pass++)
+        {
+            for (int i = 0; i < readings; i++)
+                sink += apply(raw[i]);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%-34s %6.2f ns/reading (checksum %.0f)\n", name, seconds * 1e9 / (passes * readings), sink);
+    };
+
+    time("uncalibrated (count check only)", [&](float c)
+         { return uncalibrated.count ? calibrationApply(uncalibrated, c) : c; });
+    time("2-point curve", [&](float c)
+         { return calibrationApply(twoPoint, c); });
+    time("16-point curve", [&](float c)
+         { return calibrationApply(sixteenPoint, c); });
+    time("16-point, naive scan and divide", [&](float c)
+         { return naiveApply(sixteen, c); });
+}
+
+int main(int argc, char **argv)
+{
+    checkCases();
+    checkId();
+    checkAccuracy();
+    checkCommandPath();
+    printCheckResult();
+
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0)
+        benchmark();
+    return checkExitCode();
+}
@@ -0,0 +1,314 @@
+// Fault injection for the thermocouple chip adapters and channel recovery.
+// The chips sit on a mocked SPI bus (tools/mock_spi) that answers with the
+// words a real chip would send, so faults, missing chips and recoveries can
+// be scripted. Build once per chip; from the repository root:
+//
+//   for chip in MAX31855 MAX31856 MAX6675; do
+//     g++ -std=gnu++17 -O2 -g -fsanitize=address,undefined -Itools/mock_spi -Isrc
+//         -DTHERMOCOUPLE_CHIP=THERMOCOUPLE_CHIP_$chip -DTHERMOCOUPLE_CHANNELS=4
+//         tools/channel_fault_check.cpp src/sensors/channel_health.cpp
+//         src/sensors/thermocouple_linearization.cpp src/sensors/calibration.cpp
+//         -o channel_fault_check && ./channel_fault_check
+//   done
+//
+// An optional argument sets the number of passes in the random soak.
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "check.h"
+#include "sensors/thermocouple_chips.h"
+
+static const uint8_t csPins[MAX_THERMOCOUPLE_CHANNELS] = {5, 10, 15, 16};
+static const uint8_t N = ThermocoupleArray::CHANNELS;
+static_assert(N >= 2, "build with -DTHERMOCOUPLE_CHANNELS=2 or more");
+
+// The firmware's channel state, driven the way main.cpp drives it
+struct Rig
+{
+    ThermocoupleArray array{csPins};
+    ChannelHealth health[MAX_THERMOCOUPLE_CHANNELS];
+    CalibrationSet calibration = {};
+    TemperatureSample sample = {};
+    unsigned long now = 0;
+
+    Rig()
+    {
+        mockReset();
+        for (uint8_t i = 0; i < N; i++)
+            channelHealthInit(health[i], array.chip(i).begin(), now);
+    }
+
+    void read(unsigned long stepMs = 100)
+    {
+        now += stepMs;
+        sample.timestamp = now;
+        array.read(sample, health, calibration);
+    }
+
+    // As recoverThermocouples(): at most one re-init per pass
+    void recover()
+    {
+        for (uint8_t i = 0; i < N; i++)
+        {
+            if (!channelHealthRetryDue(health[i], now))
+                continue;
+            channelHealthRetryResult(health[i], array.chip(i).begin(), now);
+            return;
+        }
+    }
+
+    bool healthy(uint8_t i, float expectC) const
+    {
+        return sample.fault[i] == 0 && fabsf(sample.temperatureC[i] - expectC) <= 0.25f;
+    }
+};
+
+static void checkHealthy()
+{
+    Rig rig;
+    for (uint8_t i = 0; i < N; i++)
+        mockChip(csPins[i]).hotC = 100.0f + i * 10.0f;
+    rig.read();
+
+    bool all = true;
+    for (uint8_t i = 0; i < N; i++)
+        all = all && rig.health[i].online && rig.healthy(i, 100.0f + i * 10.0f);
+    expect(all, "healthy chips read their junction temperature");
+}
+
+// Types set per channel; only chips converting in software change the value
+static void checkTypes()
+{
+    if constexpr (!ThermocoupleChip::SOFTWARE_LINEARIZATION)
+        return;
+
+    Rig rig;
+    for (uint8_t i = 0; i < N; i++)
+        mockChip(csPins[i]).hotC = 400.0f;
+    rig.read();
+    float chipC = rig.sample.temperatureC[1];
+    float typeJ = rig.array.chip(1).linearize(chipC, *thermocoupleTable('J'));
+
+    rig.array.setType(1, thermocoupleTable('J'));
+    rig.read();
+    bool linearized = rig.sample.temperatureC[1] == typeJ && fabsf(typeJ - chipC) > 10 && rig.healthy(0, 400.0f);
+    rig.array.setType(1, nullptr);
+    rig.read();
+    expect(linearized && rig.sample.temperatureC[1] == chipC,
+           "type J on one channel converts only that channel, until set back to the chip's own");
+}
+
+static void checkOpenProbe()
+{
+    Rig rig;
+#if THERMOCOUPLE_CHIP == THERMOCOUPLE_CHIP_MAX31855
+    mockChip(csPins[1]).fault = MAX31855_FAULT_OPEN;
+#elif THERMOCOUPLE_CHIP == THERMOCOUPLE_CHIP_MAX31856
+    mockChip(csPins[1]).fault = MAX31856_FAULT_OPEN;
+#else
+    mockChip(csPins[1]).fault = 0x04; // D2 on the MAX6675
+#endif
+    for (int i = 0; i < 20; i++)
+        rig.read();
+
+    expect(isnan(rig.sample.temperatureC[1]) && rig.sample.fault[1] == CHANNEL_FAULT_OPEN,
+           "open probe reads NaN with CHANNEL_FAULT_OPEN");
+    expect(rig.health[1].online, "a wiring fault never takes the chip offline");
+    expect(rig.healthy(0, 25.0f), "other channels keep reading");
+
+    mockChip(csPins[1]).fault = 0;
+    rig.read();
+    expect(rig.healthy(1, 25.0f), "reconnected probe reads again with no re-init");
+}
+
+static void checkMissingChip()
+{
+    Rig rig;
+    MockChip &chip = mockChip(csPins[1]);
+
+    // A glitch shorter than the threshold is ridden out
+    chip.present = false;
+    for (int i = 0; i < CHANNEL_FAULT_THRESHOLD - 1; i++)
+        rig.read();
+    bool flagged = rig.sample.fault[1] == CHANNEL_FAULT_NO_RESPONSE;
+    chip.present = true;
+    rig.read();
+    expect(flagged && rig.health[1].online && rig.healthy(1, 25.0f), "short bus glitch flags NO_RESPONSE, stays online");
+
+    // Enough in a row and the channel goes offline, off the bus
+    chip.present = false;
+    for (int i = 0; i < CHANNEL_FAULT_THRESHOLD; i++)
+        rig.read();
+    expect(!rig.health[1].online, "missing chip goes offline after the threshold");
+
+    uint32_t transfers = chip.transfers;
+    rig.read();
+    expect(rig.sample.fault[1] == CHANNEL_FAULT_OFFLINE && chip.transfers == transfers,
+           "offline channel reports OFFLINE without a transfer");
+    expect(rig.healthy(0, 25.0f), "healthy channels keep reading meanwhile");
+
+    // Re-init waits for the backoff, then doubles it while the chip is gone
+    unsigned long firstRetry = rig.health[1].nextRetryMs;
+    bool waited = !channelHealthRetryDue(rig.health[1], firstRetry - 1);
+    rig.now = firstRetry;
+    rig.recover();
+    unsigned long backoff = rig.health[1].backoffMs;
+    expect(waited && !rig.health[1].online && backoff == CHANNEL_RETRY_MIN_MS * 2,
+           "failed re-init waits for the backoff, then doubles it");
+
+    for (int i = 0; i < 20; i++)
+    {
+        rig.now = rig.health[1].nextRetryMs;
+        rig.recover();
+    }
+    expect(rig.health[1].backoffMs == CHANNEL_RETRY_MAX_MS, "backoff stops at CHANNEL_RETRY_MAX_MS");
+
+    // Chip back: re-init succeeds and the next good read resets the backoff
+    chip.present = true;
+    rig.now = rig.health[1].nextRetryMs;
+    rig.recover();
+    rig.read();
+    expect(rig.health[1].online && rig.health[1].recoveries == 1 && rig.healthy(1, 25.0f),
+           "returned chip is re-initialized and reads again");
+    expect(rig.health[1].backoffMs == CHANNEL_RETRY_MIN_MS, "a good read resets the backoff");
+}
+
+static void checkOneRetryPerPass()
+{
+    Rig rig;
+    mockChip(csPins[0]).present = false;
+    mockChip(csPins[1]).present = false;
+    for (int i = 0; i < CHANNEL_FAULT_THRESHOLD; i++)
+        rig.read();
+
+    mockChip(csPins[0]).present = true;
+    mockChip(csPins[1]).present = true;
+    rig.now += CHANNEL_RETRY_MIN_MS;
+    rig.recover();
+    bool one = rig.health[0].online && !rig.health[1].online;
+    rig.recover();
+    expect(one && rig.health[1].online, "two channels due re-init one per pass");
+}
+
+#if THERMOCOUPLE_CHIP == THERMOCOUPLE_CHIP_MAX31855
+static void checkChipFaults()
+{
+    Rig rig;
+    const uint8_t cases[][2] = {
+        {MAX31855_FAULT_SHORT_GND, CHANNEL_FAULT_SHORT_GND},
+        {MAX31855_FAULT_SHORT_VCC, CHANNEL_FAULT_SHORT_VCC},
+        {MAX31855_FAULT_OPEN | MAX31855_FAULT_SHORT_GND, CHANNEL_FAULT_OPEN | CHANNEL_FAULT_SHORT_GND},
+    };
+    bool all = true;
+    for (const auto &c : cases)
+    {
+        mockChip(csPins[0]).fault = c[0];
+        rig.read();
+        all = all && isnan(rig.sample.temperatureC[0]) && rig.sample.fault[0] == c[1];
+    }
+    expect(all && rig.health[0].online, "MAX31855 short-to-GND/VCC bits map through");
+}
+#elif THERMOCOUPLE_CHIP == THERMOCOUPLE_CHIP_MAX31856
+static void checkChipFaults()
+{
+    Rig rig;
+    const uint8_t cases[][2] = {
+        {MAX31856_FAULT_OPEN, CHANNEL_FAULT_OPEN},
+        {MAX31856_FAULT_OVUV, CHANNEL_FAULT_SHORT_GND | CHANNEL_FAULT_SHORT_VCC},
+        {MAX31856_FAULT_TCRANGE, CHANNEL_FAULT_TC_RANGE},
+        {MAX31856_FAULT_TCHIGH, CHANNEL_FAULT_TC_RANGE | CHANNEL_FAULT_LIMIT},
+        {MAX31856_FAULT_TCLOW, CHANNEL_FAULT_TC_RANGE | CHANNEL_FAULT_LIMIT},
+        {MAX31856_FAULT_CJRANGE, CHANNEL_FAULT_CJ_RANGE},
+        {MAX31856_FAULT_CJHIGH, CHANNEL_FAULT_CJ_RANGE | CHANNEL_FAULT_LIMIT},
+        {MAX31856_FAULT_CJLOW, CHANNEL_FAULT_CJ_RANGE | CHANNEL_FAULT_LIMIT},
+        {MAX31856_FAULT_CJRANGE | MAX31856_FAULT_TCRANGE, CHANNEL_FAULT_CJ_RANGE | CHANNEL_FAULT_TC_RANGE},
+        {0x7F, 0x3F}, // Everything short of a floating bus
+    };
+    bool all = true;
+    for (const auto &c : cases)
+    {
+        mockChip(csPins[0]).fault = c[0];
+        rig.read();
+        bool mapped = isnan(rig.sample.temperatureC[0]) && rig.sample.fault[0] == c[1];
+        if (!mapped)
+            printf("  status 0x%02X -> 0x%02X, want 0x%02X\n", c[0], rig.sample.fault[0], c[1]);
+        all = all && mapped;
+    }
+    expect(all, "MAX31856 decodes all eight status bits");
+    expect(rig.health[0].online, "range and limit faults never take the chip offline");
+
+    mockChip(csPins[0]).fault = 0;
+    rig.read();
+    expect(rig.healthy(0, 25.0f), "reading resumes when the status clears");
+}
+#else
+static void checkChipFaults() {}
+#endif
+
+// Random faults, dropouts and returns on every channel. Whatever happens,
+// a channel reports either a finite reading with no fault or NaN with
+// known fault bits, and an offline channel stays off the bus.
+static void soak(long passes)
+{
+    Rig rig;
+    std::mt19937 rng(29);
+    uint8_t known = CHANNEL_FAULT_OPEN | CHANNEL_FAULT_SHORT_GND | CHANNEL_FAULT_SHORT_VCC | CHANNEL_FAULT_TC_RANGE |
+                    CHANNEL_FAULT_CJ_RANGE | CHANNEL_FAULT_LIMIT | CHANNEL_FAULT_NO_RESPONSE | CHANNEL_FAULT_OFFLINE;
+    long consistent = 0, offBus = 0, readings = 0;
+    for (long pass = 0; pass < passes; pass++)
+    {
+        for (uint8_t i = 0; i < N; i++)
+        {
+            MockChip &chip = mockChip(csPins[i]);
+            uint32_t roll = rng() % 1000;
+            if (roll < 5)
+                chip.present = !chip.present;
+            else if (roll < 15)
+                chip.fault = (uint8_t)(rng() & 0x7F);
+            else if (roll < 60)
+                chip.fault = 0;
+            chip.hotC = 20.0f + (rng() % 4000) / 10.0f;
+        }
+
+        uint32_t before[MAX_THERMOCOUPLE_CHANNELS];
+        bool wasOnline[MAX_THERMOCOUPLE_CHANNELS];
+        for (uint8_t i = 0; i < N; i++)
+        {
+            before[i] = mockChip(csPins[i]).transfers;
+            wasOnline[i] = rig.health[i].online;
+        }
+        rig.read();
+        for (uint8_t i = 0; i < N; i++)
+            offBus += (!wasOnline[i] && mockChip(csPins[i]).transfers != before[i]) ? 1 : 0;
+        rig.recover();
+
+        for (uint8_t i = 0; i < N; i++)
+        {
+            float t = rig.sample.temperatureC[i];
+            uint8_t f = rig.sample.fault[i];
+            bool valid = (f == 0 && !isnan(t)) || (f != 0 && isnan(t) && (f & ~known) == 0);
+            consistent += valid ? 1 : 0;
+            readings += (f == 0) ? 1 : 0;
+        }
+    }
+    char what[80];
+    snprintf(what, sizeof(what), "soak %ld passes: value xor fault on every channel", passes);
+    expect(consistent == passes * N, what);
+    expect(offBus == 0, "soak: offline channels never touched the bus");
+    printf("  %.1f%% of channel reads were good\n", 100.0 * readings / (passes * N));
+}
+
+int main(int argc, char **argv)
+{
+    printf("%s x %d channels on the mocked bus\n", THERMOCOUPLE_CHIP_NAME, N);
+    checkHealthy();
+    checkTypes();
+    checkOpenProbe();
+    checkMissingChip();
+    checkOneRetryPerPass();
+    checkChipFaults();
+    soak(argc >= 2 ? atol(argv[1]) : 200000);
+    printCheckResult();
+    return checkExitCode();
+}
@@ -0,0 +1,24 @@
+#pragma once
+// Pass/fail reporting shared by the host checks. Header-only; include it
+// from a tool in this directory.
+
+#include <cstdio>
+
+inline bool ok = true;
+
+// One result line, aligned with the others; a failure sticks
+inline void expect(bool condition, const char *what)
+{
+    printf("%-58s %s\n", what, condition ? "ok" : "FAILED");
+    ok = ok && condition;
+}
+
+inline void printCheckResult()
+{
+    printf("%s\n", ok ? "all checks ok" : "check failed");
+}
+
+inline int checkExitCode()
+{
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+// Runs src/clock/clock_sync.cpp against a simulated host and a drifting
+// device clock over links with symmetric, fixed-asymmetric and queued
+// (bursty, one-way) delays. Pings go out every two seconds and, as with
+// sync_clock, each ping carries the previous one's t4. Every 100 ms the
+// device's host_time_us estimate is compared with true host time. From the
+// repository root:
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/clock_sync_sim.cpp
+//       src/clock/clock_sync.cpp -o clock_sync_sim
+//   ./clock_sync_sim
+//
+// A fixed one-way asymmetry is invisible to any two-way exchange and
+// biases the offset by half of it; the checks allow for that and test
+// that jitter and queueing add little on top. Errors are reported as
+// |e - b|, beyond that bias b; "naive" is a plain mean of recent offsets
+// without the fastest-exchange filter.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "check.h"
+#include "clock/clock_sync.h"
+
+static const int64_t HOST_EPOCH_US = 1700000000000000LL; // Host time at device boot
+static const int64_t PING_INTERVAL_US = 2000000;
+static const int64_t EVAL_INTERVAL_US = 100000;
+static const int64_t WARMUP_US = 5LL * 60 * 1000000;
+static const int64_t TURNAROUND_US = 200; // Parse the ping, build the reply
+
+struct Link
+{
+    const char *name;
+    double upBaseUs, upJitterUs;     // Host to device: base + exponential
+    double downBaseUs, downJitterUs; // Device to host
+    double queuedChance;             // Reply waits behind a telemetry frame
+    double queuedMaxUs;              // Uniform wait, up to one frame time
+};
+
+// Device uptime as a function of host time, with a drift step part way
+struct DeviceClock
+{
+    double driftBefore, driftAfter;
+    int64_t stepAtUs; // Host time since boot
+
+    int64_t at(int64_t hostUs) const
+    {
+        double t = (double)(hostUs - HOST_EPOCH_US);
+        double step = (double)stepAtUs;
+        if (t < step)
+            return (int64_t)(t * (1 + driftBefore));
+        return (int64_t)(step * (1 + driftBefore) + (t - step) * (1 + driftAfter));
+    }
+
+    double driftAt(int64_t hostUs) const
+    {
+        return hostUs - HOST_EPOCH_US < stepAtUs ? driftBefore : driftAfter;
+    }
+};
+
+struct Result
+{
+    std::vector<double> errorUs; // Estimate minus truth, after warm-up
+    std::vector<double> naiveUs; // Mean of the last 8 offsets, no delay filter
+    double driftErrorPpm;        // Fitted minus true, at the end of the run
+};
+
+static double percentile(std::vector<double> values, double p)
+{
+    std::sort(values.begin(), values.end());
+    return values[(size_t)(p * (values.size() - 1))];
+}
+
+static Result simulate(const Link &link, const DeviceClock &device, int64_t durationUs, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::exponential_distribution<double> upJitter(1.0 / link.upJitterUs), downJitter(1.0 / link.downJitterUs);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    // Every exchange up front, in host time
+    struct Ping
+    {
+        ClockSyncExchange exchange;
+        int64_t arrivesUs; // Host time the ping reaches the device
+    };
+    std::vector<Ping> pings;
+    for (int64_t t1 = HOST_EPOCH_US + 1000000; t1 < HOST_EPOCH_US + durationUs; t1 += PING_INTERVAL_US)
+    {
+        int64_t up = (int64_t)(link.upBaseUs + upJitter(rng));
+        int64_t down = (int64_t)(link.downBaseUs + downJitter(rng));
+        if (unit(rng) < link.queuedChance)
+            down += (int64_t)(unit(rng) * link.queuedMaxUs);
+        int64_t arrive = t1 + up;
+        Ping ping;
+        ping.exchange = {t1, device.at(arrive), device.at(arrive + TURNAROUND_US), arrive + TURNAROUND_US + down};
+        ping.arrivesUs = arrive;
+        pings.push_back(ping);
+    }
+
+    clockSyncReset();
+    Result result = {};
+    std::vector<double> recentOffsets;
+    size_t next = 1; // Ping k completes when ping k + 1 reaches the device
+    for (int64_t now = HOST_EPOCH_US; now < HOST_EPOCH_US + durationUs; now += EVAL_INTERVAL_US)
+    {
+        for (; next < pings.size() && pings[next].arrivesUs <= now; next++)
+        {
+            const ClockSyncExchange &e = pings[next - 1].exchange;
+            clockSyncAddExchange(e);
+            recentOffsets.push_back(((e.t1 - e.t2) + (e.t4 - e.t3)) / 2.0);
+            if (recentOffsets.size() > CLOCK_SYNC_WINDOW)
+                recentOffsets.erase(recentOffsets.begin());
+        }
+        if (!clockSyncValid() || now - HOST_EPOCH_US < WARMUP_US)
+            continue;
+
+        int64_t deviceUs = device.at(now);
+        result.errorUs.push_back((double)(clockSyncToHostUs(deviceUs) - now));
+
+        // Ignoring drift is fine for the last 16 s of a naive mean
+        double mean = 0;
+        for (double offset : recentOffsets)
+            mean += offset;
+        result.naiveUs.push_back(deviceUs + mean / recentOffsets.size() - now);
+    }
+    // A device clock running fast makes host minus device fall
+    double drift = device.driftAt(HOST_EPOCH_US + durationUs);
+    result.driftErrorPpm = clockSyncDriftPpm() + drift / (1 + drift) * 1e6;
+    return result;
+}
+
+int main()
+{
+    const Link links[] = {
+        {"symmetric jitter", 1500, 500, 1500, 500, 0.0, 0},
+        {"fixed asymmetry 1/3 ms", 1000, 300, 3000, 300, 0.0, 0},
+        {"replies queued behind frames", 1000, 300, 1000, 300, 0.6, 36000}, // 413 B at 115200
+        {"both, 921600 frames", 1000, 300, 3000, 300, 0.6, 4500},
+    };
+    const DeviceClock steady = {35e-6, 35e-6, 0};
+    const DeviceClock warming = {35e-6, -10e-6, 30LL * 60 * 1000000}; // Enclosure heats up at 30 min
+    const int64_t hour = 60LL * 60 * 1000000;
+
+    printf("%-30s %-8s %9s %9s %9s %11s %9s\n", "link", "clock", "median", "p99 |e-b|", "max |e-b|", "naive p99",
+           "drift err");
+    for (const Link &link : links)
+    {
+        double biasUs = (link.downBaseUs - link.upBaseUs) / 2; // No exchange can see it
+        for (const DeviceClock *device : {&steady, &warming})
+        {
+            Result r = simulate(link, *device, hour, 27);
+            std::vector<double> magnitude, naive;
+            for (double e : r.errorUs)
+                magnitude.push_back(fabs(e - biasUs));
+            for (double e : r.naiveUs)
+                naive.push_back(fabs(e - biasUs));
+            double median = percentile(r.errorUs, 0.5);
+            double p99 = percentile(magnitude, 0.99);
+            printf("%-30s %-8s %7.0f us %7.0f us %7.0f us %9.0f us %5.1f ppm\n", link.name,
+                   device == &steady ? "35 ppm" : "step", median, p99, percentile(magnitude, 1.0), percentile(naive, 0.99),
+                   r.driftErrorPpm);
+
+            char what[80];
+            snprintf(what, sizeof(what), "%s, %s: p99 beyond the bias < 1 ms", link.name,
+                     device == &steady ? "steady" : "step");
+            expect(p99 < 1000, what);
+            snprintf(what, sizeof(what), "%s, %s: drift within 2 ppm", link.name, device == &steady ? "steady" : "step");
+            expect(fabs(r.driftErrorPpm) < 2, what);
+        }
+    }
+    printCheckResult();
+    return checkExitCode();
+}
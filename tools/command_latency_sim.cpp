@@ -0,0 +1,236 @@
+// Command latency while streaming at full rate, on a simulated link. The
+// outbound path is modelled as it runs on the device: telemetry and
+// response rings (the real src/serial/tx_ring.cpp), a writer that prefers
+// responses, and a UART that drains at the baud rate behind a 4 KB driver
+// buffer. Commands land at random times, wait for the loop's current
+// state-locked step, run, and queue their response.
+//
+// Two loads are run: live data frames alone, and live frames with a
+// get_history export streaming behind them, paced on the telemetry ring the
+// way the loop paces it. Two writer policies are compared: handing frames
+// to the driver as soon as it has room (the original), and waiting for each
+// frame to leave the wire before picking the next (the current
+// serial_tx.cpp). Latency is from the command's line ending to the last
+// byte of its response on the wire. From the repository root:
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/command_latency_sim.cpp
+//       src/serial/tx_ring.cpp -o command_latency_sim
+//   ./command_latency_sim [minutes]
+//
+// Loop step and command run times are assumptions, not measurements; see
+// the constants below. The 20 ms bound is checked for the 921600 baud
+// build (esp32-s3-fast-uart) only; the default 115200 cannot meet it.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "check.h"
+#include "protocol/protocol.h"
+#include "serial/tx_ring.h"
+
+// Device-side assumptions
+static const double SAMPLE_PERIOD_US = 100000; // Fastest sampling rate
+static const double LOOP_STEP_US = 2000;       // Read, filter, encode under the state lock
+static const double COMMAND_RUN_US = 500;      // Parse, apply, build the response
+static const double COMMAND_MEAN_GAP_US = 250000;
+static const size_t DRIVER_BUFFER = 4096; // SERIAL_TX_BUFFER
+static const size_t TELEMETRY_RING_SIZE = 16384;
+static const size_t BACKLOG_BYTES = TELEMETRY_RING_SIZE / 4; // txTelemetryBacklogged()
+static const double EXPORT_POLL_US = 5000;                   // Loop wake while backlogged
+static const size_t HISTORY_FRAME = 1300;                    // 32 rows x 4 channels, roughly
+static const size_t RESPONSE_RING_SIZE = 4096;
+static const double LATENCY_BOUND_MS = 20.0;
+
+struct Link
+{
+    const char *name;
+    double bytesPerSecond;
+};
+
+// A frame as queued: what it is, padded to its encoded length
+struct Pending
+{
+    double queuedUs;
+    bool response;
+    int command; // Index into the command list, responses only
+    size_t length;
+};
+
+struct Produced
+{
+    double atUs;
+    Pending frame;
+    bool ifRoom; // Export: only sent while the ring is not backlogged
+};
+
+// A 4-channel data frame as the firmware encodes it, clock synced
+static size_t dataFrameLength()
+{
+    DataMessage msg = {};
+    msg.deviceId = protoSpan("P61-A1B2C3D4E5F6");
+    msg.firmwareVersion = protoSpan("1.4.0");
+    msg.metadata.timestamp = 3600000;
+    msg.metadata.samplingRateMs = 100;
+    msg.metadata.sequence = 36000;
+    msg.metadata.keyframe = true;
+    msg.metadata.hasHostTime = true;
+    msg.metadata.hostTimeUs = 1700000003600000LL;
+    msg.channelCount = 4;
+    for (uint8_t i = 0; i < 4; i++)
+        msg.channels[i] = {(uint8_t)(i + 1), true, 201.25f + i * 10.5f, 0};
+    char frame[1024];
+    return encodeDataMessage(msg, frame, sizeof(frame)) + 2;
+}
+
+static const char *const RESPONSE =
+    R"({"device_id":"P61-A1B2C3D4E5F6","metadata":{"timestamp":3600000,"received_us":3600000123,)"
+    R"("sent_us":3600000623,"host_time_us":1700000003600000},"payload":{"result":"sampling_rate_updated",)"
+    R"("sampling_rate_ms":500},"request_id":"c0ffee-42","type":"configuration"})";
+
+struct Result
+{
+    std::vector<double> latencyMs;
+    uint32_t telemetrySent;
+    uint32_t telemetryDropped;
+};
+
+static Result simulate(const Link &link, bool waitForWire, bool exporting, double seconds, uint32_t seed)
+{
+    const double byteUs = 1e6 / link.bytesPerSecond;
+    const size_t dataLength = dataFrameLength();
+    const size_t responseLength = strlen(RESPONSE) + 2;
+
+    // Producers: the loop's steps and the commands, in time order. A
+    // command that lands inside a step waits for it to finish.
+    std::mt19937 rng(seed);
+    std::exponential_distribution<double> gap(1.0 / COMMAND_MEAN_GAP_US);
+    std::vector<double> arrivals;
+    for (double t = gap(rng); t < seconds * 1e6; t += gap(rng))
+        arrivals.push_back(t);
+
+    std::vector<Produced> produced;
+    double lockFreeUs = 0;
+    size_t next = 0;
+    for (double sampleUs = 0; sampleUs < seconds * 1e6; sampleUs += SAMPLE_PERIOD_US)
+    {
+        for (; next < arrivals.size() && arrivals[next] < sampleUs; next++)
+        {
+            double start = std::max(arrivals[next], lockFreeUs);
+            lockFreeUs = start + COMMAND_RUN_US;
+            produced.push_back({lockFreeUs, {lockFreeUs, true, (int)next, responseLength}, false});
+        }
+        double start = std::max(sampleUs, lockFreeUs);
+        lockFreeUs = start + LOOP_STEP_US;
+        produced.push_back({lockFreeUs, {lockFreeUs, false, -1, dataLength}, false});
+    }
+    for (double t = 0; exporting && t < seconds * 1e6; t += EXPORT_POLL_US)
+        produced.push_back({t, {t, false, -1, HISTORY_FRAME}, true});
+    std::stable_sort(produced.begin(), produced.end(),
+                     [](const Produced &a, const Produced &b) { return a.atUs < b.atUs; });
+
+    static uint8_t telemetryStorage[TELEMETRY_RING_SIZE];
+    static uint8_t responseStorage[RESPONSE_RING_SIZE];
+    TxRing telemetry, responses;
+    txRingInit(telemetry, telemetryStorage, TELEMETRY_RING_SIZE);
+    txRingInit(responses, responseStorage, RESPONSE_RING_SIZE);
+
+    Result result = {};
+    double writerFreeUs = 0; // When the writer next looks at the rings
+    double wireFreeUs = 0;   // When the driver buffer runs empty
+
+    // Runs the writer until it would next pick a frame after untilUs
+    auto runWriter = [&](double untilUs)
+    {
+        for (;;)
+        {
+            double pickUs = waitForWire ? std::max(writerFreeUs, wireFreeUs) : writerFreeUs;
+            if (pickUs > untilUs)
+                return;
+            TxRing &ring = responses.frames > 0 ? responses : telemetry;
+            const uint8_t *bytes;
+            if (txRingPeek(ring, &bytes) == 0)
+                return; // Asleep until the next push
+            Pending frame;
+            memcpy(&frame, bytes, sizeof(frame));
+            txRingPop(ring);
+
+            // Serial.write returns once the frame fits in the driver buffer
+            double room = (DRIVER_BUFFER - frame.length) * byteUs;
+            double writtenUs = std::max(pickUs, wireFreeUs - room);
+            wireFreeUs = std::max(writtenUs, wireFreeUs) + frame.length * byteUs;
+            writerFreeUs = waitForWire ? wireFreeUs : writtenUs;
+
+            if (frame.response)
+                result.latencyMs.push_back((wireFreeUs - arrivals[frame.command]) / 1000.0);
+            else
+                result.telemetrySent++;
+        }
+    };
+
+    for (const Produced &p : produced)
+    {
+        runWriter(p.atUs);
+        if (p.ifRoom && telemetry.used > BACKLOG_BYTES)
+            continue;
+        TxRing &ring = p.frame.response ? responses : telemetry;
+        uint8_t *slot = txRingPush(ring, p.frame.length, p.frame.response ? TX_NEVER_DROP : TX_DROP_OLDEST);
+        if (slot)
+            memcpy(slot, &p.frame, sizeof(p.frame));
+        writerFreeUs = std::max(writerFreeUs, p.atUs); // Woken by the push
+    }
+    runWriter(1e18);
+    result.telemetryDropped = telemetry.dropped;
+    return result;
+}
+
+static double percentile(std::vector<double> values, double p)
+{
+    std::sort(values.begin(), values.end());
+    return values[(size_t)(p * (values.size() - 1))];
+}
+
+int main(int argc, char **argv)
+{
+    double minutes = argc >= 2 ? atof(argv[1]) : 30;
+    printf("data frame %zu bytes every %.0f ms, response %zu bytes, one command per %.0f ms on average\n",
+           dataFrameLength(), SAMPLE_PERIOD_US / 1000, strlen(RESPONSE) + 2, COMMAND_MEAN_GAP_US / 1000);
+
+    const Link links[] = {
+        {"UART 115200", 11520},
+        {"UART 460800", 46080},
+        {"UART 921600", 92160},
+        {"USB CDC", 1000000}, // Full-speed bulk, roughly
+    };
+
+    double fastUartP99[2] = {0, 0};
+    for (bool exporting : {false, true})
+    {
+        printf("%s\n", exporting ? "live frames + history export" : "live frames");
+        for (const Link &link : links)
+        {
+            for (bool wait : {false, true})
+            {
+                Result r = simulate(link, wait, exporting, minutes * 60, 32);
+                double p99 = percentile(r.latencyMs, 0.99);
+                printf("  %-12s %-14s p50 %6.1f ms  p99 %6.1f ms  max %6.1f ms  frames %6u dropped %u\n", link.name,
+                       wait ? "wait for wire" : "fill driver", percentile(r.latencyMs, 0.5), p99,
+                       percentile(r.latencyMs, 1.0), r.telemetrySent, r.telemetryDropped);
+                if (wait && strcmp(link.name, "UART 921600") == 0)
+                    fastUartP99[exporting] = p99;
+            }
+        }
+    }
+
+    char what[80];
+    snprintf(what, sizeof(what), "fast-uart 921600, live: p99 %.1f ms < %.0f ms", fastUartP99[0],
+             LATENCY_BOUND_MS);
+    expect(fastUartP99[0] < LATENCY_BOUND_MS, what);
+    snprintf(what, sizeof(what), "fast-uart 921600, exporting: p99 %.1f ms < %.0f ms", fastUartP99[1],
+             LATENCY_BOUND_MS);
+    expect(fastUartP99[1] < LATENCY_BOUND_MS, what);
+    printCheckResult();
+    return checkExitCode();
+}
@@ -0,0 +1,267 @@
+// Replays a roast through src/telemetry/deadband.cpp on a host and counts
+// the bytes each data frame takes on the wire, encoded as
+// transmitSample() encodes it. Every threshold is compared with deadband
+// off, overall and split into steady stretches (the bean probe moved
+// less than 0.5 C over the last 10 s: idle, plateaus) and changing ones. The
+// host's view, the last reported value of each channel, is checked
+// against the real one, and a lossy link is replayed to check that
+// keyframes repair what a lost frame leaves stale. From the repository
+// root:
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/deadband_replay.cpp
+//       src/telemetry/deadband.cpp -o deadband_replay
+//   ./deadband_replay [trace]
+//
+// trace is a recorded series as read by roast_trace.h. Without one, the
+// synthetic hour of roasting is used, preceded by 20 minutes of probes
+// sitting at ambient.
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "check.h"
+#include "roast_trace.h"
+#include "telemetry/deadband.h"
+
+static const unsigned long KEYFRAME_INTERVAL_MS = 10000; // Default keyframe_interval_ms
+static const uint32_t STEADY_WINDOW_MS = 10000;
+static const float STEADY_SPAN_C = 0.5f;
+static const double LOSS_CHANCE = 0.01;
+
+// Probes at ambient before the first batch is charged
+static Series withIdleStart(const Series &roast)
+{
+    const uint32_t idleMs = 20 * 60 * 1000;
+    Series series;
+    series.channels = roast.channels;
+    std::mt19937 rng(35);
+    std::normal_distribution<float> noise(0.0f, 0.15f);
+    uint32_t step = roast.rows[1].timestampMs - roast.rows[0].timestampMs;
+    for (uint32_t t = 0; t < idleMs; t += step)
+    {
+        SeriesPoint row;
+        row.timestampMs = t;
+        for (uint8_t ch = 0; ch < MAX_THERMOCOUPLE_CHANNELS; ch++)
+            row.temperatureC[ch] = ch < roast.channels ? 21.5f + ch * 0.8f + noise(rng) : NAN;
+        series.rows.push_back(row);
+    }
+    for (SeriesPoint row : roast.rows)
+    {
+        row.timestampMs += idleMs;
+        series.rows.push_back(row);
+    }
+    return series;
+}
+
+// Rows where the first channel, averaged over a second to see past probe
+// noise, has moved less than STEADY_SPAN_C in the last STEADY_WINDOW_MS
+static std::vector<bool> steadyRows(const Series &series)
+{
+    const std::vector<SeriesPoint> &rows = series.rows;
+    auto meanOver = [&](size_t last)
+    {
+        double sum = 0;
+        size_t n = 0;
+        for (size_t j = last + 1; j-- > 0 && rows[last].timestampMs - rows[j].timestampMs < 1000;)
+        {
+            if (!std::isnan(rows[j].temperatureC[0]))
+            {
+                sum += rows[j].temperatureC[0];
+                n++;
+            }
+        }
+        return n ? sum / n : NAN;
+    };
+
+    std::vector<bool> steady(rows.size(), false);
+    size_t from = 0;
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        while (rows[i].timestampMs - rows[from].timestampMs > STEADY_WINDOW_MS)
+            from++;
+        if (rows[i].timestampMs - rows[0].timestampMs >= STEADY_WINDOW_MS)
+            steady[i] = fabs(meanOver(i) - meanOver(from)) <= STEADY_SPAN_C;
+    }
+    return steady;
+}
+
+static TemperatureSample sampleAt(const Series &series, const SeriesPoint &row)
+{
+    TemperatureSample sample = {};
+    sample.timestamp = row.timestampMs;
+    sample.deviceTimeUs = (int64_t)row.timestampMs * 1000;
+    sample.channelCount = series.channels;
+    for (uint8_t ch = 0; ch < series.channels; ch++)
+    {
+        sample.temperatureC[ch] = row.temperatureC[ch];
+        sample.fault[ch] = std::isnan(row.temperatureC[ch]) ? 0x01 : 0; // Open probe
+    }
+    return sample;
+}
+
+// As buildDataMessage() and encodeDataMessage() put it on the wire
+static size_t frameBytes(const TemperatureSample &sample, ChannelMask channels, bool keyframe, uint32_t sequence,
+                         uint32_t rateMs)
+{
+    DataMessage msg = {};
+    msg.deviceId = protoSpan("P61-A1B2C3D4E5F6");
+    msg.firmwareVersion = protoSpan("1.4.0");
+    msg.metadata.timestamp = sample.timestamp;
+    msg.metadata.samplingRateMs = rateMs;
+    msg.metadata.sequence = sequence;
+    msg.metadata.keyframe = keyframe;
+    msg.metadata.hasHostTime = true;
+    msg.metadata.hostTimeUs = 1700000000000000LL + sample.deviceTimeUs;
+    for (int i = 0; i < sample.channelCount; i++)
+    {
+        if (!(channels & (1u << i)))
+            continue;
+        DataChannel &channel = msg.channels[msg.channelCount++];
+        channel.channel = i + 1;
+        channel.ok = sample.fault[i] == 0;
+        channel.faultCode = sample.fault[i];
+        channel.temperatureC = sample.temperatureC[i];
+    }
+    char frame[PROTO_DATA_FRAME_MAX];
+    return encodeDataMessage(msg, frame, sizeof(frame)) + 2;
+}
+
+struct Result
+{
+    double bytes[2];   // Changing, steady
+    double seconds[2]; // Time spent in each
+    size_t frames;
+    size_t lost;       // Frames the link dropped
+    size_t gaps;       // Frames the host found missing from the sequence
+    double maxErrorC;  // Host view against the sample
+    double maxStaleMs; // Longest the host view was further off than that
+};
+
+static Result replay(const Series &series, const std::vector<bool> &steady, float thresholdC, double lossChance)
+{
+    configureDeadband(thresholdC, KEYFRAME_INTERVAL_MS);
+    std::mt19937 rng(35);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    Result result = {};
+    uint32_t rateMs = series.rows[1].timestampMs - series.rows[0].timestampMs;
+    float hostC[MAX_THERMOCOUPLE_CHANNELS];
+    for (float &c : hostC)
+        c = NAN;
+    uint32_t sequence = 0, hostExpects = 0;
+    double staleSinceMs = -1;
+
+    for (size_t i = 0; i < series.rows.size(); i++)
+    {
+        TemperatureSample sample = sampleAt(series, series.rows[i]);
+        result.seconds[steady[i]] += rateMs / 1000.0;
+
+        bool keyframe;
+        ChannelMask changed = deadbandSelect(sample, keyframe);
+        if (changed)
+        {
+            uint32_t frameSequence = sequence++;
+            result.bytes[steady[i]] += frameBytes(sample, changed, keyframe, frameSequence, rateMs);
+            result.frames++;
+
+            if (unit(rng) < lossChance)
+                result.lost++;
+            else
+            {
+                result.gaps += frameSequence - hostExpects;
+                hostExpects = frameSequence + 1;
+                for (uint8_t ch = 0; ch < sample.channelCount; ch++)
+                {
+                    if (changed & (1u << ch))
+                        hostC[ch] = sample.temperatureC[ch];
+                }
+            }
+        }
+
+        // The host's view may lag by up to the threshold, and a fault
+        // always goes out the moment it appears
+        bool stale = false;
+        for (uint8_t ch = 0; ch < sample.channelCount; ch++)
+        {
+            float truth = sample.temperatureC[ch];
+            if (std::isnan(truth) != std::isnan(hostC[ch]))
+                stale = true;
+            else if (!std::isnan(truth))
+            {
+                float error = fabsf(truth - hostC[ch]);
+                stale = stale || error > thresholdC + 1e-4f;
+                result.maxErrorC = std::max(result.maxErrorC, (double)error);
+            }
+        }
+        double nowMs = series.rows[i].timestampMs;
+        if (stale && staleSinceMs < 0)
+            staleSinceMs = nowMs;
+        if (!stale && staleSinceMs >= 0)
+        {
+            result.maxStaleMs = std::max(result.maxStaleMs, nowMs - staleSinceMs);
+            staleSinceMs = -1;
+        }
+    }
+    // Losses after the last delivered frame have nothing to reveal them
+    result.gaps += sequence - hostExpects;
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    Series series;
+    if (argc >= 2)
+    {
+        if (!loadTrace(argv[1], series) || series.rows.size() < 2)
+        {
+            fprintf(stderr, "cannot read a trace from %s\n", argv[1]);
+            return 2;
+        }
+        printf("trace %s: %zu rows, %u channel(s)\n", argv[1], series.rows.size(), series.channels);
+    }
+    else
+    {
+        series = withIdleStart(syntheticRoast());
+        printf("synthetic: 20 min idle, then 5 roasts, %zu rows at 100 ms, %u channels\n", series.rows.size(),
+               series.channels);
+    }
+    std::vector<bool> steady = steadyRows(series);
+
+    Result off = replay(series, steady, 0.0f, 0.0);
+    printf("keyframe every %lu ms; steady %.0f s, changing %.0f s\n", KEYFRAME_INTERVAL_MS, off.seconds[1],
+           off.seconds[0]);
+    printf("%-9s %9s %10s %10s %10s %10s %9s %10s\n", "deadband", "frames", "B/s", "steady", "changing", "saved",
+           "max err", "lossy fix");
+
+    for (float thresholdC : {0.0f, 0.1f, 0.25f, 0.5f, 1.0f})
+    {
+        Result r = replay(series, steady, thresholdC, 0.0);
+        Result lossy = replay(series, steady, thresholdC, LOSS_CHANCE);
+        double total = (r.bytes[0] + r.bytes[1]) / (r.seconds[0] + r.seconds[1]);
+        double steadyRate = r.bytes[1] / r.seconds[1];
+        double changingRate = r.bytes[0] / r.seconds[0];
+        double saved = 1 - (r.bytes[0] + r.bytes[1]) / (off.bytes[0] + off.bytes[1]);
+        printf("%6.2f C %9zu %10.1f %10.1f %10.1f %9.1f%% %7.3f C %7.0f ms\n", thresholdC, r.frames, total, steadyRate,
+               changingRate, 100 * saved, r.maxErrorC, lossy.maxStaleMs);
+
+        if (thresholdC == 0.0f)
+            continue;
+        char what[80];
+        snprintf(what, sizeof(what), "%.2f C: host view within the threshold on a clean link", thresholdC);
+        expect(r.maxErrorC <= thresholdC + 1e-4 && r.maxStaleMs == 0, what);
+        snprintf(what, sizeof(what), "%.2f C: 1%% loss seen by sequence, repaired by a keyframe", thresholdC);
+        expect(lossy.lost > 0 && lossy.gaps == lossy.lost && lossy.maxStaleMs <= KEYFRAME_INTERVAL_MS, what);
+    }
+
+    // Probe noise (0.15 C here) keeps tight thresholds busy; from 0.5 C
+    // an idle or plateaued probe should cost a fraction of the link
+    Result half = replay(series, steady, 0.5f, 0.0);
+    double steadyShare = (half.bytes[1] / half.seconds[1]) / (off.bytes[1] / off.seconds[1]);
+    char what[80];
+    snprintf(what, sizeof(what), "0.50 C: steady stretches use %.0f%% of the full-frame bytes", 100 * steadyShare);
+    expect(steadyShare < 0.25, what);
+
+    printCheckResult();
+    return checkExitCode();
+}
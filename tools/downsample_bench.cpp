@@ -0,0 +1,125 @@
+// Measures the history reduction in src/telemetry/downsample.cpp on a
+// host: rows per second through the cursor, and how closely the kept rows
+// follow the full series compared with plain decimation to the same
+// budget. From the repository root:
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/downsample_bench.cpp
+//       src/telemetry/downsample.cpp -o downsample_bench
+//   ./downsample_bench [trace] [max_points]
+//
+// trace is a recorded series as read by roast_trace.h. Without one, a
+// synthetic one-hour roast sampled at 10 Hz is used.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "roast_trace.h"
+#include "telemetry/downsample.h"
+
+static bool readRow(void *context, uint32_t index, SeriesPoint &point)
+{
+    const Series &series = *(const Series *)context;
+    if (index >= series.rows.size())
+        return false;
+    point = series.rows[index];
+    return true;
+}
+
+// Error of the kept rows, joined by straight lines, against every row of
+// the full series
+struct Fidelity
+{
+    double maxErrorC;
+    double rmsErrorC;
+};
+
+static Fidelity fidelity(const Series &series, const std::vector<uint32_t> &kept)
+{
+    double worst = 0, sumSq = 0;
+    size_t compared = 0;
+    size_t k = 0;
+    for (uint32_t i = 0; i < series.rows.size(); i++)
+    {
+        while (k + 2 < kept.size() && kept[k + 1] <= i)
+            k++;
+        const SeriesPoint &a = series.rows[kept[k]];
+        const SeriesPoint &b = series.rows[kept[k + 1]];
+        double span = (double)(b.timestampMs - a.timestampMs);
+        double f = span > 0 ? (series.rows[i].timestampMs - a.timestampMs) / span : 0;
+
+        for (uint8_t ch = 0; ch < series.channels; ch++)
+        {
+            double actual = series.rows[i].temperatureC[ch];
+            double ya = a.temperatureC[ch], yb = b.temperatureC[ch];
+            if (std::isnan(actual) || std::isnan(ya) || std::isnan(yb))
+                continue;
+            double error = std::fabs(ya + (yb - ya) * f - actual);
+            worst = std::max(worst, error);
+            sumSq += error * error;
+            compared++;
+        }
+    }
+    return {worst, compared ? std::sqrt(sumSq / compared) : 0};
+}
+
+int main(int argc, char **argv)
+{
+    Series series;
+    const char *source = "synthetic 1 h roast at 10 Hz";
+    if (argc >= 2 && strcmp(argv[1], "-") != 0)
+    {
+        if (!loadTrace(argv[1], series))
+        {
+            fprintf(stderr, "no data rows in %s\n", argv[1]);
+            return 1;
+        }
+        source = argv[1];
+    }
+    else
+    {
+        series = syntheticRoast();
+    }
+    uint32_t count = series.rows.size();
+    printf("%s: %u rows, %u channel(s)\n", source, count, series.channels);
+
+    const uint32_t budgets[] = {250, 500, 1000, 2000};
+    uint32_t only = argc >= 3 ? strtoul(argv[2], nullptr, 10) : 0;
+
+    for (uint32_t target : budgets)
+    {
+        if (only && target != only)
+            continue;
+
+        // Reduce repeatedly for a stable rate
+        std::vector<uint32_t> kept;
+        const int rounds = 20;
+        auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < rounds; round++)
+        {
+            kept.clear();
+            Downsample ds;
+            downsampleBegin(ds, count, target, series.channels, readRow, &series);
+            uint32_t index;
+            SeriesPoint point;
+            while (downsampleNext(ds, index, point))
+                kept.push_back(index);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // Every k-th row, same budget, last row included
+        std::vector<uint32_t> decimated;
+        for (uint32_t i = 0; i < target - 1; i++)
+            decimated.push_back((uint64_t)i * (count - 1) / (target - 1));
+        decimated.push_back(count - 1);
+
+        Fidelity lttb = fidelity(series, kept);
+        Fidelity plain = fidelity(series, decimated);
+        printf("%5u points: %6.1f M rows/s | LTTB max %5.2f C rms %.3f C | decimation max %5.2f C rms %.3f C\n",
+               (unsigned)kept.size(), rounds * (double)count / seconds / 1e6, lttb.maxErrorC, lttb.rmsErrorC,
+               plain.maxErrorC, plain.rmsErrorC);
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+// Host checks for src/scheduler/event_bus.cpp: subscription masks, queue
+// order and overflow, wake hooks, and many producers feeding one
+// subscriber across threads, then the publish/poll cost and throughput.
+// From the repository root:
+//
+//   g++ -std=gnu++17 -O2 -pthread -Isrc tools/event_bus_check.cpp
+//       src/scheduler/event_bus.cpp -o event_bus_check
+//   ./event_bus_check        # behaviour
+//   ./event_bus_check bench  # also time publish/poll and throughput
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "check.h"
+#include "scheduler/event_bus.h"
+
+static BusEvent makeEvent(uint8_t type, uint32_t timestampMs, int32_t value)
+{
+    BusEvent event = {type, timestampMs, 0, value};
+    return event;
+}
+
+static void countWake(void *context)
+{
+    (*(int *)context)++;
+}
+
+static void checkSubscriptions()
+{
+    busReset();
+    int wifi = busSubscribe(BUS_MASK(BUS_WIFI_CONNECTED) | BUS_MASK(BUS_WIFI_DISCONNECTED), nullptr, nullptr);
+    int roast = busSubscribe(BUS_MASK(BUS_ROAST_STARTED), nullptr, nullptr);
+
+    busPublish(makeEvent(BUS_WIFI_CONNECTED, 10, -61));
+    busPublish(makeEvent(BUS_ROAST_STARTED, 20, 20150));
+    busPublish(makeEvent(BUS_WIFI_DISCONNECTED, 30, 0));
+    busPublish(makeEvent(BUS_DATA_SENT, 40, 0)); // Nobody wants it
+
+    BusEvent event;
+    bool first = busPoll(wifi, event) && event.type == BUS_WIFI_CONNECTED && event.value == -61;
+    bool second = busPoll(wifi, event) && event.type == BUS_WIFI_DISCONNECTED && event.timestampMs == 30;
+    expect(first && second && !busPoll(wifi, event), "subscriber sees only its types, in publish order");
+    expect(busPoll(roast, event) && event.value == 20150 && !busPoll(roast, event), "each subscriber gets its own copy");
+    expect(!busPoll(-1, event) && !busPoll(BUS_MAX_SUBSCRIBERS, event), "unknown subscriber ids poll nothing");
+
+    busReset();
+    int taken = 0;
+    for (int i = 0; i < BUS_MAX_SUBSCRIBERS; i++)
+        taken += busSubscribe(BUS_MASK(BUS_DATA_SENT), nullptr, nullptr) == i ? 1 : 0;
+    expect(taken == BUS_MAX_SUBSCRIBERS && busSubscribe(BUS_MASK(BUS_DATA_SENT), nullptr, nullptr) == -1,
+           "slots run out at BUS_MAX_SUBSCRIBERS");
+}
+
+static void checkOverflow()
+{
+    busReset();
+    int wakes = 0;
+    int full = busSubscribe(BUS_MASK(BUS_DATA_SENT), countWake, &wakes);
+    int other = busSubscribe(BUS_MASK(BUS_DATA_SENT), nullptr, nullptr);
+
+    bool accepted = true;
+    for (int i = 0; i < BUS_QUEUE_DEPTH; i++)
+        accepted = accepted && busPublish(makeEvent(BUS_DATA_SENT, i, i));
+    expect(accepted && wakes == BUS_QUEUE_DEPTH, "queue takes BUS_QUEUE_DEPTH events, one wake each");
+
+    bool rejected = !busPublish(makeEvent(BUS_DATA_SENT, 99, 99));
+    expect(rejected && busDropped(full) == 1 && wakes == BUS_QUEUE_DEPTH,
+           "a full queue drops, counts it and does not wake");
+
+    // The drop was per queue: drain one and the next publish fits
+    BusEvent event;
+    busPoll(other, event);
+    busPoll(full, event);
+    bool fits = busPublish(makeEvent(BUS_DATA_SENT, 100, 100));
+    int32_t last = -1;
+    int drained = 0;
+    while (busPoll(full, event))
+    {
+        last = event.value;
+        drained++;
+    }
+    expect(fits && drained == BUS_QUEUE_DEPTH && last == 100, "oldest events survive an overflow");
+}
+
+// Producers tag events with their id and a running count; the subscriber
+// checks that every event arrives exactly once and in per-producer order
+static void checkConcurrent(int producers, int perProducer)
+{
+    busReset();
+    int subscriber = busSubscribe(BUS_MASK(BUS_DATA_SENT), nullptr, nullptr);
+
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++)
+    {
+        threads.emplace_back([&, p]()
+                             {
+            while (!go.load())
+                std::this_thread::yield();
+            for (int i = 0; i < perProducer; i++)
+            {
+                // Full means the consumer is behind; the bus never blocks,
+                // so the producer retries
+                while (!busPublish(makeEvent(BUS_DATA_SENT, p, i)))
+                    std::this_thread::yield();
+            } });
+    }
+
+    std::vector<int32_t> next(producers, 0);
+    long received = 0;
+    bool inOrder = true;
+    go = true;
+    while (received < (long)producers * perProducer)
+    {
+        BusEvent event;
+        if (!busPoll(subscriber, event))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if (event.timestampMs >= (uint32_t)producers || event.value != next[event.timestampMs])
+            inOrder = false;
+        else
+            next[event.timestampMs]++;
+        received++;
+    }
+    for (std::thread &t : threads)
+        t.join();
+
+    BusEvent extra;
+    char what[80];
+    snprintf(what, sizeof(what), "%d producers x %d events: exactly once, in order", producers, perProducer);
+    expect(inOrder && !busPoll(subscriber, extra), what);
+}
+
+static void benchmark()
+{
+    // One task publishing to one subscriber and draining it
+    busReset();
+    int subscriber = busSubscribe(BUS_MASK(BUS_DATA_SENT), nullptr, nullptr);
+    const long rounds = 20000000;
+    long sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < rounds; i++)
+    {
+        BusEvent event;
+        busPublish(makeEvent(BUS_DATA_SENT, 0, (int32_t)i));
+        busPoll(subscriber, event);
+        sink += event.value;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("publish + poll, one thread            %6.1f ns/event (checksum %ld)\n", seconds * 1e9 / rounds, sink);
+
+    // Publishing to every subscriber slot at once
+    busReset();
+    for (int i = 0; i < BUS_MAX_SUBSCRIBERS; i++)
+        busSubscribe(BUS_MASK(BUS_DATA_SENT), nullptr, nullptr);
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < rounds / 8; i++)
+    {
+        BusEvent event;
+        busPublish(makeEvent(BUS_DATA_SENT, 0, (int32_t)i));
+        for (int s = 0; s < BUS_MAX_SUBSCRIBERS; s++)
+            busPoll(s, event);
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("publish to %d subscribers + polls      %6.1f ns/event\n", BUS_MAX_SUBSCRIBERS, seconds * 1e9 / (rounds / 8));
+
+    // Producer and consumer threads, the way tasks use it on the device
+    for (int producers : {1, 2, 4})
+    {
+        const int perProducer = 2000000 / producers;
+        start = std::chrono::steady_clock::now();
+        checkConcurrent(producers, perProducer);
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("  %d producer thread(s) -> 1 consumer   %6.2f M events/s\n", producers,
+               (double)producers * perProducer / seconds / 1e6);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    checkSubscriptions();
+    checkOverflow();
+    checkConcurrent(4, 200000);
+    printCheckResult();
+
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0)
+        benchmark();
+    return checkExitCode();
+}
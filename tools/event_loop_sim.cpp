@@ -0,0 +1,169 @@
+// Command latency, sampling lateness and idle wakeups for the original
+// loop, which ended every pass with delay(calculateLoopDelay(rate)), against
+// the event-driven one, which blocks in eventLoopWait() until an event
+// source signals or calculateWakeTimeout() runs out. Both are run on the
+// same simulated event sources: commands at random times, a BOOT press now
+// and then, and WiFi drops. From the repository root:
+//
+//   g++ -std=gnu++17 -O2 tools/event_loop_sim.cpp -o event_loop_sim
+//   ./event_loop_sim [minutes]
+//
+// Latency is from a command's line ending to the end of its handling.
+// Busy time is modelled with the pass costs below, which are assumptions,
+// not measurements; wakeup counts and latencies follow from the two
+// scheduling policies alone.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "check.h"
+
+// Device-side assumptions
+static const double PASS_US = 150;       // A pass with nothing due: housekeeping checks
+static const double SAMPLE_US = 2000;    // Read 4 channels, filter, encode, queue
+static const double COMMAND_US = 500;    // Parse, apply, build the response
+static const double RX_TIMEOUT_US = 174; // UART RX timeout, 2 symbols at 115200
+static const double COMMAND_MEAN_GAP_US = 5e6;
+static const double BUTTON_MEAN_GAP_US = 600e6;
+static const double WIFI_DROP_MEAN_GAP_US = 900e6;
+static const double HOUSEKEEPING_US = 1e6; // Cap on the event-driven wait
+static const double WAKE_BOUND_MS = 5.0;
+
+// The original calculateLoopDelay()
+static double pollingDelayUs(double rateMs)
+{
+    if (rateMs <= 2000)
+        return 10e3;
+    if (rateMs <= 10000)
+        return 50e3;
+    if (rateMs <= 30000)
+        return 100e3;
+    return 250e3;
+}
+
+struct Source
+{
+    double atUs;
+    bool command; // Otherwise a button edge or WiFi drop, handled in the pass
+};
+
+struct Result
+{
+    std::vector<double> latencyMs;  // Commands
+    std::vector<double> reactionMs; // Button edges and WiFi drops
+    std::vector<double> lateMs;     // Sample start after its due time
+    double wakeups;
+    double busyUs;
+};
+
+static std::vector<Source> sources(double durationUs, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<Source> out;
+    auto add = [&](double meanGapUs, bool command)
+    {
+        std::exponential_distribution<double> gap(1.0 / meanGapUs);
+        for (double t = gap(rng); t < durationUs; t += gap(rng))
+            out.push_back({t, command});
+    };
+    add(COMMAND_MEAN_GAP_US, true);
+    add(BUTTON_MEAN_GAP_US, false);
+    add(WIFI_DROP_MEAN_GAP_US, false);
+    std::sort(out.begin(), out.end(), [](const Source &a, const Source &b) { return a.atUs < b.atUs; });
+    return out;
+}
+
+static Result simulate(bool eventDriven, double rateMs, double durationUs, const std::vector<Source> &events)
+{
+    const double rateUs = rateMs * 1000;
+    Result result = {};
+    double now = 0;
+    double lastReadingUs = -rateUs; // First pass samples, as after setup()
+    size_t next = 0;                // First event not yet handled
+
+    while (now < durationUs)
+    {
+        // One pass: commands and events that have landed, then the sample
+        result.wakeups++;
+        double t = now + PASS_US;
+        for (; next < events.size() && events[next].atUs + (eventDriven ? RX_TIMEOUT_US : 0) <= now; next++)
+        {
+            if (events[next].command)
+            {
+                t += COMMAND_US;
+                result.latencyMs.push_back((t - events[next].atUs) / 1000);
+            }
+            else
+                result.reactionMs.push_back((t - events[next].atUs) / 1000);
+        }
+        if (now - lastReadingUs >= rateUs)
+        {
+            result.lateMs.push_back((now - (lastReadingUs + rateUs)) / 1000);
+            lastReadingUs = now;
+            t += SAMPLE_US;
+        }
+        result.busyUs += t - now;
+
+        if (!eventDriven)
+        {
+            now = t + pollingDelayUs(rateMs);
+            continue;
+        }
+
+        // calculateWakeTimeout(): the next sample, capped for housekeeping
+        double wake = std::min(t + HOUSEKEEPING_US, std::max(t, lastReadingUs + rateUs));
+
+        // An event that landed during the pass left its bit set, so the
+        // wait returns at once; a later one wakes the wait early
+        if (next < events.size())
+        {
+            double signalled = events[next].atUs + (events[next].command ? RX_TIMEOUT_US : 0);
+            wake = std::min(wake, std::max(t, signalled));
+        }
+        now = wake;
+    }
+    return result;
+}
+
+static double percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+        return 0;
+    std::sort(values.begin(), values.end());
+    return values[(size_t)(p * (values.size() - 1))];
+}
+
+int main(int argc, char **argv)
+{
+    double minutes = argc >= 2 ? atof(argv[1]) : 120;
+    double durationUs = minutes * 60e6;
+    std::vector<Source> events = sources(durationUs, 31);
+    printf("%.0f min, one command per %.0f s on average, pass %.0f us, sample %.0f us, command %.0f us\n", minutes,
+           COMMAND_MEAN_GAP_US / 1e6, PASS_US, SAMPLE_US, COMMAND_US);
+    printf("%-8s %-8s %10s %10s %11s %10s %10s %8s\n", "rate", "loop", "cmd p50", "cmd p99", "event p99", "late p99",
+           "wakeups/s", "busy");
+
+    for (double rateMs : {100.0, 1000.0, 5000.0, 30000.0, 60000.0})
+    {
+        Result polled = simulate(false, rateMs, durationUs, events);
+        Result driven = simulate(true, rateMs, durationUs, events);
+        for (const Result *r : {&polled, &driven})
+        {
+            printf("%6.0f ms %-8s %7.2f ms %7.2f ms %8.2f ms %7.2f ms %10.2f %7.3f%%\n", rateMs,
+                   r == &polled ? "polled" : "events", percentile(r->latencyMs, 0.5), percentile(r->latencyMs, 0.99),
+                   percentile(r->reactionMs, 0.99), percentile(r->lateMs, 0.99), r->wakeups / (durationUs / 1e6),
+                   100 * r->busyUs / durationUs);
+        }
+
+        char what[80];
+        snprintf(what, sizeof(what), "%.0f ms: event-driven command p99 %.2f ms < %.0f ms", rateMs,
+                 percentile(driven.latencyMs, 0.99), WAKE_BOUND_MS);
+        expect(percentile(driven.latencyMs, 0.99) < WAKE_BOUND_MS, what);
+        snprintf(what, sizeof(what), "%.0f ms: samples on time, fewer wakeups than polling", rateMs);
+        expect(percentile(driven.lateMs, 1.0) < 1 && driven.wakeups < polled.wakeups, what);
+    }
+    printCheckResult();
+    return checkExitCode();
+}
@@ -0,0 +1,213 @@
+// Host checks for src/sensors/thermocouple_linearization.cpp. The file is
+// built into this one so the NIST reference functions it tabulates can be
+// evaluated in double precision as the reference. For every type, every
+// 0.1 C step of its range is taken to EMF and back through the fixed-point
+// tables, with and without cold-junction compensation, and the table EMFs
+// are checked against values printed in the NIST tables. With "bench", the
+// table conversion is timed against the NIST inverse polynomial for type K
+// evaluated in float. From the repository root:
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/linearization_check.cpp -o linearization_check
+//   ./linearization_check        # accuracy
+//   ./linearization_check bench  # also cycles per conversion
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "check.h"
+#include "sensors/thermocouple_linearization.cpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLES 1
+#endif
+
+struct Reference
+{
+    char type;
+    double (*emf)(double);
+    double minC, maxC; // Range checked
+    double limitC;     // Worst error allowed over that range from -200 C up
+    double coldLimitC; // Worst error allowed below -200 C
+};
+
+// B is checked from 250 C: below that its EMF is a few microvolts and
+// non-monotonic, and no instrument uses it there. The others are checked
+// down to their table's lower bound. Below -200 C, where the NIST inverse
+// functions (and so every datasheet accuracy figure) stop, the EMF curve
+// flattens and interpolating 5 C steps errs by up to 0.6 C near -270 C.
+static const Reference references[] = {
+    {'B', emfB, 250, 1820, 0.05, 0},   {'E', emfE, -270, 1000, 0.05, 0.7}, {'J', emfJ, -210, 1200, 0.05, 0.05},
+    {'K', emfK, -270, 1370, 0.05, 0.7}, {'N', emfN, -270, 1300, 0.05, 0.7}, {'R', emfR, -50, 1760, 0.05, 0},
+    {'S', emfS, -50, 1760, 0.05, 0},    {'T', emfT, -270, 400, 0.05, 0.7},
+};
+
+static int32_t emfUnits(double mv)
+{
+    double units = mv * EMF_UNITS_PER_MV;
+    return (int32_t)lround(units);
+}
+
+static void checkAgainstReference()
+{
+    printf("%-4s %-14s %12s %12s %14s %14s\n", "type", "range C", "max err C", "rms err C", "CJC max err C",
+           "<-200 max err");
+    for (const Reference &ref : references)
+    {
+        const ThermocoupleTable *table = thermocoupleTable(ref.type);
+        double worst = 0, sumSq = 0, worstCjc = 0, worstCold = 0;
+        size_t n = 0;
+        for (int tenths = (int)(ref.minC * 10); tenths <= (int)(ref.maxC * 10); tenths++)
+        {
+            double c = tenths / 10.0;
+            bool cold = tenths < -2000;
+            double error = fabs(thermocoupleMilliCFromEmf(*table, emfUnits(ref.emf(c))) / 1000.0 - c);
+            if (cold)
+                worstCold = std::max(worstCold, error);
+            else
+                worst = std::max(worst, error);
+            sumSq += error * error;
+            n++;
+
+            // The chip measures hot minus cold junction; compensate at 25 C
+            if (c >= ref.minC + 30)
+            {
+                int32_t measured = emfUnits(ref.emf(c) - ref.emf(25.0));
+                double cjc = fabs(linearizeThermocouple(*table, measured, 25000) / 1000.0 - c);
+                if (cold)
+                    worstCold = std::max(worstCold, cjc);
+                else
+                    worstCjc = std::max(worstCjc, cjc);
+            }
+        }
+        printf("%-4c %5.0f..%-6.0f %12.3f %12.4f %14.3f %14.3f\n", ref.type, ref.minC, ref.maxC, worst,
+               sqrt(sumSq / n), worstCjc, worstCold);
+
+        char what[80];
+        snprintf(what, sizeof(what), "type %c within %.2f C of NIST, with and without CJC", ref.type, ref.limitC);
+        expect(worst <= ref.limitC && worstCjc <= ref.limitC, what);
+        if (ref.minC < -200)
+        {
+            snprintf(what, sizeof(what), "type %c below -200 C: within %.2f C", ref.type, ref.coldLimitC);
+            expect(worstCold <= ref.coldLimitC, what);
+        }
+    }
+}
+
+// Printed in the NIST ITS-90 tables (NIST Monograph 175), mV
+static void checkPrintedValues()
+{
+    struct Point
+    {
+        char type;
+        int c;
+        double mv;
+    };
+    const Point points[] = {
+        {'K', 100, 4.096}, {'K', 200, 8.138}, {'K', 500, 20.644}, {'K', 1000, 41.276},
+        {'J', 100, 5.269}, {'J', 500, 27.393}, {'T', 100, 4.279},  {'E', 100, 6.319},
+        {'N', 100, 2.774}, {'S', 1000, 9.587}, {'R', 1000, 10.506}, {'B', 1000, 4.834},
+    };
+    bool all = true;
+    for (const Point &p : points)
+    {
+        const ThermocoupleTable *table = thermocoupleTable(p.type);
+        double mv = thermocoupleEmfFromMilliC(*table, p.c * 1000) / EMF_UNITS_PER_MV;
+        if (fabs(mv - p.mv) > 0.0005)
+        {
+            printf("  %c at %d C: %.4f mV, table says %.3f\n", p.type, p.c, mv, p.mv);
+            all = false;
+        }
+    }
+    expect(all, "table EMFs match the printed NIST values to 1 uV");
+}
+
+// NIST ITS-90 inverse for type K, t90 = sum d_i E^i with E in mV
+static const float K_INVERSE_NEG[] = {0.0f, 2.5173462e1f, -1.1662878f, -1.0833638f, -8.977354e-1f,
+                                      -3.7342377e-1f, -8.6632643e-2f, -1.0450598e-2f, -5.1920577e-4f};
+static const float K_INVERSE_LOW[] = {0.0f, 2.508355e1f, 7.860106e-2f, -2.503131e-1f, 8.31527e-2f,
+                                      -1.228034e-2f, 9.804036e-4f, -4.41303e-5f, 1.057734e-6f, -1.052755e-8f};
+static const float K_INVERSE_HIGH[] = {-1.318058e2f, 4.830222e1f, -1.646031f, 5.464731e-2f,
+                                       -9.650715e-4f, 8.802193e-6f, -3.11081e-8f};
+
+template <size_t N>
+static float horner(const float (&c)[N], float x)
+{
+    float result = c[N - 1];
+    for (size_t i = N - 1; i > 0; i--)
+        result = result * x + c[i - 1];
+    return result;
+}
+
+static float kInverseFloat(float mv)
+{
+    if (mv < 0.0f)
+        return horner(K_INVERSE_NEG, mv);
+    return mv < 20.644f ? horner(K_INVERSE_LOW, mv) : horner(K_INVERSE_HIGH, mv);
+}
+
+static void benchmark()
+{
+    const ThermocoupleTable *table = thermocoupleTable('K');
+    std::mt19937 rng(28);
+    std::uniform_real_distribution<double> temperature(-200.0, 1370.0);
+    std::vector<int32_t> emf(4096);
+    std::vector<float> mv(emf.size());
+    for (size_t i = 0; i < emf.size(); i++)
+    {
+        emf[i] = emfUnits(emfK(temperature(rng)));
+        mv[i] = (float)(emf[i] / EMF_UNITS_PER_MV);
+    }
+
+    // The float polynomial is the baseline the tables replace; check it
+    // too, so the timing compares like with like
+    double worst = 0;
+    for (int c = -200; c <= 1370; c++)
+        worst = std::max(worst, fabs(kInverseFloat((float)emfK(c)) - c));
+    char what[80];
+    snprintf(what, sizeof(what), "K inverse polynomial in float within %.3f C", worst);
+    expect(worst < 0.1, what);
+
+    const int rounds = 2000;
+    auto run = [&](const char *name, auto convert)
+    {
+        double seconds = 0;
+        unsigned long long cycles = 0;
+        volatile double sink = 0;
+        for (int r = 0; r < rounds; r++)
+        {
+            auto start = std::chrono::steady_clock::now();
+#ifdef HAVE_CYCLES
+            unsigned long long c0 = __rdtsc();
+#endif
+            double sum = 0;
+            for (size_t i = 0; i < emf.size(); i++)
+                sum += convert(i);
+#ifdef HAVE_CYCLES
+            cycles += __rdtsc() - c0;
+#endif
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            sink = sink + sum;
+        }
+        double conversions = (double)rounds * emf.size();
+        printf("%-34s %6.1f ns/conversion  %6.1f TSC cycles/conversion\n", name, seconds * 1e9 / conversions,
+               cycles / conversions);
+    };
+    run("fixed-point table (K)", [&](size_t i) { return (double)thermocoupleMilliCFromEmf(*table, emf[i]); });
+    run("fixed-point table + CJC (K)", [&](size_t i) { return (double)linearizeThermocouple(*table, emf[i], 25000); });
+    run("NIST inverse polynomial, float (K)", [&](size_t i) { return (double)kInverseFloat(mv[i]); });
+}
+
+int main(int argc, char **argv)
+{
+    checkAgainstReference();
+    checkPrintedValues();
+    bool bench = argc >= 2 && strcmp(argv[1], "bench") == 0;
+    if (bench)
+        benchmark();
+    printCheckResult();
+    return checkExitCode();
+}
@@ -0,0 +1,359 @@
+// Host-side receiver for measuring sustained throughput of the serial
+// link, UART bridge or native USB CDC (the esp32-s3-usb build). It asks
+// the device for its whole history with get_history, which the loop
+// streams as fast as the link drains, and times the history frames as
+// they arrive. Every line is checked to be one complete JSON value, and
+// the frame counter is checked for gaps. Reports link bytes/s, history
+// frames/s, and the rate of four-channel data frames (as the firmware
+// encodes them) that the same bytes would carry. From the repository
+// root:
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/link_receiver.cpp -o link_receiver -pthread
+//   ./link_receiver /dev/ttyUSB0 115200   # UART bridge
+//   ./link_receiver /dev/ttyUSB0 921600   # esp32-s3-fast-uart build
+//   ./link_receiver /dev/ttyACM0          # native USB CDC, baud ignored
+//   ./link_receiver                       # self-test over a pty
+//
+// Let the device sample for a while first so its history holds enough
+// rows to measure; at 100 ms, ten minutes gives 6000. The self-test feeds
+// synthetic history frames through a pseudo-terminal, paced at the UART
+// byte rates and unpaced, to check the receiver's arithmetic and show its
+// own ceiling.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include "check.h"
+#include "common/temperature_sample.h"
+#include "protocol/protocol.h"
+
+static const int FIRST_FRAME_TIMEOUT_MS = 5000;
+static const int IDLE_TIMEOUT_MS = 3000;
+static const char *const DEVICE_ID = "P61-A1B2C3D4E5F6";
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A four-channel data frame as transmitSample() encodes it, line ending
+// included
+static size_t dataFrameLength()
+{
+    DataMessage msg = {};
+    msg.deviceId = protoSpan(DEVICE_ID);
+    msg.firmwareVersion = protoSpan("1.4.0");
+    msg.metadata.timestamp = 3600000;
+    msg.metadata.samplingRateMs = 100;
+    msg.metadata.sequence = 36000;
+    msg.metadata.keyframe = true;
+    msg.metadata.hasHostTime = true;
+    msg.metadata.hostTimeUs = 1700000003600000LL;
+    msg.channelCount = 4;
+    for (uint8_t i = 0; i < 4; i++)
+        msg.channels[i] = {(uint8_t)(i + 1), true, 201.25f + i * 10.5f, 0};
+    char frame[PROTO_DATA_FRAME_MAX];
+    return encodeDataMessage(msg, frame, sizeof(frame)) + 2;
+}
+
+static long memberInt(const std::string &line, const char *key)
+{
+    std::string quoted = std::string("\"") + key + "\":";
+    size_t at = line.find(quoted);
+    return at == std::string::npos ? -1 : strtol(line.c_str() + at + quoted.size(), nullptr, 10);
+}
+
+struct Received
+{
+    size_t historyFrames;
+    size_t otherLines;
+    size_t bytes;   // After the first history frame up to the last, all lines
+    double seconds; // Between those two frames arriving
+    long frames;    // Announced in each history frame
+    size_t gaps;    // Frame numbers skipped
+    size_t invalid; // Lines that are not one complete JSON value
+    bool complete;  // The last frame arrived
+};
+
+// Reads lines from fd until the history stream ends or goes quiet
+static Received receive(int fd)
+{
+    Received r = {};
+    r.frames = -1;
+    std::string pending;
+    char chunk[4096];
+    long expected = 0;
+    auto first = std::chrono::steady_clock::now();
+    auto lastFrame = first;
+    auto lastByte = first;
+
+    for (;;)
+    {
+        int timeout = r.historyFrames ? IDLE_TIMEOUT_MS : FIRST_FRAME_TIMEOUT_MS;
+        pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, 100) <= 0)
+        {
+            if (secondsSince(lastByte) * 1000 > timeout)
+                break;
+            continue;
+        }
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n <= 0)
+            break;
+        lastByte = std::chrono::steady_clock::now();
+        pending.append(chunk, n);
+
+        size_t end;
+        while ((end = pending.find('\n')) != std::string::npos)
+        {
+            std::string line = pending.substr(0, end);
+            pending.erase(0, end + 1);
+            size_t wire = line.size() + 1;
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty() || line[0] != '{')
+                continue; // Log lines and blank keep-alives
+
+            ProtoCursor c = {line.data(), line.data() + line.size()};
+            if (!protoSkipValue(c) || c.p != c.end)
+                r.invalid++;
+
+            bool history = line.find("\"type\":\"history\"") != std::string::npos;
+            if (r.historyFrames > 0)
+                r.bytes += wire;
+            if (!history)
+            {
+                r.otherLines++;
+                if (line.find("history_started") != std::string::npos)
+                    printf("device: %ld rows, %ld points, %ld frames\n", memberInt(line, "rows"),
+                           memberInt(line, "points"), memberInt(line, "frames"));
+                continue;
+            }
+
+            if (r.historyFrames++ == 0)
+                first = lastByte;
+            lastFrame = lastByte;
+            long frame = memberInt(line, "frame");
+            r.frames = memberInt(line, "frames");
+            if (frame > expected)
+                r.gaps += frame - expected;
+            expected = frame + 1;
+            if (expected >= r.frames)
+            {
+                r.complete = true;
+                r.seconds = std::chrono::duration<double>(lastFrame - first).count();
+                return r;
+            }
+        }
+    }
+    r.seconds = std::chrono::duration<double>(lastFrame - first).count();
+    return r;
+}
+
+static void report(const Received &r, double uartBytesPerSecond)
+{
+    double bytesPerSecond = r.seconds > 0 ? r.bytes / r.seconds : 0;
+    double framesPerSecond = r.seconds > 0 ? (r.historyFrames - 1) / r.seconds : 0;
+    printf("  %zu history frames (%ld announced, %zu missing), %zu other lines, %zu invalid\n", r.historyFrames,
+           r.frames, r.gaps, r.otherLines, r.invalid);
+    printf("  %.2f s, %.0f B/s, %.1f history frames/s, %.1f four-channel data frames/s\n", r.seconds,
+           bytesPerSecond, framesPerSecond, bytesPerSecond / dataFrameLength());
+    if (uartBytesPerSecond > 0)
+        printf("  %.0f%% of the 8N1 ceiling\n", 100 * bytesPerSecond / uartBytesPerSecond);
+}
+
+static speed_t speedFor(long baud)
+{
+    switch (baud)
+    {
+    case 115200:
+        return B115200;
+    case 230400:
+        return B230400;
+    case 460800:
+        return B460800;
+    case 921600:
+        return B921600;
+    default:
+        return 0;
+    }
+}
+
+static int openPort(const char *path, long baud)
+{
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0)
+        return -1;
+    termios tio;
+    if (tcgetattr(fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        if (speedFor(baud))
+        {
+            cfsetispeed(&tio, speedFor(baud));
+            cfsetospeed(&tio, speedFor(baud));
+        }
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+static int measureDevice(const char *path, long baud)
+{
+    if (baud && !speedFor(baud))
+    {
+        fprintf(stderr, "unsupported baud %ld\n", baud);
+        return 2;
+    }
+    int fd = openPort(path, baud);
+    if (fd < 0)
+    {
+        perror(path);
+        return 2;
+    }
+
+    // A blank line first re-syncs a device that woke from light sleep
+    const char request[] = "\n\n{\"get_history\":{\"since_ms\":0,\"max_points\":0},\"request_id\":\"link\"}\n";
+    if (write(fd, request, sizeof(request) - 1) != (ssize_t)(sizeof(request) - 1))
+    {
+        perror("write");
+        return 2;
+    }
+    printf("%s%s\n", path, baud ? "" : " (baud set by the driver)");
+    Received r = receive(fd);
+    close(fd);
+    if (r.historyFrames < 2)
+    {
+        fprintf(stderr, "too few history frames to time; let the device sample for longer\n");
+        return 1;
+    }
+    report(r, baud ? baud / 10.0 : 0);
+    expect(r.complete && r.gaps == 0 && r.invalid == 0, "history arrived complete, in order, well formed");
+    return checkExitCode();
+}
+
+// Synthetic history frames, as sendHistoryFrame() encodes them
+static std::string historyFrame(uint32_t frame, uint32_t frames)
+{
+    TemperatureSample rows[32];
+    for (uint16_t i = 0; i < 32; i++)
+    {
+        TemperatureSample &s = rows[i];
+        s = {};
+        s.timestamp = (frame * 32 + i) * 100;
+        s.channelCount = 4;
+        for (uint8_t ch = 0; ch < 4; ch++)
+            s.temperatureC[ch] = 150.0f + ((frame * 32 + i) % 900) * 0.1f + ch * 12.5f;
+    }
+    char buffer[8192];
+    ProtoWriter w;
+    protoWriterInit(w, buffer, sizeof(buffer));
+    protoBeginObject(w);
+    protoKey(w, "type");
+    protoString(w, protoSpan("history"));
+    protoKey(w, "device_id");
+    protoString(w, protoSpan(DEVICE_ID));
+    protoKey(w, "firmware_version");
+    protoString(w, protoSpan("1.4.0"));
+    protoKey(w, "metadata");
+    protoBeginObject(w);
+    protoKey(w, "timestamp");
+    protoInt(w, (uint32_t)rows[0].timestamp);
+    protoKey(w, "sample_count");
+    protoInt(w, 32);
+    protoKey(w, "frame");
+    protoInt(w, frame);
+    protoKey(w, "frames");
+    protoInt(w, frames);
+    protoKey(w, "remaining");
+    protoInt(w, (frames - frame - 1) * 32);
+    protoKey(w, "downsampled");
+    protoBool(w, false);
+    size_t length = protoFinishSampleColumns(w, rows, 32);
+    return std::string(buffer, length) + "\r\n";
+}
+
+// Streams frames into fd at bytesPerSecond (0 = as fast as it takes them)
+static void feed(int fd, uint32_t frames, double bytesPerSecond)
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t sent = 0;
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        std::string frame = historyFrame(i, frames);
+        for (size_t off = 0; off < frame.size();)
+        {
+            ssize_t n = write(fd, frame.data() + off, frame.size() - off);
+            if (n <= 0)
+                return;
+            off += n;
+        }
+        sent += frame.size();
+        if (bytesPerSecond > 0)
+            std::this_thread::sleep_until(start + std::chrono::duration<double>(sent / bytesPerSecond));
+    }
+}
+
+static int selfTest()
+{
+    struct Case
+    {
+        const char *name;
+        double bytesPerSecond;
+        uint32_t frames;
+    };
+    const Case cases[] = {{"paced at 115200 8N1", 11520, 40}, {"paced at 921600 8N1", 92160, 300},
+                          {"unpaced (receiver ceiling)", 0, 5000}};
+    printf("self-test over a pty; one four-channel data frame is %zu bytes\n", dataFrameLength());
+
+    for (const Case &c : cases)
+    {
+        int master = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+        {
+            perror("pty");
+            return 2;
+        }
+        int slave = openPort(ptsname(master), 0);
+        std::thread writer(feed, master, c.frames, c.bytesPerSecond);
+        printf("%s\n", c.name);
+        Received r = receive(slave);
+        writer.join();
+        close(slave);
+        close(master);
+        report(r, c.bytesPerSecond);
+
+        char what[80];
+        snprintf(what, sizeof(what), "%s: %u frames, none missing", c.name, c.frames);
+        expect(r.complete && r.historyFrames == c.frames && r.gaps == 0 && r.invalid == 0, what);
+        if (c.bytesPerSecond > 0)
+        {
+            double measured = r.bytes / r.seconds;
+            snprintf(what, sizeof(what), "%s: measured within 5%% of the pace", c.name);
+            expect(measured > 0.95 * c.bytesPerSecond && measured < 1.05 * c.bytesPerSecond, what);
+        }
+        else
+        {
+            snprintf(what, sizeof(what), "%s: keeps up with full-speed USB (1 MB/s)", c.name);
+            expect(r.bytes / r.seconds > 1e6, what);
+        }
+    }
+    printCheckResult();
+    return checkExitCode();
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 2)
+        return measureDevice(argv[1], argc >= 3 ? atol(argv[2]) : 0);
+    return selfTest();
+}
@@ -0,0 +1,53 @@
+#pragma once
+// Mock of the Adafruit MAX31855 driver over the mocked bus. Each call
+// clocks out the chip's 32-bit frame and decodes it as the library does.
+#include "Arduino.h"
+
+#define MAX31855_FAULT_OPEN 0x01
+#define MAX31855_FAULT_SHORT_GND 0x02
+#define MAX31855_FAULT_SHORT_VCC 0x04
+#define MAX31855_FAULT_ALL 0x07
+
+class Adafruit_MAX31855
+{
+public:
+    explicit Adafruit_MAX31855(int8_t csPin) : csPin(csPin) {}
+
+    bool begin() { return true; } // The library never checks for a chip
+
+    double readCelsius()
+    {
+        uint32_t v = frame();
+        if (v & 0x7)
+            return NAN;
+        int32_t hot = (int32_t)v >> 18; // Signed 14 bits, 0.25 C
+        return hot * 0.25;
+    }
+
+    double readInternal()
+    {
+        int32_t cold = (int32_t)(frame() << 16) >> 20; // Signed 12 bits, 0.0625 C
+        return cold * 0.0625;
+    }
+
+    uint8_t readError() { return frame() & 0x7; }
+
+private:
+    uint32_t frame()
+    {
+        digitalWrite(csPin, LOW);
+        const MockChip &chip = mockChip(csPin);
+        uint32_t v = 0xFFFFFFFF;
+        if (chip.present)
+        {
+            v = ((uint32_t)(int32_t)(chip.hotC * 4.0f) & 0x3FFF) << 18;
+            v |= ((uint32_t)(int32_t)(chip.coldC * 16.0f) & 0xFFF) << 4;
+            v |= chip.fault & 0x7;
+            v |= (chip.fault & 0x7) ? 0x10000 : 0;
+        }
+        digitalWrite(csPin, HIGH);
+        return v;
+    }
+
+    int8_t csPin;
+};
@@ -0,0 +1,67 @@
+#pragma once
+// Mock of the Adafruit MAX31856 driver over the mocked bus: a register
+// fetch per call, with all ones when MISO floats
+#include "Arduino.h"
+
+#define MAX31856_FAULT_CJRANGE 0x80
+#define MAX31856_FAULT_TCRANGE 0x40
+#define MAX31856_FAULT_CJHIGH 0x20
+#define MAX31856_FAULT_CJLOW 0x10
+#define MAX31856_FAULT_TCHIGH 0x08
+#define MAX31856_FAULT_TCLOW 0x04
+#define MAX31856_FAULT_OVUV 0x02
+#define MAX31856_FAULT_OPEN 0x01
+
+typedef enum
+{
+    MAX31856_TCTYPE_B = 0,
+    MAX31856_TCTYPE_E,
+    MAX31856_TCTYPE_J,
+    MAX31856_TCTYPE_K,
+    MAX31856_TCTYPE_N,
+    MAX31856_TCTYPE_R,
+    MAX31856_TCTYPE_S,
+    MAX31856_TCTYPE_T,
+} max31856_thermocoupletype_t;
+
+typedef enum
+{
+    MAX31856_ONESHOT,
+    MAX31856_ONESHOT_NOWAIT,
+    MAX31856_CONTINUOUS,
+} max31856_conversion_mode_t;
+
+class Adafruit_MAX31856
+{
+public:
+    explicit Adafruit_MAX31856(int8_t csPin) : csPin(csPin) {}
+
+    bool begin() { return true; } // As in the library, no chip check
+    void setThermocoupleType(max31856_thermocoupletype_t type) { this->type = type; }
+    void setConversionMode(max31856_conversion_mode_t) {}
+
+    uint8_t readFault()
+    {
+        select();
+        return mockChip(csPin).present ? mockChip(csPin).fault : 0xFF;
+    }
+
+    // LTCBH..LTCBL: signed 19 bits in 1/128 C
+    float readThermocoupleTemperature()
+    {
+        select();
+        int32_t raw = mockChip(csPin).present ? (int32_t)(mockChip(csPin).hotC * 128.0f) : -1;
+        return raw / 128.0f;
+    }
+
+    max31856_thermocoupletype_t type = MAX31856_TCTYPE_K;
+
+private:
+    void select()
+    {
+        digitalWrite(csPin, LOW);
+        digitalWrite(csPin, HIGH);
+    }
+
+    int8_t csPin;
+};
@@ -0,0 +1,31 @@
+#pragma once
+// Host stand-in for the few Arduino calls the chip adapters make
+#include <math.h>
+#include <stdint.h>
+#include "mock_spi.h"
+
+#define OUTPUT 1
+#define HIGH 1
+#define LOW 0
+
+inline uint8_t &mockSelectedPin()
+{
+    static uint8_t pin = 0xFF;
+    return pin;
+}
+
+inline void pinMode(uint8_t, uint8_t) {}
+
+// Remembers which chip is selected for the next transfer
+inline void digitalWrite(uint8_t pin, uint8_t level)
+{
+    if (level == LOW)
+    {
+        mockSelectedPin() = pin;
+        mockChip(pin).transfers++;
+    }
+    else if (mockSelectedPin() == pin)
+    {
+        mockSelectedPin() = 0xFF;
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+// Mocked SPI bus. transfer16 answers as a MAX6675 on the selected pin.
+#include "Arduino.h"
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+struct SPISettings
+{
+    SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+class SPIClass
+{
+public:
+    void beginTransaction(SPISettings) {}
+    void endTransaction() {}
+
+    // D14..D3 temperature in 0.25 C, D2 open input, D1 always 0
+    uint16_t transfer16(uint16_t)
+    {
+        if (mockSelectedPin() == 0xFF || !mockChip(mockSelectedPin()).present)
+            return 0xFFFF;
+        const MockChip &chip = mockChip(mockSelectedPin());
+        if (chip.fault & 0x04)
+            return 0x0004;
+        return (uint16_t)((uint16_t)(chip.hotC * 4.0f) << 3);
+    }
+};
+
+inline SPIClass SPI;
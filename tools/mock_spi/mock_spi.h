@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+
+// What each chip select answers on the mocked bus. Tests set these between
+// reads to inject faults; the mock libraries and SPI turn them into the
+// words the real chip would shift out.
+struct MockChip
+{
+    bool present = true;    // false: MISO floats high and every bit reads 1
+    float hotC = 25.0f;     // Thermocouple junction
+    float coldC = 25.0f;    // Chip die
+    uint8_t fault = 0;      // Fault bits in the chip's own encoding
+    uint32_t transfers = 0; // Chip selects seen
+};
+
+inline MockChip &mockChip(uint8_t csPin)
+{
+    static MockChip chips[64];
+    return chips[csPin & 63];
+}
+
+inline void mockReset()
+{
+    for (uint8_t pin = 0; pin < 64; pin++)
+        mockChip(pin) = MockChip();
+}
@@ -0,0 +1,603 @@
+// Host checks for the MQTT publish queue (src/mqtt/mqtt_queue.cpp), then a
+// broker test: the queue drives a minimal MQTT 3.1.1 client over TCP the
+// way the publisher task does, with up to MQTT_MAX_IN_FLIGHT QoS 1
+// messages awaiting PUBACK. By default the broker is an in-process one that
+// holds each PUBACK for a simulated round trip and drops the connection
+// once mid-run; every message must arrive, in order of first delivery.
+// Given a host, a real broker is used instead and a second connection
+// subscribes to count what arrives. From the repository root:
+//
+//   g++ -std=gnu++17 -O2 -pthread -Isrc tools/mqtt_broker_check.cpp
+//       src/mqtt/mqtt_queue.cpp src/serial/tx_ring.cpp -o mqtt_broker_check
+//   ./mqtt_broker_check                  # queue checks, in-process broker
+//   ./mqtt_broker_check localhost [1883] # queue checks, real broker
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.h"
+#include "mqtt/mqtt_queue.h"
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// --- Queue ---------------------------------------------------------------
+
+static void push(MqttQueue &queue, uint8_t topic, const std::string &payload)
+{
+    char *slot = mqttQueuePush(queue, topic, payload.size());
+    if (slot)
+        memcpy(slot, payload.data(), payload.size());
+}
+
+// Publishes everything the window allows, numbering packets from nextId
+static std::vector<int32_t> publishWindow(MqttQueue &queue, int32_t &nextId, std::vector<std::string> *sent = nullptr)
+{
+    std::vector<int32_t> ids;
+    size_t index;
+    uint8_t topic;
+    const char *payload;
+    while (size_t length = mqttQueueNext(queue, &index, &topic, &payload))
+    {
+        if (sent)
+            sent->push_back(std::string(payload, length));
+        mqttQueueSent(queue, index, queue.pops, nextId);
+        ids.push_back(nextId++);
+    }
+    return ids;
+}
+
+static void checkQueue()
+{
+    static uint8_t storage[4096];
+    MqttQueue queue;
+    mqttQueueInit(queue, storage, sizeof(storage));
+    int32_t nextId = 1;
+
+    for (int i = 0; i < 12; i++)
+        push(queue, i % 2, "m" + std::to_string(i));
+    std::vector<std::string> sent;
+    std::vector<int32_t> ids = publishWindow(queue, nextId, &sent);
+    expect(ids.size() == MQTT_MAX_IN_FLIGHT && mqttQueueInFlight(queue) == MQTT_MAX_IN_FLIGHT,
+           "publishes a full window, then waits");
+    expect(sent.front() == "m0" && sent.back() == "m7", "window is the oldest messages, in order");
+
+    // Acks out of order: nothing leaves until the head is acked
+    mqttQueueAcked(queue, ids[2]);
+    mqttQueueAcked(queue, ids[1]);
+    expect(queue.ring.frames == 12, "acks behind an unacked head keep their messages");
+    mqttQueueAcked(queue, ids[0]);
+    expect(queue.ring.frames == 9 && queue.ring.sent == 3, "head ack releases the acked run behind it");
+    sent.clear();
+    publishWindow(queue, nextId, &sent);
+    expect(sent.size() == 3 && sent[0] == "m8" && sent[2] == "m10", "window refills from the next unsent");
+
+    // An ack that lands before the publish call has returned
+    mqttQueueInit(queue, storage, sizeof(storage));
+    push(queue, 0, "r0");
+    push(queue, 0, "r1");
+    size_t index;
+    uint8_t topic;
+    const char *payload;
+    mqttQueueNext(queue, &index, &topic, &payload);
+    uint32_t pops = queue.pops;
+    mqttQueueAcked(queue, nextId);
+    mqttQueueSent(queue, index, pops, nextId++);
+    expect(queue.ring.frames == 1 && mqttQueueInFlight(queue) == 0, "early ack is matched when the publish is recorded");
+
+    // Unmatched acks: only ids just ahead of the last publish are kept,
+    // across the 16-bit wrap, and only for a window's worth of publishes
+    mqttQueueInit(queue, storage, sizeof(storage));
+    for (int i = 0; i < 20; i++)
+        push(queue, 0, "w" + std::to_string(i));
+    int32_t wrapId = 65536 - MQTT_MAX_IN_FLIGHT;
+    ids = publishWindow(queue, wrapId); // Up to 65535
+    mqttQueueAcked(queue, 65000);       // Long gone
+    expect(queue.earlyAcks[0].packetId == 0, "ack behind the publish window is not kept");
+    mqttQueueAcked(queue, 1);
+    expect(queue.earlyAcks[0].packetId == 1, "ack just past the 65535 wrap is kept");
+    for (int32_t id : ids)
+        mqttQueueAcked(queue, id);
+    int32_t laterId = 10;
+    for (int i = 0; i <= MQTT_MAX_IN_FLIGHT; i++)
+    {
+        mqttQueueNext(queue, &index, &topic, &payload);
+        mqttQueueSent(queue, index, queue.pops, laterId);
+        mqttQueueAcked(queue, laterId++);
+    }
+    bool aged = true;
+    for (const MqttEarlyAck &early : queue.earlyAcks)
+        aged = aged && early.packetId == 0;
+    expect(aged, "early ack whose publish never came ages out");
+    mqttQueueAcked(queue, laterId);
+    mqttQueueDisconnected(queue);
+    expect(queue.earlyAcks[0].packetId == 0 && queue.earlyAcks[1].packetId == 0,
+           "disconnect forgets acks waiting for their publish");
+
+    // Expiry and a lost session put messages back to unsent, in place
+    mqttQueueInit(queue, storage, sizeof(storage));
+    for (int i = 0; i < 4; i++)
+        push(queue, 0, "e" + std::to_string(i));
+    ids = publishWindow(queue, nextId);
+    mqttQueueExpired(queue, ids[1]);
+    sent.clear();
+    publishWindow(queue, nextId, &sent);
+    expect(sent.size() == 1 && sent[0] == "e1", "expired packet is published again");
+    mqttQueueResendAll(queue);
+    sent.clear();
+    publishWindow(queue, nextId, &sent);
+    expect(sent.size() == 4 && sent[0] == "e0", "lost session republishes the whole window");
+
+    // Full ring: the oldest go, in flight or not, and the window follows
+    mqttQueueInit(queue, storage, sizeof(storage));
+    std::string big(500, 'x');
+    for (int i = 0; i < 4; i++)
+        push(queue, 0, big + std::to_string(i));
+    ids = publishWindow(queue, nextId);
+    for (int i = 4; i < 12; i++)
+        push(queue, 0, big + std::to_string(i));
+    const uint8_t *frame;
+    size_t length = txRingPeek(queue.ring, &frame);
+    bool headIsNewer = length > 0 && std::string((const char *)frame + 1, length - 1) != big + "0";
+    mqttQueueAcked(queue, ids[0]); // Late ack for an evicted message
+    expect(headIsNewer && queue.ring.dropped > 0 && mqttQueueInFlight(queue) < 4,
+           "overflow evicts the oldest, in-flight ones included");
+    sent.clear();
+    publishWindow(queue, nextId, &sent);
+    expect(!sent.empty() && queue.ring.frames == mqttQueueInFlight(queue), "evicted slots leave the window in step");
+
+    // Too big for the ring at all: rejected without evicting anything
+    size_t frames = queue.ring.frames;
+    expect(mqttQueuePush(queue, 0, sizeof(storage)) == nullptr && queue.ring.frames == frames,
+           "message larger than the ring is rejected");
+
+    // Against the old 256 fixed 4 KB slots in the same megabyte
+    static uint8_t megabyte[1024 * 1024];
+    mqttQueueInit(queue, megabyte, sizeof(megabyte));
+    std::string frameText(413, 'd');
+    while (queue.ring.dropped == 0)
+        push(queue, 0, frameText);
+    char what[80];
+    snprintf(what, sizeof(what), "1 MB holds %zu data frames of 413 B (slots held 256)", queue.ring.frames);
+    expect(queue.ring.frames > 2000, what);
+}
+
+// --- MQTT 3.1.1 on the wire ----------------------------------------------
+
+static std::string lengthBytes(size_t length)
+{
+    std::string out;
+    do
+    {
+        uint8_t digit = length % 128;
+        length /= 128;
+        out += (char)(length > 0 ? digit | 0x80 : digit);
+    } while (length > 0);
+    return out;
+}
+
+static std::string str16(const std::string &s)
+{
+    return std::string{(char)(s.size() >> 8), (char)(s.size() & 0xFF)} + s;
+}
+
+static std::string id16(uint16_t id)
+{
+    return std::string{(char)(id >> 8), (char)(id & 0xFF)};
+}
+
+static std::string packet(uint8_t header, const std::string &body)
+{
+    return std::string(1, (char)header) + lengthBytes(body.size()) + body;
+}
+
+static std::string connectPacket(const std::string &clientId)
+{
+    // Protocol level 4, clean session, 30 s keepalive
+    return packet(0x10, str16("MQTT") + std::string{4, 0x02, 0, 30} + str16(clientId));
+}
+
+struct Packet
+{
+    uint8_t header;
+    std::string body;
+};
+
+class Connection
+{
+  public:
+    int fd = -1;
+
+    bool open(const char *host, int port)
+    {
+        addrinfo hints = {}, *found = nullptr;
+        hints.ai_socktype = SOCK_STREAM;
+        if (getaddrinfo(host, std::to_string(port).c_str(), &hints, &found) != 0)
+            return false;
+        fd = socket(found->ai_family, SOCK_STREAM, 0);
+        bool connected = fd >= 0 && connect(fd, found->ai_addr, found->ai_addrlen) == 0;
+        freeaddrinfo(found);
+        if (!connected)
+            return false;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return true;
+    }
+
+    void close()
+    {
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+        pending.clear();
+    }
+
+    bool send(const std::string &bytes)
+    {
+        size_t done = 0;
+        while (done < bytes.size())
+        {
+            ssize_t n = ::send(fd, bytes.data() + done, bytes.size() - done, MSG_NOSIGNAL);
+            if (n <= 0)
+                return false;
+            done += n;
+        }
+        return true;
+    }
+
+    // 1 with a packet, 0 on timeout, -1 when the connection is gone
+    int read(Packet &out, int timeoutMs)
+    {
+        double deadline = now() + timeoutMs / 1000.0;
+        for (;;)
+        {
+            if (take(out))
+                return 1;
+            int wait = (int)((deadline - now()) * 1000);
+            pollfd p = {fd, POLLIN, 0};
+            if (wait <= 0 || poll(&p, 1, wait) == 0)
+                return 0;
+            char buffer[8192];
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0)
+                return -1;
+            pending.append(buffer, n);
+        }
+    }
+
+  private:
+    std::string pending;
+
+    bool take(Packet &out)
+    {
+        size_t length = 0, shift = 0, at = 1;
+        for (;; at++)
+        {
+            if (at >= pending.size())
+                return false;
+            uint8_t digit = pending[at];
+            length |= (size_t)(digit & 0x7F) << shift;
+            shift += 7;
+            if (!(digit & 0x80))
+                break;
+        }
+        if (pending.size() < at + 1 + length)
+            return false;
+        out.header = pending[0];
+        out.body = pending.substr(at + 1, length);
+        pending.erase(0, at + 1 + length);
+        return true;
+    }
+};
+
+static uint16_t readId(const std::string &body, size_t at)
+{
+    return (uint16_t)((uint8_t)body[at] << 8 | (uint8_t)body[at + 1]);
+}
+
+// Splits a PUBLISH body into its payload, and packet id for QoS 1
+static std::string publishPayload(const Packet &p, uint16_t *id)
+{
+    size_t topicLength = readId(p.body, 0);
+    size_t at = 2 + topicLength;
+    if ((p.header >> 1 & 3) > 0)
+    {
+        *id = readId(p.body, at);
+        at += 2;
+    }
+    return p.body.substr(at);
+}
+
+// --- In-process broker ---------------------------------------------------
+
+struct FakeBroker
+{
+    int listenFd = -1;
+    int port = 0;
+    int ackDelayMs = 0;
+    size_t dropAfter = 0; // Close the connection once, after this many publishes
+    std::vector<std::string> received;
+    std::atomic<bool> stop{false};
+    std::thread thread;
+
+    void start()
+    {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listenFd, (sockaddr *)&addr, sizeof(addr));
+        listen(listenFd, 4);
+        socklen_t length = sizeof(addr);
+        getsockname(listenFd, (sockaddr *)&addr, &length);
+        port = ntohs(addr.sin_port);
+        thread = std::thread([this] { run(); });
+    }
+
+    void finish()
+    {
+        stop = true;
+        thread.join();
+        ::close(listenFd);
+    }
+
+    void run()
+    {
+        while (!stop)
+        {
+            pollfd p = {listenFd, POLLIN, 0};
+            if (poll(&p, 1, 20) <= 0)
+                continue;
+            Connection client;
+            client.fd = accept(listenFd, nullptr, nullptr);
+            int one = 1;
+            setsockopt(client.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            serve(client);
+            client.close();
+        }
+    }
+
+    // PUBACKs wait out the round trip in a queue, so several are in flight
+    void serve(Connection &client)
+    {
+        std::deque<std::pair<double, uint16_t>> acks;
+        while (!stop)
+        {
+            while (!acks.empty() && acks.front().first <= now())
+            {
+                client.send(packet(0x40, id16(acks.front().second)));
+                acks.pop_front();
+            }
+            int wait = acks.empty() ? 20 : std::max(0, (int)((acks.front().first - now()) * 1000));
+            Packet p;
+            int got = client.read(p, wait);
+            if (got < 0)
+                return;
+            if (got == 0)
+                continue;
+
+            uint8_t type = p.header >> 4;
+            if (type == 1)
+                client.send(packet(0x20, std::string{0, 0}));
+            else if (type == 3)
+            {
+                uint16_t id = 0;
+                received.push_back(publishPayload(p, &id));
+                acks.push_back({now() + ackDelayMs / 1000.0, id});
+                if (dropAfter > 0 && received.size() == dropAfter)
+                {
+                    dropAfter = 0;
+                    return; // Unacked publishes are lost with the session
+                }
+            }
+            else if (type == 14)
+                return;
+        }
+    }
+};
+
+// --- Publisher -----------------------------------------------------------
+
+struct Run
+{
+    double seconds;
+    size_t reconnects;
+    bool drained;
+};
+
+// Queues count numbered messages and publishes them as the firmware's task
+// does, with at most window in flight
+static Run publishAll(const char *host, int port, const std::string &topic, size_t count, size_t window,
+                      size_t payloadSize)
+{
+    static std::vector<uint8_t> storage(1024 * 1024);
+    MqttQueue queue;
+    mqttQueueInit(queue, storage.data(), storage.size());
+    for (size_t i = 0; i < count; i++)
+    {
+        std::string payload = "{\"seq\":" + std::to_string(i) + ",\"pad\":\"";
+        payload += std::string(payloadSize > payload.size() + 2 ? payloadSize - payload.size() - 2 : 0, 'x') + "\"}";
+        push(queue, 0, payload);
+    }
+
+    Run run = {0, 0, false};
+    Connection link;
+    uint16_t nextId = 1;
+    double start = now();
+    while (queue.ring.frames > 0 && now() - start < 120)
+    {
+        if (link.fd < 0)
+        {
+            Packet connack;
+            if (!link.open(host, port) || !link.send(connectPacket("roaster-check-pub")) ||
+                link.read(connack, 2000) != 1 || connack.header != 0x20)
+            {
+                link.close();
+                usleep(100000);
+                continue;
+            }
+            mqttQueueResendAll(queue);
+        }
+
+        size_t index;
+        uint8_t topicIndex;
+        const char *payload;
+        size_t length;
+        while (mqttQueueInFlight(queue) < window &&
+               (length = mqttQueueNext(queue, &index, &topicIndex, &payload)) > 0)
+        {
+            uint16_t id = nextId;
+            nextId = nextId == 65535 ? 1 : nextId + 1;
+            link.send(packet(0x32, str16(topic) + id16(id) + std::string(payload, length)));
+            mqttQueueSent(queue, index, queue.pops, id);
+        }
+
+        Packet p;
+        int got = link.read(p, 1000);
+        if (got < 0)
+        {
+            link.close();
+            run.reconnects++;
+        }
+        else if (got > 0 && (p.header >> 4) == 4)
+            mqttQueueAcked(queue, readId(p.body, 0));
+    }
+    run.seconds = now() - start;
+    run.drained = queue.ring.frames == 0;
+    if (link.fd >= 0)
+        link.send(packet(0xE0, ""));
+    link.close();
+    return run;
+}
+
+static bool allArrived(const std::vector<std::string> &received, size_t count)
+{
+    std::vector<bool> seen(count, false);
+    size_t expected = 0;
+    bool ordered = true;
+    for (const std::string &payload : received)
+    {
+        size_t seq = strtoul(payload.c_str() + 7, nullptr, 10);
+        if (seq >= count)
+            return false;
+        if (!seen[seq])
+        {
+            ordered = ordered && seq == expected;
+            expected = seq + 1;
+            seen[seq] = true;
+        }
+    }
+    for (bool s : seen)
+        ordered = ordered && s;
+    return ordered;
+}
+
+static void checkFakeBroker()
+{
+    const size_t count = 400, payloadSize = 413;
+    const int rttMs = 10;
+    printf("in-process broker, PUBACK after %d ms, %zu messages of %zu B\n", rttMs, count, payloadSize);
+
+    double rate[MQTT_MAX_IN_FLIGHT + 1] = {};
+    for (size_t window : {1, 2, 4, 8})
+    {
+        FakeBroker broker;
+        broker.ackDelayMs = rttMs;
+        broker.dropAfter = count / 2;
+        broker.start();
+        Run run = publishAll("127.0.0.1", broker.port, "roaster/check/data", count, window, payloadSize);
+        broker.finish();
+
+        rate[window] = count / run.seconds;
+        printf("  window %zu  %6.0f msg/s  %zu reconnect(s)  %zu delivered\n", window, rate[window], run.reconnects,
+               broker.received.size());
+        char what[80];
+        snprintf(what, sizeof(what), "window %zu: all acked, every message delivered in order", window);
+        expect(run.drained && run.reconnects == 1 && allArrived(broker.received, count), what);
+    }
+    char what[80];
+    snprintf(what, sizeof(what), "8 in flight is %.1fx one at a time", rate[8] / rate[1]);
+    expect(rate[8] > 4 * rate[1], what);
+}
+
+static void checkRealBroker(const char *host, int port)
+{
+    const size_t count = 2000, payloadSize = 413;
+    std::string topic = "roaster/check-" + std::to_string(getpid()) + "/data";
+    printf("broker %s:%d, topic %s, %zu messages of %zu B\n", host, port, topic.c_str(), count, payloadSize);
+
+    Connection subscriber;
+    Packet p;
+    bool subscribed = subscriber.open(host, port) && subscriber.send(connectPacket("roaster-check-sub")) &&
+                      subscriber.read(p, 2000) == 1 && p.header == 0x20 && p.body[1] == 0 &&
+                      subscriber.send(packet(0x82, id16(1) + str16(topic) + std::string(1, 1))) &&
+                      subscriber.read(p, 2000) == 1 && (p.header >> 4) == 9;
+    expect(subscribed, "subscriber connected");
+    if (!subscribed)
+        return;
+
+    std::vector<std::string> received;
+    std::atomic<bool> done{false};
+    std::thread reader([&]
+                       {
+                           Packet in;
+                           double quiet = now();
+                           while (!done || now() - quiet < 2)
+                           {
+                               if (subscriber.read(in, 100) != 1 || (in.header >> 4) != 3)
+                                   continue;
+                               uint16_t id = 0;
+                               received.push_back(publishPayload(in, &id));
+                               if (in.header & 0x06)
+                                   subscriber.send(packet(0x40, id16(id)));
+                               quiet = now();
+                           } });
+
+    double rate[MQTT_MAX_IN_FLIGHT + 1] = {};
+    for (size_t window : {1, 8})
+    {
+        Run run = publishAll(host, port, topic, count, window, payloadSize);
+        rate[window] = count / run.seconds;
+        printf("  window %zu  %6.0f msg/s\n", window, rate[window]);
+        char what[80];
+        snprintf(what, sizeof(what), "window %zu: all %zu messages acked", window, count);
+        expect(run.drained, what);
+    }
+    done = true;
+    reader.join();
+    subscriber.close();
+
+    // Both runs publish the same sequence numbers to the one subscriber
+    std::vector<std::string> first(received.begin(), received.begin() + std::min(received.size(), count));
+    std::vector<std::string> second(received.begin() + first.size(), received.end());
+    expect(allArrived(first, count) && allArrived(second, count), "subscriber got every message of both runs");
+    char what[80];
+    snprintf(what, sizeof(what), "8 in flight is %.1fx one at a time", rate[8] / rate[1]);
+    expect(rate[8] >= rate[1], what);
+}
+
+int main(int argc, char **argv)
+{
+    checkQueue();
+    if (argc >= 2)
+        checkRealBroker(argv[1], argc >= 3 ? atoi(argv[2]) : 1883);
+    else
+        checkFakeBroker();
+    printCheckResult();
+    return checkExitCode();
+}
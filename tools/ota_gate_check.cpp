@@ -0,0 +1,77 @@
+// Table-driven checks for the OTA gate rules in src/ota/ota_gate.cpp.
+// From the repository root:
+//
+//   g++ -std=gnu++17 -O2 -Wall -Wextra -Isrc tools/ota_gate_check.cpp
+//       src/ota/ota_gate.cpp -o ota_gate_check
+//   ./ota_gate_check
+
+#include <cstdio>
+#include <cstring>
+#include "ota/ota_gate.h"
+
+static OtaHealth health(const char *version, float jitterUs, float serializeUs, uint32_t freeHeap,
+                        int32_t heapDrift, uint8_t online, uint16_t samples = 16)
+{
+    OtaHealth h = {};
+    h.magic = OTA_GATE_MAGIC;
+    strncpy(h.version, version, sizeof(h.version) - 1);
+    h.jitterMaxUs = jitterUs;
+    h.serializeMedianUs = serializeUs;
+    h.freeHeap = freeHeap;
+    h.heapDrift = heapDrift;
+    h.channelsOnline = online;
+    h.channelCount = 4;
+    h.samples = samples;
+    return h;
+}
+
+struct Case
+{
+    const char *name;
+    bool withBaseline;
+    OtaHealth candidate;
+    bool expectPass;
+    const char *expectReason; // Prefix of the reason
+};
+
+int main()
+{
+    const OtaHealth baseline = health("1.4.0", 1800, 42, 180000, 0, 4);
+    OtaHealth corrupt = baseline;
+    corrupt.magic = 0;
+
+    const Case cases[] = {
+        {"same numbers", true, health("1.5.0", 1800, 42, 180000, 0, 4), true, "passed against 1.4.0"},
+        {"noise within slack", true, health("1.5.0", 4400, 70, 170000, 2048, 4), true, "passed"},
+        {"sample jitter doubled", true, health("1.5.0", 6000, 42, 180000, 0, 4), false, "sample jitter"},
+        {"serialization slower", true, health("1.5.0", 1800, 130, 180000, 0, 4), false, "frame serialization"},
+        {"less free heap", true, health("1.5.0", 1800, 42, 150000, 0, 4), false, "free heap 150000 vs"},
+        {"heap leaking", true, health("1.5.0", 1800, 42, 180000, 9000, 4), false, "heap leak"},
+        {"channel lost", true, health("1.5.0", 1800, 42, 180000, 0, 3), false, "sensor health"},
+        {"sampling stalled", true, health("1.5.0", 1800, 42, 180000, 0, 4, 5), false, "sampling stalled"},
+        {"below heap floor", true, health("1.5.0", 1800, 42, 20000, 0, 4), false, "free heap 20000 below"},
+        {"no baseline, healthy", false, health("1.5.0", 9000, 400, 100000, 0, 1), true, "passed absolute"},
+        {"no baseline, no sensors", false, health("1.5.0", 1800, 42, 180000, 0, 0), false, "sensor health"},
+    };
+
+    bool ok = true;
+    char reason[96];
+    for (const Case &c : cases)
+    {
+        bool passed = otaGateEvaluate(c.withBaseline ? &baseline : nullptr, c.candidate, OTA_GATE_DEFAULT_LIMITS,
+                                      reason, sizeof(reason));
+        bool match = passed == c.expectPass && strncmp(reason, c.expectReason, strlen(c.expectReason)) == 0;
+        printf("%-26s %-4s %-8s %s\n", c.name, passed ? "pass" : "fail", match ? "ok" : "MISMATCH", reason);
+        ok = ok && match;
+    }
+
+    // A baseline that fails its magic check is ignored, not trusted
+    bool passed = otaGateEvaluate(&corrupt, health("1.5.0", 9000, 42, 180000, 0, 4), OTA_GATE_DEFAULT_LIMITS,
+                                  reason, sizeof(reason));
+    bool match = passed && strncmp(reason, "passed absolute", 15) == 0;
+    printf("%-26s %-4s %-8s %s\n", "corrupt baseline", passed ? "pass" : "fail", match ? "ok" : "MISMATCH", reason);
+    ok = ok && match;
+
+    printf("%s\n", ok ? "all cases ok" : "case mismatch");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+// Host checks for the power mode policy (src/power/power_policy.h) and for
+// the command reader's re-sync after a UART wake (src/serial/line_reader.cpp).
+// The wake is modelled as the UART losing the first bytes of what the host
+// sent: every cut is tried, with and without the blank-line preamble, and
+// every command lost to a cut must be reported for a resend. From
+// the repository root:
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/power_wake_check.cpp
+//       src/serial/line_reader.cpp -o power_wake_check
+//   ./power_wake_check
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "power/power_policy.h"
+#include "serial/line_reader.h"
+
+static const unsigned long IDLE_DELAY_MS = 60000;
+
+static PowerMode select(bool roasting, bool setupMode, bool hostConnected, unsigned long msSinceActivity)
+{
+    PowerPolicyInput input = {roasting, setupMode, hostConnected, msSinceActivity};
+    return selectPowerMode(input, IDLE_DELAY_MS);
+}
+
+static void checkPolicy()
+{
+    // Every combination: roasting or recent activity wins, then anything
+    // that needs the UART or the portal polled keeps the device awake
+    bool table = true;
+    for (int bits = 0; bits < 16; bits++)
+    {
+        bool roasting = bits & 1, setupMode = bits & 2, hostConnected = bits & 4, recent = bits & 8;
+        PowerMode expected = (roasting || recent)             ? POWER_PERFORMANCE
+                             : (setupMode || hostConnected) ? POWER_IDLE_SCALED
+                                                            : POWER_IDLE_SLEEP;
+        table = table && select(roasting, setupMode, hostConnected, recent ? 1000 : 120000) == expected;
+    }
+    expect(table, "mode for every roast/setup/host/activity combination");
+
+    expect(select(false, false, false, IDLE_DELAY_MS - 1) == POWER_PERFORMANCE &&
+               select(false, false, false, IDLE_DELAY_MS) == POWER_IDLE_SLEEP,
+           "idle delay boundary is exclusive");
+    expect(select(false, false, true, 0xFFFFFFFFUL) == POWER_IDLE_SCALED,
+           "a connected host never lets the UART sleep");
+    expect(select(true, false, false, 0xFFFFFFFFUL) == POWER_PERFORMANCE, "roasting never scales down");
+
+    const char *names[] = {powerModeName(POWER_PERFORMANCE), powerModeName(POWER_IDLE_SCALED),
+                           powerModeName(POWER_IDLE_SLEEP)};
+    expect(strcmp(names[0], "performance") == 0 && strcmp(names[1], "idle_scaled") == 0 &&
+               strcmp(names[2], "idle_sleep") == 0,
+           "mode names as reported in get_device_info");
+}
+
+static std::vector<std::string> feed(LineReader &reader, const std::string &bytes)
+{
+    std::vector<std::string> lines;
+    for (char c : bytes)
+    {
+        if (lineReaderPush(reader, c) == LINE_READY)
+            lines.push_back(reader.buffer);
+    }
+    return lines;
+}
+
+static void checkReader()
+{
+    char buffer[64];
+    LineReader reader;
+    lineReaderInit(reader, buffer, sizeof(buffer));
+
+    std::vector<std::string> lines = feed(reader, "{\"a\":1}\r\n\n{\"b\":2}\r");
+    expect(lines.size() == 2 && lines[0] == "{\"a\":1}" && lines[1] == "{\"b\":2}",
+           "CR, LF and CRLF end lines; blank lines are skipped");
+
+    std::string overlong = std::string(100, 'x') + "\n";
+    LineStatus status = LINE_PENDING;
+    for (char c : overlong)
+        status = lineReaderPush(reader, c);
+    lines = feed(reader, std::string(sizeof(buffer) - 1, 'y') + "\n");
+    expect(status == LINE_TOO_LONG && lines.size() == 1 && lines[0] == std::string(sizeof(buffer) - 1, 'y'),
+           "overlong line is refused, not cut; a full one fits");
+
+    feed(reader, "{\"partial\":");
+    lineReaderResync(reader);
+    status = LINE_PENDING;
+    for (char c : std::string("\"tail\"}\n"))
+        status = lineReaderPush(reader, c);
+    lines = feed(reader, "{\"c\":3}\n");
+    expect(status == LINE_DROPPED && lines.size() == 1 && lines[0] == "{\"c\":3}",
+           "resync drops input up to the next line ending, reported");
+
+    lineReaderResync(reader);
+    status = lineReaderPush(reader, '\n');
+    expect(status == LINE_PENDING, "resync ended by a bare line ending: nothing reported");
+
+    // The wake loses everything up to and including the character that
+    // woke the UART; try every cut
+    const std::string command = "{\"update_connection_status\":\"connected\"}\n";
+    const std::string sends[] = {command, "\n\n" + command};
+    int garbled[2] = {0, 0}, delivered[2] = {0, 0}, unreported[2] = {0, 0};
+    for (int preamble = 0; preamble < 2; preamble++)
+    {
+        for (size_t lost = 1; lost < sends[preamble].size(); lost++)
+        {
+            lineReaderInit(reader, buffer, sizeof(buffer));
+            lineReaderResync(reader);
+            int dropped = 0;
+            lines.clear();
+            for (char c : sends[preamble].substr(lost) + command)
+            {
+                LineStatus pushed = lineReaderPush(reader, c);
+                dropped += pushed == LINE_DROPPED;
+                if (pushed == LINE_READY)
+                    lines.push_back(reader.buffer);
+            }
+            for (const std::string &line : lines)
+                garbled[preamble] += line + "\n" != command;
+            bool firstKept = preamble && lost < 2;
+            delivered[preamble] += lines.size() == (firstKept ? 2u : 1u);
+            // Every command that does not arrive is answered with an error,
+            // unless the wake took all of it but the line ending: then
+            // nothing reached the device, and only the host's timeout helps
+            bool allLost = lost == sends[preamble].size() - 1;
+            unreported[preamble] += dropped != (firstKept || allLost ? 0 : 1);
+        }
+    }
+    expect(garbled[0] == 0 && garbled[1] == 0, "no cut ever hands on a garbled line");
+    expect(delivered[0] == (int)command.size() - 1 && delivered[1] == (int)sends[1].size() - 1,
+           "commands after the cut line all arrive");
+    expect(unreported[0] == 0 && unreported[1] == 0, "each partly received command reported once");
+
+    // With the preamble the wake character is a line ending, so the
+    // command itself survives when only the first byte is lost
+    lineReaderInit(reader, buffer, sizeof(buffer));
+    lineReaderResync(reader);
+    lines = feed(reader, sends[1].substr(1));
+    expect(lines.size() == 1 && lines[0] + "\n" == command, "blank-line preamble keeps the first command");
+}
+
+int main()
+{
+    checkPolicy();
+    checkReader();
+    printCheckResult();
+    return checkExitCode();
+}
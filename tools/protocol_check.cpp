@@ -0,0 +1,257 @@
+// Host checks for src/protocol/protocol.h: a decode throughput benchmark
+// and a mutation fuzzer. Build with the sanitizers so the fuzzer catches
+// out-of-bounds reads. From the repository root:
+//
+//   g++ -std=gnu++17 -O2 -g -fsanitize=address,undefined -Isrc
+//       tools/protocol_check.cpp -o protocol_check
+//   ./protocol_check bench
+//   ./protocol_check fuzz 1000000
+//
+// The same file is a libFuzzer target:
+//
+//   clang++ -std=gnu++17 -O1 -g -fsanitize=fuzzer,address,undefined
+//       -DPROTOCOL_LIBFUZZER -Isrc tools/protocol_check.cpp -o protocol_fuzz
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "protocol/protocol.h"
+
+// One of each modelled message, as the firmware sends them
+static const char *const corpus[] = {
+    R"({"type":"data","device_id":"PP-0A1B2C","firmware_version":"1.4.0","metadata":{"timestamp":123456,"sampling_rate_ms":1000,"sequence":42,"keyframe":true,"host_time_us":1700000000123456},"channels":[{"channel":1,"status":"ok","temperature_c":201.25},{"channel":2,"status":"error","fault_code":1,"temperature_c":null},{"channel":3,"status":"ok","temperature_c":-3.5},{"channel":4,"status":"ok","temperature_c":22}]})",
+    R"({"type":"ready","device_id":"PP-0A1B2C","firmware_version":"1.4.0","model":"P61","metadata":{"timestamp":1012,"sampling_rate_ms":1000}})",
+    R"({"device_id":"PP-0A1B2C","metadata":{"timestamp":5000,"received_us":4999000,"sent_us":4999870},"payload":{"result":"sampling_rate_updated","sampling_rate_ms":500},"request_id":"abc-1","type":"configuration"})",
+    R"({"device_id":"PP-0A1B2C","metadata":{"timestamp":5100,"received_us":5099000,"sent_us":5099900,"host_time_us":1700000005099900},"payload":{"serial_number":"PP-0A1B2C","device_id":"0A1B2C","firmware_version":"1.4.0","model":"P61","wifi_configured":true,"sampling_rate_ms":1000,"effective_sampling_rate_ms":500,"tx_telemetry":{"queued":10,"sent":10,"dropped":0,"pending_bytes":0},"channels":[{"channel":1,"online":true,"recoveries":0}],"clock_synced":true},"request_id":7,"type":"device_info"})",
+    R"({"device_id":"PP-0A1B2C","metadata":{"timestamp":5200,"received_us":5199000,"sent_us":5199100},"payload":{"error":"Invalid sampling rate. Must be 100-10000ms","requested_rate":5},"type":"error"})",
+    R"({"type":"update_available","version":"v1.5.0","firmware_url":"https://example.com/firmware.bin","signature_url":"https://example.com/firmware.bin.sig","changelog":"Fixes:\n- \"quoted\" é text"})",
+};
+static const size_t CORPUS_SIZE = sizeof(corpus) / sizeof(corpus[0]);
+
+static bool sameSpan(ProtoSpan a, ProtoSpan b)
+{
+    return a.length == b.length && (a.length == 0 || memcmp(a.data, b.data, a.length) == 0);
+}
+
+// Encode a random data message, decode it back and compare
+static bool roundTrip(std::mt19937 &rng)
+{
+    char deviceId[16];
+    for (char &c : deviceId)
+        c = (char)(rng() % 95 + 32); // Printable, quotes and backslashes included
+
+    DataMessage sent = {};
+    sent.deviceId = {deviceId, rng() % sizeof(deviceId)};
+    sent.firmwareVersion = protoSpan("1.4.0");
+    sent.metadata.timestamp = rng();
+    sent.metadata.samplingRateMs = rng() % 10000;
+    sent.metadata.sequence = rng();
+    sent.metadata.keyframe = rng() & 1;
+    sent.metadata.calibrationId = (rng() & 1) ? rng() : 0;
+    sent.metadata.hasHostTime = rng() & 1;
+    sent.metadata.hostTimeUs = sent.metadata.hasHostTime ? ((int64_t)rng() << 20) : 0;
+    sent.channelCount = rng() % (PROTO_MAX_CHANNELS + 1);
+    for (uint8_t i = 0; i < sent.channelCount; i++)
+    {
+        DataChannel &channel = sent.channels[i];
+        channel.channel = i + 1;
+        channel.ok = rng() % 4 != 0;
+        channel.temperatureC = channel.ok ? (int)(rng() % 200000 - 50000) / 100.0f : 0;
+        channel.faultCode = channel.ok ? 0 : rng() % 8;
+    }
+
+    char frame[PROTO_DATA_FRAME_MAX];
+    size_t length = encodeDataMessage(sent, frame, sizeof(frame));
+    Message received;
+    if (length == 0 || !decodeMessage(frame, length, received) || received.type != MSG_DATA)
+        return false;
+
+    const DataMessage &got = received.data;
+    if (got.metadata.timestamp != sent.metadata.timestamp ||
+        got.metadata.sequence != sent.metadata.sequence ||
+        got.metadata.keyframe != sent.metadata.keyframe ||
+        got.metadata.calibrationId != sent.metadata.calibrationId ||
+        got.metadata.hasHostTime != sent.metadata.hasHostTime ||
+        got.metadata.hostTimeUs != sent.metadata.hostTimeUs ||
+        got.channelCount != sent.channelCount)
+        return false;
+
+    // Strings come back escaped, so compare by re-encoding
+    char again[PROTO_DATA_FRAME_MAX];
+    DataMessage reencoded = got;
+    std::string unescaped;
+    for (size_t i = 0; i < got.deviceId.length; i++)
+    {
+        char c = got.deviceId.data[i];
+        if (c == '\\')
+            c = got.deviceId.data[++i];
+        unescaped += c;
+    }
+    reencoded.deviceId = {unescaped.data(), unescaped.size()};
+    if (!sameSpan(reencoded.deviceId, sent.deviceId))
+        return false;
+    if (encodeDataMessage(reencoded, again, sizeof(again)) != length || memcmp(again, frame, length) != 0)
+        return false;
+
+    for (uint8_t i = 0; i < got.channelCount; i++)
+    {
+        if (got.channels[i].ok != sent.channels[i].ok ||
+            got.channels[i].faultCode != sent.channels[i].faultCode ||
+            (got.channels[i].ok && got.channels[i].temperatureC != sent.channels[i].temperatureC))
+            return false;
+    }
+    return true;
+}
+
+static void decodeOne(const uint8_t *data, size_t size)
+{
+    Message msg;
+    if (!decodeMessage((const char *)data, size, msg))
+        return;
+
+    // Every span the decoder hands out must lie inside the input
+    auto inside = [&](ProtoSpan span)
+    {
+        if (span.data && (span.data < (const char *)data || span.data + span.length > (const char *)data + size))
+            abort();
+    };
+    inside(msg.typeName);
+    inside(msg.data.deviceId);
+    inside(msg.response.payload);
+    inside(msg.response.requestId);
+    inside(msg.response.result);
+    inside(msg.response.error);
+    inside(msg.update.changelog);
+
+    ProtoSpan value;
+    if (protoFindMember(msg.response.payload, "channels", value))
+        inside(value);
+}
+
+#ifdef PROTOCOL_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    decodeOne(data, size);
+    return 0;
+}
+
+#else
+
+static int runBench()
+{
+    std::vector<std::string> lines(corpus, corpus + CORPUS_SIZE);
+    size_t totalBytes = 0;
+    for (const std::string &line : lines)
+    {
+        Message msg;
+        if (!decodeMessage(line.data(), line.size(), msg) || msg.type == MSG_UNKNOWN)
+        {
+            fprintf(stderr, "corpus line failed to decode: %s\n", line.c_str());
+            return 1;
+        }
+        totalBytes += line.size();
+    }
+
+    const size_t rounds = 200000;
+    size_t decoded = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; round++)
+    {
+        for (const std::string &line : lines)
+        {
+            Message msg;
+            decoded += decodeMessage(line.data(), line.size(), msg);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t messages = rounds * lines.size();
+    printf("decoded %zu messages (%zu ok) in %.3f s: %.0f msg/s, %.1f MB/s\n",
+           messages, decoded, seconds, messages / seconds,
+           rounds * totalBytes / seconds / 1e6);
+
+    // The hot path on its own: data frames
+    const std::string &data = lines[0];
+    start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds * 4; round++)
+    {
+        Message msg;
+        decodeMessage(data.data(), data.size(), msg);
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("data frames: %.0f msg/s\n", rounds * 4 / seconds);
+    return 0;
+}
+
+static int runFuzz(unsigned long iterations)
+{
+    std::mt19937 rng(12345);
+    static const char tokens[] = "{}[]\",:\\0123456789.-eE+ntfu\r\n";
+
+    for (unsigned long i = 0; i < iterations; i++)
+    {
+        if (i % 8 == 0 && !roundTrip(rng))
+        {
+            fprintf(stderr, "round trip mismatch at iteration %lu\n", i);
+            return 1;
+        }
+
+        std::string input = corpus[rng() % CORPUS_SIZE];
+        int mutations = 1 + rng() % 8;
+        for (int m = 0; m < mutations && !input.empty(); m++)
+        {
+            size_t at = rng() % input.size();
+            switch (rng() % 5)
+            {
+            case 0: // Flip a byte
+                input[at] = (char)rng();
+                break;
+            case 1: // Insert a structural token
+                input.insert(at, 1, tokens[rng() % (sizeof(tokens) - 1)]);
+                break;
+            case 2: // Delete a run
+                input.erase(at, 1 + rng() % 16);
+                break;
+            case 3: // Truncate
+                input.resize(at);
+                break;
+            case 4: // Splice in part of another message
+            {
+                std::string other = corpus[rng() % CORPUS_SIZE];
+                size_t from = rng() % other.size();
+                input.insert(at, other, from, 1 + rng() % 64);
+                break;
+            }
+            }
+        }
+
+        // An exact-size heap copy so ASan flags any read past the end
+        std::vector<uint8_t> bytes(input.begin(), input.end());
+        decodeOne(bytes.data(), bytes.size());
+    }
+
+    // Deep nesting must be rejected, not recursed into
+    std::string deep = R"({"type":"data","extra":)" + std::string(100000, '[');
+    decodeOne((const uint8_t *)deep.data(), deep.size());
+
+    printf("fuzzed %lu inputs, round trips ok\n", iterations);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0)
+        return runBench();
+    if (argc >= 2 && strcmp(argv[1], "fuzz") == 0)
+        return runFuzz(argc >= 3 ? strtoul(argv[2], nullptr, 10) : 100000);
+
+    fprintf(stderr, "usage: %s bench | fuzz [iterations]\n", argv[0]);
+    return 2;
+}
+
+#endif
@@ -0,0 +1,146 @@
+#pragma once
+// Roast temperature series shared by the host tools: a recorded trace or a
+// synthetic hour of roasting. Header-only; include it from a tool in this
+// directory.
+//
+// A trace is a serial log holding data frames (other lines are skipped) or
+// CSV rows of timestamp_ms,t1[,t2...].
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "protocol/protocol.h"
+#include "telemetry/downsample.h"
+
+struct Series
+{
+    std::vector<SeriesPoint> rows;
+    uint8_t channels = 0;
+};
+
+// Bean and environment probes over five 12-minute batches: charge, turning
+// point, ramp, first crack stall, development, drop and reheating of the
+// empty drum, with probe noise
+inline float beanProbeC(float s)
+{
+    const float turningC = 95.0f;
+    const float preheatC = 215.0f;
+    if (s < 540)
+    {
+        // Charge pulls the probe down to the turning point, then the
+        // ramp flattens towards first crack
+        float drop = (preheatC - turningC) * (1.0f - expf(-s / 25.0f));
+        float ramp = 125.0f * (1.0f - expf(-s / 300.0f));
+        return preheatC - drop + ramp;
+    }
+    float crackC = beanProbeC(539.9f);
+    if (s < 600)
+        return crackC + (s - 540) * 0.02f; // First crack stall
+    if (s < 660)
+        return crackC + 1.2f + (s - 600) * 0.12f; // Development
+    float dropC = crackC + 8.4f;
+    return preheatC + (dropC - preheatC) * expf(-(s - 660) / 15.0f); // Empty drum
+}
+
+inline Series syntheticRoast(uint32_t rateMs = 100)
+{
+    Series series;
+    series.channels = 2;
+    std::mt19937 rng(61);
+    std::normal_distribution<float> noise(0.0f, 0.15f);
+
+    const uint32_t roastMs = 12 * 60 * 1000;
+    for (uint32_t t = 0; t < 60 * 60 * 1000; t += rateMs)
+    {
+        float s = (t % roastMs) / 1000.0f;
+        float bean = beanProbeC(s);
+
+        SeriesPoint row;
+        row.timestampMs = t;
+        row.temperatureC[0] = bean + noise(rng);
+        row.temperatureC[1] = bean + 35.0f + 10.0f * sinf(s * 6.2831853f / 720.0f) + noise(rng);
+        row.temperatureC[2] = row.temperatureC[3] = NAN;
+
+        // An open probe for a few seconds mid-hour
+        if (t >= 1800000 && t < 1803000)
+            row.temperatureC[1] = NAN;
+        series.rows.push_back(row);
+    }
+    return series;
+}
+
+inline bool loadTrace(const char *path, Series &series)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+
+    SeriesPoint last;
+    for (float &c : last.temperatureC)
+        c = NAN;
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        SeriesPoint row = last;
+        if (!line.empty() && line[0] == '{')
+        {
+            // Deadbanded frames carry only the channels that changed
+            Message msg;
+            if (!decodeMessage(line.data(), line.size(), msg) || msg.type != MSG_DATA)
+                continue;
+            row.timestampMs = msg.data.metadata.timestamp;
+            for (uint8_t i = 0; i < msg.data.channelCount; i++)
+            {
+                const DataChannel &channel = msg.data.channels[i];
+                if (channel.channel < 1 || channel.channel > MAX_THERMOCOUPLE_CHANNELS)
+                    continue;
+                row.temperatureC[channel.channel - 1] = channel.ok ? channel.temperatureC : NAN;
+                if (channel.channel > series.channels)
+                    series.channels = channel.channel;
+            }
+        }
+        else
+        {
+            char *end;
+            row.timestampMs = strtoul(line.c_str(), &end, 10);
+            if (end == line.c_str())
+                continue;
+            uint8_t ch = 0;
+            while (*end == ',' && ch < MAX_THERMOCOUPLE_CHANNELS)
+            {
+                char *next;
+                float value = strtof(end + 1, &next);
+                row.temperatureC[ch++] = next == end + 1 ? NAN : value;
+                end = next;
+            }
+            if (ch > series.channels)
+                series.channels = ch;
+        }
+        series.rows.push_back(row);
+        last = row;
+    }
+    return !series.rows.empty();
+}
+
+// Channel ch at tMs, straight between the rows either side; NaN if either
+// is faulted. rows must be in time order.
+inline float seriesAt(const Series &series, uint8_t ch, uint32_t tMs)
+{
+    const std::vector<SeriesPoint> &rows = series.rows;
+    size_t lo = 0, hi = rows.size() - 1;
+    if (tMs <= rows[lo].timestampMs)
+        return rows[lo].temperatureC[ch];
+    if (tMs >= rows[hi].timestampMs)
+        return rows[hi].temperatureC[ch];
+    while (hi - lo > 1)
+    {
+        size_t mid = (lo + hi) / 2;
+        (rows[mid].timestampMs <= tMs ? lo : hi) = mid;
+    }
+    float f = (float)(tMs - rows[lo].timestampMs) / (float)(rows[hi].timestampMs - rows[lo].timestampMs);
+    return rows[lo].temperatureC[ch] + (rows[hi].temperatureC[ch] - rows[lo].temperatureC[ch]) * f;
+}
@@ -0,0 +1,159 @@
+// Times the acquisition pass of src/sensors/sensor_array.h against the
+// same pass through a virtual driver interface, the runtime abstraction
+// the templates replace. Both read the simulated chip, so what is left is
+// the per-read dispatch and loop overhead, not SPI. From the repository
+// root:
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/sensor_bench.cpp
+//       src/sensors/channel_health.cpp src/sensors/thermocouple_linearization.cpp
+//       -o sensor_bench
+//   ./sensor_bench [passes]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "sensors/sensor_array.h"
+
+static const uint8_t csPins[MAX_THERMOCOUPLE_CHANNELS] = {5, 10, 15, 16};
+
+// ----------------------------------------------------------------------------
+// Virtual-dispatch baseline
+// ----------------------------------------------------------------------------
+
+class ThermocoupleDriver
+{
+public:
+    virtual ~ThermocoupleDriver() {}
+    virtual bool begin() = 0;
+    virtual float readCelsius(uint8_t &fault) = 0;
+    virtual bool softwareLinearization() const = 0;
+    virtual float linearize(float reportedC, const ThermocoupleTable &table) = 0;
+};
+
+template <typename Chip>
+class DriverFor : public ThermocoupleDriver
+{
+public:
+    explicit DriverFor(uint8_t csPin) : chip(csPin) {}
+    bool begin() override { return chip.begin(); }
+    float readCelsius(uint8_t &fault) override { return chip.readCelsius(fault); }
+    bool softwareLinearization() const override { return Chip::SOFTWARE_LINEARIZATION; }
+    float linearize(float reportedC, const ThermocoupleTable &table) override { return chip.linearize(reportedC, table); }
+
+private:
+    Chip chip;
+};
+
+// Channel count and drivers known only at run time
+class VirtualSensorArray
+{
+public:
+    VirtualSensorArray(ThermocoupleDriver **drivers, uint8_t count) : drivers(drivers), count(count) {}
+
+    void read(TemperatureSample &sample, ChannelHealth *health, const CalibrationSet &calibration)
+    {
+        sample.channelCount = count;
+        sample.calibrationId = calibration.id;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            sample.temperatureC[i] = NAN;
+            sample.fault[i] = 0;
+
+            if (!health[i].online)
+            {
+                sample.fault[i] = CHANNEL_FAULT_OFFLINE;
+                continue;
+            }
+
+            uint8_t fault = 0;
+            float tempC = drivers[i]->readCelsius(fault);
+            if (isnan(tempC))
+            {
+                sample.fault[i] = fault;
+                channelHealthReportFault(health[i], fault, sample.timestamp);
+                continue;
+            }
+
+            channelHealthReportOk(health[i]);
+            if (tables[i] && drivers[i]->softwareLinearization())
+                tempC = drivers[i]->linearize(tempC, *tables[i]);
+            if (calibration.curves[i].count)
+                tempC = calibrationApply(calibration.curves[i], tempC);
+
+            sample.temperatureC[i] = tempC;
+        }
+    }
+
+private:
+    ThermocoupleDriver **drivers;
+    uint8_t count;
+    const ThermocoupleTable *tables[MAX_THERMOCOUPLE_CHANNELS] = {}; // Chip default
+};
+
+// ----------------------------------------------------------------------------
+// Benchmark
+// ----------------------------------------------------------------------------
+
+struct Result
+{
+    double nsPerPass;
+    float checksum; // Keeps the reads from being optimized away
+};
+
+template <typename Reader>
+static Result timePasses(Reader &reader, uint8_t channels, unsigned long passes)
+{
+    ChannelHealth health[MAX_THERMOCOUPLE_CHANNELS];
+    for (ChannelHealth &h : health)
+        channelHealthInit(h, true, 0);
+
+    CalibrationSet calibration = {};
+    TemperatureSample sample = {};
+    float checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long pass = 0; pass < passes; pass++)
+    {
+        sample.timestamp = pass;
+        reader.read(sample, health, calibration);
+        for (uint8_t i = 0; i < channels; i++)
+            checksum += sample.temperatureC[i];
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return {seconds * 1e9 / passes, checksum};
+}
+
+template <uint8_t N>
+static void compare(unsigned long passes)
+{
+    SensorArray<SimulatedChip, N> templated(csPins);
+    for (uint8_t i = 0; i < N; i++)
+        templated.chip(i).begin();
+
+    // Built at run time so the compiler cannot see through the calls
+    ThermocoupleDriver *drivers[MAX_THERMOCOUPLE_CHANNELS];
+    for (uint8_t i = 0; i < N; i++)
+    {
+        drivers[i] = new DriverFor<SimulatedChip>(csPins[i]);
+        drivers[i]->begin();
+    }
+    VirtualSensorArray dispatched(drivers, N);
+
+    Result fixed = timePasses(templated, N, passes);
+    Result virt = timePasses(dispatched, N, passes);
+    printf("%u channel(s): template %6.2f ns/pass, virtual %6.2f ns/pass, %.2fx%s\n",
+           N, fixed.nsPerPass, virt.nsPerPass, virt.nsPerPass / fixed.nsPerPass,
+           fixed.checksum == virt.checksum ? "" : " (checksum mismatch)");
+
+    for (uint8_t i = 0; i < N; i++)
+        delete drivers[i];
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long passes = argc >= 2 ? strtoul(argv[1], nullptr, 10) : 20000000;
+
+    compare<1>(passes);
+    compare<2>(passes);
+    compare<4>(passes);
+    return 0;
+}
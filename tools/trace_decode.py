@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""Rebuild a Chrome/Perfetto trace from a device serial log.
+
+Send {"get_trace": "live"} (or "crash") to the device, save everything it
+prints to a file, then run:
+
+    python3 tools/trace_decode.py serial.log -o trace.json
+
+Open trace.json in https://ui.perfetto.dev or chrome://tracing.
+"""
+
+import argparse
+import json
+import sys
+
+
+def read_dumps(lines):
+    """Group trace frames into dumps, keyed by the frame's chunk numbering."""
+    dumps = []
+    current = None
+
+    for line in lines:
+        line = line.strip()
+        if not line.startswith("{"):
+            continue
+        try:
+            frame = json.loads(line)
+        except ValueError:
+            continue
+        if frame.get("type") != "trace":
+            continue
+
+        meta = frame.get("metadata", {})
+        if meta.get("chunk") == 0 or current is None:
+            current = {"metadata": meta, "chunks": {}}
+            dumps.append(current)
+        current["chunks"][meta.get("chunk", 0)] = frame.get("traceEvents", [])
+
+    return dumps
+
+
+def to_chrome(dump):
+    meta = dump["metadata"]
+    expected = meta.get("chunks", len(dump["chunks"]))
+    missing = [i for i in range(expected) if i not in dump["chunks"]]
+    if missing:
+        print(f"warning: {len(missing)} of {expected} chunks missing: {missing}", file=sys.stderr)
+
+    events = []
+    for index in sorted(dump["chunks"]):
+        events.extend(dump["chunks"][index])
+
+    events.append({"name": "process_name", "ph": "M", "pid": 1,
+                   "args": {"name": f"device ({meta.get('source', 'live')})"}})
+
+    return {
+        "traceEvents": events,
+        "displayTimeUnit": "ms",
+        "otherData": {
+            "source": meta.get("source"),
+            "event_count": meta.get("event_count"),
+            "overhead_ns": meta.get("overhead_ns"),
+        },
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", help="serial log containing trace frames ('-' for stdin)")
+    parser.add_argument("-o", "--output", default="trace.json")
+    parser.add_argument("--dump", type=int, default=-1,
+                        help="which dump in the log to decode (default: last)")
+    args = parser.parse_args()
+
+    source = sys.stdin if args.log == "-" else open(args.log, encoding="utf-8", errors="replace")
+    with source:
+        dumps = read_dumps(source)
+
+    if not dumps:
+        sys.exit("no trace frames found")
+
+    trace = to_chrome(dumps[args.dump])
+    with open(args.output, "w", encoding="utf-8") as out:
+        json.dump(trace, out)
+
+    print(f"wrote {len(trace['traceEvents'])} events to {args.output} "
+          f"(device overhead {trace['otherData']['overhead_ns']} ns/event)")
+
+
+if __name__ == "__main__":
+    main()
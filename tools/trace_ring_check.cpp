@@ -0,0 +1,252 @@
+// Host checks for src/trace/trace_ring.cpp, the ring behind the trace
+// recorder. First, what a snapshot returns: a fresh ring, a full one, a
+// head that wraps past 2^32, and writes cut off part way as a crash or a
+// preempting task leaves them. Then writer threads record numbered events
+// while a reader takes snapshots, and every event a snapshot returns must
+// be whole and in its writer's order. Last, the cost of one event, with
+// and without a clock read. From the repository root:
+//
+//   g++ -std=gnu++17 -O2 -pthread -Isrc tools/trace_ring_check.cpp
+//       src/trace/trace_ring.cpp -o trace_ring_check
+//   ./trace_ring_check
+//
+// Timings are this host's. On the device the recorder also reads
+// esp_timer and looks up the calling task; traceRecorderBegin() measures
+// the whole path at boot and trace dumps report it as overhead_ns.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <time.h>
+#include <vector>
+#include "check.h"
+#include "trace/trace_ring.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLES 1
+#endif
+
+static const int WRITERS = 4;
+static const uint32_t EVENTS_PER_WRITER = 8000000;
+
+static TraceRing ring;
+static uint32_t events[TRACE_CAPACITY][2];
+
+static void resetRing(uint32_t head)
+{
+    memset(&ring, 0, sizeof(ring));
+    ring.head = head;
+}
+
+// Timestamps count up from first, one per event
+static bool consecutive(size_t count, uint32_t first)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (events[i][0] != first + i || (events[i][1] & ((1u << TRACE_TAG_LAP_SHIFT) - 1)) != ((first + i) & 0xFFF))
+            return false;
+    }
+    return true;
+}
+
+static void writeCounted(uint32_t from, uint32_t count)
+{
+    for (uint32_t i = from; i < from + count; i++)
+        traceRingWrite(ring, i, i & 0xFFF);
+}
+
+static void checkSnapshots()
+{
+    resetRing(0);
+    writeCounted(0, 10);
+    size_t count = traceRingSnapshot(ring, events, TRACE_CAPACITY);
+    expect(count == 10 && consecutive(count, 0), "fresh ring: every event, oldest first");
+    count = traceRingSnapshot(ring, events, 4);
+    expect(count == 4 && consecutive(count, 6), "fresh ring, max 4: the newest 4");
+
+    resetRing(0);
+    writeCounted(0, 5 * TRACE_CAPACITY + 17);
+    count = traceRingSnapshot(ring, events, TRACE_CAPACITY);
+    expect(count == TRACE_CAPACITY && consecutive(count, 4 * TRACE_CAPACITY + 17),
+           "after 5 laps: the newest TRACE_CAPACITY events");
+
+    // A lap before head wraps to 0, half a lap after
+    resetRing(0u - TRACE_CAPACITY);
+    writeCounted(0, TRACE_CAPACITY + TRACE_CAPACITY / 2);
+    count = traceRingSnapshot(ring, events, TRACE_CAPACITY);
+    expect(count == TRACE_CAPACITY && consecutive(count, TRACE_CAPACITY / 2), "head just past 2^32: nothing lost");
+    expect(((traceRingLap(0) - traceRingLap(0u - 1)) & TRACE_TAG_LAP_MASK) == 1,
+           "laps consecutive across the wrap");
+
+    // A writer stopped after claiming, and one after marking its slot busy
+    // and storing the time; the slots still hold the previous lap's events
+    resetRing(0);
+    writeCounted(0, TRACE_CAPACITY + 100);
+    uint32_t claim = __atomic_fetch_add(&ring.head, 1, __ATOMIC_RELAXED);
+    claim = __atomic_fetch_add(&ring.head, 1, __ATOMIC_RELAXED);
+    uint32_t *slot = ring.slots[claim % TRACE_CAPACITY];
+    slot[1] = TRACE_TAG_BUSY;
+    slot[0] = 0xDEADBEEF;
+    count = traceRingSnapshot(ring, events, TRACE_CAPACITY);
+    expect(count == TRACE_CAPACITY - 2 && consecutive(count, 102),
+           "writes cut off after the claim or the time: skipped");
+
+    // Crash dumps take the newest few
+    count = traceRingSnapshot(ring, events, 256);
+    expect(count == 254 && consecutive(count, TRACE_CAPACITY + 100 - 254), "max 256 with two cut off: the other 254");
+
+    // A lap later the busy writer still has not finished: its slot is left
+    // alone, the other writes land
+    bool busyDropped = true;
+    for (uint32_t i = 0; i < TRACE_CAPACITY; i++)
+    {
+        bool written = traceRingWrite(ring, 2000 + i, 0);
+        busyDropped = busyDropped && written == (i != TRACE_CAPACITY - 1);
+    }
+    expect(busyDropped && slot[1] == TRACE_TAG_BUSY && slot[0] == 0xDEADBEEF,
+           "a lap on, the busy slot's writer is dropped");
+
+    // A writer preempted between its claim and its stores for a whole lap:
+    // the slot already holds the later lap's event, which must survive
+    resetRing(0);
+    writeCounted(0, TRACE_CAPACITY + 1);
+    ring.head = 0; // Replays claim 0 as the stale writer would
+    bool written = traceRingWrite(ring, 0xDEADBEEF, 0);
+    ring.head = TRACE_CAPACITY + 1;
+    count = traceRingSnapshot(ring, events, TRACE_CAPACITY);
+    expect(!written && count == TRACE_CAPACITY && consecutive(count, 1),
+           "a writer a lap behind is dropped, the newer event kept");
+}
+
+// Writer w records its events numbered i as time (w << 28) | i and tag
+// (w << 8) | (i & 0xFF), so a torn event has the wrong pair
+struct Stress
+{
+    uint64_t snapshots;
+    uint64_t events;
+    uint64_t skipped;
+    uint64_t raced;   // Snapshots that skipped a slot a writer had claimed
+    uint64_t dropped; // Writes that found their slot busy or lapped
+    uint64_t torn;
+    uint64_t outOfOrder;
+};
+
+static Stress stress()
+{
+    resetRing(0u - 3 * TRACE_CAPACITY); // Wraps during the run
+    std::atomic<int> running(WRITERS);
+    Stress s = {};
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < WRITERS; w++)
+    {
+        writers.emplace_back(
+            [w, &running, &s]
+            {
+                uint64_t dropped = 0;
+                for (uint32_t i = 0; i < EVENTS_PER_WRITER; i++)
+                    dropped += !traceRingWrite(ring, ((uint32_t)w << 28) | i, ((uint32_t)w << 8) | (i & 0xFF));
+                __atomic_fetch_add(&s.dropped, dropped, __ATOMIC_RELAXED);
+                running--;
+            });
+    }
+
+    static uint32_t snapshot[TRACE_CAPACITY][2];
+    bool last = false;
+    while (!last)
+    {
+        last = running == 0; // One more snapshot once the writers are done
+        size_t count = traceRingSnapshot(ring, snapshot, TRACE_CAPACITY);
+        int64_t previous[WRITERS];
+        std::fill(previous, previous + WRITERS, -1);
+        for (size_t k = 0; k < count; k++)
+        {
+            uint32_t w = snapshot[k][0] >> 28, i = snapshot[k][0] & 0x0FFFFFFF;
+            uint32_t tag = snapshot[k][1];
+            if (w >= WRITERS || ((tag >> 8) & 0xF) != w || (tag & 0xFF) != (i & 0xFF))
+            {
+                s.torn++;
+                continue;
+            }
+            s.outOfOrder += (int64_t)i <= previous[w];
+            previous[w] = i;
+        }
+        s.snapshots++;
+        s.events += count;
+        s.skipped += TRACE_CAPACITY - count;
+        s.raced += count < TRACE_CAPACITY;
+    }
+    for (std::thread &writer : writers)
+        writer.join();
+    return s;
+}
+
+template <typename Record> static void timeEvents(const char *name, Record record)
+{
+    const uint32_t perRound = 1000000;
+    double best = 1e9, bestCycles = 0;
+    for (int round = 0; round < 5; round++)
+    {
+        resetRing(0);
+        auto start = std::chrono::steady_clock::now();
+#ifdef HAVE_CYCLES
+        unsigned long long c0 = __rdtsc();
+#endif
+        for (uint32_t i = 0; i < perRound; i++)
+            record(i);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / perRound;
+#ifdef HAVE_CYCLES
+        double cycles = (double)(__rdtsc() - c0) / perRound;
+#else
+        double cycles = 0;
+#endif
+        if (ns < best)
+        {
+            best = ns;
+            bestCycles = cycles;
+        }
+    }
+    printf("%-34s %6.1f ns/event  %6.1f TSC cycles/event\n", name, best, bestCycles);
+
+    char what[80];
+    snprintf(what, sizeof(what), "%s: under 100 ns/event", name);
+    expect(best < 100, what);
+}
+
+static uint32_t clockUs()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(now.tv_sec * 1000000ull + now.tv_nsec / 1000);
+}
+
+int main()
+{
+    checkSnapshots();
+
+    printf("%d writers x %u events, one reader taking snapshots, %u hardware thread(s)\n", WRITERS,
+           EVENTS_PER_WRITER, std::thread::hardware_concurrency());
+    Stress s = stress();
+    printf("%llu snapshots, %llu events checked; %llu raced a writer, skipping %llu slots in flight or overwritten\n",
+           (unsigned long long)s.snapshots, (unsigned long long)s.events, (unsigned long long)s.raced,
+           (unsigned long long)s.skipped);
+    printf("%llu writes dropped by writers a lap behind\n", (unsigned long long)s.dropped);
+    expect(s.raced > 0, "snapshots taken while writers were mid-lap");
+    expect(s.torn == 0, "no torn events");
+    expect(s.outOfOrder == 0, "each writer's events in order within a snapshot");
+    size_t count = traceRingSnapshot(ring, events, TRACE_CAPACITY);
+    // A dropped write in the last lap leaves its slot to the older event
+    expect(count + s.dropped >= TRACE_CAPACITY &&
+               ring.head == (uint32_t)(WRITERS * EVENTS_PER_WRITER - 3 * TRACE_CAPACITY),
+           "afterwards: the last lap readable, every claim counted");
+
+    timeEvents("ring write", [](uint32_t i) { traceRingWrite(ring, i, i & 0xFFF); });
+    timeEvents("clock read + ring write", [](uint32_t i) { traceRingWrite(ring, clockUs(), i & 0xFFF); });
+
+    printCheckResult();
+    return checkExitCode();
+}
@@ -0,0 +1,330 @@
+// Host checks for src/serial/tx_ring.cpp. First, random pushes and pops
+// against a std::deque model for each drop policy: contents, order,
+// counters and the evictions reported to onEvict must match. Then a slow consumer: telemetry and responses
+// queued as serial_tx.cpp queues them (responses first, telemetry never
+// waits, a response waits for room), drained by a writer whose host reads
+// at the link rate, stops reading for 30 s, then reads slower than frames
+// are produced. The host checks what arrives. From the repository root:
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/tx_ring_check.cpp src/serial/tx_ring.cpp
+//       -o tx_ring_check
+//   ./tx_ring_check
+//
+// The writer here blocks while the host is not reading. On the device the
+// native USB build gives up on a write after 100 ms, so frames written to
+// a stalled port are lost there and counted as sent; the host still sees
+// them as sequence gaps.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <vector>
+#include "check.h"
+#include "serial/tx_ring.h"
+
+static const size_t TELEMETRY_RING_SIZE = 16384;
+static const size_t RESPONSE_RING_SIZE = 4096;
+
+static const char *policyName(TxDropPolicy policy)
+{
+    return policy == TX_DROP_OLDEST ? "drop_oldest" : policy == TX_DROP_NEWEST ? "drop_newest" : "never_drop";
+}
+
+// Every frame carries its id in its first bytes and a fill derived from it
+static void fillFrame(uint8_t *slot, size_t length, uint32_t id)
+{
+    for (size_t i = 0; i < length; i++)
+        slot[i] = (uint8_t)(id * 31 + i);
+    if (length >= sizeof(id))
+        memcpy(slot, &id, sizeof(id));
+}
+
+static bool frameIs(const uint8_t *frame, size_t length, uint32_t id)
+{
+    std::vector<uint8_t> expected(length);
+    fillFrame(expected.data(), length, id);
+    return memcmp(frame, expected.data(), length) == 0;
+}
+
+struct Model
+{
+    uint32_t id;
+    size_t length;
+};
+
+// Frames the ring reported evicting, by id
+static std::deque<uint32_t> evicted;
+
+static void onEvict(const uint8_t *frame, size_t length)
+{
+    uint32_t id = UINT32_MAX;
+    if (length >= sizeof(id))
+        memcpy(&id, frame, sizeof(id));
+    evicted.push_back(id);
+}
+
+static void checkAgainstModel(TxDropPolicy policy, size_t operations, uint32_t seed)
+{
+    static uint8_t storage[4096];
+    TxRing ring;
+    txRingInit(ring, storage, sizeof(storage));
+    ring.onEvict = onEvict;
+    evicted.clear();
+    std::deque<Model> model;
+    uint32_t queued = 0, dropped = 0, nextId = 0;
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> op(0, 99);
+    std::uniform_int_distribution<size_t> small(4, 600), large(600, sizeof(storage));
+    bool matches = true, fitsEmpty = true;
+
+    for (size_t i = 0; i < operations && matches; i++)
+    {
+        if (op(rng) < 55)
+        {
+            size_t length = op(rng) < 5 ? large(rng) : small(rng);
+            bool wasEmpty = ring.frames == 0;
+            uint32_t id = nextId++;
+            uint8_t *slot = txRingPush(ring, length, policy);
+            if (slot)
+            {
+                fillFrame(slot, length, id);
+                queued++;
+                // Drop-oldest evicts from the front until the frame fits
+                while (policy == TX_DROP_OLDEST && model.size() + 1 > ring.frames)
+                {
+                    matches = matches && !evicted.empty() && evicted.front() == model.front().id;
+                    if (!evicted.empty())
+                        evicted.pop_front();
+                    model.pop_front();
+                    dropped++;
+                }
+                model.push_back({id, length});
+            }
+            else
+            {
+                if (policy != TX_NEVER_DROP)
+                    dropped++;
+                fitsEmpty = fitsEmpty && !(wasEmpty && length <= txRingMaxFrame(ring));
+                matches = matches && (policy != TX_DROP_OLDEST || length > txRingMaxFrame(ring));
+            }
+        }
+        else if (!model.empty())
+        {
+            const uint8_t *frame;
+            size_t length = txRingPeek(ring, &frame);
+            matches = matches && length == model.front().length && frameIs(frame, length, model.front().id);
+            txRingPop(ring);
+            model.pop_front();
+        }
+
+        // Every queued frame is where the model says, in order, and every
+        // eviction was reported once
+        matches = matches && evicted.empty() && ring.frames == model.size() && ring.queued == queued && ring.dropped == dropped;
+        size_t bytes = 0;
+        for (size_t k = 0; k < model.size() && matches; k++)
+        {
+            const uint8_t *frame;
+            size_t length = txRingPeekAt(ring, k, &frame);
+            matches = length == model[k].length && frameIs(frame, length, model[k].id);
+            bytes += 2 + length;
+        }
+        matches = matches && ring.used >= bytes && ring.used <= ring.capacity;
+    }
+
+    char what[80];
+    snprintf(what, sizeof(what), "%s: %zu random ops match the model", policyName(policy), operations);
+    expect(matches, what);
+    snprintf(what, sizeof(what), "%s: an empty ring takes any frame up to the max", policyName(policy));
+    expect(fitsEmpty, what);
+}
+
+// Slow consumer
+
+struct Phase
+{
+    const char *name;
+    double untilS;
+    double hostBytesPerSecond; // 0 = not reading
+};
+
+struct Slow
+{
+    uint32_t telemetryMade, telemetryArrived, telemetryGapFrames;
+    uint32_t responsesMade, responsesArrived;
+    bool responsesInOrder, telemetryInOrder;
+    uint32_t responsesWaited;
+    double longestResponseWaitS;
+    double staleAfterStallS; // Age of the first frame the host gets once it reads again
+    uint32_t shedInStall, shedWhileSlow, shedTotal;
+    bool accounting; // Made == sent + dropped + still queued, both rings
+};
+
+static Slow slowConsumer(TxDropPolicy policy)
+{
+    const double tickS = 0.001;
+    const double telemetryEveryS = 0.25; // 4-channel frames at 250 ms
+    const double responseEveryS = 0.5;   // A chatty host
+    const size_t telemetryLength = 415, responseLength = 262;
+    const Phase phases[] = {
+        {"reading", 30, 11520},  // 115200 8N1
+        {"stalled", 60, 0},      // Tab in the background
+        {"slow", 90, 1200},      // Below the ~2.2 KB/s produced
+        {"reading", 120, 11520},
+    };
+
+    static uint8_t telemetryStorage[TELEMETRY_RING_SIZE], responseStorage[RESPONSE_RING_SIZE];
+    TxRing telemetry, responses;
+    txRingInit(telemetry, telemetryStorage, sizeof(telemetryStorage));
+    txRingInit(responses, responseStorage, sizeof(responseStorage));
+
+    struct Header
+    {
+        uint32_t id;
+        double madeS;
+    };
+
+    Slow s = {};
+    s.responsesInOrder = s.telemetryInOrder = true;
+    s.staleAfterStallS = -1;
+    double nextTelemetryS = 0, nextResponseS = 0;
+    double responseWaitingSinceS = -1; // The command task blocked on room
+    uint32_t nextTelemetryExpected = 0, nextResponseExpected = 0;
+
+    // Writer state: the frame being handed to the host
+    std::vector<uint8_t> writing;
+    bool writingResponse = false;
+    double writtenBytes = 0;
+
+    for (double now = 0; now < phases[3].untilS; now += tickS)
+    {
+        const Phase *phase = &phases[0];
+        while (now >= phase->untilS)
+            phase++;
+        uint32_t droppedBefore = telemetry.dropped;
+
+        if (now >= nextTelemetryS)
+        {
+            uint8_t *slot = txRingPush(telemetry, telemetryLength, policy);
+            if (slot)
+            {
+                Header h = {s.telemetryMade, now};
+                memcpy(slot, &h, sizeof(h));
+            }
+            s.telemetryMade++;
+            nextTelemetryS += telemetryEveryS;
+        }
+        if (now >= nextResponseS)
+        {
+            uint8_t *slot = txRingPush(responses, responseLength, TX_NEVER_DROP);
+            if (slot)
+            {
+                Header h = {s.responsesMade, now};
+                memcpy(slot, &h, sizeof(h));
+                s.responsesMade++;
+                if (responseWaitingSinceS >= 0)
+                    s.longestResponseWaitS = std::max(s.longestResponseWaitS, now - responseWaitingSinceS);
+                responseWaitingSinceS = -1;
+                nextResponseS = std::max(nextResponseS + responseEveryS, now); // No catching up
+            }
+            else if (responseWaitingSinceS < 0)
+            {
+                responseWaitingSinceS = now;
+                s.responsesWaited++;
+            }
+        }
+        uint32_t shed = telemetry.dropped - droppedBefore;
+        if (strcmp(phase->name, "stalled") == 0)
+            s.shedInStall += shed;
+        else if (strcmp(phase->name, "slow") == 0)
+            s.shedWhileSlow += shed;
+
+        // Writer: responses first, one frame handed over at a time
+        double budget = phase->hostBytesPerSecond * tickS;
+        while (budget > 0)
+        {
+            if (writing.empty())
+            {
+                TxRing &ring = responses.frames > 0 ? responses : telemetry;
+                const uint8_t *frame;
+                size_t length = txRingPeek(ring, &frame);
+                if (length == 0)
+                    break;
+                writing.assign(frame, frame + length);
+                writingResponse = &ring == &responses;
+                txRingPop(ring);
+                writtenBytes = 0;
+            }
+            double step = std::min(budget, writing.size() - writtenBytes);
+            writtenBytes += step;
+            budget -= step;
+            if (writtenBytes < writing.size())
+                break;
+
+            // The last byte reached the host
+            Header h;
+            memcpy(&h, writing.data(), sizeof(h));
+            if (writingResponse)
+            {
+                responses.sent++;
+                s.responsesInOrder = s.responsesInOrder && h.id == nextResponseExpected;
+                nextResponseExpected = h.id + 1;
+                s.responsesArrived++;
+            }
+            else
+            {
+                telemetry.sent++;
+                s.telemetryInOrder = s.telemetryInOrder && h.id >= nextTelemetryExpected;
+                s.telemetryGapFrames += h.id - nextTelemetryExpected;
+                nextTelemetryExpected = h.id + 1;
+                s.telemetryArrived++;
+                if (s.staleAfterStallS < 0 && now >= phases[1].untilS)
+                    s.staleAfterStallS = now - h.madeS;
+            }
+            writing.clear();
+        }
+    }
+
+    // Drop-newest counts rejected frames that were never queued, so the
+    // identity that holds for both policies is over frames made
+    bool inFlight = !writing.empty();
+    bool telemetryInFlight = inFlight && !writingResponse;
+    s.shedTotal = telemetry.dropped;
+    s.telemetryGapFrames += s.telemetryMade - nextTelemetryExpected - telemetry.frames - telemetryInFlight;
+    s.accounting = s.telemetryMade == telemetry.sent + telemetry.dropped + telemetry.frames + telemetryInFlight &&
+                   s.responsesMade == responses.sent + responses.frames + (inFlight && writingResponse) &&
+                   responses.queued == s.responsesMade && responses.dropped == 0;
+    return s;
+}
+
+int main()
+{
+    for (TxDropPolicy policy : {TX_DROP_OLDEST, TX_DROP_NEWEST, TX_NEVER_DROP})
+        checkAgainstModel(policy, 500000, 39);
+
+    printf("slow consumer: 4 frames/s + 2 responses/s; host reads 0-30 s at 115200, stalls 30-60 s,\n"
+           "reads 1200 B/s 60-90 s, then 115200 again\n");
+    printf("%-12s %9s %9s %9s %9s %10s %11s %12s\n", "policy", "made", "arrived", "shed", "gap frms",
+           "responses", "resp waits", "stale after");
+    for (TxDropPolicy policy : {TX_DROP_OLDEST, TX_DROP_NEWEST})
+    {
+        Slow s = slowConsumer(policy);
+        printf("%-12s %9u %9u %4u+%-4u %9u %5u/%-4u %4u, %4.1f s %9.1f s\n", policyName(policy), s.telemetryMade,
+               s.telemetryArrived, s.shedInStall, s.shedWhileSlow, s.telemetryGapFrames, s.responsesArrived,
+               s.responsesMade, s.responsesWaited, s.longestResponseWaitS, s.staleAfterStallS);
+
+        char what[80];
+        snprintf(what, sizeof(what), "%s: every response arrives, in order", policyName(policy));
+        expect(s.responsesArrived == s.responsesMade && s.responsesInOrder, what);
+        snprintf(what, sizeof(what), "%s: telemetry in order, every shed frame a gap", policyName(policy));
+        expect(s.telemetryInOrder && s.telemetryGapFrames == s.shedTotal &&
+                   s.telemetryArrived + s.telemetryGapFrames <= s.telemetryMade,
+               what);
+        snprintf(what, sizeof(what), "%s: made = sent + dropped + pending, both rings", policyName(policy));
+        expect(s.accounting, what);
+    }
+    printCheckResult();
+    return checkExitCode();
+}
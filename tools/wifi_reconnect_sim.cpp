@@ -0,0 +1,156 @@
+// Drives the reconnect strategy in src/wifi/fast_connect.cpp against a
+// simulated radio and access point, checking which path each scenario
+// takes and how long it needs to reach a usable link. From the
+// repository root:
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/wifi_reconnect_sim.cpp
+//       src/wifi/fast_connect.cpp -o wifi_reconnect_sim
+//   ./wifi_reconnect_sim
+//
+// Radio timings are typical ESP32 figures, not measurements; see below.
+
+#include <cstdio>
+#include <cstring>
+#include "wifi/fast_connect.h"
+
+static const unsigned long ASSOCIATE_MS = 250;  // Auth + 4-way handshake
+static const unsigned long SCAN_MS = 1900;      // Active scan of 13 channels
+static const unsigned long DHCP_MS = 1200;      // DORA plus the ARP probe
+static const unsigned long POLL_MS = 10;        // GOT_IP wakes the loop
+static const unsigned long JOIN_TIMEOUT_MS = 15000;
+
+struct SimAccessPoint
+{
+    bool up;
+    uint8_t bssid[6];
+    uint8_t channel;
+};
+
+struct SimRadio
+{
+    const SimAccessPoint *ap;
+    unsigned long now;
+    enum { OFF, DIRECTED, SCAN } mode;
+    unsigned long startedAt;
+    unsigned long readyAfter; // 0 = will not connect
+    int scans;
+};
+
+static void simBeginDirected(void *context, const WiFiLinkCache &link, bool reuseLease)
+{
+    SimRadio &radio = *(SimRadio *)context;
+    radio.mode = SimRadio::DIRECTED;
+    radio.startedAt = radio.now;
+
+    // A directed probe only finds the AP on the cached channel and BSSID
+    bool found = radio.ap->up && link.channel == radio.ap->channel &&
+                 memcmp(link.bssid, radio.ap->bssid, sizeof(link.bssid)) == 0;
+    radio.readyAfter = found ? ASSOCIATE_MS + (reuseLease ? 0 : DHCP_MS) : 0;
+}
+
+static void simBeginScan(void *context)
+{
+    SimRadio &radio = *(SimRadio *)context;
+    radio.mode = SimRadio::SCAN;
+    radio.startedAt = radio.now;
+    radio.readyAfter = radio.ap->up ? SCAN_MS + ASSOCIATE_MS + DHCP_MS : 0;
+    radio.scans++;
+}
+
+static bool simConnected(void *context)
+{
+    SimRadio &radio = *(SimRadio *)context;
+    return radio.mode != SimRadio::OFF && radio.readyAfter != 0 &&
+           radio.now - radio.startedAt >= radio.readyAfter;
+}
+
+static void simStop(void *context)
+{
+    ((SimRadio *)context)->mode = SimRadio::OFF;
+}
+
+struct Scenario
+{
+    const char *name;
+    bool cached;
+    bool apMoved; // Same SSID, different BSSID and channel
+    bool apUp;
+    uint32_t leaseAgeS;
+    bool sameClockEpoch;
+    FastConnectState expectedState;
+    FastConnectState expectedPath;
+    bool expectedLeaseReuse;
+};
+
+static const SimAccessPoint homeAp = {true, {0x10, 0x20, 0x30, 0x40, 0x50, 0x60}, 6};
+
+static bool runScenario(const Scenario &scenario)
+{
+    SimAccessPoint ap = homeAp;
+    ap.up = scenario.apUp;
+    if (scenario.apMoved)
+    {
+        ap.bssid[5] ^= 0xFF;
+        ap.channel = 11;
+    }
+
+    WiFiLinkCache link = {};
+    const uint32_t nowS = 100000;
+    if (scenario.cached)
+    {
+        link.magic = WIFI_LINK_MAGIC;
+        memcpy(link.bssid, homeAp.bssid, sizeof(link.bssid));
+        link.channel = homeAp.channel;
+        link.ip = 0x2A01A8C0; // 192.168.1.42
+        link.leaseObtainedS = nowS - scenario.leaseAgeS;
+        link.clockEpoch = 7;
+    }
+    uint32_t epoch = scenario.sameClockEpoch ? 7 : 8;
+
+    SimRadio sim = {&ap, 0, SimRadio::OFF, 0, 0, 0};
+    WiFiRadio radio = {&sim, simBeginDirected, simBeginScan, simConnected, simStop};
+
+    FastConnect join;
+    fastConnectStart(join, radio, link, nowS, epoch, sim.now, JOIN_TIMEOUT_MS);
+    FastConnectState state;
+    while ((state = fastConnectPoll(join, radio, sim.now)) != FAST_CONNECT_CONNECTED && state != FAST_CONNECT_FAILED)
+    {
+        sim.now += POLL_MS;
+    }
+
+    bool ok = state == scenario.expectedState &&
+              (state != FAST_CONNECT_CONNECTED ||
+               (join.path == scenario.expectedPath && join.leaseReused == scenario.expectedLeaseReuse));
+
+    const char *path = state != FAST_CONNECT_CONNECTED ? "failed"
+                       : join.path == FAST_CONNECT_SCAN ? "scan"
+                       : join.leaseReused ? "cached_lease"
+                                          : "cached_ap";
+    printf("%-36s %-13s %6lu ms  scans=%d  %s\n", scenario.name, path, sim.now, sim.scans, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+int main()
+{
+    const Scenario scenarios[] = {
+        {"first boot, nothing cached", false, false, true, 0, true,
+         FAST_CONNECT_CONNECTED, FAST_CONNECT_SCAN, false},
+        {"OTA reboot, lease 2 min old", true, false, true, 120, true,
+         FAST_CONNECT_CONNECTED, FAST_CONNECT_DIRECTED, true},
+        {"AP blip, lease 2 h old", true, false, true, 7200, true,
+         FAST_CONNECT_CONNECTED, FAST_CONNECT_DIRECTED, false},
+        {"power cycle, lease from old epoch", true, false, true, 120, false,
+         FAST_CONNECT_CONNECTED, FAST_CONNECT_DIRECTED, false},
+        {"AP replaced or moved channel", true, true, true, 120, true,
+         FAST_CONNECT_CONNECTED, FAST_CONNECT_SCAN, false},
+        {"AP down", true, false, false, 120, true,
+         FAST_CONNECT_FAILED, FAST_CONNECT_IDLE, false},
+    };
+
+    bool ok = true;
+    for (const Scenario &scenario : scenarios)
+        ok = runScenario(scenario) && ok;
+
+    printf("%s\n", ok ? "all scenarios ok" : "scenario mismatch");
+    return ok ? 0 : 1;
+}